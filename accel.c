@@ -1,5 +1,7 @@
 
+#include <float.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <Python.h>
@@ -8,6 +10,44 @@
 #include <datetime.h>
 #endif
 
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define ACCEL_HAVE_READ_ENGINE 1
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#ifdef IORING_FEAT_FAST_POLL
+#define ACCEL_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifdef ACCEL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef ACCEL_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef ACCEL_HAVE_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
 #ifndef PyBUF_WRITE
 #define PyBUF_WRITE 0x200
 #endif
@@ -16,6 +56,27 @@
 #define ACCEL_OUT_STRUCTSEQUENCES 1
 #define ACCEL_OUT_DICTS 2
 #define ACCEL_OUT_NAMEDTUPLES 3
+#define ACCEL_OUT_NUMPY 4
+#define ACCEL_OUT_ARROW 5
+#define ACCEL_OUT_LAZYROWS 6
+#define ACCEL_OUT_ROWS 7
+
+#define ACCEL_COL_OBJECT 0
+#define ACCEL_COL_INT64 1
+#define ACCEL_COL_UINT64 2
+#define ACCEL_COL_FLOAT64 3
+#define ACCEL_COL_DATETIME64 4
+#define ACCEL_COL_DATE64 5
+#define ACCEL_COL_TIMEDELTA64 6
+#define ACCEL_COL_DATE32 7
+#define ACCEL_COL_STRING 8
+#define ACCEL_COL_BINARY 9
+#define ACCEL_COL_SCALED_INT64 10
+#define ACCEL_COL_DECIMAL128 11
+#define ACCEL_COL_DECIMAL256 12
+
+#define ACCEL_COL_MIN_CAPACITY 1024
+#define ACCEL_COL_MIN_DATA_SIZE 65536
 
 #define NUMPY_BOOL 1
 #define NUMPY_INT8 2
@@ -88,17 +149,74 @@
 
 #define MYSQL_SERVER_MORE_RESULTS_EXISTS 8
 
+// Character set number of binary strings
+#define MYSQL_CHARSET_BINARY 63
+
 // 2**24 - 1
 #define MYSQL_MAX_PACKET_LEN 16777215
 
+// Initial size of the socket reader buffer
+#define ACCEL_READER_BUFFER_SIZE (256 * 1024)
+
+// Largest buffer kept around after a big packet has been consumed
+#define ACCEL_READER_MAX_IDLE_SIZE (4 * 1024 * 1024)
+
+// Most segments passed to one vectored write
+#define ACCEL_SEND_MAX_SEGMENTS 64
+
+// Small segments are gathered into writes of this size on TLS connections,
+// which is the largest TLS record
+#define ACCEL_TLS_STAGE_SIZE 16384
+
+#ifdef _WIN32
+typedef SOCKET accel_socket_t;
+#define ACCEL_SOCKET_ERRNO WSAGetLastError()
+#define ACCEL_EINTR WSAEINTR
+#define ACCEL_EAGAIN WSAEWOULDBLOCK
+#define ACCEL_EWOULDBLOCK WSAEWOULDBLOCK
+#define accel_poll WSAPoll
+#define ACCEL_INVALID_SOCKET INVALID_SOCKET
+typedef struct { char *iov_base; size_t iov_len; } accel_iovec_t;
+#else
+typedef int accel_socket_t;
+#define ACCEL_SOCKET_ERRNO errno
+#define ACCEL_EINTR EINTR
+#define ACCEL_EAGAIN EAGAIN
+#define ACCEL_EWOULDBLOCK EWOULDBLOCK
+#define accel_poll poll
+#define ACCEL_INVALID_SOCKET -1
+typedef struct iovec accel_iovec_t;
+#endif
+
+// Negative return codes of the GIL-free socket reader functions
+#define ACCEL_READ_AGAIN -2
+#define ACCEL_READ_ERROR -3
+#define ACCEL_READ_TIMEOUT -4
+#define ACCEL_READ_INTERRUPTED -5
+#define ACCEL_READ_NOMEM -6
+#define ACCEL_READ_SEQUENCE -7
+#define ACCEL_READ_CORRUPT -8
+#define ACCEL_READ_TLS -9
+
+// Algorithms of the compressed protocol
+#define ACCEL_COMPRESSION_NONE 0
+#define ACCEL_COMPRESSION_ZLIB 1
+#define ACCEL_COMPRESSION_ZSTD 2
+
+// Size of the header of a compressed frame
+#define ACCEL_COMPRESSED_HEADER_LEN 7
+
 #define ACCEL_OPTION_TIME_TYPE_TIMEDELTA 0
 #define ACCEL_OPTION_TIME_TYPE_TIME 1
 #define ACCEL_OPTION_JSON_TYPE_STRING 0
 #define ACCEL_OPTION_JSON_TYPE_OBJ 1
 #define ACCEL_OPTION_BIT_TYPE_BYTES 0
 #define ACCEL_OPTION_BIT_TYPE_INT 1
+#define ACCEL_OPTION_DECIMAL_TYPE_DECIMAL 0
+#define ACCEL_OPTION_DECIMAL_TYPE_FLOAT 1
+#define ACCEL_OPTION_DECIMAL_TYPE_SCALED_INT 2
 
-#define CHR2INT1(x) ((x)[1] - '0')
+#define CHR2INT1(x) ((x)[0] - '0')
 #define CHR2INT2(x) ((((x)[0] - '0') * 10) + ((x)[1] - '0'))
 #define CHR2INT3(x) ((((x)[0] - '0') * 1e2) + (((x)[1] - '0') * 10) + ((x)[2] - '0'))
 #define CHR2INT4(x) ((((x)[0] - '0') * 1e3) + (((x)[1] - '0') * 1e2) + (((x)[2] - '0') * 10) + ((x)[3] - '0'))
@@ -168,7 +286,7 @@
     ((s_l) == 23 && \
      CHECK_DATE_STR(s, 10) && \
      ((s)[10] == ' ' || (s)[10] == 'T') && \
-     CHECK_MICRO_TIME_STR((s)+11, 12))
+     CHECK_MILLI_TIME_STR((s)+11, 12))
 
 #define CHECK_ANY_DATETIME_STR(s, s_l) \
     (((s_l) == 19 && CHECK_DATETIME_STR(s, s_l)) || \
@@ -320,9 +438,16 @@
 
 #define CHECKRC(x) if ((x) < 0) goto error;
 
+#define DESTROY(x) do { if (x) { free((void*)x); (x) = NULL; } } while (0)
+
 typedef struct {
     int results_type;
     int parse_json;
+    int decimal_type;
+    int decimal256; // Can the consumer of Arrow results read decimal256 values?
+    int intern_strings; // Intern the values of all string columns?
+    int read_ahead; // Read unbuffered results ahead on a helper thread?
+    int decode_on_fetch; // Keep the rows of buffered results undecoded until they are fetched?
     PyObject *invalid_values;
 } MySQLAccelOptions;
 
@@ -345,9 +470,410 @@ char *_PyUnicode_AsUTF8(PyObject *unicode) {
 }
 
 //
-// Cached int values for date/time components
+// Numbers
+//
+// Length-bounded parsers for the integer and floating point values of the
+// text protocol. They do not depend on the locale or on a NUL terminator.
+// Digits are converted eight at a time using 64-bit SWAR arithmetic on
+// little-endian platforms.
+//
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ACCEL_SWAR_DIGITS 0
+#else
+#define ACCEL_SWAR_DIGITS 1
+#endif
+
+// The fast float path needs double arithmetic without extended precision.
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#define ACCEL_FAST_DOUBLE 1
+#else
+#define ACCEL_FAST_DOUBLE 0
+#endif
+
+//
+// Are all eight bytes of the (little-endian) chunk ASCII digits?
+//
+static inline int is_eight_digits(uint64_t chunk) {
+    return (((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
+
+//
+// Convert eight ASCII digits in a (little-endian) chunk to an integer.
+//
+static inline uint64_t parse_eight_digits(uint64_t chunk) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+    chunk -= 0x3030303030303030ULL;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+    return chunk;
+}
+
+//
+// Read the digits in [s, end) into `*value` and return a pointer to the first
+// non-digit. At most 19 digits are accumulated (which always fit in 64 bits);
+// `*n_digits` is the total number of digits, including any that were skipped.
+//
+static inline const char *read_digits(
+    const char *s,
+    const char *end,
+    uint64_t *value,
+    int *n_digits
+) {
+    const char *start = s;
+    uint64_t v = 0;
+
+#if ACCEL_SWAR_DIGITS
+    while (end - s >= 8 && s - start <= 11) {
+        uint64_t chunk = 0;
+        memcpy(&chunk, s, 8);
+        if (!is_eight_digits(chunk)) break;
+        v = v * 100000000ULL + parse_eight_digits(chunk);
+        s += 8;
+    }
+#endif
+
+    while (s < end && (unsigned char)(*s - '0') < 10) {
+        if (s - start < 19) v = v * 10 + (*s - '0');
+        s++;
+    }
+
+    *value = v;
+    *n_digits = (int)(s - start);
+
+    return s;
+}
+
+//
+// Parse an unsigned integer magnitude. Values that do not fit in 64 bits
+// saturate at UINT64_MAX.
+//
+static uint64_t parse_uint64_digits(const char *s, const char *end) {
+    uint64_t v = 0;
+    int n_digits = 0;
+
+    // ZEROFILL columns have leading zeros.
+    while (s < end && *s == '0') s++;
+
+    const char *digits_end = read_digits(s, end, &v, &n_digits);
+    if (n_digits <= 19) return v;
+    if (n_digits > 20) return UINT64_MAX;
+
+    uint64_t last = digits_end[-1] - '0';
+    if (v > (UINT64_MAX - last) / 10) return UINT64_MAX;
+
+    return v * 10 + last;
+}
+
+//
+// Parse a signed integer like `strtoll`, but bounded by `s_l`.
+//
+static int64_t parse_int64(const char *s, unsigned long long s_l) {
+    const char *end = s + s_l;
+    int negative = 0;
+
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        s++;
+    }
+
+    uint64_t v = parse_uint64_digits(s, end);
+
+    if (negative) {
+        return (v >= (uint64_t)INT64_MAX + 1) ? INT64_MIN : -(int64_t)v;
+    }
+
+    return (v > (uint64_t)INT64_MAX) ? INT64_MAX : (int64_t)v;
+}
+
+//
+// Parse an unsigned integer like `strtoull`, but bounded by `s_l`.
+//
+static uint64_t parse_uint64(const char *s, unsigned long long s_l) {
+    const char *end = s + s_l;
+    int negative = 0;
+
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        s++;
+    }
+
+    uint64_t v = parse_uint64_digits(s, end);
+
+    return (negative) ? (uint64_t)0 - v : v;
+}
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+//
+// Parse a floating point value. Values with at most 19 significant digits
+// whose mantissa and power of ten are both exactly representable are
+// computed with a single correctly rounded multiplication or division
+// (Clinger's fast path). All other values fall back to `strtod`, which
+// requires `s[s_l]` to be writable.
+//
+static double parse_double(char *s, unsigned long long s_l) {
+    const char *p = s;
+    const char *end = s + s_l;
+    uint64_t mantissa = 0;
+    uint64_t fraction = 0;
+    uint64_t exp_value = 0;
+    int n_int_digits = 0;
+    int n_frac_digits = 0;
+    int n_exp_digits = 0;
+    int negative = 0;
+    int exp_negative = 0;
+    int64_t exponent = 0;
+    double out = 0;
+
+    if (!ACCEL_FAST_DOUBLE) goto fallback;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    // Leading zeros are not significant.
+    while (p < end && *p == '0') p++;
+
+    p = read_digits(p, end, &mantissa, &n_int_digits);
+
+    if (p < end && *p == '.') {
+        const char *frac_start = ++p;
+
+        // Leading zeros of the fraction only shift the exponent.
+        if (!n_int_digits) {
+            while (p < end && *p == '0') p++;
+        }
+        int n_zeros = (int)(p - frac_start);
+
+        p = read_digits(p, end, &fraction, &n_frac_digits);
+
+        if (n_int_digits + n_frac_digits > 19) goto fallback;
+
+        for (int i = 0; i < n_frac_digits; i++) mantissa *= 10;
+        mantissa += fraction;
+        n_frac_digits += n_zeros;
+    }
+    else if (n_int_digits > 19) {
+        goto fallback;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exp_negative = *p == '-';
+            p++;
+        }
+        p = read_digits(p, end, &exp_value, &n_exp_digits);
+        if (!n_exp_digits || n_exp_digits > 4) goto fallback;
+        exponent = (exp_negative) ? -(int64_t)exp_value : (int64_t)exp_value;
+    }
+
+    if (p != end) goto fallback;
+
+    exponent -= n_frac_digits;
+
+    if (mantissa > (1ULL << 53) || exponent < -22 || exponent > 22) goto fallback;
+
+    out = (double)mantissa;
+    if (exponent < 0) {
+        out /= exact_powers_of_ten[-exponent];
+    } else {
+        out *= exact_powers_of_ten[exponent];
+    }
+
+    return (negative) ? -out : out;
+
+fallback:
+    {
+        char last = s[s_l];
+        s[s_l] = '\0';
+        out = strtod(s, NULL);
+        s[s_l] = last;
+        return out;
+    }
+}
+
+//
+// Multiply a little-endian array of 64-bit limbs by `mul` and add `add`.
+// Returns -1 if the result does not fit.
+//
+static inline int limbs_mul_add(uint64_t *limbs, int n_limbs, uint64_t mul, uint64_t add) {
+    const uint64_t mask = 0xFFFFFFFFULL;
+    uint64_t carry = add;
+
+    for (int i = 0; i < n_limbs; i++) {
+        uint64_t a_lo = limbs[i] & mask, a_hi = limbs[i] >> 32;
+        uint64_t b_lo = mul & mask, b_hi = mul >> 32;
+        uint64_t p0 = a_lo * b_lo;
+        uint64_t p1 = a_lo * b_hi;
+        uint64_t p2 = a_hi * b_lo;
+        uint64_t mid = (p0 >> 32) + (p1 & mask) + (p2 & mask);
+        uint64_t lo = (p0 & mask) | (mid << 32);
+        uint64_t hi = a_hi * b_hi + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+        lo += carry;
+        hi += lo < carry;
+        limbs[i] = lo;
+        carry = hi;
+    }
+
+    return (carry) ? -1 : 0;
+}
+
+static const uint64_t powers_of_ten[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+    1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL,
+};
+
+//
+// Parse a DECIMAL value into a two's complement integer scaled by
+// 10**scale, stored in `n_limbs` little-endian 64-bit limbs. Digits beyond
+// the scale are truncated. Returns -1 if the value is not a decimal number
+// or does not fit.
+//
+static int parse_scaled_decimal(
+    const char *s,
+    unsigned long long s_l,
+    unsigned long scale,
+    uint64_t *limbs,
+    int n_limbs
+) {
+    const char *end = s + s_l;
+    uint64_t group = 0;
+    int n_group = 0;
+    int n_digits = 0;
+    int negative = 0;
+    int in_fraction = 0;
+    unsigned long n_frac_digits = 0;
+
+    memset(limbs, 0, n_limbs * sizeof(uint64_t));
+
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        s++;
+    }
+
+    // Digits are accumulated in groups of 18, which fit in 64 bits.
+    for (; s < end; s++) {
+        if (*s == '.' && !in_fraction) {
+            in_fraction = 1;
+            continue;
+        }
+        unsigned int digit = (unsigned char)(*s - '0');
+        if (digit > 9) return -1;
+        n_digits++;
+        if (in_fraction && n_frac_digits++ >= scale) continue;
+        group = group * 10 + digit;
+        if (++n_group == 18) {
+            if (limbs_mul_add(limbs, n_limbs, powers_of_ten[18], group) < 0) return -1;
+            group = 0;
+            n_group = 0;
+        }
+    }
+
+    if (!n_digits) return -1;
+
+    for (; n_frac_digits < scale; n_frac_digits++) {
+        group *= 10;
+        if (++n_group == 18) {
+            if (limbs_mul_add(limbs, n_limbs, powers_of_ten[18], group) < 0) return -1;
+            group = 0;
+            n_group = 0;
+        }
+    }
+
+    if (n_group && limbs_mul_add(limbs, n_limbs, powers_of_ten[n_group], group) < 0) {
+        return -1;
+    }
+
+    // Leave room for the sign bit.
+    if (limbs[n_limbs - 1] >> 63) return -1;
+
+    if (negative) {
+        uint64_t carry = 1;
+        for (int i = 0; i < n_limbs; i++) {
+            limbs[i] = ~limbs[i] + carry;
+            carry = carry && !limbs[i];
+        }
+    }
+
+    return 0;
+}
+
+//
+// Create a Python int from a DECIMAL value scaled by 10**scale. Used for
+// values that do not fit in 64 bits.
+//
+static PyObject *scaled_decimal_to_pylong(
+    const char *s,
+    unsigned long long s_l,
+    unsigned long scale
+) {
+    PyObject *py_out = NULL;
+    char *buf = calloc(s_l + scale + 1, 1);
+    if (!buf) return PyErr_NoMemory();
+
+    char *p = buf;
+    const char *end = s + s_l;
+    int in_fraction = 0;
+    unsigned long n_frac_digits = 0;
+
+    for (; s < end; s++) {
+        if (*s == '.' && !in_fraction) {
+            in_fraction = 1;
+            continue;
+        }
+        if (in_fraction && n_frac_digits++ >= scale) continue;
+        *p++ = *s;
+    }
+
+    for (; n_frac_digits < scale; n_frac_digits++) *p++ = '0';
+
+    py_out = PyLong_FromString(buf, NULL, 10);
+    free(buf);
+
+    return py_out;
+}
+
+//
+// End Numbers
+//
+
+#ifdef Py_LIMITED_API
+
+//
+// Cached int values for date/time components. They cover years as well as
+// the other components and are created on first use.
+//
+#define ACCEL_INT_CACHE_SIZE 10000
+
+static PyObject *PyInts[ACCEL_INT_CACHE_SIZE] = {0};
+
+//
+// Return a new reference to an int, using the cache for small values.
 //
-static PyObject *PyInts[62] = {0};
+static PyObject *get_cached_int(long value) {
+    if (value < 0 || value >= ACCEL_INT_CACHE_SIZE) return PyLong_FromLong(value);
+    if (!PyInts[value]) {
+        PyInts[value] = PyLong_FromLong(value);
+        if (!PyInts[value]) return NULL;
+    }
+    Py_INCREF(PyInts[value]);
+    return PyInts[value];
+}
+
+#endif
 
 //
 // Cached string values
@@ -368,27 +894,28 @@ typedef struct {
     PyObject *datetime;
     PyObject *loads;
     PyObject *field_count;
-    PyObject *converters;
-    PyObject *fields;
-    PyObject *flags;
-    PyObject *scale;
-    PyObject *type_code;
-    PyObject *name;
-    PyObject *table_name;
     PyObject *_sock;
     PyObject *settimeout;
     PyObject *_rfile;
     PyObject *read;
+    PyObject *fileno;
     PyObject *x_errno;
     PyObject *_result;
     PyObject *_read_timeout;
     PyObject *_next_seq_id;
+    PyObject *_compression;
+    PyObject *_column_definitions;
     PyObject *rows;
     PyObject *namedtuple;
     PyObject *Row;
     PyObject *Series;
     PyObject *array;
     PyObject *vectorize;
+    PyObject *frombuffer;
+    PyObject *empty;
+    PyObject *ma;
+    PyObject *MaskedArray;
+    PyObject *mask;
 } PyStrings;
 
 static PyStrings PyStr = {0};
@@ -406,6 +933,9 @@ typedef struct {
     PyObject *collections_namedtuple;
     PyObject *numpy_array;
     PyObject *numpy_vectorize;
+    PyObject *numpy_frombuffer;
+    PyObject *numpy_empty;
+    PyObject *numpy_masked_array;
 } PyFunctions;
 
 static PyFunctions PyFunc = {0};
@@ -422,1195 +952,8153 @@ typedef struct {
 static PyObjects PyObj = {0};
 
 //
-// State
+// SocketReader
+//
+// Reads directly from a socket's file descriptor into a native buffer.
+// It replaces the `socket.makefile('rb')` object on non-SSL connections,
+// so the Python packet reader and the row data reader share one buffer
+// and many packets can be parsed out of each `recv` call.
+//
+// When the compressed protocol is in use, frames are received into a
+// separate buffer and inflated straight into the receive buffer, so the
+// packet readers above only ever see the uncompressed packet stream.
+//
+// When built with OpenSSL, the reader can also run TLS on the socket
+// itself, so that records are decrypted straight into the receive buffer.
+// Outgoing data then has to be written with its `sendall` method.
+//
+// A reader created without a socket is fed the received data by the
+// caller instead (e.g., from an asyncio protocol). Its response scanner
+// reports when the complete response to a command has been buffered, so
+// that it can be parsed without ever waiting for more data.
 //
 
-static PyTypeObject *StateType = NULL;
+// States of the response scanner
+#define ACCEL_SCAN_FIRST 0 // First packet of a result
+#define ACCEL_SCAN_COLUMNS 1 // Column definitions and the EOF packet after them
+#define ACCEL_SCAN_ROWS 2 // Rows and the EOF or error packet after them
 
-typedef struct {
+static PyTypeObject *SocketReaderType = NULL;
+
+#ifdef ACCEL_HAVE_READ_ENGINE
+struct ReadEngineObject;
+#endif
+
+typedef struct SocketReaderObject {
     PyObject_HEAD
-    PyObject *py_conn; // Database connection
-    PyObject *py_fields; // List of table fields
-    PyObject *py_rows; // Output object
-    PyObject *py_rfile; // Socket file I/O
-    PyObject *py_read; // File I/O read method
     PyObject *py_sock; // Socket
-    PyObject *py_read_timeout; // Socket read timeout value
-    PyObject *py_settimeout; // Socket settimeout method
-    PyObject **py_converters; // List of converter functions
-    PyObject **py_names; // Column names
-    PyObject *py_names_list; // Python list of column names
-    PyObject *py_default_converters; // Dict of default converters
-    PyObject *py_namedtuple; // Generated namedtuple type
-    PyObject *py_namedtuple_args; // Pre-allocated tuple for namedtuple args
-    PyTypeObject *structsequence; // StructSequence type (like C namedtuple)
-    PyStructSequence_Desc structsequence_desc;
-    PyObject **py_encodings; // Encoding for each column as Python string
-    PyObject **py_invalid_values; // Values to use when invalid data exists in a cell
-    const char **encodings; // Encoding for each column
-    unsigned long long n_cols; // Total number of columns
-    unsigned long long n_rows; // Total number of rows read
-    unsigned long long n_rows_in_batch; // Number of rows in current batch (fetchmany size)
-    unsigned long *type_codes; // Type code for each column
-    unsigned long *flags; // Column flags
-    unsigned long *scales; // Column scales
-    unsigned long *offsets; // Column offsets in buffer
-    unsigned long long next_seq_id; // MySQL packet sequence number
-    MySQLAccelOptions options; // Packet reader options
-    int unbuffered; // Are we running in unbuffered mode?
-    int is_eof; // Have we hit the eof packet yet?
-    struct {
-        PyObject *_next_seq_id;
-        PyObject *rows;
-    } py_str;
-    char *encoding_errors;
-} StateObject;
+    char *buff; // Receive buffer (with one spare byte past buff_size)
+    unsigned long long buff_size; // Usable size of receive buffer
+    unsigned long long start; // Offset of the first unread byte
+    unsigned long long end; // Offset just past the last received byte
+    double timeout; // Read timeout in seconds (negative means no timeout)
+    int busy; // Is a read currently in progress?
+    int compression; // ACCEL_COMPRESSION_* algorithm of incoming frames
+    char *raw; // Compressed frames received from the socket
+    unsigned long long raw_size; // Allocated size of raw
+    unsigned long long raw_start; // Offset of the first unread frame byte
+    unsigned long long raw_end; // Offset just past the last received frame byte
+    unsigned int compressed_seq_id; // Sequence number after the last frame
+#ifdef ACCEL_HAVE_ZSTD
+    ZSTD_DCtx *zstd; // Reusable zstd decompression context
+#endif
+    int scan_state; // ACCEL_SCAN_* state of the response scanner
+    int scan_continued; // Is the next packet part of a multi-packet payload?
+    unsigned long long scan_pos; // Offset of the next unscanned packet from start
+    unsigned long long scan_columns; // Column definitions left to scan
+#ifdef ACCEL_HAVE_OPENSSL
+    SSL_CTX *tls_ctx; // TLS settings of the connection
+    SSL *tls; // TLS session (NULL until start_tls has completed)
+#endif
+    int at_packet; // Does the unread data start with a packet header?
+#ifdef ACCEL_HAVE_READ_ENGINE
+    struct ReadEngineObject *engine; // Engine that receives for the reader, if any
+    PyThread_type_lock engine_ready; // Released by the engine when a receive is done
+    struct SocketReaderObject *engine_prev; // Neighbors in the engine's list
+    struct SocketReaderObject *engine_next; // of receives in progress
+    accel_socket_t engine_sock; // Socket of the receive in progress
+    char *engine_buff; // Where the receive in progress stores its data
+    unsigned long long engine_buff_l; // Room at engine_buff
+    unsigned long long engine_need; // Bytes to receive before waking the reader
+    char *engine_packet; // Header of the packet being received, or NULL
+    unsigned long long engine_got; // Bytes received so far
+    int engine_state; // ACCEL_ENGINE_* state of the receive
+    int engine_err; // Error code of the finished receive
+#endif
+} SocketReaderObject;
+
+#ifdef ACCEL_HAVE_READ_ENGINE
+static void engine_detach(SocketReaderObject *reader);
+static long long engine_recv_nogil(
+    SocketReaderObject *self,
+    accel_socket_t sock,
+    char *buff,
+    unsigned long long buff_l,
+    unsigned long long need,
+    char *packet,
+    int *err
+);
+#endif
 
-static void read_options(MySQLAccelOptions *options, PyObject *dict);
+static void SocketReader_dealloc(SocketReaderObject *self) {
+    DESTROY(self->buff);
+    DESTROY(self->raw);
+#ifdef ACCEL_HAVE_ZSTD
+    if (self->zstd) { ZSTD_freeDCtx(self->zstd); self->zstd = NULL; }
+#endif
+#ifdef ACCEL_HAVE_OPENSSL
+    if (self->tls) { SSL_free(self->tls); self->tls = NULL; }
+    if (self->tls_ctx) { SSL_CTX_free(self->tls_ctx); self->tls_ctx = NULL; }
+#endif
+#ifdef ACCEL_HAVE_READ_ENGINE
+    if (self->engine) engine_detach(self);
+#endif
+    Py_CLEAR(self->py_sock);
+    PyObject_Del(self);
+}
 
-#define DESTROY(x) do { if (x) { free((void*)x); (x) = NULL; } } while (0)
+static int SocketReader_init(SocketReaderObject *self, PyObject *args, PyObject *kwds) {
+    PyObject *py_sock = NULL;
+    PyObject *py_timeout = Py_None;
+    char *keywords[] = {"sock", "timeout", NULL};
 
-static void State_clear_fields(StateObject *self) {
-    if (!self) return;
-    DESTROY(self->offsets);
-    DESTROY(self->scales);
-    DESTROY(self->flags);
-    DESTROY(self->type_codes);
-    DESTROY(self->encodings);
-    DESTROY(self->structsequence_desc.fields);
-    DESTROY(self->encoding_errors);
-    if (self->py_converters) {
-        for (unsigned long i = 0; i < self->n_cols; i++) {
-            Py_CLEAR(self->py_converters[i]);
-        }
-        DESTROY(self->py_converters);
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", keywords, &py_sock, &py_timeout)) {
+        return -1;
     }
-    if (self->py_names) {
-        for (unsigned long i = 0; i < self->n_cols; i++) {
-            Py_CLEAR(self->py_names[i]);
-        }
-        DESTROY(self->py_names);
+
+    self->timeout = -1.0;
+    if (py_timeout != Py_None) {
+        self->timeout = PyFloat_AsDouble(py_timeout);
+        if (self->timeout == -1.0 && PyErr_Occurred()) return -1;
     }
-    if (self->py_encodings) {
-        for (unsigned long i = 0; i < self->n_cols; i++) {
-            Py_CLEAR(self->py_encodings[i]);
-        }
-        DESTROY(self->py_encodings);
+
+    DESTROY(self->buff);
+    self->buff = malloc(ACCEL_READER_BUFFER_SIZE + 1);
+    if (!self->buff) { PyErr_NoMemory(); return -1; }
+    self->buff_size = ACCEL_READER_BUFFER_SIZE;
+    self->start = 0;
+    self->end = 0;
+    self->compression = ACCEL_COMPRESSION_NONE;
+    self->raw_start = 0;
+    self->raw_end = 0;
+    self->compressed_seq_id = 0;
+    self->scan_state = ACCEL_SCAN_FIRST;
+    self->scan_continued = 0;
+    self->scan_pos = 0;
+    self->scan_columns = 0;
+
+    Py_CLEAR(self->py_sock);
+    self->py_sock = py_sock;
+    Py_INCREF(self->py_sock);
+
+    return 0;
+}
+
+static int reader_get_socket(SocketReaderObject *self, accel_socket_t *sock) {
+    if (self->py_sock == Py_None) {
+        PyErr_SetString(PyExc_BlockingIOError, "not enough data has been fed to the reader");
+        return -1;
     }
-    if (self->py_invalid_values) {
-        for (unsigned long i = 0; i < self->n_cols; i++) {
-            Py_CLEAR(self->py_invalid_values[i]);
+
+    PyObject *py_fileno = PyObject_CallMethodObjArgs(self->py_sock, PyStr.fileno, NULL);
+    if (!py_fileno) return -1;
+
+    long long fd = PyLong_AsLongLong(py_fileno);
+    Py_DECREF(py_fileno);
+    if (fd == -1 && PyErr_Occurred()) return -1;
+
+    if (fd < 0) {
+        PyErr_SetString(PyExc_OSError, "socket is closed");
+        return -1;
+    }
+
+    *sock = (accel_socket_t)fd;
+    return 0;
+}
+
+//
+// Convert a timeout in seconds to the milliseconds of poll(), rounding up
+// so that a positive timeout never becomes a non-blocking poll.
+//
+static int timeout_ms(double timeout) {
+    if (timeout < 0) return -1;
+    if (timeout * 1000 >= INT32_MAX) return INT32_MAX;
+    return (int)ceil(timeout * 1000);
+}
+
+//
+// Receive data from a socket, waiting at most `timeout` seconds for it
+// to arrive. This is called without the GIL.
+//
+// Returns the number of bytes received (0 at end of stream), -1 on error
+// with the error code in `err`, or -2 if the timeout expired.
+//
+static long long socket_recv(
+    accel_socket_t sock,
+    char *buff,
+    unsigned long long buff_l,
+    double timeout,
+    int *err
+) {
+    struct pollfd pfd;
+    long long rc = 0;
+    int wait = timeout >= 0;
+
+    if (buff_l > INT32_MAX) buff_l = INT32_MAX;
+
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+
+    while (1) {
+        if (wait) {
+            pfd.revents = 0;
+            rc = accel_poll(&pfd, 1, timeout_ms(timeout));
+            if (rc == 0) return -2;
+            if (rc < 0) { *err = ACCEL_SOCKET_ERRNO; return -1; }
         }
-        DESTROY(self->py_invalid_values);
+
+        rc = recv(sock, buff, (int)buff_l, 0);
+        if (rc >= 0) return rc;
+
+        *err = ACCEL_SOCKET_ERRNO;
+        if (*err != ACCEL_EAGAIN && *err != ACCEL_EWOULDBLOCK) return -1;
+
+        // Non-blocking socket with no data yet
+        wait = 1;
     }
-    Py_CLEAR(self->structsequence);
-    Py_CLEAR(self->py_namedtuple);
-    Py_CLEAR(self->py_namedtuple_args);
-    Py_CLEAR(self->py_names_list);
-    Py_CLEAR(self->py_default_converters);
-    Py_CLEAR(self->py_settimeout);
-    Py_CLEAR(self->py_read_timeout);
-    Py_CLEAR(self->py_sock);
-    Py_CLEAR(self->py_read);
-    Py_CLEAR(self->py_rfile);
-    Py_CLEAR(self->py_rows);
-    Py_CLEAR(self->py_fields);
-    Py_CLEAR(self->py_conn);
 }
 
-static void State_dealloc(StateObject *self) {
-    State_clear_fields(self);
-    PyObject_Del(self);
+#ifdef ACCEL_HAVE_OPENSSL
+
+//
+// Wait until the socket is ready for the TLS operation that returned
+// `ssl_err`. This is called without the GIL.
+//
+// Returns 0 when ready, -1 on error with the error code in `err`, or -2
+// if the timeout expired.
+//
+static int tls_wait(accel_socket_t sock, int ssl_err, double timeout, int *err) {
+    struct pollfd pfd;
+    int rc = 0;
+
+    pfd.fd = sock;
+    pfd.events = (ssl_err == SSL_ERROR_WANT_WRITE) ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+
+    rc = accel_poll(&pfd, 1, timeout_ms(timeout));
+    if (rc == 0) return -2;
+    if (rc < 0) { *err = ACCEL_SOCKET_ERRNO; return -1; }
+    return 0;
 }
 
-static int State_init(StateObject *self, PyObject *args, PyObject *kwds) {
+//
+// Classify a failed TLS operation. This is called without the GIL.
+//
+// Returns 0 to retry once `tls_wait` succeeds, 1 at end of stream, -1 on
+// a socket error (with its code in `err`), or -3 on a TLS error (with the
+// OpenSSL error code in `err`).
+//
+static int tls_check_error(SSL *tls, int rc, int *ssl_err, int *err) {
+    *ssl_err = SSL_get_error(tls, rc);
+
+    switch (*ssl_err) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        return 0;
+    case SSL_ERROR_ZERO_RETURN:
+        return 1;
+    case SSL_ERROR_SYSCALL:
+        *err = ACCEL_SOCKET_ERRNO;
+        // The server closed the connection without a TLS alert.
+        if (*err == 0 && ERR_peek_error() == 0) return 1;
+        if (*err != 0) return -1;
+        break;
+    }
+
+    *err = (int)(ERR_peek_last_error() & 0x7FFFFFFF);
+    return -3;
+}
+
+//
+// Receive and decrypt data, waiting at most `timeout` seconds for it
+// to arrive. This is called without the GIL.
+//
+// Returns the number of bytes received (0 at end of stream), -1 on a
+// socket error, -2 if the timeout expired, or -3 on a TLS error, with
+// the error code in `err`.
+//
+static long long tls_recv(
+    SSL *tls,
+    accel_socket_t sock,
+    char *buff,
+    unsigned long long buff_l,
+    double timeout,
+    int *err
+) {
+    size_t n = 0;
+    int ssl_err = 0;
     int rc = 0;
-    PyObject *py_res = NULL;
-    PyObject *py_converters = NULL;
-    PyObject *py_options = NULL;
-    PyObject *py_args = NULL;
-    unsigned long long requested_n_rows = 0;
 
-    if (!PyArg_ParseTuple(args, "OK", &py_res, &requested_n_rows)) {
-        return -1;
+    if (buff_l > INT32_MAX) buff_l = INT32_MAX;
+
+    // Apply the timeout to blocking sockets as well.
+    if (timeout >= 0 && !SSL_has_pending(tls)) {
+        rc = tls_wait(sock, SSL_ERROR_WANT_READ, timeout, err);
+        if (rc < 0) return rc;
     }
 
-    py_options = PyObject_GetAttr(py_res, PyStr.options);
-    if (!py_options) {
-        Py_INCREF(Py_None);
-        py_options = Py_None;
+    while (1) {
+        ERR_clear_error();
+        if (SSL_read_ex(tls, buff, (size_t)buff_l, &n) > 0) return (long long)n;
+
+        rc = tls_check_error(tls, 0, &ssl_err, err);
+        if (rc == 1) return 0;
+        if (rc < 0) return rc;
+
+        rc = tls_wait(sock, ssl_err, timeout, err);
+        if (rc < 0) return rc;
     }
+}
 
-    if (PyDict_Check(py_options)) {
-        self->py_default_converters = PyDict_GetItemString(py_options, "default_converters");
-        if (self->py_default_converters && !PyDict_Check(self->py_default_converters)) {
-            self->py_default_converters = NULL;
+#endif
+
+//
+// Receive data for the reader, decrypting it if TLS is in use, or through
+// the reader's engine if it has one. At least one byte is received, but
+// the engine keeps receiving until `need` bytes have arrived, as well as
+// the rest of the packet whose header is at `packet` (if not NULL). This
+// is called without the GIL.
+//
+// Returns the number of bytes received (0 at end of stream), or one of the
+// negative ACCEL_READ_* codes (with the error code in `err`).
+//
+static long long reader_recv_nogil(
+    SocketReaderObject *self,
+    accel_socket_t sock,
+    char *buff,
+    unsigned long long buff_l,
+    unsigned long long need,
+    char *packet,
+    int *err
+) {
+    long long rc = 0;
+
+#ifdef ACCEL_HAVE_READ_ENGINE
+    if (self->engine) rc = engine_recv_nogil(self, sock, buff, buff_l, need, packet, err);
+    else
+#endif
+#ifdef ACCEL_HAVE_OPENSSL
+    if (self->tls) rc = tls_recv(self->tls, sock, buff, buff_l, self->timeout, err);
+    else
+#endif
+    rc = socket_recv(sock, buff, buff_l, self->timeout, err);
+
+    if (rc >= 0) return rc;
+    if (rc == -2) return ACCEL_READ_TIMEOUT;
+    if (rc == -3) return ACCEL_READ_TLS;
+    if (*err == ACCEL_EINTR) return ACCEL_READ_INTERRUPTED;
+    return ACCEL_READ_ERROR;
+}
+
+//
+// Receive the next compressed frame and append its uncompressed payload to
+// the receive buffer. Frames that are already in the raw buffer are used
+// first. This does not use the Python API, so it can be called without the
+// GIL. If `sock` is ACCEL_INVALID_SOCKET, nothing is received and
+// ACCEL_READ_AGAIN is returned when more data is needed.
+//
+// Returns the number of bytes appended (0 at end of stream), or one of the
+// negative ACCEL_READ_* codes (with the socket error code in `err`).
+//
+static long long reader_inflate_nogil(
+    SocketReaderObject *self,
+    accel_socket_t sock,
+    int *err
+) {
+    unsigned char *header = NULL;
+    unsigned long long frame_l = 0;
+    unsigned long long payload_l = 0;
+    unsigned long long uncompressed_l = 0;
+    unsigned long long avail = 0;
+    unsigned long long needed = 0;
+    unsigned long long out_l = 0;
+    unsigned int seq_id = 0;
+    char *payload = NULL;
+    long long rc = 0;
+
+    while (1) {
+        // Wait for a complete frame.
+        avail = self->raw_end - self->raw_start;
+        needed = ACCEL_COMPRESSED_HEADER_LEN;
+        if (avail >= ACCEL_COMPRESSED_HEADER_LEN) {
+            header = (unsigned char*)self->raw + self->raw_start;
+            payload_l = header[0] + (header[1] << 8) + (header[2] << 16);
+            needed += payload_l;
         }
-        Py_XINCREF(self->py_default_converters);
-        PyObject *py_unbuffered = PyDict_GetItemString(py_options, "unbuffered");
-        if (py_unbuffered && PyObject_IsTrue(py_unbuffered)) {
-            self->unbuffered = 1;
+
+        if (avail < needed) {
+            if (sock == ACCEL_INVALID_SOCKET) return ACCEL_READ_AGAIN;
+
+            if (self->raw_start > 0) {
+                memmove(self->raw, self->raw + self->raw_start, avail);
+                self->raw_start = 0;
+                self->raw_end = avail;
+            }
+
+            if (self->raw_size < needed) {
+                unsigned long long new_size = self->raw_size * 2;
+                if (new_size < ACCEL_READER_BUFFER_SIZE) new_size = ACCEL_READER_BUFFER_SIZE;
+                if (new_size < needed) new_size = needed;
+                char *new_raw = realloc(self->raw, new_size);
+                if (!new_raw) return ACCEL_READ_NOMEM;
+                self->raw = new_raw;
+                self->raw_size = new_size;
+            }
+
+            rc = reader_recv_nogil(self, sock, self->raw + self->raw_end,
+                                   self->raw_size - self->raw_end, needed - avail,
+                                   NULL, err);
+            if (rc > 0) { self->raw_end += rc; continue; }
+            return rc;
         }
-        PyObject *py_encoding_errors = PyDict_GetItemString(py_options, "encoding_errors");
-        if (py_encoding_errors) {
-            self->encoding_errors = _PyUnicode_AsUTF8(py_encoding_errors);
-            if (!self->encoding_errors) goto error;
+
+        uncompressed_l = header[4] + (header[5] << 8) + (header[6] << 16);
+        seq_id = header[3];
+        payload = self->raw + self->raw_start + ACCEL_COMPRESSED_HEADER_LEN;
+        frame_l = ACCEL_COMPRESSED_HEADER_LEN + payload_l;
+
+        // An uncompressed length of zero means the payload was sent as is.
+        out_l = (uncompressed_l) ? uncompressed_l : payload_l;
+
+        if (self->buff_size - self->end < out_l) {
+            unsigned long long new_size = self->buff_size * 2;
+            if (new_size < self->end + out_l) new_size = self->end + out_l;
+            char *new_buff = realloc(self->buff, new_size + 1);
+            if (!new_buff) return ACCEL_READ_NOMEM;
+            self->buff = new_buff;
+            self->buff_size = new_size;
+        }
+
+        if (!uncompressed_l) {
+            memcpy(self->buff + self->end, payload, payload_l);
+        }
+#ifdef ACCEL_HAVE_ZLIB
+        else if (self->compression == ACCEL_COMPRESSION_ZLIB) {
+            uLongf dest_l = (uLongf)uncompressed_l;
+            if (uncompress((Bytef*)self->buff + self->end, &dest_l,
+                           (const Bytef*)payload, (uLong)payload_l) != Z_OK ||
+                    dest_l != uncompressed_l) {
+                return ACCEL_READ_CORRUPT;
+            }
+        }
+#endif
+#ifdef ACCEL_HAVE_ZSTD
+        else if (self->compression == ACCEL_COMPRESSION_ZSTD) {
+            size_t dest_l = ZSTD_decompressDCtx(self->zstd, self->buff + self->end,
+                                                uncompressed_l, payload, payload_l);
+            if (ZSTD_isError(dest_l) || dest_l != uncompressed_l) {
+                return ACCEL_READ_CORRUPT;
+            }
+        }
+#endif
+        else {
+            return ACCEL_READ_CORRUPT;
         }
+
+        self->raw_start += frame_l;
+        self->compressed_seq_id = (seq_id + 1) % 256;
+        self->end += out_l;
+
+        // Empty frames are skipped, since zero means end of stream.
+        if (out_l > 0) return (long long)out_l;
     }
+}
 
-    if (!self->encoding_errors) {
-        self->encoding_errors = calloc(7, 1);
-        if (!self->encoding_errors) goto error;
-        memcpy(self->encoding_errors, "strict", 6);
+//
+// Make sure that at least `n` unread bytes are in the buffer. This does not
+// use the Python API, so it can be called without the GIL. If `sock` is
+// ACCEL_INVALID_SOCKET, nothing is received and ACCEL_READ_AGAIN is
+// returned when more data is needed.
+//
+// Returns the number of unread bytes available, which is only less
+// than `n` if the server closed the connection, or one of the negative
+// ACCEL_READ_* codes (with the socket error code in `err`).
+//
+static long long reader_fill_nogil(
+    SocketReaderObject *self,
+    accel_socket_t sock,
+    unsigned long long n,
+    int *err
+) {
+    unsigned long long avail = self->end - self->start;
+    long long rc = 0;
+
+    if (avail >= n) return (long long)avail;
+    if (sock == ACCEL_INVALID_SOCKET && !self->compression) return ACCEL_READ_AGAIN;
+
+    // Give back memory from a previous large packet.
+    if (avail == 0 && self->buff_size > ACCEL_READER_MAX_IDLE_SIZE
+            && n <= ACCEL_READER_BUFFER_SIZE) {
+        char *new_buff = realloc(self->buff, ACCEL_READER_BUFFER_SIZE + 1);
+        if (new_buff) {
+            self->buff = new_buff;
+            self->buff_size = ACCEL_READER_BUFFER_SIZE;
+        }
     }
 
-    if (self->unbuffered) {
-        PyObject *unbuffered_active = PyObject_GetAttr(py_res, PyStr.unbuffered_active);
-        if (!unbuffered_active || !PyObject_IsTrue(unbuffered_active)) {
-            Py_XDECREF(unbuffered_active);
-            goto error;
+    // Move unread data to the front of the buffer.
+    if (self->start > 0) {
+        memmove(self->buff, self->buff + self->start, avail);
+        self->start = 0;
+        self->end = avail;
+    }
+
+    if (self->buff_size < n) {
+        unsigned long long new_size = self->buff_size * 2;
+        if (new_size < n) new_size = n;
+        char *new_buff = realloc(self->buff, new_size + 1);
+        if (!new_buff) return ACCEL_READ_NOMEM;
+        self->buff = new_buff;
+        self->buff_size = new_size;
+    }
+
+    while (self->end - self->start < n) {
+        if (self->compression) {
+            rc = reader_inflate_nogil(self, sock, err);
+            if (rc > 0) continue;
+            if (rc == 0) break;
+            return rc;
         }
-        Py_XDECREF(unbuffered_active);
+        rc = reader_recv_nogil(self, sock, self->buff + self->end,
+                               self->buff_size - self->end,
+                               n - (self->end - self->start),
+                               self->at_packet ? self->buff + self->start : NULL, err);
+        if (rc > 0) self->end += rc;
+        else if (rc == 0) break;
+        else return rc;
     }
 
-    // Retrieve type codes for each column.
-    PyObject *py_field_count = PyObject_GetAttr(py_res, PyStr.field_count);
-    if (!py_field_count) goto error;
-    self->n_cols = PyLong_AsUnsignedLong(py_field_count);
-    Py_XDECREF(py_field_count);
+    return (long long)(self->end - self->start);
+}
+
+//
+// Set the exception for a negative return code of reader_fill_nogil.
+//
+static void reader_set_error(long long rc, int err) {
+    if (rc == ACCEL_READ_NOMEM) {
+        PyErr_NoMemory();
+    }
+    else if (rc == ACCEL_READ_TIMEOUT) {
+        PyErr_SetString(PyExc_TimeoutError, "timed out");
+    }
+    else if (rc == ACCEL_READ_CORRUPT) {
+        PyErr_SetString(PyExc_OSError, "malformed compressed packet");
+    }
+#ifdef ACCEL_HAVE_OPENSSL
+    else if (rc == ACCEL_READ_TLS) {
+        const char *reason = ERR_reason_error_string((unsigned long)err);
+        PyErr_Format(PyExc_OSError, "TLS error: %s", reason ? reason : "unknown error");
+    }
+#endif
+    else {
+#ifdef _WIN32
+        PyErr_SetFromWindowsErr(err);
+#else
+        errno = err;
+        PyErr_SetFromErrno(PyExc_OSError);
+#endif
+    }
+}
 
-    py_converters = PyObject_GetAttr(py_res, PyStr.converters);
-    if (!py_converters) goto error;
+//
+// Make sure that at least `n` unread bytes are in the buffer, releasing
+// the GIL while waiting for the socket.
+//
+// Returns the number of unread bytes available, which is only less
+// than `n` if the server closed the connection. Returns -1 with an
+// exception set on error.
+//
+static long long reader_fill(SocketReaderObject *self, unsigned long long n) {
+    accel_socket_t sock;
+    long long rc = 0;
+    int err = 0;
 
-    self->py_converters = calloc(self->n_cols, sizeof(PyObject*));
-    if (!self->py_converters) goto error;
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent reads from one connection are not allowed");
+        return -1;
+    }
 
-    self->type_codes = calloc(self->n_cols, sizeof(unsigned long));
-    if (!self->type_codes) goto error;
+    if (self->end - self->start >= n) return (long long)(self->end - self->start);
 
-    self->flags = calloc(self->n_cols, sizeof(unsigned long));
-    if (!self->flags) goto error;
+    if (!self->buff) {
+        PyErr_SetString(PyExc_ValueError, "socket reader is not initialized");
+        return -1;
+    }
 
-    self->scales = calloc(self->n_cols, sizeof(unsigned long));
-    if (!self->scales) goto error;
+    if (reader_get_socket(self, &sock) < 0) return -1;
 
-    self->encodings = calloc(self->n_cols, sizeof(char*));
-    if (!self->encodings) goto error;
+    self->busy = 1;
 
-    self->py_encodings = calloc(self->n_cols, sizeof(char*));
-    if (!self->py_encodings) goto error;
+    while (1) {
+        Py_BEGIN_ALLOW_THREADS
+        rc = reader_fill_nogil(self, sock, n, &err);
+        Py_END_ALLOW_THREADS
 
-    self->py_invalid_values = calloc(self->n_cols, sizeof(char*));
-    if (!self->py_invalid_values) goto error;
+        if (rc != ACCEL_READ_INTERRUPTED) break;
+        if (PyErr_CheckSignals() < 0) { rc = -1; goto exit; }
+    }
 
-    self->py_names = calloc(self->n_cols, sizeof(PyObject*));
-    if (!self->py_names) goto error;
+    if (rc < 0) {
+        reader_set_error(rc, err);
+        rc = -1;
+    }
 
-    self->py_fields = PyObject_GetAttr(py_res, PyStr.fields);
-    if (!self->py_fields) goto error;
+exit:
+    self->busy = 0;
+    return rc;
+}
 
-    self->py_names_list = PyList_New(self->n_cols);
-    if (!self->py_names_list) goto error;
+static PyObject *SocketReader_read(SocketReaderObject *self, PyObject *args) {
+    PyObject *py_out = NULL;
+    Py_ssize_t n = 0;
+    long long avail = 0;
 
-    for (unsigned long i = 0; i < self->n_cols; i++) {
-        // Get type codes.
-        PyObject *py_field = PyList_GetItem(self->py_fields, i);
-        if (!py_field) goto error;
+    if (!PyArg_ParseTuple(args, "n", &n)) return NULL;
 
-        PyObject *py_flags = PyObject_GetAttr(py_field, PyStr.flags);
-        if (!py_flags) goto error;
-        self->flags[i] = PyLong_AsUnsignedLong(py_flags);
-        Py_XDECREF(py_flags);
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "number of bytes to read must be positive");
+        return NULL;
+    }
 
-        PyObject *py_scale = PyObject_GetAttr(py_field, PyStr.scale);
-        if (!py_scale) goto error;
-        self->scales[i] = PyLong_AsUnsignedLong(py_scale);
-        Py_XDECREF(py_scale);
+    avail = reader_fill(self, n);
+    if (avail < 0) return NULL;
+    if (avail > n) avail = n;
 
-        PyObject *py_field_type = PyObject_GetAttr(py_field, PyStr.type_code);
-        if (!py_field_type) goto error;
-        self->type_codes[i] = PyLong_AsUnsignedLong(py_field_type);
-        PyObject *py_default_converter = (self->py_default_converters) ?
-                      PyDict_GetItem(self->py_default_converters, py_field_type) : NULL;
-        PyObject *py_invalid_value = (self->options.invalid_values) ?
-                      PyDict_GetItem(self->options.invalid_values, py_field_type) : NULL;
-        Py_XDECREF(py_field_type);
-
-        // Get field name.
-        PyObject *py_field_name = PyObject_GetAttr(py_field, PyStr.name);
-        if (!py_field_name) goto error;
-
-        // Make sure field name is not a duplicate.
-        int dup_found = 0;
-        for (unsigned long j = 0; j < i; j++) {
-            if (PyUnicode_Compare(self->py_names[j], py_field_name) == 0) {
-                dup_found = 1;
-                break;
-            }
+    py_out = PyBytes_FromStringAndSize(self->buff + self->start, avail);
+    if (py_out) self->start += avail;
+
+    return py_out;
+}
+
+//
+// Framing state of a packet stream: the expected sequence number of the
+// next packet and a buffer for stitching multi-packet payloads together.
+// The sequence numbers of packets carried in compressed frames are not
+// contiguous (the server resyncs them to the frame sequence number on
+// every flush), so they are only checked on uncompressed streams.
+//
+typedef struct {
+    unsigned long long next_seq_id; // MySQL packet sequence number
+    int compressed; // Is the stream carried in compressed frames?
+    char *arena; // Buffer for stitching multi-packet payloads
+    unsigned long long arena_size; // Allocated size of arena
+} PacketFramer;
+
+//
+// Grow the framer's arena so that it can hold at least `size` bytes, plus
+// a spare byte for NUL-terminating the last value of a row. This does not
+// use the Python API, so it can be called without the GIL.
+//
+static int framer_reserve_arena(PacketFramer *framer, unsigned long long size) {
+    char *arena = NULL;
+    unsigned long long arena_size = framer->arena_size;
+
+    if (size <= arena_size) return 0;
+
+    if (arena_size == 0) arena_size = 1024;
+    while (arena_size < size) arena_size *= 2;
+
+    arena = realloc(framer->arena, arena_size + 1);
+    if (!arena) return -1;
+
+    framer->arena = arena;
+    framer->arena_size = arena_size;
+
+    return 0;
+}
+
+//
+// Frame the next packet payload out of the native socket reader's buffer,
+// receiving more data as needed. Multi-packet payloads are stitched
+// together in the arena, `*arena_l` bytes of which have been filled by
+// previous calls. A packet is only consumed once it has been received in
+// full, so the call can be repeated after ACCEL_READ_AGAIN or
+// ACCEL_READ_INTERRUPTED. This does not use the Python API, so it can be
+// called without the GIL.
+//
+// Returns 0 on success, 1 if the server closed the connection, or one of
+// the negative ACCEL_READ_* codes.
+//
+static int frame_packet_nogil(
+    SocketReaderObject *reader,
+    PacketFramer *framer,
+    accel_socket_t sock,
+    char **data,
+    unsigned long long *data_l,
+    unsigned long long *arena_l,
+    uint8_t *packet_number,
+    int *err
+) {
+    unsigned long long bytes_to_read = 0;
+    unsigned char *header = NULL;
+    char *payload = NULL;
+    long long avail = 0;
+
+    while (1) {
+        reader->at_packet = 1;
+        avail = reader_fill_nogil(reader, sock, 4, err);
+        reader->at_packet = 0;
+        if (avail < 0) return (int)avail;
+        if (avail < 4) return 1;
+
+        header = (unsigned char*)reader->buff + reader->start;
+        bytes_to_read = header[0] + (header[1] << 8) + (header[2] << 16);
+        *packet_number = header[3];
+
+        if (!framer->compressed && *packet_number != framer->next_seq_id) {
+            return ACCEL_READ_SEQUENCE;
         }
-        if (dup_found) {
-            PyObject *py_table_name = PyObject_GetAttr(py_field, PyStr.table_name);
-            self->py_names[i] = PyUnicode_FromFormat("%U.%U", py_table_name, py_field_name);
-            Py_XDECREF(py_table_name);
-            if (!self->py_names[i]) goto error;
-        } else {
-            self->py_names[i] = py_field_name;
+
+        avail = reader_fill_nogil(reader, sock, 4 + bytes_to_read, err);
+        if (avail < 0) return (int)avail;
+        if ((unsigned long long)avail < 4 + bytes_to_read) return 1;
+
+        payload = reader->buff + reader->start + 4;
+        reader->start += 4 + bytes_to_read;
+        framer->next_seq_id = (*packet_number + 1) % 256;
+
+        // Common case: a single packet is parsed in place.
+        if (*arena_l == 0 && bytes_to_read < MYSQL_MAX_PACKET_LEN) {
+            *data = payload;
+            *data_l = bytes_to_read;
+            return 0;
         }
 
-        Py_INCREF(self->py_names[i]);  // Extra ref since SetItem steals one
-        rc = PyList_SetItem(self->py_names_list, i, self->py_names[i]);
-        if (rc) goto error;
-
-        // Get field encodings (NULL means binary) and default converters.
-        PyObject *py_tmp = PyList_GetItem(py_converters, i);
-        if (!py_tmp) goto error;
-        PyObject *py_encoding = PyTuple_GetItem(py_tmp, 0);
-        if (!py_encoding) goto error;
-        PyObject *py_converter = PyTuple_GetItem(py_tmp, 1);
-        if (!py_converter) goto error;
+        if (framer_reserve_arena(framer, *arena_l + bytes_to_read) < 0) {
+            return ACCEL_READ_NOMEM;
+        }
+        memcpy(framer->arena + *arena_l, payload, bytes_to_read);
+        *arena_l += bytes_to_read;
 
-        self->py_encodings[i] = (py_encoding == Py_None) ? NULL : py_encoding;
-        Py_XINCREF(self->py_encodings[i]);
+        if (bytes_to_read < MYSQL_MAX_PACKET_LEN) {
+            *data = framer->arena;
+            *data_l = *arena_l;
+            return 0;
+        }
+    }
+}
 
-        self->encodings[i] = (!py_encoding || py_encoding == Py_None) ?
-                              NULL : _PyUnicode_AsUTF8(py_encoding);
+//
+// Switch the incoming stream to compressed frames of the given algorithm.
+// This is called once authentication has completed.
+//
+static PyObject *SocketReader_set_compression(SocketReaderObject *self, PyObject *args) {
+    char *algorithm = NULL;
 
-        self->py_invalid_values[i] = (!py_invalid_value || py_invalid_value == Py_None) ?
-                                      NULL : py_converter;
-        Py_XINCREF(self->py_invalid_values[i]);
+    if (!PyArg_ParseTuple(args, "s", &algorithm)) return NULL;
 
-        self->py_converters[i] = (!py_converter
-                                  || py_converter == Py_None
-                                  || py_converter == py_default_converter) ?
-                                 NULL : py_converter;
-        Py_XINCREF(self->py_converters[i]);
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent reads from one connection are not allowed");
+        return NULL;
     }
 
-    // Loop over all data packets.
-    self->py_conn = PyObject_GetAttr(py_res, PyStr.connection);
-    if (!self->py_conn) goto error;
+#ifdef ACCEL_HAVE_ZLIB
+    if (strcmp(algorithm, "zlib") == 0) {
+        self->compression = ACCEL_COMPRESSION_ZLIB;
+        Py_RETURN_NONE;
+    }
+#endif
 
-    // Cache socket timeout and read methods.
-    self->py_sock = PyObject_GetAttr(self->py_conn, PyStr._sock);
-    if (!self->py_sock) goto error;
-    self->py_settimeout = PyObject_GetAttr(self->py_sock, PyStr.settimeout);
-    if (!self->py_settimeout) goto error;
-    self->py_read_timeout = PyObject_GetAttr(self->py_conn, PyStr._read_timeout);
-    if (!self->py_read_timeout) goto error;
+#ifdef ACCEL_HAVE_ZSTD
+    if (strcmp(algorithm, "zstd") == 0) {
+        if (!self->zstd) self->zstd = ZSTD_createDCtx();
+        if (!self->zstd) return PyErr_NoMemory();
+        self->compression = ACCEL_COMPRESSION_ZSTD;
+        Py_RETURN_NONE;
+    }
+#endif
+
+    PyErr_Format(PyExc_ValueError, "unsupported compression algorithm: %s", algorithm);
+    return NULL;
+}
+
+static PyObject *SocketReader_get_compressed_seq_id(SocketReaderObject *self, void *closure) {
+    return PyLong_FromUnsignedLong(self->compressed_seq_id);
+}
+
+static int SocketReader_set_compressed_seq_id(SocketReaderObject *self, PyObject *value, void *closure) {
+    if (!value) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete compressed_seq_id");
+        return -1;
+    }
+    unsigned long seq_id = PyLong_AsUnsignedLong(value);
+    if (seq_id == (unsigned long)-1 && PyErr_Occurred()) return -1;
+    self->compressed_seq_id = seq_id % 256;
+    return 0;
+}
+
+static PyObject *SocketReader_get_buffered(SocketReaderObject *self, void *closure) {
+    return PyLong_FromUnsignedLongLong(self->end - self->start);
+}
+
+//
+// Make room for `n` more bytes at the end of a buffer, moving the unread
+// data at `*start` to the front first.
+//
+static int reader_reserve(
+    char **buff,
+    unsigned long long *buff_size,
+    unsigned long long *start,
+    unsigned long long *end,
+    unsigned long long n,
+    unsigned long long spare
+) {
+    unsigned long long avail = *end - *start;
+
+    if (*buff_size - *end >= n) return 0;
+
+    if (*start > 0) {
+        memmove(*buff, *buff + *start, avail);
+        *start = 0;
+        *end = avail;
+    }
+
+    if (*buff_size - *end < n) {
+        unsigned long long new_size = *buff_size * 2;
+        if (new_size < ACCEL_READER_BUFFER_SIZE) new_size = ACCEL_READER_BUFFER_SIZE;
+        if (new_size < avail + n) new_size = avail + n;
+        char *new_buff = realloc(*buff, new_size + spare);
+        if (!new_buff) return -1;
+        *buff = new_buff;
+        *buff_size = new_size;
+    }
+
+    return 0;
+}
+
+//
+// Append data received by the caller to a reader without a socket.
+// Compressed frames are inflated as soon as they are complete.
+//
+static PyObject *SocketReader_feed(SocketReaderObject *self, PyObject *args) {
+    PyObject *py_data = NULL;
+    char *data = NULL;
+    Py_ssize_t data_l = 0;
+    long long rc = 0;
+    int err = 0;
+
+    if (!PyArg_ParseTuple(args, "O", &py_data)) return NULL;
+
+    if (self->py_sock != Py_None) {
+        PyErr_SetString(PyExc_ValueError, "only readers without a socket can be fed");
+        return NULL;
+    }
+
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent reads from one connection are not allowed");
+        return NULL;
+    }
+
+    if (!self->buff) {
+        PyErr_SetString(PyExc_ValueError, "socket reader is not initialized");
+        return NULL;
+    }
+
+    if (PyByteArray_Check(py_data)) {
+        data = PyByteArray_AsString(py_data);
+        data_l = PyByteArray_Size(py_data);
+    }
+    else if (PyBytes_AsStringAndSize(py_data, &data, &data_l) < 0) {
+        return NULL;
+    }
+
+    if (data_l == 0) Py_RETURN_NONE;
+
+    if (!self->compression) {
+        // Give back memory from a previous large response.
+        if (self->end == self->start && self->buff_size > ACCEL_READER_MAX_IDLE_SIZE
+                && (unsigned long long)data_l <= ACCEL_READER_BUFFER_SIZE) {
+            char *new_buff = realloc(self->buff, ACCEL_READER_BUFFER_SIZE + 1);
+            if (new_buff) {
+                self->buff = new_buff;
+                self->buff_size = ACCEL_READER_BUFFER_SIZE;
+            }
+            self->start = self->end = 0;
+        }
+        if (reader_reserve(&self->buff, &self->buff_size, &self->start, &self->end,
+                           data_l, 1) < 0) {
+            return PyErr_NoMemory();
+        }
+        memcpy(self->buff + self->end, data, data_l);
+        self->end += data_l;
+        Py_RETURN_NONE;
+    }
+
+    if (reader_reserve(&self->raw, &self->raw_size, &self->raw_start, &self->raw_end,
+                       data_l, 0) < 0) {
+        return PyErr_NoMemory();
+    }
+    memcpy(self->raw + self->raw_end, data, data_l);
+    self->raw_end += data_l;
+
+    // Inflate after the unread data, which is moved to the front first.
+    if (self->start > 0) {
+        memmove(self->buff, self->buff + self->start, self->end - self->start);
+        self->end -= self->start;
+        self->start = 0;
+    }
+
+    while ((rc = reader_inflate_nogil(self, ACCEL_INVALID_SOCKET, &err)) > 0);
+
+    if (rc != ACCEL_READ_AGAIN) {
+        reader_set_error(rc, err);
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static unsigned long long read_length_encoded_integer(
+    char **data, unsigned long long *data_l, int *is_null);
+static int is_eof_packet(char *data, unsigned long long data_l);
+
+//
+// Scan the buffered packets for the end of the response to a command,
+// continuing where the previous call left off. The response ends with
+// the OK, EOF or error packet of its last result set. Once the end has
+// been found, the next call starts over at the first unread byte.
+//
+// Returns 1 if the complete response is buffered, 0 otherwise.
+//
+static int reader_scan_response(SocketReaderObject *self) {
+    unsigned long long avail = 0;
+    unsigned long long packet_l = 0;
+    unsigned char *header = NULL;
+    char *payload = NULL;
+    uint16_t server_status = 0;
+    int done = 0;
+
+    while (1) {
+        avail = self->end - self->start - self->scan_pos;
+        if (avail < 4) return 0;
+
+        header = (unsigned char*)self->buff + self->start + self->scan_pos;
+        packet_l = header[0] + (header[1] << 8) + (header[2] << 16);
+        if (avail < 4 + packet_l) return 0;
+
+        payload = (char*)header + 4;
+        self->scan_pos += 4 + packet_l;
+
+        // Only the first packet of a multi-packet payload is inspected.
+        if (self->scan_continued) {
+            self->scan_continued = (packet_l == MYSQL_MAX_PACKET_LEN);
+            continue;
+        }
+        self->scan_continued = (packet_l == MYSQL_MAX_PACKET_LEN);
+
+        switch (self->scan_state) {
+        case ACCEL_SCAN_FIRST:
+            if (packet_l > 0 && (uint8_t)payload[0] == 0x00) {
+                // OK packet: affected rows, insert id, then the server status
+                char *data = payload + 1;
+                unsigned long long data_l = packet_l - 1;
+                read_length_encoded_integer(&data, &data_l, NULL);
+                read_length_encoded_integer(&data, &data_l, NULL);
+                server_status = (data_l >= 2) ? (uint8_t)data[0] + ((uint8_t)data[1] << 8) : 0;
+                done = !(server_status & MYSQL_SERVER_MORE_RESULTS_EXISTS);
+            }
+            else if (packet_l > 0 && ((uint8_t)payload[0] == 0xFF || (uint8_t)payload[0] == 0xFB)) {
+                // Error packet or LOAD DATA LOCAL request
+                done = 1;
+            }
+            else {
+                char *data = payload;
+                unsigned long long data_l = packet_l;
+                self->scan_columns = read_length_encoded_integer(&data, &data_l, NULL);
+                self->scan_state = ACCEL_SCAN_COLUMNS;
+            }
+            break;
+
+        case ACCEL_SCAN_COLUMNS:
+            if (self->scan_columns > 0) self->scan_columns--;
+            else self->scan_state = ACCEL_SCAN_ROWS;
+            break;
+
+        case ACCEL_SCAN_ROWS:
+            if (is_eof_packet(payload, packet_l)) {
+                server_status = (packet_l >= 5) ? (uint8_t)payload[3] + ((uint8_t)payload[4] << 8) : 0;
+                done = !(server_status & MYSQL_SERVER_MORE_RESULTS_EXISTS);
+                self->scan_state = ACCEL_SCAN_FIRST;
+            }
+            else if (packet_l > 0 && (uint8_t)payload[0] == 0xFF) {
+                done = 1;
+            }
+            break;
+        }
+
+        if (done) {
+            self->scan_state = ACCEL_SCAN_FIRST;
+            self->scan_continued = 0;
+            self->scan_pos = 0;
+            self->scan_columns = 0;
+            return 1;
+        }
+    }
+}
+
+static PyObject *SocketReader_scan(SocketReaderObject *self, PyObject *args) {
+    if (reader_scan_response(self)) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+#ifdef ACCEL_HAVE_OPENSSL
+
+//
+// Raise the error of a failed TLS handshake as an ssl.SSLError, or as an
+// ssl.SSLCertVerificationError if the server certificate was rejected.
+//
+static void tls_set_error(SSL *tls, long long rc, int err) {
+    PyObject *py_ssl = NULL;
+    PyObject *py_exc = NULL;
+    long verify_result = X509_V_OK;
+    const char *reason = NULL;
+
+    if (rc == -1) { errno = err; PyErr_SetFromErrno(PyExc_OSError); return; }
+    if (rc == -2) { PyErr_SetString(PyExc_TimeoutError, "timed out"); return; }
+
+    py_ssl = PyImport_ImportModule("ssl");
+    if (!py_ssl) return;
+
+    if (tls) verify_result = SSL_get_verify_result(tls);
+
+    if (verify_result != X509_V_OK) {
+        py_exc = PyObject_GetAttrString(py_ssl, "SSLCertVerificationError");
+        if (py_exc) {
+            PyErr_Format(py_exc, "certificate verify failed: %s",
+                         X509_verify_cert_error_string(verify_result));
+        }
+    }
+    else {
+        py_exc = PyObject_GetAttrString(py_ssl, "SSLError");
+        if (py_exc) {
+            reason = ERR_reason_error_string((unsigned long)err);
+            PyErr_Format(py_exc, "TLS handshake failed: %s",
+                         reason ? reason : "connection closed");
+        }
+    }
+
+    Py_XDECREF(py_exc);
+    Py_DECREF(py_ssl);
+}
+
+//
+// Run the TLS handshake on the reader's socket. The server has already
+// been sent the SSL request packet, so no unread data may be buffered.
+//
+static PyObject *SocketReader_start_tls(SocketReaderObject *self, PyObject *args, PyObject *kwargs) {
+    char *server_hostname = NULL;
+    char *cafile = NULL;
+    char *capath = NULL;
+    char *certfile = NULL;
+    char *keyfile = NULL;
+    char *ciphers = NULL;
+    int verify = 1;
+    int check_hostname = 1;
+    int is_ip = 0;
+    int ssl_err = 0;
+    int err = 0;
+    long long rc = 0;
+    accel_socket_t sock;
+    ASN1_OCTET_STRING *ip = NULL;
+    SSL_CTX *ctx = NULL;
+    SSL *tls = NULL;
+    X509_VERIFY_PARAM *param = NULL;
+    char *keywords[] = {
+        "server_hostname", "cafile", "capath", "certfile", "keyfile",
+        "ciphers", "verify", "check_hostname", NULL,
+    };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "z|zzzzzpp", keywords,
+                                     &server_hostname, &cafile, &capath, &certfile,
+                                     &keyfile, &ciphers, &verify, &check_hostname)) {
+        return NULL;
+    }
+
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent reads from one connection are not allowed");
+        return NULL;
+    }
+
+    if (self->tls) {
+        PyErr_SetString(PyExc_ValueError, "TLS has already been started");
+        return NULL;
+    }
+
+#ifdef ACCEL_HAVE_READ_ENGINE
+    if (self->engine) {
+        PyErr_SetString(PyExc_ValueError, "TLS can not be started on a reader of a read engine");
+        return NULL;
+    }
+#endif
+
+    if (self->end != self->start || self->compression) {
+        PyErr_SetString(PyExc_ValueError, "TLS must be started before any data is buffered");
+        return NULL;
+    }
+
+    if (reader_get_socket(self, &sock) < 0) return NULL;
+
+    ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx) goto tls_error;
+
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_COMPRESSION);
+    // Writes interrupted by a signal are retried from another buffer.
+    SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
+    if (ciphers && !SSL_CTX_set_cipher_list(ctx, ciphers)) goto tls_error;
+
+    if (cafile || capath) {
+        if (!SSL_CTX_load_verify_locations(ctx, cafile, capath)) goto tls_error;
+    }
+    else if (!SSL_CTX_set_default_verify_paths(ctx)) {
+        goto tls_error;
+    }
+
+    if (certfile) {
+        if (!SSL_CTX_use_certificate_chain_file(ctx, certfile)) goto tls_error;
+        if (!SSL_CTX_use_PrivateKey_file(ctx, keyfile ? keyfile : certfile,
+                                         SSL_FILETYPE_PEM)) goto tls_error;
+    }
+
+    SSL_CTX_set_verify(ctx, verify ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, NULL);
+
+    tls = SSL_new(ctx);
+    if (!tls) goto tls_error;
+
+    if (server_hostname) {
+        ip = a2i_IPADDRESS(server_hostname);
+        is_ip = ip != NULL;
+        if (ip) ASN1_OCTET_STRING_free(ip);
+        ERR_clear_error();
+
+        // Server name indication only takes host names.
+        if (!is_ip && !SSL_set_tlsext_host_name(tls, server_hostname)) goto tls_error;
+
+        if (verify && check_hostname) {
+            param = SSL_get0_param(tls);
+            X509_VERIFY_PARAM_set_hostflags(param, X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
+            if (is_ip) {
+                if (!X509_VERIFY_PARAM_set1_ip_asc(param, server_hostname)) goto tls_error;
+            }
+            else if (!X509_VERIFY_PARAM_set1_host(param, server_hostname, 0)) {
+                goto tls_error;
+            }
+        }
+    }
+
+    if (!SSL_set_fd(tls, (int)sock)) goto tls_error;
+
+    self->busy = 1;
+
+    Py_BEGIN_ALLOW_THREADS
+    while (1) {
+        ERR_clear_error();
+        rc = SSL_connect(tls);
+        if (rc == 1) { rc = 0; break; }
+
+        rc = tls_check_error(tls, (int)rc, &ssl_err, &err);
+        if (rc == 1) { rc = -3; err = 0; }
+        if (rc < 0) break;
+
+        rc = tls_wait(sock, ssl_err, self->timeout, &err);
+        if (rc < 0) break;
+    }
+    Py_END_ALLOW_THREADS
+
+    self->busy = 0;
+
+    if (rc < 0) {
+        tls_set_error(tls, rc, err);
+        goto error;
+    }
+
+    self->tls_ctx = ctx;
+    self->tls = tls;
+
+    Py_RETURN_NONE;
+
+tls_error:
+    tls_set_error(NULL, -3, (int)(ERR_peek_last_error() & 0x7FFFFFFF));
+
+error:
+    if (tls) SSL_free(tls);
+    if (ctx) SSL_CTX_free(ctx);
+    return NULL;
+}
+
+#endif
+
+//
+// Drop `n` sent bytes from the front of a list of segments.
+//
+static void send_advance(accel_iovec_t **iov, int *n_iov, size_t n) {
+    while (*n_iov > 0 && n >= (*iov)->iov_len) {
+        n -= (*iov)->iov_len;
+        (*iov)++;
+        (*n_iov)--;
+    }
+    if (*n_iov > 0) {
+        (*iov)->iov_base = (char*)(*iov)->iov_base + n;
+        (*iov)->iov_len -= n;
+    }
+}
+
+//
+// Send a list of segments, encrypting them if TLS was started by the
+// reader, waiting at most `timeout` seconds for the socket to accept them.
+// Sent data is dropped from the list, and `*iov` and `*n_iov` are advanced
+// past it, so the call can be repeated with them after an interruption.
+// This is called without the GIL.
+//
+// Returns 0 once everything was sent, -1 on a socket error, -2 if the
+// timeout expired, or -3 on a TLS error, with the error code in `err`.
+//
+static int reader_send_nogil(
+    SocketReaderObject *self,
+    accel_socket_t sock,
+    accel_iovec_t **p_iov,
+    int *p_n_iov,
+    double timeout,
+    int *err
+) {
+    accel_iovec_t *iov = *p_iov;
+    int n_iov = *p_n_iov;
+    struct pollfd pfd;
+    long long rc = 0;
+#ifndef _WIN32
+    struct msghdr msg;
+    // Blocking sockets only honor the timeout with non-blocking sends.
+    int flags = (timeout >= 0) ? MSG_DONTWAIT : 0;
+#endif
+#ifdef ACCEL_HAVE_OPENSSL
+    char stage[ACCEL_TLS_STAGE_SIZE];
+    char *buff = NULL;
+    size_t buff_l = 0;
+    size_t n = 0;
+    int ssl_err = 0;
+    int i = 0;
+#endif
+
+    while (n_iov > 0) {
+        if (iov->iov_len == 0) { iov++; n_iov--; continue; }
+
+#ifdef ACCEL_HAVE_OPENSSL
+        if (self->tls) {
+            // Small segments, such as packet headers, are gathered so that
+            // they do not end up in TLS records of their own. The staged
+            // data only depends on the unsent segments, so a retried write
+            // gets the same bytes.
+            if (iov->iov_len >= ACCEL_TLS_STAGE_SIZE) {
+                buff = iov->iov_base;
+                buff_l = iov->iov_len;
+            }
+            else {
+                buff = stage;
+                buff_l = 0;
+                for (i = 0; i < n_iov && buff_l < ACCEL_TLS_STAGE_SIZE; i++) {
+                    n = iov[i].iov_len;
+                    if (n > ACCEL_TLS_STAGE_SIZE - buff_l) n = ACCEL_TLS_STAGE_SIZE - buff_l;
+                    memcpy(stage + buff_l, iov[i].iov_base, n);
+                    buff_l += n;
+                }
+            }
+
+            if (timeout >= 0) {
+                rc = tls_wait(sock, SSL_ERROR_WANT_WRITE, timeout, err);
+                if (rc < 0) goto exit;
+            }
+
+            ERR_clear_error();
+            if (SSL_write_ex(self->tls, buff, buff_l, &n) > 0) {
+                send_advance(&iov, &n_iov, n);
+                continue;
+            }
+            rc = tls_check_error(self->tls, 0, &ssl_err, err);
+            if (rc == 1) { *err = EPIPE; rc = -1; goto exit; }
+            if (rc < 0) goto exit;
+            rc = tls_wait(sock, ssl_err, timeout, err);
+            if (rc < 0) goto exit;
+            continue;
+        }
+#endif
+
+#ifdef _WIN32
+        rc = send(sock, iov->iov_base,
+                  (int)((iov->iov_len > INT32_MAX) ? INT32_MAX : iov->iov_len), 0);
+#else
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (n_iov > ACCEL_SEND_MAX_SEGMENTS) ? ACCEL_SEND_MAX_SEGMENTS : n_iov;
+        rc = sendmsg(sock, &msg, flags);
+#endif
+        if (rc >= 0) {
+            send_advance(&iov, &n_iov, (size_t)rc);
+            continue;
+        }
+
+        *err = ACCEL_SOCKET_ERRNO;
+        if (*err != ACCEL_EAGAIN && *err != ACCEL_EWOULDBLOCK) { rc = -1; goto exit; }
+
+        // Non-blocking socket with a full send buffer
+        pfd.fd = sock;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        rc = accel_poll(&pfd, 1, timeout_ms(timeout));
+        if (rc == 0) { rc = -2; goto exit; }
+        if (rc < 0) { *err = ACCEL_SOCKET_ERRNO; rc = -1; goto exit; }
+    }
+
+    rc = 0;
+
+exit:
+    *p_iov = iov;
+    *p_n_iov = n_iov;
+    return (int)rc;
+}
+
+//
+// Send a list of segments to the reader's socket, releasing the GIL while
+// waiting for it.
+//
+// Returns 0 on success, or -1 with an exception set on error.
+//
+static int reader_send(
+    SocketReaderObject *self,
+    accel_iovec_t *iov,
+    int n_iov,
+    PyObject *py_timeout
+) {
+    accel_socket_t sock;
+    double timeout = -1.0;
+    int rc = 0;
+    int err = 0;
+
+    if (py_timeout != Py_None) {
+        timeout = PyFloat_AsDouble(py_timeout);
+        if (timeout == -1.0 && PyErr_Occurred()) return -1;
+    }
+
+    if (reader_get_socket(self, &sock) < 0) return -1;
+
+    while (1) {
+        Py_BEGIN_ALLOW_THREADS
+        rc = reader_send_nogil(self, sock, &iov, &n_iov, timeout, &err);
+        Py_END_ALLOW_THREADS
+
+        if (rc == 0) return 0;
+        if (rc != -1 || err != ACCEL_EINTR) break;
+        if (PyErr_CheckSignals() < 0) return -1;
+    }
+
+    if (rc == -2) PyErr_SetString(PyExc_TimeoutError, "timed out");
+#ifdef ACCEL_HAVE_OPENSSL
+    else if (rc == -3) reader_set_error(ACCEL_READ_TLS, err);
+#endif
+    else { errno = err; PyErr_SetFromErrno(PyExc_OSError); }
+
+    return -1;
+}
+
+//
+// Get the contents of a bytes-like object for sending. Bytes and bytearrays
+// are used in place; a bytearray is locked against resizing by a memoryview
+// while it is being sent. Other objects are used in place when building
+// against the full C API and copied otherwise.
+//
+// Returns 0 and a new reference in `py_ref` that keeps the data valid,
+// or -1 with an exception set on error.
+//
+static int get_send_data(PyObject *py_data, PyObject **py_ref, char **data, Py_ssize_t *data_l) {
+    if (PyBytes_Check(py_data)) {
+        if (PyBytes_AsStringAndSize(py_data, data, data_l) < 0) return -1;
+        Py_INCREF(py_data);
+        *py_ref = py_data;
+        return 0;
+    }
+
+    if (PyByteArray_Check(py_data)) {
+        *py_ref = PyMemoryView_FromObject(py_data);
+        if (!*py_ref) return -1;
+        *data = PyByteArray_AsString(py_data);
+        *data_l = PyByteArray_Size(py_data);
+        return 0;
+    }
+
+#ifndef Py_LIMITED_API
+    *py_ref = PyMemoryView_FromObject(py_data);
+    if (!*py_ref) return -1;
+    if (!PyBuffer_IsContiguous(PyMemoryView_GET_BUFFER(*py_ref), 'C')) {
+        Py_CLEAR(*py_ref);
+        PyErr_SetString(PyExc_ValueError, "data to send must be contiguous");
+        return -1;
+    }
+    *data = PyMemoryView_GET_BUFFER(*py_ref)->buf;
+    *data_l = PyMemoryView_GET_BUFFER(*py_ref)->len;
+    return 0;
+#else
+    *py_ref = PyBytes_FromObject(py_data);
+    if (!*py_ref) return -1;
+    return PyBytes_AsStringAndSize(*py_ref, data, data_l);
+#endif
+}
+
+//
+// Send all of the given data, encrypting it if TLS was started by the
+// reader, waiting at most `timeout` seconds for the socket to accept it.
+//
+static PyObject *SocketReader_sendall(SocketReaderObject *self, PyObject *args) {
+    PyObject *py_data = NULL;
+    PyObject *py_timeout = Py_None;
+    PyObject *py_ref = NULL;
+    accel_iovec_t iov;
+    char *data = NULL;
+    Py_ssize_t data_l = 0;
+    int rc = 0;
+
+    if (!PyArg_ParseTuple(args, "O|O", &py_data, &py_timeout)) return NULL;
+
+    if (get_send_data(py_data, &py_ref, &data, &data_l) < 0) return NULL;
+
+    iov.iov_base = data;
+    iov.iov_len = (size_t)data_l;
+    rc = reader_send(self, &iov, 1, py_timeout);
+
+    Py_DECREF(py_ref);
+    if (rc < 0) return NULL;
+    Py_RETURN_NONE;
+}
+
+//
+// Send a command with its argument as MySQL packets, waiting at most
+// `timeout` seconds for the socket to accept them. Arguments that do
+// not fit into one packet are split into packets of 16MB with their
+// headers written separately, so the argument is sent without copying it.
+//
+// Returns the sequence number following the last packet.
+//
+static PyObject *SocketReader_send_command(SocketReaderObject *self, PyObject *args) {
+    PyObject *py_data = NULL;
+    PyObject *py_timeout = Py_None;
+    PyObject *py_ref = NULL;
+    PyObject *py_out = NULL;
+    accel_iovec_t *iov = NULL;
+    char *headers = NULL;
+    char *data = NULL;
+    Py_ssize_t data_l = 0;
+    unsigned long long payload_l = 0;
+    unsigned long long n_packets = 0;
+    unsigned long long packet_l = 0;
+    unsigned long long i = 0;
+    int command = 0;
+
+    if (!PyArg_ParseTuple(args, "iO|O", &command, &py_data, &py_timeout)) return NULL;
+
+    if (command < 0 || command > 255) {
+        PyErr_SetString(PyExc_ValueError, "command must be a single byte");
+        return NULL;
+    }
+
+    if (get_send_data(py_data, &py_ref, &data, &data_l) < 0) return NULL;
+
+    // A payload that fills its last packet is followed by an empty one.
+    payload_l = (unsigned long long)data_l + 1;
+    n_packets = payload_l / MYSQL_MAX_PACKET_LEN + 1;
+
+    if (n_packets > INT32_MAX / 2) {
+        PyErr_SetString(PyExc_ValueError, "command is too large to send");
+        goto error;
+    }
+
+    // Every packet has a header and a chunk of the argument; the command
+    // byte follows the header of the first packet.
+    headers = malloc(n_packets * 4 + 1);
+    iov = malloc(n_packets * 2 * sizeof(accel_iovec_t));
+    if (!headers || !iov) { PyErr_NoMemory(); goto error; }
+
+    for (i = 0; i < n_packets; i++) {
+        packet_l = payload_l - i * MYSQL_MAX_PACKET_LEN;
+        if (packet_l > MYSQL_MAX_PACKET_LEN) packet_l = MYSQL_MAX_PACKET_LEN;
+
+        headers[i * 4 + (i > 0)] = (char)(packet_l & 0xFF);
+        headers[i * 4 + (i > 0) + 1] = (char)((packet_l >> 8) & 0xFF);
+        headers[i * 4 + (i > 0) + 2] = (char)((packet_l >> 16) & 0xFF);
+        headers[i * 4 + (i > 0) + 3] = (char)i;
+
+        if (i == 0) {
+            headers[4] = (char)command;
+            iov[0].iov_base = headers;
+            iov[0].iov_len = 5;
+            iov[1].iov_base = data;
+            iov[1].iov_len = packet_l - 1;
+        }
+        else {
+            iov[i * 2].iov_base = headers + i * 4 + 1;
+            iov[i * 2].iov_len = 4;
+            iov[i * 2 + 1].iov_base = data + i * MYSQL_MAX_PACKET_LEN - 1;
+            iov[i * 2 + 1].iov_len = packet_l;
+        }
+    }
+
+    if (reader_send(self, iov, (int)(n_packets * 2), py_timeout) < 0) goto error;
+
+    py_out = PyLong_FromUnsignedLongLong(n_packets % 256);
+
+error:
+    DESTROY(headers);
+    DESTROY(iov);
+    Py_XDECREF(py_ref);
+    return py_out;
+}
+
+static PyMethodDef SocketReader_methods[] = {
+    {"read", (PyCFunction)SocketReader_read, METH_VARARGS, "Read `n` bytes from the socket"},
+    {"set_compression", (PyCFunction)SocketReader_set_compression, METH_VARARGS,
+     "Read compressed frames of the given algorithm from now on"},
+    {"feed", (PyCFunction)SocketReader_feed, METH_VARARGS,
+     "Append received data to a reader without a socket"},
+    {"scan", (PyCFunction)SocketReader_scan, METH_NOARGS,
+     "Return True once the complete response to a command is buffered"},
+#ifdef ACCEL_HAVE_OPENSSL
+    {"start_tls", (PyCFunction)SocketReader_start_tls, METH_VARARGS | METH_KEYWORDS,
+     "Run the TLS handshake and decrypt the incoming stream from now on"},
+#endif
+    {"sendall", (PyCFunction)SocketReader_sendall, METH_VARARGS,
+     "Send all of the data to the socket, encrypting it if TLS was started"},
+    {"send_command", (PyCFunction)SocketReader_send_command, METH_VARARGS,
+     "Send a command and its argument as MySQL packets"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef SocketReader_getset[] = {
+    {"buffered", (getter)SocketReader_get_buffered, NULL,
+     "Number of received bytes that have not been read", NULL},
+    {"compressed_seq_id", (getter)SocketReader_get_compressed_seq_id,
+     (setter)SocketReader_set_compressed_seq_id,
+     "Sequence number following the last compressed frame", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot SocketReaderType_slots[] = {
+    {Py_tp_init, (initproc)SocketReader_init},
+    {Py_tp_dealloc, (destructor)SocketReader_dealloc},
+    {Py_tp_methods, SocketReader_methods},
+    {Py_tp_getset, SocketReader_getset},
+    {Py_tp_doc, "Buffered reader for socket data"},
+    {0, NULL},
+};
+
+static PyType_Spec SocketReaderType_spec = {
+    .name = "_singlestoredb_accel.SocketReader",
+    .basicsize = sizeof(SocketReaderObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT,
+    .slots = SocketReaderType_slots,
+};
+
+//
+// End SocketReader
+//
+
+//
+// Interned strings
+//
+// Small per-column tables of decoded str values keyed on their raw bytes.
+// Columns with few distinct values (ENUM, SET, status codes) then share a
+// single str object per distinct value instead of creating one for every
+// cell. Once a table is full, other values are decoded as usual.
+//
+
+#define ACCEL_INTERN_SLOTS 512 // Must be a power of two
+#define ACCEL_INTERN_MAX_VALUES 256
+#define ACCEL_INTERN_MAX_LENGTH 64
+
+typedef struct {
+    uint64_t hash; // Hash of the raw bytes
+    unsigned long long key_offset; // Offset of the raw bytes in the table keys
+    unsigned long long key_l; // Length of the raw bytes
+    PyObject *py_value; // Decoded value (NULL for empty slots)
+} InternSlot;
+
+typedef struct {
+    InternSlot *slots; // Open addressing hash table
+    char *keys; // Raw bytes of the values
+    unsigned long long keys_l; // Bytes of keys used
+    unsigned long long keys_size; // Allocated size of keys
+    unsigned long n_values; // Number of values in the table
+} InternTable;
+
+static uint64_t intern_hash(const char *s, unsigned long long s_l) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned long long i = 0; i < s_l; i++) {
+        hash ^= (unsigned char)s[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void intern_table_free(InternTable *table) {
+    if (!table) return;
+    if (table->slots) {
+        for (unsigned long i = 0; i < ACCEL_INTERN_SLOTS; i++) {
+            Py_CLEAR(table->slots[i].py_value);
+        }
+    }
+    DESTROY(table->slots);
+    DESTROY(table->keys);
+    free(table);
+}
+
+//
+// Return a new reference to the decoded value of `s`, adding it to the
+// table if there is room.
+//
+static PyObject *intern_decode(
+    InternTable *table,
+    const char *s,
+    unsigned long long s_l,
+    const char *encoding,
+    const char *errors
+) {
+    PyObject *py_value = NULL;
+    InternSlot *slot = NULL;
+
+    if (s_l > ACCEL_INTERN_MAX_LENGTH) {
+        return PyUnicode_Decode(s, s_l, encoding, errors);
+    }
+
+    if (!table->slots) {
+        table->slots = calloc(ACCEL_INTERN_SLOTS, sizeof(InternSlot));
+        if (!table->slots) return PyErr_NoMemory();
+    }
+
+    uint64_t hash = intern_hash(s, s_l);
+
+    // The table is never more than half full, so there is always an empty slot.
+    for (unsigned long j = hash & (ACCEL_INTERN_SLOTS - 1);; j = (j + 1) & (ACCEL_INTERN_SLOTS - 1)) {
+        slot = &table->slots[j];
+        if (!slot->py_value) break;
+        if (slot->hash == hash && slot->key_l == s_l &&
+            memcmp(table->keys + slot->key_offset, s, s_l) == 0) {
+            Py_INCREF(slot->py_value);
+            return slot->py_value;
+        }
+    }
+
+    py_value = PyUnicode_Decode(s, s_l, encoding, errors);
+    if (!py_value || table->n_values >= ACCEL_INTERN_MAX_VALUES) return py_value;
+
+    if (table->keys_l + s_l > table->keys_size) {
+        unsigned long long size = (table->keys_size) ? table->keys_size * 2 : 1024;
+        char *keys = realloc(table->keys, size);
+        if (!keys) return py_value;
+        table->keys = keys;
+        table->keys_size = size;
+    }
+
+    memcpy(table->keys + table->keys_l, s, s_l);
+    slot->hash = hash;
+    slot->key_offset = table->keys_l;
+    slot->key_l = s_l;
+    slot->py_value = py_value;
+    Py_INCREF(py_value);
+    table->keys_l += s_l;
+    table->n_values++;
+
+    return py_value;
+}
+
+//
+// End Interned strings
+//
+
+//
+// JSON
+//
+// Parser for the values of JSON columns that builds the Python objects
+// straight from the packet bytes, instead of decoding a str and passing
+// it to `json.loads`. Strings are scanned eight bytes at a time, and object
+// keys are interned per column, since the same keys repeat in every row.
+// Text that the parser does not accept (invalid JSON, deep nesting, lone
+// surrogate escapes) is handed to `json.loads`, so results and errors are
+// the same as before.
+//
+
+#define ACCEL_JSON_MAX_DEPTH 200
+
+#define ACCEL_SWAR_ONES 0x0101010101010101ULL
+#define ACCEL_SWAR_HIGHS 0x8080808080808080ULL
+
+// Does the chunk contain a byte below `n` (n <= 128)?
+#define ACCEL_SWAR_HAS_LESS(x, n) (((x) - ACCEL_SWAR_ONES * (n)) & ~(x) & ACCEL_SWAR_HIGHS)
+
+// Does the chunk contain the byte `b`?
+#define ACCEL_SWAR_HAS_BYTE(x, b) ACCEL_SWAR_HAS_LESS((x) ^ (ACCEL_SWAR_ONES * (b)), 1)
+
+typedef struct {
+    char *p; // Next unparsed byte
+    char *end; // End of the text
+    const char *errors; // Error handler for invalid UTF-8
+    InternTable *keys; // Interned object keys (NULL if not interned)
+    char *scratch; // Buffer for unescaped strings and long integers
+    unsigned long long scratch_size;
+    int depth; // Nesting level of the value being parsed
+    int invalid; // Was text found that json.loads has to handle?
+} JsonParser;
+
+static PyObject *json_parse_value(JsonParser *jp);
+
+static inline void json_skip_space(JsonParser *jp) {
+    while (jp->p < jp->end &&
+           (*jp->p == ' ' || *jp->p == '\n' || *jp->p == '\r' || *jp->p == '\t')) {
+        jp->p++;
+    }
+}
+
+static PyObject *json_invalid(JsonParser *jp) {
+    jp->invalid = 1;
+    return NULL;
+}
+
+static int json_reserve(JsonParser *jp, unsigned long long size) {
+    if (jp->scratch_size >= size) return 0;
+    char *scratch = realloc(jp->scratch, size);
+    if (!scratch) { PyErr_NoMemory(); return -1; }
+    jp->scratch = scratch;
+    jp->scratch_size = size;
+    return 0;
+}
+
+//
+// Return the first quote, backslash or control character at or after `p`.
+//
+static char *json_scan_string(char *p, char *end) {
+    uint64_t chunk = 0;
+
+    while (end - p >= 8) {
+        memcpy(&chunk, p, 8);
+        if (ACCEL_SWAR_HAS_BYTE(chunk, '"') | ACCEL_SWAR_HAS_BYTE(chunk, '\\') |
+                ACCEL_SWAR_HAS_LESS(chunk, 0x20)) {
+            break;
+        }
+        p += 8;
+    }
+
+    while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) p++;
+
+    return p;
+}
+
+static int json_hex4(const char *p, unsigned int *out) {
+    *out = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        *out <<= 4;
+        if (c >= '0' && c <= '9') *out |= c - '0';
+        else if (c >= 'a' && c <= 'f') *out |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') *out |= c - 'A' + 10;
+        else return -1;
+    }
+    return 0;
+}
+
+//
+// Copy the string starting at `jp->p` into the scratch buffer as UTF-8,
+// replacing its escape sequences. `jp->p` is left on the closing quote.
+//
+// Returns the length of the string, or -1 (with `jp->invalid` set or an
+// exception raised).
+//
+static long long json_unescape(JsonParser *jp) {
+    char *out = NULL;
+    unsigned int cp = 0;
+    unsigned int low = 0;
+    char *run = NULL;
+
+    // Escapes are never shorter than what they stand for.
+    if (json_reserve(jp, (unsigned long long)(jp->end - jp->p) + 1) < 0) return -1;
+    out = jp->scratch;
+
+    while (1) {
+        run = jp->p;
+        jp->p = json_scan_string(jp->p, jp->end);
+        memcpy(out, run, jp->p - run);
+        out += jp->p - run;
+
+        if (jp->p >= jp->end || *jp->p != '\\') break;
+
+        if (jp->end - jp->p < 2) { jp->invalid = 1; return -1; }
+        switch (jp->p[1]) {
+        case '"': *out++ = '"'; break;
+        case '\\': *out++ = '\\'; break;
+        case '/': *out++ = '/'; break;
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'n': *out++ = '\n'; break;
+        case 'r': *out++ = '\r'; break;
+        case 't': *out++ = '\t'; break;
+        case 'u':
+            if (jp->end - jp->p < 6 || json_hex4(jp->p + 2, &cp) < 0) {
+                jp->invalid = 1;
+                return -1;
+            }
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                // A high surrogate must be followed by a low one.
+                if (jp->end - jp->p < 12 || jp->p[6] != '\\' || jp->p[7] != 'u' ||
+                        json_hex4(jp->p + 8, &low) < 0 || low < 0xDC00 || low > 0xDFFF) {
+                    jp->invalid = 1;
+                    return -1;
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                jp->p += 6;
+            }
+            else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                jp->invalid = 1;
+                return -1;
+            }
+            if (cp < 0x80) {
+                *out++ = (char)cp;
+            } else if (cp < 0x800) {
+                *out++ = (char)(0xC0 | (cp >> 6));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                *out++ = (char)(0xE0 | (cp >> 12));
+                *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            } else {
+                *out++ = (char)(0xF0 | (cp >> 18));
+                *out++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+                *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            }
+            jp->p += 4;
+            break;
+        default:
+            jp->invalid = 1;
+            return -1;
+        }
+        jp->p += 2;
+    }
+
+    if (jp->p >= jp->end || *jp->p != '"') { jp->invalid = 1; return -1; }
+
+    return (long long)(out - jp->scratch);
+}
+
+//
+// Parse the string at `jp->p`, which is on the opening quote. Object keys
+// are interned when they have no escape sequences.
+//
+static PyObject *json_parse_string(JsonParser *jp, int is_key) {
+    char *start = ++jp->p;
+    PyObject *py_out = NULL;
+    long long n = 0;
+
+    jp->p = json_scan_string(jp->p, jp->end);
+
+    if (jp->p < jp->end && *jp->p == '"') {
+        if (is_key && jp->keys) {
+            py_out = intern_decode(jp->keys, start, jp->p - start, "utf-8", jp->errors);
+        } else {
+            py_out = PyUnicode_DecodeUTF8(start, jp->p - start, jp->errors);
+        }
+        jp->p++;
+        return py_out;
+    }
+
+    if (jp->p >= jp->end || *jp->p != '\\') return json_invalid(jp);
+
+    jp->p = start;
+    n = json_unescape(jp);
+    if (n < 0) return NULL;
+    jp->p++;
+
+    return PyUnicode_DecodeUTF8(jp->scratch, n, jp->errors);
+}
+
+static PyObject *json_parse_number(JsonParser *jp) {
+    char *start = jp->p;
+    char *digits = NULL;
+    int is_float = 0;
+    int64_t value = 0;
+
+    if (*jp->p == '-') jp->p++;
+
+    digits = jp->p;
+    if (jp->p < jp->end && *jp->p == '0') {
+        jp->p++;
+    } else {
+        while (jp->p < jp->end && *jp->p >= '0' && *jp->p <= '9') jp->p++;
+    }
+    if (jp->p == digits) return json_invalid(jp);
+
+    if (jp->p < jp->end && *jp->p == '.') {
+        char *frac = ++jp->p;
+        while (jp->p < jp->end && *jp->p >= '0' && *jp->p <= '9') jp->p++;
+        if (jp->p == frac) return json_invalid(jp);
+        is_float = 1;
+    }
+
+    if (jp->p < jp->end && (*jp->p == 'e' || *jp->p == 'E')) {
+        jp->p++;
+        if (jp->p < jp->end && (*jp->p == '+' || *jp->p == '-')) jp->p++;
+        char *exp = jp->p;
+        while (jp->p < jp->end && *jp->p >= '0' && *jp->p <= '9') jp->p++;
+        if (jp->p == exp) return json_invalid(jp);
+        is_float = 1;
+    }
+
+    if (is_float) {
+        return PyFloat_FromDouble(parse_double(start, jp->p - start));
+    }
+
+    if (jp->p - digits <= 18) {
+        for (char *c = digits; c < jp->p; c++) value = value * 10 + (*c - '0');
+        return PyLong_FromLongLong((*start == '-') ? -value : value);
+    }
+
+    if (json_reserve(jp, (unsigned long long)(jp->p - start) + 1) < 0) return NULL;
+    memcpy(jp->scratch, start, jp->p - start);
+    jp->scratch[jp->p - start] = '\0';
+    return PyLong_FromString(jp->scratch, NULL, 10);
+}
+
+//
+// Match the keyword `word` and return a new reference to `py_value`.
+//
+static PyObject *json_parse_keyword(JsonParser *jp, const char *word, PyObject *py_value) {
+    size_t word_l = strlen(word);
+
+    if ((size_t)(jp->end - jp->p) < word_l || memcmp(jp->p, word, word_l) != 0) {
+        return json_invalid(jp);
+    }
+    jp->p += word_l;
+
+    if (!py_value) return NULL;
+    Py_INCREF(py_value);
+    return py_value;
+}
+
+static PyObject *json_parse_constant(JsonParser *jp, const char *word, double value) {
+    size_t word_l = strlen(word);
+
+    if ((size_t)(jp->end - jp->p) < word_l || memcmp(jp->p, word, word_l) != 0) {
+        return json_invalid(jp);
+    }
+    jp->p += word_l;
+
+    return PyFloat_FromDouble(value);
+}
+
+static PyObject *json_parse_object(JsonParser *jp) {
+    PyObject *py_out = NULL;
+    PyObject *py_key = NULL;
+    PyObject *py_value = NULL;
+
+    jp->p++;
+    py_out = PyDict_New();
+    if (!py_out) return NULL;
+
+    json_skip_space(jp);
+    if (jp->p < jp->end && *jp->p == '}') {
+        jp->p++;
+        return py_out;
+    }
+
+    while (1) {
+        json_skip_space(jp);
+        if (jp->p >= jp->end || *jp->p != '"') { json_invalid(jp); goto error; }
+
+        py_key = json_parse_string(jp, 1);
+        if (!py_key) goto error;
+
+        json_skip_space(jp);
+        if (jp->p >= jp->end || *jp->p != ':') { json_invalid(jp); goto error; }
+        jp->p++;
+
+        py_value = json_parse_value(jp);
+        if (!py_value) goto error;
+
+        if (PyDict_SetItem(py_out, py_key, py_value) < 0) goto error;
+        Py_CLEAR(py_key);
+        Py_CLEAR(py_value);
+
+        json_skip_space(jp);
+        if (jp->p < jp->end && *jp->p == ',') { jp->p++; continue; }
+        if (jp->p < jp->end && *jp->p == '}') { jp->p++; return py_out; }
+        json_invalid(jp);
+        goto error;
+    }
+
+error:
+    Py_XDECREF(py_key);
+    Py_XDECREF(py_value);
+    Py_DECREF(py_out);
+    return NULL;
+}
+
+static PyObject *json_parse_array(JsonParser *jp) {
+    PyObject *py_out = NULL;
+    PyObject *py_value = NULL;
+    int rc = 0;
+
+    jp->p++;
+    py_out = PyList_New(0);
+    if (!py_out) return NULL;
+
+    json_skip_space(jp);
+    if (jp->p < jp->end && *jp->p == ']') {
+        jp->p++;
+        return py_out;
+    }
+
+    while (1) {
+        py_value = json_parse_value(jp);
+        if (!py_value) goto error;
+
+        rc = PyList_Append(py_out, py_value);
+        Py_DECREF(py_value);
+        if (rc < 0) goto error;
+
+        json_skip_space(jp);
+        if (jp->p < jp->end && *jp->p == ',') { jp->p++; continue; }
+        if (jp->p < jp->end && *jp->p == ']') { jp->p++; return py_out; }
+        json_invalid(jp);
+        goto error;
+    }
+
+error:
+    Py_DECREF(py_out);
+    return NULL;
+}
+
+static PyObject *json_parse_value(JsonParser *jp) {
+    PyObject *py_out = NULL;
+
+    json_skip_space(jp);
+    if (jp->p >= jp->end) return json_invalid(jp);
+
+    switch (*jp->p) {
+    case '{':
+    case '[':
+        // Deeply nested values are left to json.loads.
+        if (++jp->depth > ACCEL_JSON_MAX_DEPTH) return json_invalid(jp);
+        py_out = (*jp->p == '{') ? json_parse_object(jp) : json_parse_array(jp);
+        jp->depth--;
+        return py_out;
+    case '"':
+        return json_parse_string(jp, 0);
+    case 't':
+        return json_parse_keyword(jp, "true", Py_True);
+    case 'f':
+        return json_parse_keyword(jp, "false", Py_False);
+    case 'n':
+        return json_parse_keyword(jp, "null", Py_None);
+    case 'N':
+        return json_parse_constant(jp, "NaN", NAN);
+    case 'I':
+        return json_parse_constant(jp, "Infinity", HUGE_VAL);
+    case '-':
+        if (jp->end - jp->p > 1 && jp->p[1] == 'I') {
+            return json_parse_constant(jp, "-Infinity", -HUGE_VAL);
+        }
+        return json_parse_number(jp);
+    default:
+        if (*jp->p >= '0' && *jp->p <= '9') return json_parse_number(jp);
+        return json_invalid(jp);
+    }
+}
+
+//
+// Can values of this encoding be parsed natively? Other encodings are
+// decoded to str first.
+//
+static int json_native_encoding(const char *encoding) {
+    return encoding && (strcmp(encoding, "utf8") == 0 || strcmp(encoding, "utf-8") == 0);
+}
+
+//
+// Parse a JSON document like `json.loads`. Object keys are interned in
+// `keys` if it is not NULL. The byte following the text must be writable.
+//
+// Returns a new reference, or NULL with an exception set. If `*invalid`
+// is set, no exception is set and the text has to be parsed by json.loads.
+//
+static PyObject *json_parse(
+    char *s,
+    unsigned long long s_l,
+    InternTable *keys,
+    const char *errors,
+    int *invalid
+) {
+    JsonParser jp;
+    PyObject *py_out = NULL;
+
+    memset(&jp, 0, sizeof(jp));
+    jp.p = s;
+    jp.end = s + s_l;
+    jp.errors = errors;
+    jp.keys = keys;
+
+    py_out = json_parse_value(&jp);
+    if (py_out) {
+        json_skip_space(&jp);
+        if (jp.p != jp.end) {
+            Py_CLEAR(py_out);
+            jp.invalid = 1;
+        }
+    }
+
+    // Errors other than invalid text (e.g., bad UTF-8) are raised as is.
+    if (jp.invalid && PyErr_Occurred()) jp.invalid = 0;
+
+    DESTROY(jp.scratch);
+    *invalid = jp.invalid;
+    return py_out;
+}
+
+//
+// End JSON
+//
+
+//
+// Temporal cache
+//
+// Recently decoded date, datetime and timedelta objects keyed on their
+// raw bytes. Timestamps in log tables repeat heavily, so most of them can
+// be returned without building a new object. The cache is two-way set
+// associative with least recently used replacement within each set.
+//
+
+#define ACCEL_TEMPORAL_CACHE_SETS 256 // Must be a power of two
+#define ACCEL_TEMPORAL_MAX_LENGTH 32
+
+#define ACCEL_TEMPORAL_DATETIME 0
+#define ACCEL_TEMPORAL_DATE 1
+#define ACCEL_TEMPORAL_TIMEDELTA 2
+
+typedef struct {
+    PyObject *py_value; // Cached object (NULL for empty entries)
+    int kind; // ACCEL_TEMPORAL_* type of the object
+    unsigned int key_l; // Length of the raw bytes
+    char key[ACCEL_TEMPORAL_MAX_LENGTH]; // Raw bytes
+} TemporalEntry;
+
+typedef struct {
+    TemporalEntry entries[ACCEL_TEMPORAL_CACHE_SETS][2]; // Most recently used first
+} TemporalCache;
+
+static void temporal_cache_free(TemporalCache *cache) {
+    if (!cache) return;
+    for (unsigned long i = 0; i < ACCEL_TEMPORAL_CACHE_SETS; i++) {
+        Py_CLEAR(cache->entries[i][0].py_value);
+        Py_CLEAR(cache->entries[i][1].py_value);
+    }
+    free(cache);
+}
+
+static inline TemporalEntry *temporal_cache_set(
+    TemporalCache *cache,
+    int kind,
+    const char *s,
+    unsigned long long s_l
+) {
+    uint64_t hash = intern_hash(s, s_l) + (uint64_t)kind;
+    return cache->entries[(hash ^ (hash >> 32)) & (ACCEL_TEMPORAL_CACHE_SETS - 1)];
+}
+
+static inline int temporal_entry_matches(
+    TemporalEntry *entry,
+    int kind,
+    const char *s,
+    unsigned long long s_l
+) {
+    return entry->py_value && entry->kind == kind && entry->key_l == s_l &&
+           memcmp(entry->key, s, s_l) == 0;
+}
+
+//
+// Return a new reference to the cached object for `s`, or NULL if there
+// is none. No exception is set.
+//
+static PyObject *temporal_cache_get(
+    TemporalCache *cache,
+    int kind,
+    const char *s,
+    unsigned long long s_l
+) {
+    if (!cache || s_l > ACCEL_TEMPORAL_MAX_LENGTH) return NULL;
+
+    TemporalEntry *set = temporal_cache_set(cache, kind, s, s_l);
+
+    if (temporal_entry_matches(&set[0], kind, s, s_l)) {
+        Py_INCREF(set[0].py_value);
+        return set[0].py_value;
+    }
+
+    if (temporal_entry_matches(&set[1], kind, s, s_l)) {
+        TemporalEntry tmp = set[0];
+        set[0] = set[1];
+        set[1] = tmp;
+        Py_INCREF(set[0].py_value);
+        return set[0].py_value;
+    }
+
+    return NULL;
+}
+
+//
+// Add an object to the cache, evicting the least recently used object of
+// its set.
+//
+static void temporal_cache_put(
+    TemporalCache *cache,
+    int kind,
+    const char *s,
+    unsigned long long s_l,
+    PyObject *py_value
+) {
+    if (!cache || s_l > ACCEL_TEMPORAL_MAX_LENGTH) return;
+
+    TemporalEntry *set = temporal_cache_set(cache, kind, s, s_l);
+
+    Py_CLEAR(set[1].py_value);
+    set[1] = set[0];
+    set[0].py_value = py_value;
+    set[0].kind = kind;
+    set[0].key_l = (unsigned int)s_l;
+    memcpy(set[0].key, s, s_l);
+    Py_INCREF(py_value);
+}
+
+//
+// End Temporal cache
+//
+
+//
+// Prefetcher
+//
+// Reads the row data packets of an unbuffered result ahead of the consumer
+// on a helper thread. Framed payloads are queued back to back in blocks,
+// and rows are decoded from the queue while more of them arrive. The
+// helper thread stops after the EOF or error packet of the result, and
+// pauses while ACCEL_PREFETCH_MAX_BYTES of payloads are waiting. It never
+// uses the Python API.
+//
+
+#define ACCEL_PREFETCH_BLOCK_SIZE (256 * 1024)
+#define ACCEL_PREFETCH_MAX_BYTES (16 * 1024 * 1024)
+
+// Payloads are handed to the consumer in batches of at least this size,
+// unless no more data has been received yet.
+#define ACCEL_PREFETCH_PUBLISH_SIZE (64 * 1024)
+
+// Number of consumed blocks kept for reuse
+#define ACCEL_PREFETCH_SPARE_BLOCKS 8
+
+// Interval for checking for signals and stop requests while waiting
+#define ACCEL_PREFETCH_WAIT_MSEC 100
+
+#define ACCEL_INVALID_THREAD_ID ((unsigned long)-1)
+
+typedef struct PrefetchBlock {
+    struct PrefetchBlock *next; // Next (newer) block
+    unsigned long long size; // Allocated size of data
+    unsigned long long used; // Bytes of data written by the helper thread
+    unsigned long long pos; // Bytes of data read by the consumer
+    char *data; // Queued entries
+} PrefetchBlock;
+
+//
+// Header of a queued payload. The payload follows the header and is padded
+// to a multiple of 8 bytes, leaving at least one spare byte after it.
+//
+typedef struct {
+    unsigned long long length; // Length of the payload
+    unsigned long long next_seq_id; // Sequence number expected after the packet
+} PrefetchEntry;
+
+typedef struct {
+    SocketReaderObject *reader; // Socket reader used by the helper thread
+    accel_socket_t sock; // Socket of the reader
+    PacketFramer framer; // Framing state of the helper thread
+    PyThread_type_lock mutex; // Protects the queue and flags below
+    PyThread_type_lock not_empty; // Released for a waiting consumer
+    PyThread_type_lock not_full; // Released for a waiting helper thread
+    PyThread_type_lock done; // Released when the helper thread exits
+    PrefetchBlock *head; // Oldest block, read by the consumer
+    PrefetchBlock *tail; // Newest block, written by the helper thread
+    PrefetchBlock *spares; // Blocks kept for reuse
+    int n_spares; // Number of spare blocks
+    unsigned long long queued; // Bytes of queued entries
+    unsigned long long pending; // Bytes appended to the tail block but not yet queued
+    unsigned long long limit; // Published bytes of the head block (consumer only)
+    unsigned long long consumed; // Bytes read since the last update of queued (consumer only)
+    int consumer_waiting; // Is the consumer waiting on not_empty?
+    int producer_waiting; // Is the helper thread waiting on not_full?
+    int stop; // Should the helper thread stop?
+    int finished; // Has the helper thread queued its last entry?
+    int owns_reader; // Is the reader marked busy for the helper thread?
+    int status; // Read status of the helper thread (see frame_packet_nogil)
+    int err; // Socket error code
+    uint8_t packet_number; // Packet number of a sequence error
+} Prefetcher;
+
+static inline unsigned long long prefetch_entry_size(unsigned long long length) {
+    return sizeof(PrefetchEntry) + ((length + 8) & ~7ULL);
+}
+
+static int prefetcher_stopped(Prefetcher *pf) {
+    PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+    int stop = pf->stop;
+    PyThread_release_lock(pf->mutex);
+    return stop;
+}
+
+//
+// Wait until the socket is readable, checking for stop requests.
+//
+// Returns 0 when data is available, 1 if the helper thread should stop,
+// or one of the negative ACCEL_READ_* codes.
+//
+static int prefetcher_wait_readable(Prefetcher *pf) {
+    struct pollfd pfd;
+    double waited = 0;
+    int rc = 0;
+
+    pfd.fd = pf->sock;
+    pfd.events = POLLIN;
+
+    while (!prefetcher_stopped(pf)) {
+        pfd.revents = 0;
+        rc = accel_poll(&pfd, 1, ACCEL_PREFETCH_WAIT_MSEC);
+        if (rc > 0) return 0;
+        if (rc < 0) {
+            pf->err = ACCEL_SOCKET_ERRNO;
+            if (pf->err == ACCEL_EINTR) continue;
+            return ACCEL_READ_ERROR;
+        }
+        waited += ACCEL_PREFETCH_WAIT_MSEC / 1000.0;
+        if (pf->reader->timeout >= 0 && waited >= pf->reader->timeout) {
+            return ACCEL_READ_TIMEOUT;
+        }
+    }
+
+    return 1;
+}
+
+//
+// Make the appended payloads visible to the consumer and wake it up.
+//
+static void prefetcher_publish(Prefetcher *pf) {
+    PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+    pf->tail->used += pf->pending;
+    pf->queued += pf->pending;
+    pf->pending = 0;
+    if (pf->consumer_waiting) {
+        pf->consumer_waiting = 0;
+        PyThread_release_lock(pf->not_empty);
+    }
+    PyThread_release_lock(pf->mutex);
+}
+
+//
+// Append a payload to the newest block. It is not visible to the consumer
+// until the next call to prefetcher_publish.
+//
+static int prefetcher_append(Prefetcher *pf, const char *data, unsigned long long data_l) {
+    unsigned long long entry_size = prefetch_entry_size(data_l);
+    PrefetchBlock *block = pf->tail;
+    PrefetchEntry *entry = NULL;
+
+    // Only this thread changes tail->used, so it can be read without the lock.
+    if (!block || block->size - block->used - pf->pending < entry_size) {
+        unsigned long long size = (entry_size > ACCEL_PREFETCH_BLOCK_SIZE) ?
+                                  entry_size : ACCEL_PREFETCH_BLOCK_SIZE;
+
+        if (pf->pending) prefetcher_publish(pf);
+
+        block = NULL;
+        if (size == ACCEL_PREFETCH_BLOCK_SIZE) {
+            PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+            if ((block = pf->spares)) {
+                pf->spares = block->next;
+                pf->n_spares--;
+            }
+            PyThread_release_lock(pf->mutex);
+        }
+
+        if (!block) {
+            block = malloc(sizeof(PrefetchBlock) + size);
+            if (!block) return -1;
+            block->size = size;
+            block->data = (char*)(block + 1);
+        }
+
+        block->next = NULL;
+        block->used = 0;
+        block->pos = 0;
+
+        PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+        if (pf->tail) pf->tail->next = block;
+        else pf->head = block;
+        pf->tail = block;
+        PyThread_release_lock(pf->mutex);
+    }
+
+    entry = (PrefetchEntry*)(block->data + block->used + pf->pending);
+    entry->length = data_l;
+    entry->next_seq_id = pf->framer.next_seq_id;
+    memcpy(entry + 1, data, data_l);
+    pf->pending += entry_size;
+
+    return 0;
+}
+
+static void prefetcher_run(void *arg) {
+    Prefetcher *pf = (Prefetcher*)arg;
+    char *data = NULL;
+    unsigned long long data_l = 0;
+    unsigned long long arena_l = 0;
+    int status = 0;
+
+    while (1) {
+        // Wait for the consumer to catch up.
+        if (pf->queued + pf->pending >= ACCEL_PREFETCH_MAX_BYTES) {
+            if (pf->pending) prefetcher_publish(pf);
+            PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+            while (!pf->stop && pf->queued >= ACCEL_PREFETCH_MAX_BYTES) {
+                pf->producer_waiting = 1;
+                PyThread_release_lock(pf->mutex);
+                PyThread_acquire_lock(pf->not_full, WAIT_LOCK);
+                PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+            }
+            PyThread_release_lock(pf->mutex);
+        }
+
+        if (prefetcher_stopped(pf)) {
+            status = 1;
+            break;
+        }
+
+        // Publish everything that is buffered before waiting for more.
+        arena_l = 0;
+        status = frame_packet_nogil(pf->reader, &pf->framer, ACCEL_INVALID_SOCKET,
+                                    &data, &data_l, &arena_l, &pf->packet_number, &pf->err);
+        if (status == ACCEL_READ_AGAIN && pf->pending) prefetcher_publish(pf);
+        while (status == ACCEL_READ_AGAIN || status == ACCEL_READ_INTERRUPTED) {
+            status = prefetcher_wait_readable(pf);
+            if (status) break;
+            status = frame_packet_nogil(pf->reader, &pf->framer, pf->sock,
+                                        &data, &data_l, &arena_l, &pf->packet_number, &pf->err);
+        }
+        if (status) break;
+
+        if (prefetcher_append(pf, data, data_l) < 0) {
+            status = ACCEL_READ_NOMEM;
+            break;
+        }
+
+        // EOF and error packets end the result.
+        if (data_l > 0 && ((uint8_t)data[0] == 0xFF ||
+                           ((uint8_t)data[0] == 0xFE && data_l < 9))) break;
+
+        if (pf->pending >= ACCEL_PREFETCH_PUBLISH_SIZE) prefetcher_publish(pf);
+    }
+
+    if (pf->pending) prefetcher_publish(pf);
+
+    PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+    pf->status = status;
+    pf->finished = 1;
+    if (pf->consumer_waiting) {
+        pf->consumer_waiting = 0;
+        PyThread_release_lock(pf->not_empty);
+    }
+    PyThread_release_lock(pf->mutex);
+
+    PyThread_release_lock(pf->done);
+}
+
+//
+// Stop the helper thread and free the prefetcher.
+//
+static void prefetcher_free(Prefetcher *pf) {
+    PrefetchBlock *block = NULL;
+
+    if (!pf) return;
+
+    if (pf->done) {
+        PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+        pf->stop = 1;
+        if (pf->producer_waiting) {
+            pf->producer_waiting = 0;
+            PyThread_release_lock(pf->not_full);
+        }
+        PyThread_release_lock(pf->mutex);
+
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(pf->done, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+
+        if (pf->owns_reader) pf->reader->busy = 0;
+    }
+
+    while ((block = pf->head)) {
+        pf->head = block->next;
+        free(block);
+    }
+    while ((block = pf->spares)) {
+        pf->spares = block->next;
+        free(block);
+    }
+    DESTROY(pf->framer.arena);
+    if (pf->mutex) PyThread_free_lock(pf->mutex);
+    if (pf->not_empty) PyThread_free_lock(pf->not_empty);
+    if (pf->not_full) PyThread_free_lock(pf->not_full);
+    if (pf->done) PyThread_free_lock(pf->done);
+    free(pf);
+}
+
+//
+// Start reading the packets of a result on a helper thread. Returns NULL
+// (without an exception) if reading ahead is not possible.
+//
+static Prefetcher *prefetcher_start(SocketReaderObject *reader, unsigned long long next_seq_id) {
+    Prefetcher *pf = NULL;
+    PyThread_type_lock done = NULL;
+
+    if (reader->busy || !reader->buff) return NULL;
+
+#ifdef ACCEL_HAVE_OPENSSL
+    // Records already decrypted by OpenSSL are not visible to a poll on the socket
+    if (reader->tls) return NULL;
+#endif
+
+    pf = calloc(1, sizeof(Prefetcher));
+    if (!pf) goto error;
+
+    if (reader_get_socket(reader, &pf->sock) < 0) goto error;
+
+    pf->reader = reader;
+    pf->framer.next_seq_id = next_seq_id;
+    pf->framer.compressed = reader->compression != ACCEL_COMPRESSION_NONE;
+
+    pf->mutex = PyThread_allocate_lock();
+    pf->not_empty = PyThread_allocate_lock();
+    pf->not_full = PyThread_allocate_lock();
+    done = PyThread_allocate_lock();
+    if (!pf->mutex || !pf->not_empty || !pf->not_full || !done) goto error;
+
+    // The wakeup locks are held until they are released for a waiter.
+    PyThread_acquire_lock(pf->not_empty, WAIT_LOCK);
+    PyThread_acquire_lock(pf->not_full, WAIT_LOCK);
+    PyThread_acquire_lock(done, WAIT_LOCK);
+
+    reader->busy = 1;
+    pf->owns_reader = 1;
+    pf->done = done;
+
+    if (PyThread_start_new_thread(prefetcher_run, pf) == ACCEL_INVALID_THREAD_ID) {
+        reader->busy = 0;
+        pf->done = NULL;
+        PyThread_free_lock(done);
+        goto error;
+    }
+
+    return pf;
+
+error:
+    PyErr_Clear();
+    prefetcher_free(pf);
+    return NULL;
+}
+
+//
+// Take the next payload off the queue, waiting for the helper thread with
+// the GIL released if necessary. The payload is only valid until the next
+// call, and the byte following it may be overwritten by the row parser.
+//
+// Returns 0 on success, -1 with an exception set if a signal handler
+// raised one, or the failed status of the helper thread.
+//
+static int prefetcher_pop(
+    Prefetcher *pf,
+    char **data,
+    unsigned long long *data_l,
+    unsigned long long *next_seq_id
+) {
+    PrefetchBlock *block = pf->head;
+    PrefetchEntry *entry = NULL;
+    PyLockStatus wait = PY_LOCK_ACQUIRED;
+    int status = 0;
+
+    // Entries below the limit have been published and can be read without
+    // the lock. The lock is only taken once they are used up.
+    while (!block || block->pos >= pf->limit) {
+        PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+
+        pf->queued -= pf->consumed;
+        pf->consumed = 0;
+
+        if (pf->producer_waiting && pf->queued <= ACCEL_PREFETCH_MAX_BYTES / 2) {
+            pf->producer_waiting = 0;
+            PyThread_release_lock(pf->not_full);
+        }
+
+        // Recycle the blocks read by previous calls. The newest block stays
+        // in place for the helper thread to append to.
+        while ((block = pf->head) && block->pos == block->used && block->next) {
+            pf->head = block->next;
+            if (pf->n_spares < ACCEL_PREFETCH_SPARE_BLOCKS &&
+                    block->size == ACCEL_PREFETCH_BLOCK_SIZE) {
+                block->next = pf->spares;
+                pf->spares = block;
+                pf->n_spares++;
+            } else {
+                free(block);
+            }
+        }
+
+        if (block && block->pos < block->used) {
+            pf->limit = block->used;
+            PyThread_release_lock(pf->mutex);
+            break;
+        }
+
+        if (pf->finished) {
+            // Reading past the end of the result is a lost connection.
+            status = (pf->status) ? pf->status : 1;
+            PyThread_release_lock(pf->mutex);
+            return status;
+        }
+
+        pf->consumer_waiting = 1;
+        PyThread_release_lock(pf->mutex);
+
+        Py_BEGIN_ALLOW_THREADS
+        wait = PyThread_acquire_lock_timed(pf->not_empty,
+                                           ACCEL_PREFETCH_WAIT_MSEC * 1000, 0);
+        Py_END_ALLOW_THREADS
+
+        if (wait != PY_LOCK_ACQUIRED) {
+            // Stop waiting, unless the helper thread has just woken us up.
+            PyThread_acquire_lock(pf->mutex, WAIT_LOCK);
+            int woken = !pf->consumer_waiting;
+            pf->consumer_waiting = 0;
+            PyThread_release_lock(pf->mutex);
+            if (woken) PyThread_acquire_lock(pf->not_empty, WAIT_LOCK);
+            if (PyErr_CheckSignals() < 0) return -1;
+        }
+
+        block = NULL;
+    }
+
+    entry = (PrefetchEntry*)(block->data + block->pos);
+    block->pos += prefetch_entry_size(entry->length);
+    pf->consumed += prefetch_entry_size(entry->length);
+
+    *data = (char*)(entry + 1);
+    *data_l = entry->length;
+    *next_seq_id = entry->next_seq_id;
+
+    return 0;
+}
+
+//
+// End Prefetcher
+//
+
+//
+// Row arena
+//
+// Raw row data packets of a buffered result, stored back to back in one
+// buffer, with the offset of each row. Rows are decoded from the arena
+// when they are fetched, so that a large result does not have to be held
+// as Python objects. It does not use the Python API.
+//
+
+typedef struct {
+    char *data; // Row payloads, followed by a spare byte for the decoders
+    unsigned long long size; // Bytes of data used
+    unsigned long long capacity; // Allocated size of data (without the spare byte)
+    unsigned long long *offsets; // Offset of each row, plus the end of the last row
+    unsigned long long n_rows; // Number of rows
+    unsigned long long n_offsets; // Number of offsets allocated
+} RowArena;
+
+static RowArena *row_arena_new(void) {
+    RowArena *arena = calloc(1, sizeof(RowArena));
+    if (!arena) return NULL;
+    arena->offsets = calloc(1024, sizeof(unsigned long long));
+    if (!arena->offsets) { free(arena); return NULL; }
+    arena->n_offsets = 1024;
+    return arena;
+}
+
+static void row_arena_free(RowArena *arena) {
+    if (!arena) return;
+    DESTROY(arena->data);
+    DESTROY(arena->offsets);
+    free(arena);
+}
+
+//
+// Append a row data packet to the arena.
+//
+static int row_arena_append(RowArena *arena, char *data, unsigned long long data_l) {
+    if (arena->size + data_l > arena->capacity) {
+        unsigned long long capacity = arena->capacity ? arena->capacity : 64 * 1024;
+        while (capacity < arena->size + data_l) capacity *= 2;
+        char *new_data = realloc(arena->data, capacity + 1);
+        if (!new_data) return -1;
+        arena->data = new_data;
+        arena->capacity = capacity;
+    }
+
+    if (arena->n_rows + 2 > arena->n_offsets) {
+        unsigned long long n_offsets = arena->n_offsets * 2;
+        unsigned long long *new_offsets = realloc(arena->offsets, n_offsets * sizeof(unsigned long long));
+        if (!new_offsets) return -1;
+        arena->offsets = new_offsets;
+        arena->n_offsets = n_offsets;
+    }
+
+    memcpy(arena->data + arena->size, data, data_l);
+    arena->size += data_l;
+    arena->offsets[++arena->n_rows] = arena->size;
+
+    return 0;
+}
+
+//
+// Give back the unused space of a complete arena.
+//
+static void row_arena_shrink(RowArena *arena) {
+    char *new_data = NULL;
+    unsigned long long *new_offsets = NULL;
+
+    if (arena->data && arena->size < arena->capacity) {
+        new_data = realloc(arena->data, arena->size + 1);
+        if (new_data) {
+            arena->data = new_data;
+            arena->capacity = arena->size;
+        }
+    }
+
+    if (arena->n_rows + 1 < arena->n_offsets) {
+        new_offsets = realloc(arena->offsets, (arena->n_rows + 1) * sizeof(unsigned long long));
+        if (new_offsets) {
+            arena->offsets = new_offsets;
+            arena->n_offsets = arena->n_rows + 1;
+        }
+    }
+}
+
+//
+// End Row arena
+//
+
+#ifdef ACCEL_HAVE_READ_ENGINE
+
+//
+// ReadEngine
+//
+// Receives data for many socket readers on one native thread. A reader
+// registered with an engine hands each of its receives to the engine and
+// sleeps until the receive is done. On Linux, receives are posted to an
+// io_uring straight into the readers' buffers and the completions of all
+// readers are reaped in batches; elsewhere, or if io_uring is not usable,
+// the engine thread polls the sockets instead. A receive is only done
+// once the bytes the reader is waiting for have arrived, including the
+// rest of a packet whose header has been received, so a reader is woken
+// about once per packet rather than once per segment.
+//
+// The receive fields of the readers are guarded by the engine's mutex.
+// Only the engine thread finishes a receive, and the reader does not
+// touch its buffer until then.
+//
+
+#define ACCEL_ENGINE_IO_URING 1
+#define ACCEL_ENGINE_POLL 2
+
+// States of the receive of a reader
+#define ACCEL_ENGINE_IDLE 0
+#define ACCEL_ENGINE_ACTIVE 1
+#define ACCEL_ENGINE_CANCELLING 2
+
+// Error code of a receive that was ended by closing the engine. The
+// reader then receives from its socket directly.
+#define ACCEL_ENGINE_CLOSED -1
+
+#define ACCEL_ENGINE_DEFAULT_READERS 256
+
+static PyTypeObject *ReadEngineType = NULL;
+
+typedef struct ReadEngineObject {
+    PyObject_HEAD
+    int backend; // ACCEL_ENGINE_IO_URING or ACCEL_ENGINE_POLL
+    unsigned long long max_readers; // Most readers that can be registered
+    unsigned long long n_readers; // Number of registered readers
+    PyThread_type_lock mutex; // Guards the fields below and the readers' receives
+    PyThread_type_lock done; // Held while the engine thread runs
+    int joined; // Has the engine thread been waited for?
+    int stopping; // Has the engine been closed (or failed)?
+    SocketReaderObject *active; // Readers with a receive in progress
+    int wake[2]; // Pipe that wakes up the poll thread
+    struct pollfd *pfds; // Poll set of the poll thread
+    SocketReaderObject **polled; // Readers of the entries in pfds
+#ifdef ACCEL_HAVE_IO_URING
+    int ring_fd; // io_uring instance
+    void *sq_ring; // Submission queue ring
+    size_t sq_ring_l;
+    void *cq_ring; // Completion queue ring (may be the same mapping)
+    size_t cq_ring_l;
+    struct io_uring_sqe *sqes; // Submission queue entries
+    size_t sqes_l;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_entries;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    int cancelled; // Have the receives been cancelled for closing?
+#endif
+} ReadEngineObject;
+
+//
+// Has a receive got everything it is waiting for? Called with the mutex.
+//
+static int engine_is_done(SocketReaderObject *r) {
+    unsigned long long avail = 0;
+    unsigned char *header = NULL;
+
+    if (r->engine_got >= r->engine_buff_l) return 1;
+    if (r->engine_got < r->engine_need) return 0;
+    if (!r->engine_packet) return 1;
+
+    avail = (unsigned long long)(r->engine_buff + r->engine_got - r->engine_packet);
+    if (avail < 4) return 0;
+
+    header = (unsigned char*)r->engine_packet;
+    return avail >= 4ULL + header[0] + (header[1] << 8) + (header[2] << 16);
+}
+
+//
+// Add a receive to the list of receives in progress. Called with the mutex.
+//
+static void engine_link(ReadEngineObject *e, SocketReaderObject *r) {
+    r->engine_prev = NULL;
+    r->engine_next = e->active;
+    if (e->active) e->active->engine_prev = r;
+    e->active = r;
+}
+
+//
+// Finish a receive and wake up its reader. Called with the mutex.
+//
+static void engine_finish(ReadEngineObject *e, SocketReaderObject *r, int err) {
+    if (r->engine_prev) r->engine_prev->engine_next = r->engine_next;
+    else e->active = r->engine_next;
+    if (r->engine_next) r->engine_next->engine_prev = r->engine_prev;
+    r->engine_prev = NULL;
+    r->engine_next = NULL;
+
+    r->engine_state = ACCEL_ENGINE_IDLE;
+    r->engine_err = err;
+    PyThread_release_lock(r->engine_ready);
+}
+
+//
+// Account for the result of a receive call: the number of bytes received,
+// or -1 with the error code in `err`. Called with the mutex.
+//
+// Returns 1 if the receive needs more data, or 0 if it was finished.
+//
+static int engine_received(ReadEngineObject *e, SocketReaderObject *r, long long rc, int err) {
+    int more = r->engine_state == ACCEL_ENGINE_ACTIVE && !e->stopping;
+
+    if (rc > 0) {
+        r->engine_got += (unsigned long long)rc;
+        if (more && !engine_is_done(r)) return 1;
+        engine_finish(e, r, 0);
+    }
+    else if (rc == 0) {
+        engine_finish(e, r, 0);
+    }
+    else if (err == EINTR || err == EAGAIN || err == EWOULDBLOCK || err == ECANCELED) {
+        if (more) return 1;
+        engine_finish(e, r, e->stopping ? ACCEL_ENGINE_CLOSED : 0);
+    }
+    else {
+        engine_finish(e, r, err);
+    }
+
+    return 0;
+}
+
+//
+// Wake up the poll thread. Called with the mutex.
+//
+static void engine_wake(ReadEngineObject *e) {
+    char c = 0;
+    // The pipe is non-blocking, and a full pipe wakes up the thread anyway.
+    if (write(e->wake[1], &c, 1) < 0) { /* ignore */ }
+}
+
+#ifdef ACCEL_HAVE_IO_URING
+
+//
+// Free the io_uring of the engine.
+//
+static void ring_free(ReadEngineObject *e) {
+    if (e->sqes) munmap(e->sqes, e->sqes_l);
+    if (e->cq_ring && e->cq_ring != e->sq_ring) munmap(e->cq_ring, e->cq_ring_l);
+    if (e->sq_ring) munmap(e->sq_ring, e->sq_ring_l);
+    if (e->ring_fd >= 0) close(e->ring_fd);
+    e->sqes = NULL;
+    e->cq_ring = NULL;
+    e->sq_ring = NULL;
+    e->ring_fd = -1;
+}
+
+//
+// Create an io_uring with room for `entries` submissions and map its
+// queues. The raw system calls are used, so liburing is not required.
+//
+// Returns 0 on success, or -1 with the error code in `errno`.
+//
+static int ring_setup(ReadEngineObject *e, unsigned entries) {
+    struct io_uring_params params;
+    char *sq = NULL;
+    char *cq = NULL;
+    unsigned *sq_array = NULL;
+    unsigned i = 0;
+    int err = 0;
+
+    memset(&params, 0, sizeof(params));
+
+    e->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (e->ring_fd < 0) { e->ring_fd = -1; return -1; }
+
+    // Receives on sockets are only efficient with the internal polling
+    // of the kernel (Linux 5.7).
+    if (!(params.features & IORING_FEAT_FAST_POLL)) { errno = ENOSYS; goto error; }
+
+    e->sq_ring_l = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    e->cq_ring_l = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (e->cq_ring_l > e->sq_ring_l) e->sq_ring_l = e->cq_ring_l;
+        e->cq_ring_l = e->sq_ring_l;
+    }
+
+    e->sq_ring = mmap(NULL, e->sq_ring_l, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_SQ_RING);
+    if (e->sq_ring == MAP_FAILED) { e->sq_ring = NULL; goto error; }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        e->cq_ring = e->sq_ring;
+    }
+    else {
+        e->cq_ring = mmap(NULL, e->cq_ring_l, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_CQ_RING);
+        if (e->cq_ring == MAP_FAILED) { e->cq_ring = NULL; goto error; }
+    }
+
+    e->sqes_l = params.sq_entries * sizeof(struct io_uring_sqe);
+    e->sqes = mmap(NULL, e->sqes_l, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_SQES);
+    if (e->sqes == MAP_FAILED) { e->sqes = NULL; goto error; }
+
+    sq = (char*)e->sq_ring;
+    cq = (char*)e->cq_ring;
+    e->sq_head = (unsigned*)(sq + params.sq_off.head);
+    e->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    e->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    e->sq_entries = (unsigned*)(sq + params.sq_off.ring_entries);
+    e->cq_head = (unsigned*)(cq + params.cq_off.head);
+    e->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    e->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    e->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // Entries are always submitted in order, so the index array is fixed.
+    sq_array = (unsigned*)(sq + params.sq_off.array);
+    for (i = 0; i < params.sq_entries; i++) sq_array[i] = i;
+
+    return 0;
+
+error:
+    err = errno;
+    ring_free(e);
+    errno = err;
+    return -1;
+}
+
+//
+// Queue a submission. Called with the mutex.
+//
+// Returns the entry to fill in, or NULL if the queue is full.
+//
+static struct io_uring_sqe *ring_queue(ReadEngineObject *e, unsigned char opcode, uint64_t user_data) {
+    unsigned tail = *e->sq_tail;
+    struct io_uring_sqe *sqe = NULL;
+
+    if (tail - __atomic_load_n(e->sq_head, __ATOMIC_ACQUIRE) >= *e->sq_entries) return NULL;
+
+    sqe = &e->sqes[tail & *e->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = -1;
+    sqe->user_data = user_data;
+    return sqe;
+}
+
+//
+// Publish the entry returned by ring_queue. Called with the mutex.
+//
+static void ring_publish(ReadEngineObject *e) {
+    __atomic_store_n(e->sq_tail, *e->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+//
+// Queue the next receive call of a reader. Called with the mutex.
+// Completions carry the reader; cancellations are tagged with the low bit.
+//
+static int ring_queue_recv(ReadEngineObject *e, SocketReaderObject *r) {
+    unsigned long long room = r->engine_buff_l - r->engine_got;
+    struct io_uring_sqe *sqe = ring_queue(e, IORING_OP_RECV, (uint64_t)(uintptr_t)r);
+
+    if (!sqe) return -1;
+    sqe->fd = r->engine_sock;
+    sqe->addr = (uint64_t)(uintptr_t)(r->engine_buff + r->engine_got);
+    sqe->len = (room > INT32_MAX) ? INT32_MAX : (unsigned)room;
+    ring_publish(e);
+    return 0;
+}
+
+static void ring_queue_cancel(ReadEngineObject *e, SocketReaderObject *r) {
+    struct io_uring_sqe *sqe = ring_queue(e, IORING_OP_ASYNC_CANCEL,
+                                          (uint64_t)(uintptr_t)r | 1);
+    if (!sqe) return;
+    sqe->addr = (uint64_t)(uintptr_t)r;
+    ring_publish(e);
+}
+
+//
+// Submit the queued entries without waiting for completions. Called with
+// the mutex. Entries left over on failure are submitted by the engine
+// thread.
+//
+static void ring_submit(ReadEngineObject *e) {
+    unsigned pending = *e->sq_tail - __atomic_load_n(e->sq_head, __ATOMIC_ACQUIRE);
+    if (pending) syscall(__NR_io_uring_enter, e->ring_fd, pending, 0, 0, NULL, 0);
+}
+
+//
+// Main loop of the engine thread with io_uring: submit the queued entries
+// and wait for completions in one call, then handle all completions.
+//
+static void engine_run_ring(ReadEngineObject *e) {
+    struct io_uring_cqe *cqe = NULL;
+    SocketReaderObject *r = NULL;
+    unsigned pending = 0;
+    unsigned head = 0;
+    unsigned tail = 0;
+    int rc = 0;
+
+    while (1) {
+        PyThread_acquire_lock(e->mutex, WAIT_LOCK);
+        pending = *e->sq_tail - __atomic_load_n(e->sq_head, __ATOMIC_ACQUIRE);
+        PyThread_release_lock(e->mutex);
+
+        rc = (int)syscall(__NR_io_uring_enter, e->ring_fd, pending, 1,
+                          IORING_ENTER_GETEVENTS, NULL, 0);
+
+        PyThread_acquire_lock(e->mutex, WAIT_LOCK);
+
+        if (rc < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // The ring is unusable, so let the readers receive directly.
+            e->stopping = 1;
+            while (e->active) engine_finish(e, e->active, ACCEL_ENGINE_CLOSED);
+            PyThread_release_lock(e->mutex);
+            return;
+        }
+
+        head = *e->cq_head;
+        tail = __atomic_load_n(e->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            cqe = &e->cqes[head & *e->cq_mask];
+            // Skip wakeups and cancellations.
+            if (!cqe->user_data || (cqe->user_data & 1)) continue;
+            r = (SocketReaderObject*)(uintptr_t)cqe->user_data;
+            if (engine_received(e, r, (cqe->res < 0) ? -1 : cqe->res, -cqe->res) &&
+                    ring_queue_recv(e, r) < 0) {
+                engine_finish(e, r, EBUSY);
+            }
+        }
+        __atomic_store_n(e->cq_head, head, __ATOMIC_RELEASE);
+
+        if (e->stopping) {
+            if (!e->active) {
+                PyThread_release_lock(e->mutex);
+                return;
+            }
+            if (!e->cancelled) {
+                for (r = e->active; r; r = r->engine_next) {
+                    if (r->engine_state == ACCEL_ENGINE_ACTIVE) ring_queue_cancel(e, r);
+                }
+                e->cancelled = 1;
+            }
+        }
+
+        PyThread_release_lock(e->mutex);
+    }
+}
+
+#endif
+
+//
+// Main loop of the engine thread without io_uring: poll the sockets with
+// receives in progress, then receive from the ones that are readable.
+//
+static void engine_run_poll(ReadEngineObject *e) {
+    SocketReaderObject *r = NULL;
+    SocketReaderObject *next = NULL;
+    char drain[64];
+    nfds_t n = 0;
+    nfds_t i = 0;
+    unsigned long long room = 0;
+    long long rc = 0;
+
+    while (1) {
+        PyThread_acquire_lock(e->mutex, WAIT_LOCK);
+
+        e->pfds[0].fd = e->wake[0];
+        e->pfds[0].events = POLLIN;
+        e->pfds[0].revents = 0;
+        n = 1;
+
+        for (r = e->active; r; r = next) {
+            next = r->engine_next;
+            if (e->stopping) {
+                engine_finish(e, r, ACCEL_ENGINE_CLOSED);
+            }
+            else if (r->engine_state == ACCEL_ENGINE_CANCELLING) {
+                engine_finish(e, r, 0);
+            }
+            else {
+                e->pfds[n].fd = r->engine_sock;
+                e->pfds[n].events = POLLIN;
+                e->pfds[n].revents = 0;
+                e->polled[n++] = r;
+            }
+        }
+
+        if (e->stopping) {
+            PyThread_release_lock(e->mutex);
+            return;
+        }
+
+        PyThread_release_lock(e->mutex);
+
+        rc = poll(e->pfds, n, -1);
+        if (rc < 0 && errno != EINTR) {
+            PyThread_acquire_lock(e->mutex, WAIT_LOCK);
+            e->stopping = 1;
+            PyThread_release_lock(e->mutex);
+            continue;
+        }
+        if (rc <= 0) continue;
+
+        if (e->pfds[0].revents) {
+            while (read(e->wake[0], drain, sizeof(drain)) > 0) { }
+        }
+
+        PyThread_acquire_lock(e->mutex, WAIT_LOCK);
+        for (i = 1; i < n; i++) {
+            r = e->polled[i];
+            // Cancelled receives are finished at the top of the loop.
+            if (!e->pfds[i].revents || r->engine_state != ACCEL_ENGINE_ACTIVE) continue;
+            room = r->engine_buff_l - r->engine_got;
+            if (room > INT32_MAX) room = INT32_MAX;
+            rc = recv(r->engine_sock, r->engine_buff + r->engine_got, (size_t)room, MSG_DONTWAIT);
+            engine_received(e, r, rc, (rc < 0) ? errno : 0);
+        }
+        PyThread_release_lock(e->mutex);
+    }
+}
+
+static void engine_run(void *arg) {
+    ReadEngineObject *e = (ReadEngineObject*)arg;
+
+#ifdef ACCEL_HAVE_IO_URING
+    if (e->backend == ACCEL_ENGINE_IO_URING) engine_run_ring(e);
+    else
+#endif
+    engine_run_poll(e);
+
+    PyThread_release_lock(e->done);
+}
+
+//
+// Receive data for a reader through its engine. This is called without
+// the GIL, and has the same return values as socket_recv. If the wait is
+// interrupted by a signal, -1 is returned with ACCEL_EINTR in `err`.
+//
+static long long engine_recv_nogil(
+    SocketReaderObject *self,
+    accel_socket_t sock,
+    char *buff,
+    unsigned long long buff_l,
+    unsigned long long need,
+    char *packet,
+    int *err
+) {
+    ReadEngineObject *e = self->engine;
+    PyLockStatus wait = PY_LOCK_ACQUIRED;
+    PY_TIMEOUT_T timeout = -1;
+
+    PyThread_acquire_lock(e->mutex, WAIT_LOCK);
+
+    if (e->stopping) {
+        PyThread_release_lock(e->mutex);
+        return socket_recv(sock, buff, buff_l, self->timeout, err);
+    }
+
+    self->engine_sock = sock;
+    self->engine_buff = buff;
+    self->engine_buff_l = buff_l;
+    self->engine_need = (need < 1) ? 1 : need;
+    self->engine_packet = packet;
+    self->engine_got = 0;
+    self->engine_err = 0;
+    self->engine_state = ACCEL_ENGINE_ACTIVE;
+    engine_link(e, self);
+
+#ifdef ACCEL_HAVE_IO_URING
+    if (e->backend == ACCEL_ENGINE_IO_URING) {
+        if (ring_queue_recv(e, self) < 0) engine_finish(e, self, EBUSY);
+        else ring_submit(e);
+    }
+    else
+#endif
+    engine_wake(e);
+
+    PyThread_release_lock(e->mutex);
+
+    if (self->timeout >= 0) {
+        timeout = (self->timeout * 1e6 < (double)PY_TIMEOUT_MAX)
+                ? (PY_TIMEOUT_T)(self->timeout * 1e6) : PY_TIMEOUT_MAX;
+    }
+
+    wait = PyThread_acquire_lock_timed(self->engine_ready, timeout, 1);
+
+    if (wait != PY_LOCK_ACQUIRED) {
+        // Take the receive back, and wait until the engine lets go of it.
+        PyThread_acquire_lock(e->mutex, WAIT_LOCK);
+        if (self->engine_state == ACCEL_ENGINE_ACTIVE) {
+            self->engine_state = ACCEL_ENGINE_CANCELLING;
+#ifdef ACCEL_HAVE_IO_URING
+            if (e->backend == ACCEL_ENGINE_IO_URING) {
+                ring_queue_cancel(e, self);
+                ring_submit(e);
+            }
+            else
+#endif
+            engine_wake(e);
+        }
+        PyThread_release_lock(e->mutex);
+        PyThread_acquire_lock(self->engine_ready, WAIT_LOCK);
+    }
+
+    if (self->engine_got > 0) return (long long)self->engine_got;
+    if (wait == PY_LOCK_INTR) { *err = ACCEL_EINTR; return -1; }
+    if (wait != PY_LOCK_ACQUIRED) return -2;
+    if (self->engine_err == ACCEL_ENGINE_CLOSED) {
+        return socket_recv(sock, buff, buff_l, self->timeout, err);
+    }
+    if (self->engine_err) { *err = self->engine_err; return -1; }
+    return 0;
+}
+
+//
+// Remove a reader from its engine. The reader must not be reading.
+//
+static void engine_detach(SocketReaderObject *reader) {
+    ReadEngineObject *e = reader->engine;
+
+    if (reader->engine_ready) {
+        PyThread_free_lock(reader->engine_ready);
+        reader->engine_ready = NULL;
+    }
+    e->n_readers--;
+    reader->engine = NULL;
+    Py_DECREF(e);
+}
+
+//
+// Stop the engine thread and free the resources of the backend. Readers
+// that are still registered receive from their sockets directly.
+//
+static void engine_stop(ReadEngineObject *self) {
+    if (!self->done || self->joined) return;
+
+    PyThread_acquire_lock(self->mutex, WAIT_LOCK);
+    if (!self->stopping) {
+        self->stopping = 1;
+#ifdef ACCEL_HAVE_IO_URING
+        if (self->backend == ACCEL_ENGINE_IO_URING) {
+            // A no-op wakes up the engine thread.
+            if (ring_queue(self, IORING_OP_NOP, 0)) ring_publish(self);
+            ring_submit(self);
+        }
+        else
+#endif
+        engine_wake(self);
+    }
+    PyThread_release_lock(self->mutex);
+
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->done, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+    self->joined = 1;
+
+#ifdef ACCEL_HAVE_IO_URING
+    ring_free(self);
+#endif
+    if (self->wake[0] >= 0) close(self->wake[0]);
+    if (self->wake[1] >= 0) close(self->wake[1]);
+    self->wake[0] = -1;
+    self->wake[1] = -1;
+    DESTROY(self->pfds);
+    DESTROY(self->polled);
+}
+
+static void ReadEngine_dealloc(ReadEngineObject *self) {
+    if (self->max_readers) {
+        engine_stop(self);
+#ifdef ACCEL_HAVE_IO_URING
+        ring_free(self);
+#endif
+        if (self->wake[0] >= 0) close(self->wake[0]);
+        if (self->wake[1] >= 0) close(self->wake[1]);
+        DESTROY(self->pfds);
+        DESTROY(self->polled);
+    }
+    if (self->mutex) PyThread_free_lock(self->mutex);
+    if (self->done) PyThread_free_lock(self->done);
+    PyObject_Del(self);
+}
+
+//
+// Create the wake pipe and poll set of the poll backend.
+//
+static int engine_setup_poll(ReadEngineObject *self) {
+    int i = 0;
+
+    if (pipe(self->wake) < 0) {
+        self->wake[0] = -1;
+        self->wake[1] = -1;
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++) {
+        fcntl(self->wake[i], F_SETFL, fcntl(self->wake[i], F_GETFL) | O_NONBLOCK);
+        fcntl(self->wake[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    self->pfds = calloc(self->max_readers + 1, sizeof(struct pollfd));
+    self->polled = calloc(self->max_readers + 1, sizeof(SocketReaderObject*));
+    if (!self->pfds || !self->polled) { PyErr_NoMemory(); return -1; }
+
+    return 0;
+}
+
+static int ReadEngine_init(ReadEngineObject *self, PyObject *args, PyObject *kwds) {
+    unsigned long long max_readers = ACCEL_ENGINE_DEFAULT_READERS;
+    char *backend = NULL;
+    char *keywords[] = {"max_readers", "backend", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Kz", keywords, &max_readers, &backend)) {
+        return -1;
+    }
+
+    if (self->max_readers) {
+        PyErr_SetString(PyExc_RuntimeError, "read engine is already initialized");
+        return -1;
+    }
+
+    if (max_readers < 1 || max_readers > 16384) {
+        PyErr_SetString(PyExc_ValueError, "max_readers must be between 1 and 16384");
+        return -1;
+    }
+
+    if (backend && strcmp(backend, "io_uring") && strcmp(backend, "poll")) {
+        PyErr_Format(PyExc_ValueError, "unknown read engine backend: %s", backend);
+        return -1;
+    }
+
+    // The resources below are freed by the deallocator once this is set.
+    self->max_readers = max_readers;
+    self->wake[0] = -1;
+    self->wake[1] = -1;
+#ifdef ACCEL_HAVE_IO_URING
+    self->ring_fd = -1;
+#endif
+
+    self->backend = ACCEL_ENGINE_POLL;
+
+    if (!backend || !strcmp(backend, "io_uring")) {
+#ifdef ACCEL_HAVE_IO_URING
+        // Each reader has at most a receive and its cancellation queued.
+        if (ring_setup(self, (unsigned)(2 * max_readers + 1)) == 0) {
+            self->backend = ACCEL_ENGINE_IO_URING;
+        }
+        else if (backend) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+#else
+        if (backend) {
+            PyErr_SetString(PyExc_ValueError, "io_uring is not available on this platform");
+            return -1;
+        }
+#endif
+    }
+
+    if (self->backend == ACCEL_ENGINE_POLL && engine_setup_poll(self) < 0) return -1;
+
+    self->mutex = PyThread_allocate_lock();
+    if (!self->mutex) { PyErr_NoMemory(); return -1; }
+
+    self->done = PyThread_allocate_lock();
+    if (!self->done) { PyErr_NoMemory(); return -1; }
+    PyThread_acquire_lock(self->done, WAIT_LOCK);
+
+    if (PyThread_start_new_thread(engine_run, self) == ACCEL_INVALID_THREAD_ID) {
+        PyThread_release_lock(self->done);
+        PyThread_free_lock(self->done);
+        self->done = NULL;
+        PyErr_SetString(PyExc_RuntimeError, "can't start read engine thread");
+        return -1;
+    }
+
+    return 0;
+}
+
+static PyObject *ReadEngine_register(ReadEngineObject *self, PyObject *args) {
+    SocketReaderObject *reader = NULL;
+
+    if (!PyArg_ParseTuple(args, "O!", SocketReaderType, &reader)) return NULL;
+
+    if (!self->done || self->stopping) {
+        PyErr_SetString(PyExc_ValueError, "read engine is closed");
+        return NULL;
+    }
+
+    if (reader->engine == self) Py_RETURN_NONE;
+
+    if (reader->engine) {
+        PyErr_SetString(PyExc_ValueError, "socket reader is registered with another read engine");
+        return NULL;
+    }
+
+    if (reader->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent reads from one connection are not allowed");
+        return NULL;
+    }
+
+    if (!reader->buff || reader->py_sock == Py_None) {
+        PyErr_SetString(PyExc_ValueError, "only socket readers with a socket can be registered");
+        return NULL;
+    }
+
+#ifdef ACCEL_HAVE_OPENSSL
+    if (reader->tls) {
+        PyErr_SetString(PyExc_ValueError, "TLS connections can not be read by a read engine");
+        return NULL;
+    }
+#endif
+
+    if (self->n_readers >= self->max_readers) {
+        PyErr_SetString(PyExc_ValueError, "read engine has no room for more readers");
+        return NULL;
+    }
+
+    reader->engine_ready = PyThread_allocate_lock();
+    if (!reader->engine_ready) return PyErr_NoMemory();
+
+    // The lock is held until the engine releases it for the reader.
+    PyThread_acquire_lock(reader->engine_ready, WAIT_LOCK);
+
+    Py_INCREF(self);
+    reader->engine = self;
+    reader->engine_state = ACCEL_ENGINE_IDLE;
+    self->n_readers++;
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *ReadEngine_unregister(ReadEngineObject *self, PyObject *args) {
+    SocketReaderObject *reader = NULL;
+
+    if (!PyArg_ParseTuple(args, "O!", SocketReaderType, &reader)) return NULL;
+
+    if (reader->engine != self) {
+        PyErr_SetString(PyExc_ValueError, "socket reader is not registered with this read engine");
+        return NULL;
+    }
+
+    if (reader->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent reads from one connection are not allowed");
+        return NULL;
+    }
+
+    engine_detach(reader);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *ReadEngine_close(ReadEngineObject *self, PyObject *Py_UNUSED(args)) {
+    engine_stop(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject *ReadEngine_get_backend(ReadEngineObject *self, void *closure) {
+    return PyUnicode_FromString(
+        (self->backend == ACCEL_ENGINE_IO_URING) ? "io_uring" : "poll"
+    );
+}
+
+static PyObject *ReadEngine_get_closed(ReadEngineObject *self, void *closure) {
+    return PyBool_FromLong(!self->done || self->stopping);
+}
+
+static PyObject *ReadEngine_get_readers(ReadEngineObject *self, void *closure) {
+    return PyLong_FromUnsignedLongLong(self->n_readers);
+}
+
+static PyMethodDef ReadEngine_methods[] = {
+    {"register", (PyCFunction)ReadEngine_register, METH_VARARGS,
+     "Receive the data of a socket reader through the engine from now on"},
+    {"unregister", (PyCFunction)ReadEngine_unregister, METH_VARARGS,
+     "Let a socket reader receive from its socket directly again"},
+    {"close", (PyCFunction)ReadEngine_close, METH_NOARGS,
+     "Stop the engine thread"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef ReadEngine_getset[] = {
+    {"backend", (getter)ReadEngine_get_backend, NULL,
+     "Mechanism used to receive data: 'io_uring' or 'poll'", NULL},
+    {"closed", (getter)ReadEngine_get_closed, NULL,
+     "Has the engine been closed?", NULL},
+    {"readers", (getter)ReadEngine_get_readers, NULL,
+     "Number of registered socket readers", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot ReadEngineType_slots[] = {
+    {Py_tp_init, (initproc)ReadEngine_init},
+    {Py_tp_dealloc, (destructor)ReadEngine_dealloc},
+    {Py_tp_methods, ReadEngine_methods},
+    {Py_tp_getset, ReadEngine_getset},
+    {Py_tp_doc, "Receives the data of many socket readers on one native thread"},
+    {0, NULL},
+};
+
+static PyType_Spec ReadEngineType_spec = {
+    .name = "_singlestoredb_accel.ReadEngine",
+    .basicsize = sizeof(ReadEngineObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT,
+    .slots = ReadEngineType_slots,
+};
+
+//
+// End ReadEngine
+//
+
+#endif
+
+//
+// Schema
+//
+// Column metadata of a result set: types, names, encodings, converters,
+// and the row types built from the names. Schemas are immutable once
+// built and are cached by their column definition packets and the
+// options they were built with, so that queries of the same shape
+// share them instead of decoding names and creating row types again.
+//
+
+static PyTypeObject *SchemaType = NULL;
+
+// Maximum number of schemas in the cache
+#define ACCEL_SCHEMA_CACHE_SIZE 256
+
+// Schema cache keyed by (column definitions, encoding, use_unicode, converters)
+static PyObject *schema_cache = NULL;
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *py_column_definitions; // Column definition packets, each preceded by its length
+    unsigned long long n_cols; // Total number of columns
+    unsigned long *type_codes; // Type code for each column
+    unsigned long *flags; // Column flags
+    unsigned long *scales; // Column scales
+    unsigned long *lengths; // Column display lengths
+    char *encoding; // Connection encoding (shared by the text columns in encodings)
+    const char **encodings; // Encoding for each column
+    PyObject **py_encodings; // Encoding for each column as Python string
+    PyObject **py_converters; // Converter for each column (NULL for the default)
+    PyObject **py_names; // Column names
+    PyObject *py_names_list; // Python list of column names
+    PyObject *py_namedtuple; // Generated namedtuple type (NULL until needed)
+    PyTypeObject *structsequence; // StructSequence type (NULL until needed)
+    PyStructSequence_Desc structsequence_desc;
+    PyObject *py_name_index; // Dict of column names to indexes for Row objects (NULL until needed)
+} SchemaObject;
+
+//
+// Fields of a column definition packet.
+//
+typedef struct {
+    char *table_name;
+    unsigned long long table_name_l;
+    char *name;
+    unsigned long long name_l;
+    unsigned long charsetnr;
+    unsigned long length;
+    unsigned long type_code;
+    unsigned long flags;
+    unsigned long scale;
+} ColumnDefinition;
+
+static void read_length_coded_string(char **data, unsigned long long *data_l,
+                                     char **out, unsigned long long *out_l, int *is_null);
+
+static int parse_column_definition(char *data, unsigned long long data_l, ColumnDefinition *col) {
+    char *out = NULL;
+    unsigned long long out_l = 0;
+
+    // catalog, db, table_name, org_table, name, org_name
+    read_length_coded_string(&data, &data_l, &out, &out_l, NULL);
+    read_length_coded_string(&data, &data_l, &out, &out_l, NULL);
+    read_length_coded_string(&data, &data_l, &col->table_name, &col->table_name_l, NULL);
+    read_length_coded_string(&data, &data_l, &out, &out_l, NULL);
+    read_length_coded_string(&data, &data_l, &col->name, &col->name_l, NULL);
+    read_length_coded_string(&data, &data_l, &out, &out_l, NULL);
+
+    // 0x0c, charset (2), length (4), type (1), flags (2), scale (1)
+    if (data_l < 11) return -1;
+    col->charsetnr = *(uint16_t*)(data + 1);
+    col->length = *(uint32_t*)(data + 3);
+    col->type_code = *(uint8_t*)(data + 7);
+    col->flags = *(uint16_t*)(data + 8);
+    col->scale = *(uint8_t*)(data + 10);
+
+    return 0;
+}
+
+static void Schema_dealloc(SchemaObject *self) {
+    DESTROY(self->type_codes);
+    DESTROY(self->flags);
+    DESTROY(self->scales);
+    DESTROY(self->lengths);
+    DESTROY(self->encoding);
+    DESTROY(self->encodings);
+    // The field names stay allocated since rows keep the type alive.
+    DESTROY(self->structsequence_desc.fields);
+    if (self->py_encodings) {
+        for (unsigned long i = 0; i < self->n_cols; i++) {
+            Py_CLEAR(self->py_encodings[i]);
+        }
+        DESTROY(self->py_encodings);
+    }
+    if (self->py_converters) {
+        for (unsigned long i = 0; i < self->n_cols; i++) {
+            Py_CLEAR(self->py_converters[i]);
+        }
+        DESTROY(self->py_converters);
+    }
+    if (self->py_names) {
+        for (unsigned long i = 0; i < self->n_cols; i++) {
+            Py_CLEAR(self->py_names[i]);
+        }
+        DESTROY(self->py_names);
+    }
+    Py_CLEAR(self->structsequence);
+    Py_CLEAR(self->py_namedtuple);
+    Py_CLEAR(self->py_name_index);
+    Py_CLEAR(self->py_names_list);
+    Py_CLEAR(self->py_column_definitions);
+    PyObject_Del(self);
+}
+
+//
+// Build a schema from the column definition packets. The converters
+// tuple holds the converter of each column, or None for the default.
+//
+static SchemaObject *Schema_new(
+    PyObject *py_column_definitions,
+    unsigned long long n_cols,
+    PyObject *py_conn_encoding,
+    int use_unicode,
+    PyObject *py_converters
+) {
+    SchemaObject *self = NULL;
+    PyObject *py_ascii = NULL;
+    PyObject *py_seen = NULL;
+    PyObject *py_name = NULL;
+    PyObject *py_table_name = NULL;
+    char *defs = NULL;
+    Py_ssize_t defs_l = 0;
+    int rc = 0;
+
+    self = (SchemaObject*)PyObject_CallObject((PyObject*)SchemaType, NULL);
+    if (!self) goto error;
+
+    self->py_column_definitions = py_column_definitions;
+    Py_INCREF(py_column_definitions);
+    self->n_cols = n_cols;
+
+    self->type_codes = calloc(n_cols, sizeof(unsigned long));
+    if (!self->type_codes) goto error;
+
+    self->flags = calloc(n_cols, sizeof(unsigned long));
+    if (!self->flags) goto error;
+
+    self->scales = calloc(n_cols, sizeof(unsigned long));
+    if (!self->scales) goto error;
+
+    self->lengths = calloc(n_cols, sizeof(unsigned long));
+    if (!self->lengths) goto error;
+
+    self->encodings = calloc(n_cols, sizeof(char*));
+    if (!self->encodings) goto error;
+
+    self->py_encodings = calloc(n_cols, sizeof(PyObject*));
+    if (!self->py_encodings) goto error;
+
+    self->py_converters = calloc(n_cols, sizeof(PyObject*));
+    if (!self->py_converters) goto error;
+
+    self->py_names = calloc(n_cols, sizeof(PyObject*));
+    if (!self->py_names) goto error;
+
+    self->py_names_list = PyList_New(n_cols);
+    if (!self->py_names_list) goto error;
+
+    self->encoding = _PyUnicode_AsUTF8(py_conn_encoding);
+    if (!self->encoding) goto error;
+
+    py_ascii = PyUnicode_FromString("ascii");
+    if (!py_ascii) goto error;
+
+    py_seen = PySet_New(NULL);
+    if (!py_seen) goto error;
+
+    if (PyBytes_AsStringAndSize(py_column_definitions, &defs, &defs_l) < 0) goto error;
+
+    for (unsigned long i = 0; i < n_cols; i++) {
+        ColumnDefinition col = {0};
+        uint32_t packet_l = 0;
+
+        memcpy(&packet_l, defs, 4);
+        if (parse_column_definition(defs + 4, packet_l, &col) < 0) {
+            PyErr_SetString(PyExc_ValueError, "malformed column definition packet");
+            goto error;
+        }
+        defs += packet_l + 4;
+
+        self->type_codes[i] = col.type_code;
+        self->flags[i] = col.flags;
+        self->scales[i] = col.scale;
+        self->lengths[i] = col.length;
+
+        // Get field name, making sure it is not a duplicate.
+        py_name = PyUnicode_Decode(col.name, col.name_l, self->encoding, "strict");
+        if (!py_name) goto error;
+
+        rc = PySet_Contains(py_seen, py_name);
+        if (rc < 0) goto error;
+        if (rc) {
+            py_table_name = PyUnicode_Decode(col.table_name, col.table_name_l,
+                                             self->encoding, "strict");
+            if (!py_table_name) goto error;
+            self->py_names[i] = PyUnicode_FromFormat("%U.%U", py_table_name, py_name);
+            Py_CLEAR(py_table_name);
+            Py_CLEAR(py_name);
+            if (!self->py_names[i]) goto error;
+        } else {
+            self->py_names[i] = py_name;
+            py_name = NULL;
+        }
+
+        if (PySet_Add(py_seen, self->py_names[i]) < 0) goto error;
+
+        Py_INCREF(self->py_names[i]);  // Extra ref since SetItem steals one
+        if (PyList_SetItem(self->py_names_list, i, self->py_names[i]) < 0) goto error;
+
+        // Get field encodings (NULL means binary).
+        PyObject *py_encoding = NULL;
+        if (use_unicode) {
+            switch (col.type_code) {
+            case MYSQL_TYPE_JSON:
+                // JSON is decoded by the connection encoding regardless
+                // of the character set, unlike TEXT and BLOB.
+                py_encoding = py_conn_encoding;
+                break;
+            case MYSQL_TYPE_BIT:
+            case MYSQL_TYPE_TINY_BLOB:
+            case MYSQL_TYPE_MEDIUM_BLOB:
+            case MYSQL_TYPE_LONG_BLOB:
+            case MYSQL_TYPE_BLOB:
+            case MYSQL_TYPE_STRING:
+            case MYSQL_TYPE_VAR_STRING:
+            case MYSQL_TYPE_VARCHAR:
+            case MYSQL_TYPE_GEOMETRY:
+                py_encoding = (col.charsetnr == MYSQL_CHARSET_BINARY) ? NULL : py_conn_encoding;
+                break;
+            default:
+                py_encoding = py_ascii;
+            }
+        }
+
+        self->py_encodings[i] = py_encoding;
+        Py_XINCREF(self->py_encodings[i]);
+
+        self->encodings[i] = (!py_encoding) ? NULL :
+                             (py_encoding == py_ascii) ? "ascii" : self->encoding;
+
+        PyObject *py_converter = PyTuple_GetItem(py_converters, i);
+        if (!py_converter) goto error;
+        self->py_converters[i] = (py_converter == Py_None) ? NULL : py_converter;
+        Py_XINCREF(self->py_converters[i]);
+    }
+
+exit:
+    Py_XDECREF(py_name);
+    Py_XDECREF(py_table_name);
+    Py_XDECREF(py_seen);
+    Py_XDECREF(py_ascii);
+    return self;
+
+error:
+    Py_CLEAR(self);
+    goto exit;
+}
+
+//
+// Create the namedtuple type of the rows.
+//
+static int Schema_ensure_namedtuple(SchemaObject *self) {
+    int rc = 0;
+    PyObject *py_args = NULL;
+
+    if (self->py_namedtuple) goto exit;
+
+    py_args = PyTuple_New(2);
+    if (!py_args) goto error;
+
+    rc = PyTuple_SetItem(py_args, 0, PyStr.Row);
+    if (rc) goto error;
+    Py_INCREF(PyStr.Row);
+
+    rc = PyTuple_SetItem(py_args, 1, self->py_names_list);
+    if (rc) goto error;
+    Py_INCREF(self->py_names_list);
+
+    self->py_namedtuple = PyObject_Call(
+                              PyFunc.collections_namedtuple,
+                              py_args, PyObj.namedtuple_kwargs);
+    if (!self->py_namedtuple) goto error;
+
+exit:
+    Py_XDECREF(py_args);
+    return rc;
+
+error:
+    rc = -1;
+    goto exit;
+}
+
+//
+// Create the StructSequence type of the rows.
+//
+static int Schema_ensure_structsequence(SchemaObject *self) {
+    if (self->structsequence) return 0;
+
+    self->structsequence_desc.name = "singlestoredb.Row";
+    self->structsequence_desc.doc = "Row of data values";
+    self->structsequence_desc.n_in_sequence = (int)self->n_cols;
+    self->structsequence_desc.fields = calloc(self->n_cols + 1, sizeof(PyStructSequence_Field));
+    if (!self->structsequence_desc.fields) return -1;
+    for (unsigned long i = 0; i < self->n_cols; i++) {
+        self->structsequence_desc.fields[i].name = _PyUnicode_AsUTF8(self->py_names[i]);
+        if (!self->structsequence_desc.fields[i].name) return -1;
+        self->structsequence_desc.fields[i].doc = NULL;
+    }
+    self->structsequence = PyStructSequence_NewType(&self->structsequence_desc);
+    if (!self->structsequence) return -1;
+
+    return 0;
+}
+
+//
+// Create the column name lookup of Row objects.
+//
+static int Schema_ensure_name_index(SchemaObject *self) {
+    PyObject *py_index = NULL;
+    PyObject *py_i = NULL;
+
+    if (self->py_name_index) return 0;
+
+    py_index = PyDict_New();
+    if (!py_index) return -1;
+
+    for (unsigned long i = 0; i < self->n_cols; i++) {
+        py_i = PyLong_FromUnsignedLong(i);
+        if (!py_i || PyDict_SetItem(py_index, self->py_names[i], py_i) < 0) {
+            Py_XDECREF(py_i);
+            Py_DECREF(py_index);
+            return -1;
+        }
+        Py_DECREF(py_i);
+    }
+
+    self->py_name_index = py_index;
+    return 0;
+}
+
+//
+// Add a schema to the cache, dropping the oldest one to make room.
+//
+static int schema_cache_add(PyObject *py_key, SchemaObject *schema) {
+    if (PyDict_Size(schema_cache) >= ACCEL_SCHEMA_CACHE_SIZE) {
+        PyObject *py_oldest = NULL;
+        PyObject *py_value = NULL;
+        Py_ssize_t pos = 0;
+        if (PyDict_Next(schema_cache, &pos, &py_oldest, &py_value)) {
+            Py_INCREF(py_oldest);
+            int rc = PyDict_DelItem(schema_cache, py_oldest);
+            Py_DECREF(py_oldest);
+            if (rc < 0) return -1;
+        }
+    }
+    return PyDict_SetItem(schema_cache, py_key, (PyObject*)schema);
+}
+
+//
+// Return the cached schema for the key or build and cache a new one.
+//
+static SchemaObject *Schema_get(
+    PyObject *py_column_definitions,
+    unsigned long long n_cols,
+    PyObject *py_conn_encoding,
+    int use_unicode,
+    PyObject *py_converters
+) {
+    SchemaObject *self = NULL;
+    PyObject *py_key = NULL;
+
+    py_key = Py_BuildValue("(OOOO)", py_column_definitions, py_conn_encoding,
+                           use_unicode ? Py_True : Py_False, py_converters);
+    if (!py_key) goto error;
+
+    self = (SchemaObject*)PyDict_GetItem(schema_cache, py_key);
+    if (self) {
+        Py_INCREF(self);
+        goto exit;
+    }
+
+    self = Schema_new(py_column_definitions, n_cols, py_conn_encoding,
+                      use_unicode, py_converters);
+    if (!self) goto error;
+
+    if (schema_cache_add(py_key, self) < 0) goto error;
+
+exit:
+    Py_XDECREF(py_key);
+    return self;
+
+error:
+    Py_CLEAR(self);
+    goto exit;
+}
+
+//
+// Return the cached schema of rows that only have column names, or build
+// and cache a new one. These schemas are used by unpickled rows.
+//
+static SchemaObject *Schema_get_for_names(PyObject *py_names) {
+    SchemaObject *self = NULL;
+    PyObject *py_key = NULL;
+    PyObject *py_name = NULL;
+    Py_ssize_t n_cols = 0;
+
+    py_names = PySequence_Tuple(py_names);
+    if (!py_names) goto error;
+    n_cols = PyTuple_Size(py_names);
+
+    py_key = Py_BuildValue("(sO)", "names", py_names);
+    if (!py_key) goto error;
+
+    self = (SchemaObject*)PyDict_GetItem(schema_cache, py_key);
+    if (self) {
+        Py_INCREF(self);
+        goto exit;
+    }
+
+    self = (SchemaObject*)PyObject_CallObject((PyObject*)SchemaType, NULL);
+    if (!self) goto error;
+
+    self->py_names = calloc(n_cols ? n_cols : 1, sizeof(PyObject*));
+    if (!self->py_names) { PyErr_NoMemory(); goto error; }
+    self->py_names_list = PyList_New(n_cols);
+    if (!self->py_names_list) goto error;
+    self->n_cols = n_cols;
+
+    for (Py_ssize_t i = 0; i < n_cols; i++) {
+        py_name = PyTuple_GetItem(py_names, i);
+        if (!PyUnicode_Check(py_name)) {
+            PyErr_SetString(PyExc_TypeError, "column names must be strings");
+            goto error;
+        }
+        Py_INCREF(py_name);
+        self->py_names[i] = py_name;
+        Py_INCREF(py_name);
+        PyList_SetItem(self->py_names_list, i, py_name);
+    }
+
+    if (Schema_ensure_name_index(self) < 0) goto error;
+    if (schema_cache_add(py_key, self) < 0) goto error;
+
+exit:
+    Py_XDECREF(py_key);
+    Py_XDECREF(py_names);
+    return self;
+
+error:
+    Py_CLEAR(self);
+    goto exit;
+}
+
+static PyType_Slot SchemaType_slots[] = {
+    {Py_tp_dealloc, (destructor)Schema_dealloc},
+    {Py_tp_doc, "Column metadata of a result set"},
+    {0, NULL},
+};
+
+static PyType_Spec SchemaType_spec = {
+    .name = "_singlestoredb_accel.Schema",
+    .basicsize = sizeof(SchemaObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT,
+    .slots = SchemaType_slots,
+};
+
+//
+// End Schema
+//
+
+//
+// State
+//
+
+static PyTypeObject *StateType = NULL;
+
+//
+// Typed buffer for one column of a columnar results type. Values are
+// stored in bytearrays so that numpy and Arrow can take them over without
+// copying. Variable-length values are stored back to back in py_data with
+// Arrow-style int64 offsets.
+//
+typedef struct {
+    int kind; // ACCEL_COL_* value type
+    int itemsize; // Bytes per value (0 for variable-length values)
+    int transcode; // Do string values need to be re-encoded to UTF-8?
+    int precision; // Precision of DECIMAL values
+    int scale; // Scale of DECIMAL values
+    PyObject *py_data; // bytearray of values
+    char *data; // Start of py_data
+    unsigned long long data_l; // Bytes of py_data used by variable-length values
+    unsigned long long data_size; // Allocated size of py_data for variable-length values
+    PyObject *py_offsets; // bytearray of value offsets for variable-length values
+    int64_t *offsets; // Start of py_offsets
+    PyObject *py_mask; // bytearray with a 1 for each NULL value
+    uint8_t *mask; // Start of py_mask
+    unsigned long long n_nulls; // Number of NULL values in the batch
+    PyObject *py_objs; // List of values for ACCEL_COL_OBJECT
+} ColumnBuffer;
+
+struct StateObject;
+
+// Converts a non-NULL text protocol value of one column to a Python object
+typedef PyObject *(*CellDecoder)(
+    struct StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+);
+
+typedef struct StateObject {
+    PyObject_HEAD
+    PyObject *py_conn; // Database connection
+    PyObject *py_rows; // Output object
+    PyObject *py_rfile; // Socket file I/O
+    PyObject *py_read; // File I/O read method
+    PyObject *py_sock; // Socket
+    PyObject *py_read_timeout; // Socket read timeout value
+    PyObject *py_settimeout; // Socket settimeout method
+    SocketReaderObject *reader; // Native socket reader (NULL if py_read is used)
+    SchemaObject *schema; // Column metadata; the arrays below are borrowed from it
+    PyObject **py_converters; // List of converter functions
+    PyObject **py_names; // Column names
+    PyObject *py_names_list; // Python list of column names
+    PyObject *py_default_converters; // Dict of default converters
+    PyObject *py_namedtuple; // Generated namedtuple type
+    PyObject *py_namedtuple_args; // Pre-allocated tuple for namedtuple args
+    PyTypeObject *structsequence; // StructSequence type (like C namedtuple)
+    PyObject **py_encodings; // Encoding for each column as Python string
+    PyObject **py_invalid_values; // Values to use when invalid data exists in a cell
+    const char **encodings; // Encoding for each column
+    unsigned long long n_cols; // Total number of columns
+    unsigned long long n_rows; // Total number of rows read
+    unsigned long long n_rows_in_batch; // Number of rows in current batch (fetchmany size)
+    unsigned long *type_codes; // Type code for each column
+    unsigned long *flags; // Column flags
+    unsigned long *scales; // Column scales
+    unsigned long *lengths; // Column display lengths
+    unsigned long *offsets; // Column offsets in buffer
+    PacketFramer framer; // Packet sequence number and multi-packet buffer
+    ColumnBuffer *columns; // Column buffers (NULL unless results are columnar)
+    InternTable **intern_tables; // String intern table for each column (NULL if not interned)
+    TemporalCache *temporal_cache; // Recently decoded date/time objects (NULL if not needed)
+    CellDecoder *decoders; // Decoder of each column's text values
+    PyObject **row_items; // Cells of the row being decoded
+    Prefetcher *prefetcher; // Helper thread reading ahead (NULL unless read_ahead is set)
+    RowArena *row_arena; // Undecoded rows (NULL unless decode_on_fetch is set)
+    unsigned long long columns_capacity; // Number of rows the column buffers can hold
+    MySQLAccelOptions options; // Packet reader options
+    int unbuffered; // Are we running in unbuffered mode?
+    int binary; // Are rows in the binary protocol of prepared statements?
+    int is_eof; // Have we hit the eof packet yet?
+    struct {
+        PyObject *_next_seq_id;
+        PyObject *rows;
+    } py_str;
+    char *encoding_errors;
+} StateObject;
+
+static void read_options(MySQLAccelOptions *options, PyObject *dict);
+static void column_init(StateObject *py_state, unsigned long i);
+static CellDecoder select_cell_decoder(StateObject *py_state, unsigned long i);
+static int read_packet(StateObject *py_state, char **data, unsigned long long *data_l);
+static void raise_exception(PyObject *self, char *err_type,
+                            unsigned long long err_code, char *err_str);
+static int is_eof_packet(char *data, unsigned long long data_l);
+int ensure_numpy();
+
+static void State_clear_fields(StateObject *self) {
+    if (!self) return;
+    prefetcher_free(self->prefetcher);
+    self->prefetcher = NULL;
+    DESTROY(self->offsets);
+    DESTROY(self->decoders);
+    DESTROY(self->row_items);
+    DESTROY(self->encoding_errors);
+    DESTROY(self->framer.arena);
+    self->framer.arena_size = 0;
+    row_arena_free(self->row_arena);
+    self->row_arena = NULL;
+    if (self->columns) {
+        for (unsigned long i = 0; i < self->n_cols; i++) {
+            Py_CLEAR(self->columns[i].py_data);
+            Py_CLEAR(self->columns[i].py_offsets);
+            Py_CLEAR(self->columns[i].py_mask);
+            Py_CLEAR(self->columns[i].py_objs);
+        }
+        DESTROY(self->columns);
+    }
+    if (self->intern_tables) {
+        for (unsigned long i = 0; i < self->n_cols; i++) {
+            intern_table_free(self->intern_tables[i]);
+        }
+        DESTROY(self->intern_tables);
+    }
+    temporal_cache_free(self->temporal_cache);
+    self->temporal_cache = NULL;
+    if (self->py_invalid_values) {
+        for (unsigned long i = 0; i < self->n_cols; i++) {
+            Py_CLEAR(self->py_invalid_values[i]);
+        }
+        DESTROY(self->py_invalid_values);
+    }
+    self->type_codes = NULL;
+    self->flags = NULL;
+    self->scales = NULL;
+    self->lengths = NULL;
+    self->encodings = NULL;
+    self->py_encodings = NULL;
+    self->py_converters = NULL;
+    self->py_names = NULL;
+    self->py_names_list = NULL;
+    self->py_namedtuple = NULL;
+    self->structsequence = NULL;
+    Py_CLEAR(self->schema);
+    Py_CLEAR(self->py_namedtuple_args);
+    Py_CLEAR(self->py_default_converters);
+    self->reader = NULL;
+    Py_CLEAR(self->py_settimeout);
+    Py_CLEAR(self->py_read_timeout);
+    Py_CLEAR(self->py_sock);
+    Py_CLEAR(self->py_read);
+    Py_CLEAR(self->py_rfile);
+    Py_CLEAR(self->py_rows);
+    Py_CLEAR(self->py_conn);
+}
+
+static void State_dealloc(StateObject *self) {
+    PyObject_GC_UnTrack(self);
+    State_clear_fields(self);
+    PyObject_GC_Del(self);
+}
+
+// Lazy rows and row buffers refer to the state, which holds the rows of the
+// current batch and the connection that holds the result.
+static int State_traverse(StateObject *self, visitproc visit, void *arg) {
+    Py_VISIT(self->py_rows);
+    Py_VISIT(self->py_conn);
+    return 0;
+}
+
+static int State_clear(StateObject *self) {
+    Py_CLEAR(self->py_rows);
+    Py_CLEAR(self->py_conn);
+    return 0;
+}
+
+//
+// Release the socket and read buffers of a state whose result has been
+// received completely, but that is kept for decoding rows later.
+//
+static void State_release_io(StateObject *self) {
+    DESTROY(self->framer.arena);
+    self->framer.arena_size = 0;
+    self->reader = NULL;
+    Py_CLEAR(self->py_settimeout);
+    Py_CLEAR(self->py_read_timeout);
+    Py_CLEAR(self->py_sock);
+    Py_CLEAR(self->py_read);
+    Py_CLEAR(self->py_rfile);
+    Py_CLEAR(self->py_rows);
+}
+
+//
+// Read the column definition packets of a result set and the EOF packet
+// that follows them, and look up the schema they describe. The packets
+// are kept in the result's _column_definitions attribute so that the
+// Python field descriptors can be built when they are asked for.
+//
+static int State_read_columns(StateObject *self, PyObject *py_res, PyObject *py_options) {
+    int rc = 0;
+    int use_unicode = 1;
+    PyObject *py_conn_encoding = NULL;
+    PyObject *py_converters = NULL;
+    PyObject *py_column_converters = NULL;
+    PyObject *py_type_code = NULL;
+    PyObject *py_defs = NULL;
+    char *defs = NULL;
+    unsigned long long defs_l = 0;
+    unsigned long long defs_size = 0;
+    char *data = NULL;
+    unsigned long long data_l = 0;
+
+    if (PyDict_Check(py_options)) {
+        PyObject *py_use_unicode = PyDict_GetItemString(py_options, "use_unicode");
+        if (py_use_unicode && !PyObject_IsTrue(py_use_unicode)) {
+            use_unicode = 0;
+        }
+        py_conn_encoding = PyDict_GetItemString(py_options, "encoding");
+        py_converters = PyDict_GetItemString(py_options, "converters");
+        if (py_converters && !PyDict_Check(py_converters)) {
+            py_converters = NULL;
+        }
+    }
+
+    if (py_conn_encoding) {
+        Py_INCREF(py_conn_encoding);
+    } else {
+        py_conn_encoding = PyUnicode_FromString("utf8");
+        if (!py_conn_encoding) goto error;
+    }
+
+    // Keep a copy of each packet, prefixed by its length.
+    for (unsigned long i = 0; i < self->n_cols; i++) {
+        if (read_packet(self, &data, &data_l) < 0) goto error;
+
+        if (defs_l + data_l + 4 > defs_size) {
+            unsigned long long new_size = (defs_size) ? defs_size * 2 : 4096;
+            while (new_size < defs_l + data_l + 4) new_size *= 2;
+            char *new_defs = realloc(defs, new_size);
+            if (!new_defs) { PyErr_NoMemory(); goto error; }
+            defs = new_defs;
+            defs_size = new_size;
+        }
+        uint32_t packet_l = (uint32_t)data_l;
+        memcpy(defs + defs_l, &packet_l, 4);
+        memcpy(defs + defs_l + 4, data, data_l);
+        defs_l += data_l + 4;
+    }
+
+    if (read_packet(self, &data, &data_l) < 0) goto error;
+    if (!is_eof_packet(data, data_l)) {
+        raise_exception(self->py_conn, "InternalError", 0,
+                        "Protocol error, expecting EOF");
+        goto error;
+    }
+
+    // Converters that differ from the defaults are part of the schema.
+    py_column_converters = PyTuple_New(self->n_cols);
+    if (!py_column_converters) goto error;
+
+    data = defs;
+    for (unsigned long i = 0; i < self->n_cols; i++) {
+        ColumnDefinition col = {0};
+        uint32_t packet_l = 0;
+
+        memcpy(&packet_l, data, 4);
+        if (parse_column_definition(data + 4, packet_l, &col) < 0) {
+            raise_exception(self->py_conn, "InternalError", 0,
+                            "Malformed column definition packet");
+            goto error;
+        }
+        data += packet_l + 4;
+
+        py_type_code = PyLong_FromUnsignedLong(col.type_code);
+        if (!py_type_code) goto error;
+
+        PyObject *py_converter = (py_converters) ?
+                      PyDict_GetItem(py_converters, py_type_code) : NULL;
+        PyObject *py_default_converter = (self->py_default_converters) ?
+                      PyDict_GetItem(self->py_default_converters, py_type_code) : NULL;
+        Py_CLEAR(py_type_code);
+
+        if (!py_converter || py_converter == py_default_converter) {
+            py_converter = Py_None;
+        }
+        Py_INCREF(py_converter);
+        PyTuple_SetItem(py_column_converters, i, py_converter);
+    }
+
+    py_defs = PyBytes_FromStringAndSize(defs, defs_l);
+    if (!py_defs) goto error;
+
+    self->schema = Schema_get(py_defs, self->n_cols, py_conn_encoding,
+                              use_unicode, py_column_converters);
+    if (!self->schema) goto error;
+
+    rc = PyObject_SetAttr(py_res, PyStr._column_definitions,
+                          self->schema->py_column_definitions);
+    if (rc) goto error;
+
+exit:
+    DESTROY(defs);
+    Py_XDECREF(py_defs);
+    Py_XDECREF(py_type_code);
+    Py_XDECREF(py_column_converters);
+    Py_XDECREF(py_conn_encoding);
+    return rc;
+
+error:
+    rc = -1;
+    goto exit;
+}
+
+static int State_init(StateObject *self, PyObject *args, PyObject *kwds) {
+    int rc = 0;
+    PyObject *py_res = NULL;
+    PyObject *py_options = NULL;
+    unsigned long long requested_n_rows = 0;
+
+    if (!PyArg_ParseTuple(args, "OK", &py_res, &requested_n_rows)) {
+        return -1;
+    }
+
+    py_options = PyObject_GetAttr(py_res, PyStr.options);
+    if (!py_options) {
+        Py_INCREF(Py_None);
+        py_options = Py_None;
+    }
+
+    if (PyDict_Check(py_options)) {
+        self->py_default_converters = PyDict_GetItemString(py_options, "default_converters");
+        if (self->py_default_converters && !PyDict_Check(self->py_default_converters)) {
+            self->py_default_converters = NULL;
+        }
+        Py_XINCREF(self->py_default_converters);
+        PyObject *py_unbuffered = PyDict_GetItemString(py_options, "unbuffered");
+        if (py_unbuffered && PyObject_IsTrue(py_unbuffered)) {
+            self->unbuffered = 1;
+        }
+        PyObject *py_binary = PyDict_GetItemString(py_options, "binary");
+        if (py_binary && PyObject_IsTrue(py_binary)) {
+            self->binary = 1;
+        }
+        PyObject *py_encoding_errors = PyDict_GetItemString(py_options, "encoding_errors");
+        if (py_encoding_errors) {
+            self->encoding_errors = _PyUnicode_AsUTF8(py_encoding_errors);
+            if (!self->encoding_errors) goto error;
+        }
+    }
+
+    if (!self->encoding_errors) {
+        self->encoding_errors = calloc(7, 1);
+        if (!self->encoding_errors) goto error;
+        memcpy(self->encoding_errors, "strict", 6);
+    }
+
+    if (self->unbuffered) {
+        PyObject *unbuffered_active = PyObject_GetAttr(py_res, PyStr.unbuffered_active);
+        if (!unbuffered_active || !PyObject_IsTrue(unbuffered_active)) {
+            Py_XDECREF(unbuffered_active);
+            goto error;
+        }
+        Py_XDECREF(unbuffered_active);
+    }
+
+    self->py_conn = PyObject_GetAttr(py_res, PyStr.connection);
+    if (!self->py_conn) goto error;
+
+    // Cache socket timeout and read methods.
+    self->py_sock = PyObject_GetAttr(self->py_conn, PyStr._sock);
+    if (!self->py_sock) goto error;
+    self->py_settimeout = PyObject_GetAttr(self->py_sock, PyStr.settimeout);
+    if (!self->py_settimeout) goto error;
+    self->py_read_timeout = PyObject_GetAttr(self->py_conn, PyStr._read_timeout);
+    if (!self->py_read_timeout) goto error;
+
+    self->py_rfile = PyObject_GetAttr(self->py_conn, PyStr._rfile);
+    if (!self->py_rfile) goto error;
+    self->py_read = PyObject_GetAttr(self->py_rfile, PyStr.read);
+    if (!self->py_read) goto error;
+
+    // Read from the socket buffer directly if it's a native reader.
+    if (PyObject_TypeCheck(self->py_rfile, SocketReaderType)) {
+        self->reader = (SocketReaderObject*)self->py_rfile;
+    }
+
+    PyObject *py_next_seq_id = PyObject_GetAttr(self->py_conn, PyStr._next_seq_id);
+    if (!py_next_seq_id) goto error;
+    self->framer.next_seq_id = PyLong_AsUnsignedLongLong(py_next_seq_id);
+    Py_XDECREF(py_next_seq_id);
+
+    PyObject *py_compression = PyObject_GetAttr(self->py_conn, PyStr._compression);
+    if (!py_compression) goto error;
+    self->framer.compressed = PyObject_IsTrue(py_compression);
+    Py_DECREF(py_compression);
+    if (self->framer.compressed < 0) goto error;
+
+    // Read the column definitions.
+    PyObject *py_field_count = PyObject_GetAttr(py_res, PyStr.field_count);
+    if (!py_field_count) goto error;
+    self->n_cols = PyLong_AsUnsignedLong(py_field_count);
+    Py_XDECREF(py_field_count);
+
+    if (State_read_columns(self, py_res, py_options) < 0) goto error;
+
+    self->type_codes = self->schema->type_codes;
+    self->flags = self->schema->flags;
+    self->scales = self->schema->scales;
+    self->lengths = self->schema->lengths;
+    self->encodings = self->schema->encodings;
+    self->py_encodings = self->schema->py_encodings;
+    self->py_converters = self->schema->py_converters;
+    self->py_names = self->schema->py_names;
+    self->py_names_list = self->schema->py_names_list;
+
+    self->py_invalid_values = calloc(self->n_cols, sizeof(PyObject*));
+    if (!self->py_invalid_values) goto error;
+
+    py_next_seq_id = PyLong_FromUnsignedLongLong(self->framer.next_seq_id);
+    if (!py_next_seq_id) goto error;
+    rc = PyObject_SetAttr(self->py_conn, PyStr._next_seq_id, py_next_seq_id);
+    Py_CLEAR(py_next_seq_id);
+    if (rc) goto error;
+
+    if (py_options && PyDict_Check(py_options)) {
+        read_options(&self->options, py_options);
+    }
+
+    // ENUM and SET values are always interned, other strings on request.
+    // For parsed JSON, the table holds the object keys.
+    self->intern_tables = calloc(self->n_cols, sizeof(InternTable*));
+    if (!self->intern_tables) goto error;
+    for (unsigned long i = 0; i < self->n_cols; i++) {
+        if (!self->encodings[i] || self->py_converters[i]) continue;
+        switch (self->type_codes[i]) {
+        case MYSQL_TYPE_ENUM:
+        case MYSQL_TYPE_SET:
+            break;
+        case MYSQL_TYPE_JSON:
+            if (self->options.parse_json && json_native_encoding(self->encodings[i])) break;
+            continue;
+        case MYSQL_TYPE_STRING:
+        case MYSQL_TYPE_VAR_STRING:
+        case MYSQL_TYPE_VARCHAR:
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BLOB:
+            if (self->flags[i] & (MYSQL_FLAG_ENUM | MYSQL_FLAG_SET)) break;
+            if (self->options.intern_strings) break;
+            continue;
+        default:
+            continue;
+        }
+        self->intern_tables[i] = calloc(1, sizeof(InternTable));
+        if (!self->intern_tables[i]) goto error;
+    }
+
+    for (unsigned long i = 0; i < self->n_cols; i++) {
+        if (self->py_converters[i] || self->temporal_cache) continue;
+        switch (self->type_codes[i]) {
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIMESTAMP:
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_NEWDATE:
+        case MYSQL_TYPE_TIME:
+            self->temporal_cache = calloc(1, sizeof(TemporalCache));
+            if (!self->temporal_cache) goto error;
+        }
+    }
+
+    self->decoders = calloc(self->n_cols, sizeof(CellDecoder));
+    if (!self->decoders) goto error;
+    for (unsigned long i = 0; i < self->n_cols; i++) {
+        self->decoders[i] = select_cell_decoder(self, i);
+    }
+
+    self->row_items = calloc(self->n_cols ? self->n_cols : 1, sizeof(PyObject*));
+    if (!self->row_items) goto error;
+
+    // Receive the rest of an unbuffered result on a helper thread.
+    if (self->options.read_ahead && self->unbuffered && self->reader) {
+        self->prefetcher = prefetcher_start(self->reader, self->framer.next_seq_id);
+    }
+
+    switch (self->options.results_type) {
+    case ACCEL_OUT_NAMEDTUPLES:
+    case ACCEL_OUT_STRUCTSEQUENCES:
+        if (self->options.results_type == ACCEL_OUT_NAMEDTUPLES)
+        {
+            if (Schema_ensure_namedtuple(self->schema) < 0) goto error;
+            self->py_namedtuple = self->schema->py_namedtuple;
+
+            self->py_namedtuple_args = PyTuple_New(self->n_cols);
+            if (!self->py_namedtuple_args) goto error;
+        }
+        else
+        {
+            if (Schema_ensure_structsequence(self->schema) < 0) goto error;
+            self->structsequence = self->schema->structsequence;
+        }
+
+        // Fall through
+
+    case ACCEL_OUT_ROWS:
+    case ACCEL_OUT_LAZYROWS:
+        if ((self->options.results_type == ACCEL_OUT_ROWS ||
+             self->options.results_type == ACCEL_OUT_LAZYROWS) &&
+            Schema_ensure_name_index(self->schema) < 0) goto error;
+
+        // Fall through
+
+    default:
+        if (self->options.results_type == ACCEL_OUT_NUMPY ||
+            self->options.results_type == ACCEL_OUT_ARROW) {
+            if (self->options.results_type == ACCEL_OUT_NUMPY && ensure_numpy() < 0) {
+                goto error;
+            }
+            self->columns = calloc(self->n_cols, sizeof(ColumnBuffer));
+            if (!self->columns) goto error;
+            for (unsigned long i = 0; i < self->n_cols; i++) {
+                column_init(self, i);
+            }
+            break;
+        }
+
+        // For fetchone, reuse the same list every time.
+        //if (requested_n_rows == 1) {
+        //    self->py_rows = PyList_New(1);
+        //    PyList_SetItem(self->py_rows, 0, Py_None);
+        //} else {
+            self->py_rows = PyList_New(0);
+        //}
+        if (!self->py_rows) goto error;
+
+        PyObject_SetAttr(py_res, PyStr.rows, self->py_rows);
+
+        // Rows of buffered results can be kept as packets until they are fetched.
+        if (self->options.decode_on_fetch && !self->unbuffered) {
+            self->row_arena = row_arena_new();
+            if (!self->row_arena) { PyErr_NoMemory(); goto error; }
+        }
+    }
+
+exit:
+    Py_XDECREF(py_options);
+    if (rc == 0 && PyErr_Occurred()) {
+        PyErr_Print();
+    }
+    return rc;
+
+error:
+    State_clear_fields(self);
+    rc = -1;
+    goto exit;
+}
+
+static int State_reset_batch(
+    StateObject *self,
+    PyObject *py_res,
+    unsigned long long requested_n_rows
+) {
+    int rc = 0;
+    PyObject *py_tmp = NULL;
+
+    self->n_rows_in_batch = 0;
+
+    if (self->columns) goto exit;
+
+    //if (requested_n_rows != 1) {
+        py_tmp = self->py_rows;
+        self->py_rows = PyList_New(0);
+        Py_XDECREF(py_tmp);
+        if (!self->py_rows) { rc = -1; goto error; }
+        rc = PyObject_SetAttr(py_res, PyStr.rows, self->py_rows);
+    //}
+
+exit:
+    return rc;
+
+error:
+    goto exit;
+}
+
+static PyType_Slot StateType_slots[] = {
+    {Py_tp_init, (initproc)State_init},
+    {Py_tp_dealloc, (destructor)State_dealloc},
+    {Py_tp_traverse, (traverseproc)State_traverse},
+    {Py_tp_clear, (inquiry)State_clear},
+    {Py_tp_doc, "PyMySQL accelerator"},
+    {0, NULL},
+};
+
+static PyType_Spec StateType_spec = {
+    .name = "_singlestoredb_accel.State",
+    .basicsize = sizeof(StateObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .slots = StateType_slots,
+};
+
+//
+// End State
+//
+
+static void read_options(MySQLAccelOptions *options, PyObject *dict) {
+    if (!options || !dict) return;
+
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    Py_ssize_t pos = 0;
+
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+        if (PyUnicode_CompareWithASCIIString(key, "results_type") == 0) {
+            if (PyUnicode_CompareWithASCIIString(value, "dict") == 0 ||
+                PyUnicode_CompareWithASCIIString(value, "dicts") == 0 ) {
+                options->results_type = ACCEL_OUT_DICTS;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "namedtuple") == 0 ||
+                     PyUnicode_CompareWithASCIIString(value, "namedtuples") == 0) {
+                options->results_type = ACCEL_OUT_NAMEDTUPLES;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "structsequence") == 0 ||
+                     PyUnicode_CompareWithASCIIString(value, "structsequences") == 0) {
+                options->results_type = ACCEL_OUT_STRUCTSEQUENCES;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "row") == 0 ||
+                     PyUnicode_CompareWithASCIIString(value, "rows") == 0) {
+                options->results_type = ACCEL_OUT_ROWS;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "lazyrow") == 0 ||
+                     PyUnicode_CompareWithASCIIString(value, "lazyrows") == 0) {
+                options->results_type = ACCEL_OUT_LAZYROWS;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "numpy") == 0 ||
+                     PyUnicode_CompareWithASCIIString(value, "pandas") == 0) {
+                options->results_type = ACCEL_OUT_NUMPY;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "arrow") == 0) {
+                options->results_type = ACCEL_OUT_ARROW;
+                options->decimal256 = 1;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "polars") == 0) {
+                options->results_type = ACCEL_OUT_ARROW;
+            }
+            else {
+                options->results_type = ACCEL_OUT_TUPLES;
+            }
+        } else if (PyUnicode_CompareWithASCIIString(key, "parse_json") == 0) {
+            options->parse_json = PyObject_IsTrue(value);
+        } else if (PyUnicode_CompareWithASCIIString(key, "intern_strings") == 0) {
+            options->intern_strings = PyObject_IsTrue(value);
+        } else if (PyUnicode_CompareWithASCIIString(key, "read_ahead") == 0) {
+            options->read_ahead = PyObject_IsTrue(value);
+        } else if (PyUnicode_CompareWithASCIIString(key, "decode_on_fetch") == 0) {
+            options->decode_on_fetch = PyObject_IsTrue(value);
+        } else if (PyUnicode_CompareWithASCIIString(key, "decimal_type") == 0) {
+            if (PyUnicode_CompareWithASCIIString(value, "float") == 0) {
+                options->decimal_type = ACCEL_OPTION_DECIMAL_TYPE_FLOAT;
+            }
+            else if (PyUnicode_CompareWithASCIIString(value, "scaled_int") == 0) {
+                options->decimal_type = ACCEL_OPTION_DECIMAL_TYPE_SCALED_INT;
+            }
+            else {
+                options->decimal_type = ACCEL_OPTION_DECIMAL_TYPE_DECIMAL;
+            }
+        } else if (PyUnicode_CompareWithASCIIString(key, "invalid_values") == 0) {
+            if (PyDict_Check(value)) {
+                options->invalid_values = value;
+            }
+        }
+    }
+}
+
+static void raise_exception(
+    PyObject *self,
+    char *err_type,
+    unsigned long long err_code,
+    char *err_str
+) {
+    PyObject *py_exc = NULL;
+    PyObject *py_val = NULL;
+
+    py_exc = PyObject_GetAttrString(self, err_type);
+    if (!py_exc) goto error;
+
+    py_val = Py_BuildValue("(Ks)", err_code, err_str);
+    if (!py_val) goto error;
+
+    PyErr_SetObject(py_exc, py_val);
+
+exit:
+    if (py_exc) { Py_DECREF(py_exc); }
+    if (py_val) { Py_DECREF(py_val); }
+    return;
+
+error:
+    goto exit;
+}
+
+static int is_error_packet(char *buff_bytes) {
+    return buff_bytes && *(uint8_t*)buff_bytes == 0xFF;
+}
+
+static int is_eof_packet(char *data, unsigned long long data_l) {
+    return data && data_l > 0 && (uint8_t)*(uint8_t*)data == 0xFE && data_l < 9;
+}
+
+static void force_close(PyObject *py_conn) {
+    PyObject *py_sock = NULL;
+
+    py_sock = PyObject_GetAttr(py_conn, PyStr._sock);
+    if (!py_sock) goto error;
+
+    Py_XDECREF(PyObject_CallMethod(py_sock, "close", NULL));
+    PyErr_Clear();
+
+    PyObject_SetAttr(py_conn, PyStr._sock, Py_None);
+    PyObject_SetAttr(py_conn, PyStr._rfile, Py_None);
+
+exit:
+    Py_XDECREF(py_sock);
+    return;
+
+error:
+    goto exit;
+}
+
+static PyObject *read_bytes(StateObject *py_state, unsigned long long num_bytes) {
+    PyObject *py_num_bytes = NULL;
+    PyObject *py_data = NULL;
+    PyObject *py_exc = NULL;
+
+    if (py_state->py_read_timeout && py_state->py_read_timeout != Py_None) {
+        Py_XDECREF(PyObject_CallFunctionObjArgs(py_state->py_settimeout,
+                                                py_state->py_read_timeout, NULL));
+        if (PyErr_Occurred()) goto error;
+    }
+
+    py_num_bytes = PyLong_FromUnsignedLongLong(num_bytes);
+    if (!py_num_bytes) goto error;
+
+    while (1) {
+        py_data = PyObject_CallFunctionObjArgs(py_state->py_read, py_num_bytes, NULL);
+
+        if ((py_exc = PyErr_Occurred())) {
+            if (PyErr_ExceptionMatches(PyExc_IOError) || PyErr_ExceptionMatches(PyExc_OSError)) {
+                PyObject *py_errno = PyObject_GetAttr(py_exc, PyStr.x_errno);
+                if (!py_errno) goto error;
+
+                unsigned long long err = PyLong_AsUnsignedLongLong(py_errno);
+                Py_DECREF(py_errno);
+
+                if (err == 4 /* errno.EINTER */) {
+                    continue;
+                }
+
+                force_close(py_state->py_conn);
+                raise_exception(py_state->py_conn, "OperationalError", 0,
+                                "Lost connection to SingleStoreDB server during query");
+                goto error;
+            }
+            else if (PyErr_ExceptionMatches(PyExc_BaseException)) {
+                // Don't convert unknown exception to MySQLError.
+                force_close(py_state->py_conn);
+                goto error;
+            }
+        }
+
+        if (py_data) {
+            break;
+        }
+    }
+
+    if (PyBytes_Size(py_data) < (long int)num_bytes) {
+        force_close(py_state->py_conn);
+        raise_exception(py_state->py_conn, "OperationalError", 0,
+                        "Lost connection to SingleStoreDB server during query");
+        goto error;
+    }
+
+exit:
+    Py_XDECREF(py_num_bytes);
+    return py_data;
+
+error:
+    Py_CLEAR(py_data);
+    goto exit;
+}
+
+//
+// Close the connection and raise the exception for a failed read status
+// (see frame_packet_nogil).
+//
+static void raise_read_error(StateObject *py_state, int rc, uint8_t packet_number) {
+    force_close(py_state->py_conn);
+
+    if (rc == ACCEL_READ_NOMEM) {
+        PyErr_NoMemory();
+    }
+    else if (rc == ACCEL_READ_SEQUENCE && packet_number != 0) {
+        raise_exception(py_state->py_conn, "InternalError", 0,
+                        "Packet sequence number wrong");
+    }
+    else if (rc == ACCEL_READ_CORRUPT) {
+        raise_exception(py_state->py_conn, "InternalError", 0,
+                        "Malformed compressed packet");
+    }
+    else {
+        raise_exception(py_state->py_conn, "OperationalError", 0,
+                        "Lost connection to SingleStoreDB server during query");
+    }
+}
+
+//
+// Read the next packet payload from the native socket reader. Packets that
+// are already buffered are framed directly. Otherwise the GIL is released
+// while receiving and framing the packet, so that other threads can run
+// while this one waits on the server.
+//
+static int read_packet_native(
+    StateObject *py_state,
+    char **data,
+    unsigned long long *data_l
+) {
+    SocketReaderObject *reader = py_state->reader;
+    accel_socket_t sock = ACCEL_INVALID_SOCKET;
+    unsigned long long arena_l = 0;
+    uint8_t packet_number = 0;
+    int err = 0;
+    int rc = 0;
+
+    if (reader->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "concurrent reads from one connection are not allowed");
+        return -1;
+    }
+
+    if (!reader->buff) {
+        PyErr_SetString(PyExc_ValueError, "socket reader is not initialized");
+        return -1;
+    }
+
+    rc = frame_packet_nogil(reader, &py_state->framer, ACCEL_INVALID_SOCKET, data, data_l,
+                            &arena_l, &packet_number, &err);
+
+    if (rc == ACCEL_READ_AGAIN) {
+        if (reader_get_socket(reader, &sock) < 0) {
+            if (!PyErr_ExceptionMatches(PyExc_OSError)) {
+                force_close(py_state->py_conn);
+                return -1;
+            }
+            PyErr_Clear();
+            rc = 1;
+        }
+
+        reader->busy = (rc == ACCEL_READ_AGAIN);
+
+        while (reader->busy) {
+            Py_BEGIN_ALLOW_THREADS
+            rc = frame_packet_nogil(reader, &py_state->framer, sock, data, data_l,
+                                    &arena_l, &packet_number, &err);
+            Py_END_ALLOW_THREADS
+
+            if (rc != ACCEL_READ_INTERRUPTED) break;
+            if (PyErr_CheckSignals() < 0) {
+                // Don't convert unknown exception to MySQLError.
+                reader->busy = 0;
+                force_close(py_state->py_conn);
+                return -1;
+            }
+        }
+
+        reader->busy = 0;
+    }
+
+    if (rc == 0) return 0;
+
+    *data = NULL;
+    *data_l = 0;
+
+    raise_read_error(py_state, rc, packet_number);
+
+    return -1;
+}
+
+//
+// Read the next packet payload queued by the prefetcher.
+//
+static int read_packet_prefetched(
+    StateObject *py_state,
+    char **data,
+    unsigned long long *data_l
+) {
+    Prefetcher *pf = py_state->prefetcher;
+    uint8_t packet_number = 0;
+    int rc = 0;
+
+    rc = prefetcher_pop(pf, data, data_l, &py_state->framer.next_seq_id);
+
+    if (rc == 0) {
+        // The helper thread is done with the reader after the last packet.
+        if (is_eof_packet(*data, *data_l) || (*data_l > 0 && is_error_packet(*data))) {
+            pf->owns_reader = 0;
+            py_state->reader->busy = 0;
+        }
+        return 0;
+    }
+
+    *data = NULL;
+    *data_l = 0;
+
+    // Stop the helper thread before the socket is closed.
+    packet_number = pf->packet_number;
+    prefetcher_free(pf);
+    py_state->prefetcher = NULL;
+
+    if (rc == -1) {
+        // Don't convert unknown exception to MySQLError.
+        force_close(py_state->py_conn);
+    }
+    else {
+        raise_read_error(py_state, rc, packet_number);
+    }
+
+    return -1;
+}
+
+//
+// Read the next packet payload. On success, `*data` points either into the
+// native socket reader's buffer (single packets) or into the state's arena
+// (multi-packet payloads and the Python file I/O path). In both cases the
+// pointer is only valid until the next call, and the byte following the
+// payload may be temporarily overwritten by the row parser.
+//
+static int read_packet(StateObject *py_state, char **data, unsigned long long *data_l) {
+    PyObject *py_packet_header = NULL;
+    PyObject *py_recv_data = NULL;
+    PyObject *py_err_packet = NULL;
+    unsigned long long bytes_to_read = 0;
+    unsigned long long arena_l = 0;
+    char *buff = NULL;
+    char *payload = NULL;
+    uint64_t btrl = 0;
+    uint8_t btrh = 0;
+    uint8_t packet_number = 0;
+    int rc = 0;
+
+    *data = NULL;
+    *data_l = 0;
+
+    if (py_state->prefetcher) {
+        if (read_packet_prefetched(py_state, data, data_l) < 0) goto error;
+    }
+    else if (py_state->reader) {
+        if (read_packet_native(py_state, data, data_l) < 0) goto error;
+    }
+
+    while (!py_state->reader) {
+        py_packet_header = read_bytes(py_state, 4);
+        if (!py_packet_header) goto error;
+        buff = PyBytes_AsString(py_packet_header);
+
+        btrl = *(uint16_t*)buff;
+        btrh = *(uint8_t*)(buff+2);
+        packet_number = *(uint8_t*)(buff+3);
+        bytes_to_read = btrl + (btrh << 16);
+
+        Py_CLEAR(py_packet_header);
+
+        if (!py_state->framer.compressed && packet_number != py_state->framer.next_seq_id) {
+            force_close(py_state->py_conn);
+            if (packet_number == 0) {
+                raise_exception(py_state->py_conn, "OperationalError", 0,
+                                "Lost connection to SingleStoreDB server during query");
+
+                goto error;
+            }
+            raise_exception(py_state->py_conn, "InternalError", 0,
+                            "Packet sequence number wrong");
+            goto error;
+        }
+
+        py_state->framer.next_seq_id = (packet_number + 1) % 256;
+
+        py_recv_data = read_bytes(py_state, bytes_to_read);
+        if (!py_recv_data) goto error;
+        payload = PyBytes_AsString(py_recv_data);
+
+        // Payloads are stitched together in the arena.
+        if (framer_reserve_arena(&py_state->framer, arena_l + bytes_to_read) < 0) {
+            PyErr_NoMemory();
+            goto error;
+        }
+        memcpy(py_state->framer.arena + arena_l, payload, bytes_to_read);
+        arena_l += bytes_to_read;
+        Py_CLEAR(py_recv_data);
+
+        if (bytes_to_read < MYSQL_MAX_PACKET_LEN) {
+            *data = py_state->framer.arena;
+            *data_l = arena_l;
+            break;
+        }
+    }
+
+    if (*data_l > 0 && is_error_packet(*data)) {
+        PyObject *py_result = PyObject_GetAttr(py_state->py_conn, PyStr._result);
+        if (py_result && py_result != Py_None) {
+            PyObject *py_unbuffered_active = PyObject_GetAttr(py_result, PyStr.unbuffered_active);
+            if (py_unbuffered_active == Py_True) {
+                PyObject_SetAttr(py_result, PyStr.unbuffered_active, Py_False);
+            }
+            Py_XDECREF(py_unbuffered_active);
+        }
+        Py_XDECREF(py_result);
+        py_err_packet = PyBytes_FromStringAndSize(*data, *data_l);
+        if (!py_err_packet) goto error;
+        Py_XDECREF(PyObject_CallMethod(py_state->py_conn, "_raise_mysql_exception",
+                                       "O", py_err_packet, NULL));
+        goto error;
+    }
+
+exit:
+    Py_XDECREF(py_err_packet);
+    Py_XDECREF(py_recv_data);
+    Py_XDECREF(py_packet_header);
+    return rc;
+
+error:
+    *data = NULL;
+    *data_l = 0;
+    rc = -1;
+    goto exit;
+}
+
+static int check_packet_is_eof(
+    char **data,
+    unsigned long long *data_l,
+    unsigned long long *warning_count,
+    int *has_next
+) {
+    uint16_t server_status = 0;
+    if (!data || !data_l) {
+        if (has_next) *has_next = 0;
+        if (warning_count) *warning_count = 0;
+        return 0;
+    }
+    if (!is_eof_packet(*data, *data_l)) {
+        return 0;
+    }
+    *data += 1; *data_l -= 1;
+    if (warning_count) *warning_count = **(uint16_t**)data;
+    *data += 2; *data_l -= 2;
+    server_status = **(uint16_t**)data;
+    *data += 2; *data_l -= 2;
+    if (has_next) *has_next = server_status & MYSQL_SERVER_MORE_RESULTS_EXISTS;
+    return 1;
+}
+
+static unsigned long long read_length_encoded_integer(
+    char **data,
+    unsigned long long *data_l,
+    int *is_null
+) {
+    if (is_null) *is_null = 0;
+
+    if (!data || !data_l || *data_l == 0) {
+        if (is_null) *is_null = 1;
+        return 0;
+    }
+
+    uint8_t c = **(uint8_t**)data;
+    *data += 1; *data_l -= 1;
+
+    if (c == MYSQL_COLUMN_NULL) {
+        if (is_null) *is_null = 1;
+        return 0;
+    }
+
+    if (c < MYSQL_COLUMN_UNSIGNED_CHAR) {
+        return c;
+    }
+
+    if (c == MYSQL_COLUMN_UNSIGNED_SHORT) {
+        if (*data_l < 2) {
+            if (is_null) *is_null = 1;
+            return 0;
+        }
+        uint16_t out = **(uint16_t**)data;
+        *data += 2; *data_l -= 2;
+        return out;
+    }
+
+    if (c == MYSQL_COLUMN_UNSIGNED_INT24) {
+        if (*data_l < 3) {
+            if (is_null) *is_null = 1;
+            return 0;
+        }
+        uint64_t low = **(uint16_t**)data;
+        *data += 2; *data_l -= 2;
+        uint64_t high = **(uint8_t**)data;
+        *data += 1; *data_l -= 1;
+        return low + (high << 16);
+    }
+
+    if (c == MYSQL_COLUMN_UNSIGNED_INT64) {
+        if (*data_l < 8) {
+            if (is_null) *is_null = 1;
+            return 0;
+        }
+        uint64_t out = **(uint64_t**)data;
+        *data += 8; *data_l -= 8;
+        return out;
+    }
+
+    if (is_null) *is_null = 1;
+    return 0;
+}
+
+static void read_length_coded_string(
+    char **data,
+    unsigned long long *data_l,
+    char **out,
+    unsigned long long *out_l,
+    int *is_null
+) {
+    if (is_null) *is_null = 0;
+
+    if (!data || !data_l || !out || !out_l) {
+        if (is_null) *is_null = 1;
+        return;
+    }
+
+    unsigned long long length = read_length_encoded_integer(data, data_l, is_null);
+
+    if (is_null && *is_null) {
+        return;
+    }
+
+    length = (length > *data_l) ? *data_l : length;
+
+    *out = *data;
+    *out_l = length;
+
+    *data += length;
+    *data_l -= length;
+
+    return;
+}
+
+#ifdef Py_LIMITED_API
+
+//
+// The datetime C-API is not part of the limited API, so these construct
+// the objects by calling the Python types.
+//
+
+static PyObject *PyDate_FromDate(
+    StateObject *py_state,
+    int year,
+    int month,
+    int day
+) {
+    PyObject *out = NULL;
+    PyObject *py_year = get_cached_int(year);
+    PyObject *py_month = get_cached_int(month);
+    PyObject *py_day = get_cached_int(day);
+
+    if (py_year && py_month && py_day) {
+        out = PyObject_CallFunctionObjArgs(
+            PyFunc.datetime_date, py_year, py_month, py_day, NULL
+        );
+    }
+
+    Py_XDECREF(py_year);
+    Py_XDECREF(py_month);
+    Py_XDECREF(py_day);
+
+    return out;
+}
+
+static PyObject *PyDelta_FromDSU(
+    StateObject *py_state,
+    int days,
+    int seconds,
+    int microseconds
+) {
+    PyObject *out = NULL;
+    PyObject *py_days = get_cached_int(days);
+    PyObject *py_seconds = get_cached_int(seconds);
+    PyObject *py_microseconds = get_cached_int(microseconds);
+
+    if (py_days && py_seconds && py_microseconds) {
+        out = PyObject_CallFunctionObjArgs(
+            PyFunc.datetime_timedelta, py_days, py_seconds, py_microseconds, NULL
+        );
+    }
+
+    Py_XDECREF(py_days);
+    Py_XDECREF(py_seconds);
+    Py_XDECREF(py_microseconds);
+
+    return out;
+}
+
+static PyObject *PyDateTime_FromDateAndTime(
+    StateObject *py_state,
+    int year,
+    int month,
+    int day,
+    int hour,
+    int minute,
+    int second,
+    int microsecond
+) {
+    PyObject *out = NULL;
+    PyObject *py_args[7] = {
+        get_cached_int(year), get_cached_int(month), get_cached_int(day),
+        get_cached_int(hour), get_cached_int(minute), get_cached_int(second),
+        get_cached_int(microsecond),
+    };
+
+    for (int i = 0; i < 7; i++) {
+        if (!py_args[i]) goto exit;
+    }
+
+    out = PyObject_CallFunctionObjArgs(
+        PyFunc.datetime_datetime, py_args[0], py_args[1], py_args[2],
+        py_args[3], py_args[4], py_args[5], py_args[6], NULL
+    );
+
+exit:
+    for (int i = 0; i < 7; i++) {
+        Py_XDECREF(py_args[i]);
+    }
+
+    return out;
+}
+
+#endif
+
+//
+// Cell decoders
+//
+// Convert a non-NULL text protocol value of column `i` to a Python object.
+// The byte following the value must be writable. State_init picks one
+// decoder per column from its type, converter, encoding and the options,
+// so that rows are decoded without looking at any of them again.
+//
+
+static PyObject *decode_converted(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    PyObject *py_str = NULL;
+    PyObject *py_item = NULL;
+
+    if (py_state->encodings[i] == NULL) {
+        py_str = PyBytes_FromStringAndSize(out, out_l);
+    } else {
+        py_str = PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
+    }
+    if (!py_str) return NULL;
+
+    py_item = PyObject_CallFunctionObjArgs(py_state->py_converters[i], py_str, NULL);
+    Py_DECREF(py_str);
+    return py_item;
+}
+
+static PyObject *decode_decimal(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    PyObject *py_str = NULL;
+    PyObject *py_item = NULL;
+
+    py_str = PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
+    if (!py_str) return NULL;
+
+    py_item = PyObject_CallFunctionObjArgs(PyFunc.decimal_Decimal, py_str, NULL);
+    Py_DECREF(py_str);
+    return py_item;
+}
+
+static PyObject *decode_scaled_decimal(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    uint64_t scaled = 0;
+
+    if (parse_scaled_decimal(out, out_l, py_state->scales[i], &scaled, 1) == 0) {
+        return PyLong_FromLongLong((int64_t)scaled);
+    }
+    return scaled_decimal_to_pylong(out, out_l, py_state->scales[i]);
+}
+
+static PyObject *decode_int(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    return PyLong_FromLongLong(parse_int64(out, out_l));
+}
+
+static PyObject *decode_uint(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    return PyLong_FromUnsignedLongLong(parse_uint64(out, out_l));
+}
+
+static PyObject *decode_float(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    return PyFloat_FromDouble(parse_double(out, out_l));
+}
+
+static PyObject *decode_null(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+//
+// Value of a date/time cell that can not be parsed: the replacement value
+// of the column if one was set, otherwise the text itself.
+//
+static PyObject *decode_invalid_temporal(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    if (py_state->py_invalid_values[i]) {
+        Py_INCREF(py_state->py_invalid_values[i]);
+        return py_state->py_invalid_values[i];
+    }
+    return PyUnicode_Decode(out, out_l, "ascii", py_state->encoding_errors);
+}
+
+static PyObject *decode_datetime(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    char *orig_out = out;
+    unsigned long long orig_out_l = out_l;
+    PyObject *py_item = NULL;
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    int microsecond = 0;
+
+    if (CHECK_ANY_ZERO_DATETIME_STR(out, out_l)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    if (!CHECK_ANY_DATETIME_STR(out, out_l)) {
+        return decode_invalid_temporal(py_state, i, out, out_l);
+    }
+
+    py_item = temporal_cache_get(py_state->temporal_cache, ACCEL_TEMPORAL_DATETIME,
+                                 orig_out, orig_out_l);
+    if (py_item) return py_item;
+
+    year = CHR2INT4(out); out += 5;
+    month = CHR2INT2(out); out += 3;
+    day = CHR2INT2(out); out += 3;
+    hour = CHR2INT2(out); out += 3;
+    minute = CHR2INT2(out); out += 3;
+    second = CHR2INT2(out); out += 3;
+    microsecond = (IS_DATETIME_MICRO(out, out_l)) ? CHR2INT6(out) :
+                  (IS_DATETIME_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
+    py_item = PyDateTime_FromDateAndTime(
+#ifdef Py_LIMITED_API
+                    py_state,
+#endif
+                    year, month, day, hour, minute, second, microsecond);
+    if (!py_item) {
+        PyErr_Clear();
+        return PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
+    }
+
+    temporal_cache_put(py_state->temporal_cache, ACCEL_TEMPORAL_DATETIME,
+                       orig_out, orig_out_l, py_item);
+    return py_item;
+}
+
+static PyObject *decode_date(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    char *orig_out = out;
+    unsigned long long orig_out_l = out_l;
+    PyObject *py_item = NULL;
+    int year = 0;
+    int month = 0;
+    int day = 0;
+
+    if (CHECK_ZERO_DATE_STR(out, out_l)) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    if (!CHECK_DATE_STR(out, out_l)) {
+        return decode_invalid_temporal(py_state, i, out, out_l);
+    }
+
+    py_item = temporal_cache_get(py_state->temporal_cache, ACCEL_TEMPORAL_DATE,
+                                 orig_out, orig_out_l);
+    if (py_item) return py_item;
+
+    year = CHR2INT4(out); out += 5;
+    month = CHR2INT2(out); out += 3;
+    day = CHR2INT2(out); out += 3;
+    py_item = PyDate_FromDate(
+#ifdef Py_LIMITED_API
+                    py_state,
+#endif
+                    year, month, day);
+    if (!py_item) {
+        PyErr_Clear();
+        return PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
+    }
+
+    temporal_cache_put(py_state->temporal_cache, ACCEL_TEMPORAL_DATE,
+                       orig_out, orig_out_l, py_item);
+    return py_item;
+}
+
+static PyObject *decode_time(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    char *orig_out = out;
+    unsigned long long orig_out_l = out_l;
+    PyObject *py_item = NULL;
+    int sign = 1;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    int microsecond = 0;
+
+    sign = CHECK_ANY_TIMEDELTA_STR(out, out_l);
+    if (!sign) {
+        return decode_invalid_temporal(py_state, i, out, out_l);
+    }
+
+    py_item = temporal_cache_get(py_state->temporal_cache, ACCEL_TEMPORAL_TIMEDELTA,
+                                 orig_out, orig_out_l);
+    if (py_item) return py_item;
+
+    if (sign < 0) {
+        out += 1; out_l -= 1;
+    }
+    if (IS_TIMEDELTA1(out, out_l)) {
+        hour = CHR2INT1(out); out += 2;
+        minute = CHR2INT2(out); out += 3;
+        second = CHR2INT2(out); out += 3;
+        microsecond = (IS_TIMEDELTA_MICRO(out, out_l)) ? CHR2INT6(out) :
+                      (IS_TIMEDELTA_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
+    }
+    else if (IS_TIMEDELTA2(out, out_l)) {
+        hour = CHR2INT2(out); out += 3;
+        minute = CHR2INT2(out); out += 3;
+        second = CHR2INT2(out); out += 3;
+        microsecond = (IS_TIMEDELTA_MICRO(out, out_l)) ? CHR2INT6(out) :
+                      (IS_TIMEDELTA_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
+    }
+    else if (IS_TIMEDELTA3(out, out_l)) {
+        hour = CHR2INT3(out); out += 4;
+        minute = CHR2INT2(out); out += 3;
+        second = CHR2INT2(out); out += 3;
+        microsecond = (IS_TIMEDELTA_MICRO(out, out_l)) ? CHR2INT6(out) :
+                      (IS_TIMEDELTA_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
+    }
+    py_item = PyDelta_FromDSU(
+#ifdef Py_LIMITED_API
+                    py_state,
+#endif
+                    0, sign * hour * 60 * 60 +
+                       sign * minute * 60 +
+                       sign * second,
+                       sign * microsecond);
+    if (!py_item) {
+        PyErr_Clear();
+        return PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
+    }
+
+    temporal_cache_put(py_state->temporal_cache, ACCEL_TEMPORAL_TIMEDELTA,
+                       orig_out, orig_out_l, py_item);
+    return py_item;
+}
+
+static PyObject *decode_year(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    if (out_l == 0) {
+        PyErr_SetString(PyExc_ValueError, "empty YEAR value");
+        return NULL;
+    }
+    return PyLong_FromLong((long)parse_uint64(out, out_l));
+}
+
+static PyObject *decode_bytes(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    return PyBytes_FromStringAndSize(out, out_l);
+}
+
+static PyObject *decode_str(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    return PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
+}
+
+static PyObject *decode_interned(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    return intern_decode(py_state->intern_tables[i], out, out_l,
+                         py_state->encodings[i], py_state->encoding_errors);
+}
+
+static PyObject *decode_json(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    PyObject *py_str = NULL;
+    PyObject *py_item = NULL;
+
+    py_str = PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
+    if (!py_str) return NULL;
+
+    py_item = PyObject_CallFunctionObjArgs(PyFunc.json_loads, py_str, NULL);
+    Py_DECREF(py_str);
+    return py_item;
+}
+
+static PyObject *decode_json_native(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    int invalid = 0;
+    PyObject *py_item = json_parse(out, out_l, py_state->intern_tables[i],
+                                   py_state->encoding_errors, &invalid);
+
+    // Let json.loads parse the text or raise the usual error.
+    if (invalid) return decode_json(py_state, i, out, out_l);
+
+    return py_item;
+}
+
+static PyObject *decode_unknown(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    PyErr_Format(PyExc_TypeError, "unknown type code: %lu", py_state->type_codes[i]);
+    return NULL;
+}
+
+//
+// Choose the decoder of column `i`. Called once the converters, intern
+// tables and options of the state are known.
+//
+static CellDecoder select_cell_decoder(StateObject *py_state, unsigned long i) {
+    if (py_state->py_converters[i]) return decode_converted;
+
+    switch (py_state->type_codes[i]) {
+    case MYSQL_TYPE_NEWDECIMAL:
+    case MYSQL_TYPE_DECIMAL:
+        switch (py_state->options.decimal_type) {
+        case ACCEL_OPTION_DECIMAL_TYPE_FLOAT: return decode_float;
+        case ACCEL_OPTION_DECIMAL_TYPE_SCALED_INT: return decode_scaled_decimal;
+        default: return decode_decimal;
+        }
+
+    case MYSQL_TYPE_TINY:
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_LONGLONG:
+    case MYSQL_TYPE_INT24:
+        return (py_state->flags[i] & MYSQL_FLAG_UNSIGNED) ? decode_uint : decode_int;
+
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_DOUBLE:
+        return decode_float;
+
+    case MYSQL_TYPE_NULL:
+        return decode_null;
+
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+        return decode_datetime;
+
+    case MYSQL_TYPE_NEWDATE:
+    case MYSQL_TYPE_DATE:
+        return decode_date;
+
+    case MYSQL_TYPE_TIME:
+        return decode_time;
+
+    case MYSQL_TYPE_YEAR:
+        return decode_year;
+
+    case MYSQL_TYPE_BIT:
+    case MYSQL_TYPE_JSON:
+    case MYSQL_TYPE_TINY_BLOB:
+    case MYSQL_TYPE_MEDIUM_BLOB:
+    case MYSQL_TYPE_LONG_BLOB:
+    case MYSQL_TYPE_BLOB:
+    case MYSQL_TYPE_GEOMETRY:
+    case MYSQL_TYPE_ENUM:
+    case MYSQL_TYPE_SET:
+    case MYSQL_TYPE_VARCHAR:
+    case MYSQL_TYPE_VAR_STRING:
+    case MYSQL_TYPE_STRING:
+        if (!py_state->encodings[i]) return decode_bytes;
+        if (py_state->type_codes[i] == MYSQL_TYPE_JSON && py_state->options.parse_json) {
+            return (json_native_encoding(py_state->encodings[i])) ?
+                   decode_json_native : decode_json;
+        }
+        if (py_state->intern_tables[i]) return decode_interned;
+        return decode_str;
+
+    default:
+        return decode_unknown;
+    }
+}
+
+static inline PyObject *read_cell(
+    StateObject *py_state,
+    unsigned long i,
+    char *out,
+    unsigned long long out_l
+) {
+    return py_state->decoders[i](py_state, i, out, out_l);
+}
+
+//
+// End Cell decoders
+//
+
+//
+// Binary protocol
+//
+// Row data packets of prepared statement results start with a 0x00 header
+// and a NULL bitmap whose first two bits are unused. Integer and floating
+// point values follow as fixed-width little-endian values, dates and times
+// as length-prefixed structs, and all other values as length-coded strings
+// like in the text protocol. Fixed-width values are converted directly;
+// they are only formatted as text for columns with custom converters.
+//
+
+#define ACCEL_BIN_NULL 0
+#define ACCEL_BIN_STRING 1
+#define ACCEL_BIN_INT 2
+#define ACCEL_BIN_FLOAT 3
+#define ACCEL_BIN_DATE 4
+#define ACCEL_BIN_DATETIME 5
+#define ACCEL_BIN_TIME 6
+
+typedef struct {
+    int kind; // ACCEL_BIN_* value kind
+    int is_unsigned; // Is an integer value unsigned?
+    int64_t i64; // Integer value (unsigned values are stored as two's complement)
+    double dbl; // Floating point value
+    int negative; // Is a time value negative?
+    int days; // Days of a time value
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+    int microsecond;
+    char *out; // String value, or the length-prefixed struct of a date or time
+    unsigned long long out_l;
+} BinaryValue;
+
+static inline uint64_t read_uint_le(const char *data, int size) {
+    uint64_t out = 0;
+    for (int i = size - 1; i >= 0; i--) {
+        out = (out << 8) | (uint8_t)data[i];
+    }
+    return out;
+}
+
+//
+// Convert a FLOAT value to the double of its shortest round-tripping
+// decimal representation, which is what the text protocol sends.
+//
+static double float_to_shortest_double(float value) {
+    char text[32];
+
+    for (int precision = 6; precision <= 9; precision++) {
+        snprintf(text, sizeof(text), "%.*g", precision, (double)value);
+        double out = strtod(text, NULL);
+        if ((float)out == value) return out;
+    }
+
+    return (double)value;
+}
+
+//
+// Skip the header of a binary row data packet and return its NULL bitmap,
+// or NULL if the packet is too short.
+//
+static uint8_t *read_binary_row_header(
+    StateObject *py_state,
+    char **data,
+    unsigned long long *data_l
+) {
+    unsigned long long header_l = 1 + (py_state->n_cols + 9) / 8;
+
+    if (*data_l < header_l) {
+        raise_exception(py_state->py_conn, "InternalError", 0,
+                        "Malformed binary row data packet");
+        return NULL;
+    }
+
+    uint8_t *null_bitmap = (uint8_t*)*data + 1;
+    *data += header_l; *data_l -= header_l;
+
+    return null_bitmap;
+}
+
+//
+// Read the value of column `i` from a binary row data packet. Values that
+// are cut off by the end of the packet are NULL.
+//
+static void read_binary_value(
+    StateObject *py_state,
+    unsigned long i,
+    uint8_t *null_bitmap,
+    char **data,
+    unsigned long long *data_l,
+    BinaryValue *v
+) {
+    unsigned long long length = 0;
+    uint64_t bits = 0;
+    uint32_t bits32 = 0;
+    float flt = 0;
+    int size = 0;
+    int is_null = 0;
+    char *p = NULL;
+
+    memset(v, 0, sizeof(BinaryValue));
+
+    if (null_bitmap[(i + 2) >> 3] & (1 << ((i + 2) & 7))) return;
+
+    switch (py_state->type_codes[i]) {
+    case MYSQL_TYPE_TINY:
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_YEAR:
+    case MYSQL_TYPE_INT24:
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_LONGLONG:
+        switch (py_state->type_codes[i]) {
+        case MYSQL_TYPE_TINY: size = 1; break;
+        case MYSQL_TYPE_SHORT: size = 2; break;
+        case MYSQL_TYPE_YEAR: size = 2; break;
+        case MYSQL_TYPE_LONGLONG: size = 8; break;
+        default: size = 4;
+        }
+        if (*data_l < (unsigned long long)size) goto truncated;
+        bits = read_uint_le(*data, size);
+        v->kind = ACCEL_BIN_INT;
+        v->is_unsigned = (py_state->flags[i] & MYSQL_FLAG_UNSIGNED) != 0;
+        if (!v->is_unsigned && size < 8) {
+            // Sign-extend to 64 bits.
+            uint64_t sign_bit = (uint64_t)1 << (size * 8 - 1);
+            bits = (bits ^ sign_bit) - sign_bit;
+        }
+        v->i64 = (int64_t)bits;
+        *data += size; *data_l -= size;
+        return;
+
+    case MYSQL_TYPE_FLOAT:
+        if (*data_l < 4) goto truncated;
+        bits32 = (uint32_t)read_uint_le(*data, 4);
+        memcpy(&flt, &bits32, 4);
+        v->kind = ACCEL_BIN_FLOAT;
+        v->dbl = float_to_shortest_double(flt);
+        *data += 4; *data_l -= 4;
+        return;
+
+    case MYSQL_TYPE_DOUBLE:
+        if (*data_l < 8) goto truncated;
+        bits = read_uint_le(*data, 8);
+        memcpy(&v->dbl, &bits, 8);
+        v->kind = ACCEL_BIN_FLOAT;
+        *data += 8; *data_l -= 8;
+        return;
+
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_NEWDATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+        if (*data_l < 1) goto truncated;
+        length = *(uint8_t*)*data;
+        if (*data_l < 1 + length) goto truncated;
+        p = *data + 1;
+        if (length >= 4) {
+            v->year = (int)read_uint_le(p, 2);
+            v->month = (uint8_t)p[2];
+            v->day = (uint8_t)p[3];
+        }
+        if (length >= 7) {
+            v->hour = (uint8_t)p[4];
+            v->minute = (uint8_t)p[5];
+            v->second = (uint8_t)p[6];
+        }
+        if (length >= 11) {
+            v->microsecond = (int)read_uint_le(p + 7, 4);
+        }
+        v->kind = (py_state->type_codes[i] == MYSQL_TYPE_DATE ||
+                   py_state->type_codes[i] == MYSQL_TYPE_NEWDATE) ?
+                  ACCEL_BIN_DATE : ACCEL_BIN_DATETIME;
+        v->out = *data;
+        v->out_l = 1 + length;
+        *data += 1 + length; *data_l -= 1 + length;
+        return;
+
+    case MYSQL_TYPE_TIME:
+        if (*data_l < 1) goto truncated;
+        length = *(uint8_t*)*data;
+        if (*data_l < 1 + length) goto truncated;
+        p = *data + 1;
+        if (length >= 8) {
+            v->negative = p[0] != 0;
+            v->days = (int)read_uint_le(p + 1, 4);
+            v->hour = (uint8_t)p[5];
+            v->minute = (uint8_t)p[6];
+            v->second = (uint8_t)p[7];
+        }
+        if (length >= 12) {
+            v->microsecond = (int)read_uint_le(p + 8, 4);
+        }
+        v->kind = ACCEL_BIN_TIME;
+        v->out = *data;
+        v->out_l = 1 + length;
+        *data += 1 + length; *data_l -= 1 + length;
+        return;
+
+    default:
+        read_length_coded_string(data, data_l, &v->out, &v->out_l, &is_null);
+        v->kind = (is_null) ? ACCEL_BIN_NULL : ACCEL_BIN_STRING;
+        return;
+    }
+
+truncated:
+    *data += *data_l;
+    *data_l = 0;
+}
+
+//
+// Format a fixed-width binary value the way the text protocol sends it.
+// Returns the length of the text.
+//
+static unsigned long long format_binary_value(BinaryValue *v, char *text, size_t text_size) {
+    int n = 0;
+
+    switch (v->kind) {
+    case ACCEL_BIN_INT:
+        n = (v->is_unsigned) ?
+            snprintf(text, text_size, "%llu", (unsigned long long)v->i64) :
+            snprintf(text, text_size, "%lld", (long long)v->i64);
+        break;
+    case ACCEL_BIN_FLOAT:
+        n = snprintf(text, text_size, "%.17g", v->dbl);
+        break;
+    case ACCEL_BIN_DATE:
+        n = snprintf(text, text_size, "%04d-%02d-%02d", v->year, v->month, v->day);
+        break;
+    case ACCEL_BIN_DATETIME:
+        n = snprintf(text, text_size, "%04d-%02d-%02d %02d:%02d:%02d",
+                     v->year, v->month, v->day, v->hour, v->minute, v->second);
+        if (v->microsecond && n > 0) {
+            n += snprintf(text + n, text_size - n, ".%06d", v->microsecond);
+        }
+        break;
+    case ACCEL_BIN_TIME:
+        n = snprintf(text, text_size, "%s%d:%02d:%02d", (v->negative) ? "-" : "",
+                     v->days * 24 + v->hour, v->minute, v->second);
+        if (v->microsecond && n > 0) {
+            n += snprintf(text + n, text_size - n, ".%06d", v->microsecond);
+        }
+        break;
+    }
+
+    return (n > 0) ? (unsigned long long)n : 0;
+}
+
+//
+// Convert a non-NULL binary protocol value of column `i` to a Python object.
+//
+static PyObject *read_binary_cell(
+    StateObject *py_state,
+    unsigned long i,
+    BinaryValue *v
+) {
+    char text[64];
+    unsigned long long text_l = 0;
+    PyObject *py_item = NULL;
+    int sign = (v->negative) ? -1 : 1;
+
+    if (v->kind == ACCEL_BIN_STRING) {
+        return read_cell(py_state, i, v->out, v->out_l);
+    }
+
+    // Custom converters receive the text protocol representation.
+    if (py_state->py_converters[i]) goto as_text;
+
+    switch (v->kind) {
+    case ACCEL_BIN_INT:
+        if (v->is_unsigned) return PyLong_FromUnsignedLongLong((uint64_t)v->i64);
+        return PyLong_FromLongLong(v->i64);
+
+    case ACCEL_BIN_FLOAT:
+        return PyFloat_FromDouble(v->dbl);
+
+    case ACCEL_BIN_DATE:
+        if (!v->year && !v->month && !v->day) {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+        py_item = temporal_cache_get(py_state->temporal_cache, ACCEL_TEMPORAL_DATE,
+                                     v->out, v->out_l);
+        if (py_item) return py_item;
+        py_item = PyDate_FromDate(
+#ifdef Py_LIMITED_API
+                        py_state,
+#endif
+                        v->year, v->month, v->day);
+        if (!py_item) break;
+        temporal_cache_put(py_state->temporal_cache, ACCEL_TEMPORAL_DATE,
+                           v->out, v->out_l, py_item);
+        return py_item;
+
+    case ACCEL_BIN_DATETIME:
+        if (!v->year && !v->month && !v->day && !v->hour && !v->minute &&
+            !v->second && !v->microsecond) {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+        py_item = temporal_cache_get(py_state->temporal_cache, ACCEL_TEMPORAL_DATETIME,
+                                     v->out, v->out_l);
+        if (py_item) return py_item;
+        py_item = PyDateTime_FromDateAndTime(
+#ifdef Py_LIMITED_API
+                        py_state,
+#endif
+                        v->year, v->month, v->day, v->hour, v->minute,
+                        v->second, v->microsecond);
+        if (!py_item) break;
+        temporal_cache_put(py_state->temporal_cache, ACCEL_TEMPORAL_DATETIME,
+                           v->out, v->out_l, py_item);
+        return py_item;
+
+    case ACCEL_BIN_TIME:
+        py_item = temporal_cache_get(py_state->temporal_cache, ACCEL_TEMPORAL_TIMEDELTA,
+                                     v->out, v->out_l);
+        if (py_item) return py_item;
+        py_item = PyDelta_FromDSU(
+#ifdef Py_LIMITED_API
+                        py_state,
+#endif
+                        0, sign * ((v->days * 24 + v->hour) * 60 * 60 +
+                                   v->minute * 60 + v->second),
+                           sign * v->microsecond);
+        if (!py_item) break;
+        temporal_cache_put(py_state->temporal_cache, ACCEL_TEMPORAL_TIMEDELTA,
+                           v->out, v->out_l, py_item);
+        return py_item;
+    }
+
+    // Invalid dates are handled like those of the text protocol.
+    PyErr_Clear();
+
+as_text:
+    text_l = format_binary_value(v, text, sizeof(text));
+    return read_cell(py_state, i, text, text_l);
+}
+
+//
+// End Binary protocol
+//
+
+//
+// Rows
+//
+// Row objects of the rows and lazyrows results types. A row holds its
+// values in one array and a reference to the schema of its result, whose
+// column names are shared by all rows. Values can be accessed by index,
+// by column name and as attributes; rows compare like tuples and have the
+// `keys`, `values`, `items` and `get` methods of mappings.
+//
+// Rows of the lazyrows type keep a copy of their row data packet and the
+// offset of each cell, found in one scan of the length prefixes, and decode
+// a cell the first time it is accessed. Until all cells have been decoded,
+// the row keeps the state of its result alive for the column decoders.
+//
+
+static PyTypeObject *RowType = NULL;
+
+// Names of the attributes of the Row type, which take precedence over
+// column names
+static PyObject *row_type_attrs = NULL;
+
+// The module's _make_row function, which unpickles rows
+static PyObject *row_factory = NULL;
+
+typedef struct {
+    unsigned long long offset; // Offset of the value in the payload
+    unsigned long long length; // Length of the value
+} RowCell;
+
+//
+// Undecoded cells of a lazy row. The cell of each column and a copy of the
+// row data packet follow the header.
+//
+typedef struct {
+    StateObject *state; // Decoders of the cells
+    unsigned long long n_undecoded; // Number of cells not decoded yet
+} RowPacket;
+
+typedef struct {
+    PyObject_VAR_HEAD
+    SchemaObject *schema; // Column names shared by the rows of a result
+    RowPacket *packet; // Undecoded cells (NULL once all are decoded)
+    PyObject *values[1]; // Value of each column (NULL until decoded)
+} RowObject;
+
+static inline RowCell *row_packet_cells(RowPacket *packet) {
+    return (RowCell*)(packet + 1);
+}
+
+static void row_packet_free(RowPacket *packet) {
+    if (!packet) return;
+    Py_CLEAR(packet->state);
+    free(packet);
+}
+
+static RowObject *Row_new(SchemaObject *schema) {
+    RowObject *self = (RowObject*)PyType_GenericAlloc(RowType, (Py_ssize_t)schema->n_cols);
+    if (!self) return NULL;
+    self->schema = schema;
+    Py_INCREF(schema);
+    return self;
+}
+
+//
+// Stop tracking a row whose values cannot be part of a reference cycle,
+// like the garbage collector does with tuples, so that large results do
+// not slow down collections.
+//
+static void Row_untrack_if_atomic(RowObject *self) {
+    if (self->packet) return;
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        if (PyType_HasFeature(Py_TYPE(self->values[i]), Py_TPFLAGS_HAVE_GC)) return;
+    }
+    PyObject_GC_UnTrack(self);
+}
+
+//
+// Build a row from a text protocol row data packet without decoding the
+// cells. NULL values are stored right away.
+//
+static PyObject *Row_from_text_packet(
+    StateObject *py_state,
+    char *data,
+    unsigned long long data_l
+) {
+    unsigned long long n_cols = py_state->n_cols;
+    RowObject *self = NULL;
+    RowPacket *packet = NULL;
+    RowCell *cells = NULL;
+    char *start = data;
+    char *out = NULL;
+    unsigned long long out_l = 0;
+    int is_null = 0;
+
+    self = Row_new(py_state->schema);
+    if (!self) return NULL;
+
+    // The decoders need a writable byte after the last value.
+    packet = malloc(sizeof(RowPacket) + n_cols * sizeof(RowCell) + data_l + 1);
+    if (!packet) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    cells = row_packet_cells(packet);
+    memcpy(cells + n_cols, data, data_l);
+    packet->n_undecoded = 0;
+    packet->state = py_state;
+    Py_INCREF(py_state);
+    self->packet = packet;
+
+    for (unsigned long i = 0; i < n_cols; i++) {
+        read_length_coded_string(&data, &data_l, &out, &out_l, &is_null);
+        if (is_null) {
+            Py_INCREF(Py_None);
+            self->values[i] = Py_None;
+            continue;
+        }
+        cells[i].offset = out - start;
+        cells[i].length = out_l;
+        packet->n_undecoded++;
+    }
+
+    if (!packet->n_undecoded) {
+        row_packet_free(self->packet);
+        self->packet = NULL;
+        Row_untrack_if_atomic(self);
+    }
+
+    return (PyObject*)self;
+}
+
+//
+// Build a row from decoded values. The references in `items` are stolen.
+//
+static PyObject *Row_from_values(SchemaObject *schema, PyObject **items) {
+    RowObject *self = Row_new(schema);
+    if (!self) return NULL;
+    for (unsigned long i = 0; i < schema->n_cols; i++) {
+        self->values[i] = items[i];
+        items[i] = NULL;
+    }
+    Row_untrack_if_atomic(self);
+    return (PyObject*)self;
+}
+
+//
+// Return a new reference to the value of column `i`, decoding it if
+// needed.
+//
+static PyObject *Row_value(RowObject *self, Py_ssize_t i) {
+    PyObject *py_value = self->values[i];
+
+    if (!py_value) {
+        RowPacket *packet = self->packet;
+        StateObject *py_state = packet->state;
+        RowCell *cells = row_packet_cells(packet);
+        char *payload = (char*)(cells + Py_SIZE(self));
+
+        py_value = py_state->decoders[i](py_state, i, payload + cells[i].offset, cells[i].length);
+        if (!py_value) return NULL;
+
+        // A converter may have accessed the cell in the meantime.
+        if (self->values[i]) {
+            Py_DECREF(py_value);
+            py_value = self->values[i];
+        } else {
+            self->values[i] = py_value;
+            if (--packet->n_undecoded == 0) {
+                self->packet = NULL;
+                row_packet_free(packet);
+                Row_untrack_if_atomic(self);
+            }
+        }
+    }
+
+    Py_INCREF(py_value);
+    return py_value;
+}
+
+// Rows are only created by the result readers.
+static PyObject *Row_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    PyErr_SetString(PyExc_TypeError, "cannot create 'Row' instances");
+    return NULL;
+}
+
+static int Row_clear(RowObject *self) {
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        Py_CLEAR(self->values[i]);
+    }
+    row_packet_free(self->packet);
+    self->packet = NULL;
+    return 0;
+}
+
+static int Row_traverse(RowObject *self, visitproc visit, void *arg) {
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        Py_VISIT(self->values[i]);
+    }
+    if (self->packet) Py_VISIT(self->packet->state);
+    return 0;
+}
+
+static void Row_dealloc(RowObject *self) {
+    PyTypeObject *tp = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    Row_clear(self);
+    Py_CLEAR(self->schema);
+    PyObject_GC_Del(self);
+    Py_DECREF(tp);
+}
+
+static Py_ssize_t Row_length(RowObject *self) {
+    return Py_SIZE(self);
+}
+
+static PyObject *Row_item(RowObject *self, Py_ssize_t i) {
+    if (i < 0 || i >= Py_SIZE(self)) {
+        PyErr_SetString(PyExc_IndexError, "row index out of range");
+        return NULL;
+    }
+    return Row_value(self, i);
+}
+
+static PyObject *Row_subscript(RowObject *self, PyObject *py_key) {
+    PyObject *py_out = NULL;
+    PyObject *py_i = NULL;
+    Py_ssize_t i = 0;
+    Py_ssize_t start = 0;
+    Py_ssize_t stop = 0;
+    Py_ssize_t step = 0;
+    Py_ssize_t n = 0;
+
+    if (PyUnicode_Check(py_key)) {
+        if (Schema_ensure_name_index(self->schema) < 0) return NULL;
+        py_i = PyDict_GetItem(self->schema->py_name_index, py_key);
+        if (!py_i) {
+            PyErr_SetObject(PyExc_KeyError, py_key);
+            return NULL;
+        }
+        return Row_value(self, PyLong_AsSsize_t(py_i));
+    }
+
+    if (PySlice_Check(py_key)) {
+        if (PySlice_Unpack(py_key, &start, &stop, &step) < 0) return NULL;
+        n = PySlice_AdjustIndices(Py_SIZE(self), &start, &stop, step);
+        py_out = PyTuple_New(n);
+        if (!py_out) return NULL;
+        for (Py_ssize_t j = 0; j < n; j++, start += step) {
+            PyObject *py_value = Row_value(self, start);
+            if (!py_value) {
+                Py_DECREF(py_out);
+                return NULL;
+            }
+            PyTuple_SetItem(py_out, j, py_value);
+        }
+        return py_out;
+    }
+
+    i = PyNumber_AsSsize_t(py_key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) return NULL;
+    if (i < 0) i += Py_SIZE(self);
+    return Row_item(self, i);
+}
+
+static PyObject *Row_iter(RowObject *self) {
+    return PySeqIter_New((PyObject*)self);
+}
+
+//
+// Return a tuple of all values, decoding the remaining cells.
+//
+static PyObject *Row_as_tuple(RowObject *self) {
+    PyObject *py_out = PyTuple_New(Py_SIZE(self));
+    if (!py_out) return NULL;
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        PyObject *py_value = Row_value(self, i);
+        if (!py_value) {
+            Py_DECREF(py_out);
+            return NULL;
+        }
+        PyTuple_SetItem(py_out, i, py_value);
+    }
+    return py_out;
+}
+
+//
+// Rows compare and hash like tuples of their values.
+//
+static PyObject *Row_richcompare(RowObject *self, PyObject *py_other, int op) {
+    PyObject *py_self = NULL;
+    PyObject *py_out = NULL;
+
+    if (PyObject_TypeCheck(py_other, RowType)) {
+        py_other = Row_as_tuple((RowObject*)py_other);
+        if (!py_other) return NULL;
+    } else if (PyTuple_Check(py_other)) {
+        Py_INCREF(py_other);
+    } else {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+
+    py_self = Row_as_tuple(self);
+    if (py_self) py_out = PyObject_RichCompare(py_self, py_other, op);
+
+    Py_XDECREF(py_self);
+    Py_DECREF(py_other);
+    return py_out;
+}
+
+static Py_hash_t Row_hash(RowObject *self) {
+    PyObject *py_tuple = Row_as_tuple(self);
+    if (!py_tuple) return -1;
+    Py_hash_t out = PyObject_Hash(py_tuple);
+    Py_DECREF(py_tuple);
+    return out;
+}
+
+//
+// Column values are attributes of the row, unless the name is taken by an
+// attribute of the type such as `keys`.
+//
+static PyObject *Row_getattro(RowObject *self, PyObject *py_name) {
+    PyObject *py_i = NULL;
+
+    if (PyUnicode_Check(py_name) && self->schema->py_name_index &&
+            !PySet_Contains(row_type_attrs, py_name)) {
+        py_i = PyDict_GetItem(self->schema->py_name_index, py_name);
+        if (py_i) return Row_value(self, PyLong_AsSsize_t(py_i));
+    }
+
+    return PyObject_GenericGetAttr((PyObject*)self, py_name);
+}
+
+static PyObject *Row_keys(RowObject *self, PyObject *Py_UNUSED(ignored)) {
+    return PyList_GetSlice(self->schema->py_names_list, 0, Py_SIZE(self));
+}
+
+static PyObject *Row_values(RowObject *self, PyObject *Py_UNUSED(ignored)) {
+    PyObject *py_out = PyList_New(Py_SIZE(self));
+    if (!py_out) return NULL;
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        PyObject *py_value = Row_value(self, i);
+        if (!py_value) {
+            Py_DECREF(py_out);
+            return NULL;
+        }
+        PyList_SetItem(py_out, i, py_value);
+    }
+    return py_out;
+}
+
+static PyObject *Row_items(RowObject *self, PyObject *Py_UNUSED(ignored)) {
+    PyObject *py_out = PyList_New(Py_SIZE(self));
+    if (!py_out) return NULL;
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        PyObject *py_value = Row_value(self, i);
+        if (!py_value) goto error;
+        PyObject *py_item = PyTuple_Pack(2, self->schema->py_names[i], py_value);
+        Py_DECREF(py_value);
+        if (!py_item) goto error;
+        PyList_SetItem(py_out, i, py_item);
+    }
+    return py_out;
+
+error:
+    Py_DECREF(py_out);
+    return NULL;
+}
+
+static PyObject *Row_get(RowObject *self, PyObject *args) {
+    PyObject *py_key = NULL;
+    PyObject *py_default = Py_None;
+    PyObject *py_out = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &py_key, &py_default)) return NULL;
+
+    py_out = Row_subscript(self, py_key);
+    if (!py_out && (PyErr_ExceptionMatches(PyExc_KeyError) ||
+                    PyErr_ExceptionMatches(PyExc_IndexError))) {
+        PyErr_Clear();
+        Py_INCREF(py_default);
+        py_out = py_default;
+    }
+
+    return py_out;
+}
+
+static PyObject *Row_asdict(RowObject *self, PyObject *Py_UNUSED(ignored)) {
+    PyObject *py_out = PyDict_New();
+    if (!py_out) return NULL;
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        PyObject *py_value = Row_value(self, i);
+        if (!py_value) goto error;
+        int rc = PyDict_SetItem(py_out, self->schema->py_names[i], py_value);
+        Py_DECREF(py_value);
+        if (rc < 0) goto error;
+    }
+    return py_out;
+
+error:
+    Py_DECREF(py_out);
+    return NULL;
+}
+
+//
+// Rows support the sequence methods of tuples. Concatenation returns a
+// tuple, like it does for namedtuples.
+//
+static PyObject *Row_concat(RowObject *self, PyObject *py_other) {
+    PyObject *py_self = NULL;
+    PyObject *py_out = NULL;
+
+    if (PyObject_TypeCheck(py_other, RowType)) {
+        py_other = Row_as_tuple((RowObject*)py_other);
+        if (!py_other) return NULL;
+    } else {
+        Py_INCREF(py_other);
+    }
+
+    py_self = Row_as_tuple(self);
+    if (py_self) py_out = PySequence_Concat(py_self, py_other);
+
+    Py_XDECREF(py_self);
+    Py_DECREF(py_other);
+    return py_out;
+}
+
+// Tuples can be concatenated with rows on their right.
+static PyObject *Row_add(PyObject *py_left, PyObject *py_right) {
+    PyObject *py_out = NULL;
+
+    if (PyObject_TypeCheck(py_left, RowType)) {
+        return Row_concat((RowObject*)py_left, py_right);
+    }
+    if (!PyTuple_Check(py_left)) Py_RETURN_NOTIMPLEMENTED;
+
+    py_right = Row_as_tuple((RowObject*)py_right);
+    if (!py_right) return NULL;
+    py_out = PySequence_Concat(py_left, py_right);
+    Py_DECREF(py_right);
+    return py_out;
+}
+
+static PyObject *Row_count(RowObject *self, PyObject *py_value) {
+    PyObject *py_self = Row_as_tuple(self);
+    if (!py_self) return NULL;
+    Py_ssize_t n = PySequence_Count(py_self, py_value);
+    Py_DECREF(py_self);
+    if (n < 0) return NULL;
+    return PyLong_FromSsize_t(n);
+}
+
+static PyObject *Row_index(RowObject *self, PyObject *args) {
+    PyObject *py_self = NULL;
+    PyObject *py_index = NULL;
+    PyObject *py_out = NULL;
+
+    py_self = Row_as_tuple(self);
+    if (!py_self) return NULL;
+
+    py_index = PyObject_GetAttrString(py_self, "index");
+    if (py_index) py_out = PyObject_CallObject(py_index, args);
+
+    Py_XDECREF(py_index);
+    Py_DECREF(py_self);
+    return py_out;
+}
+
+//
+// Rows are pickled as their column names and values. The names list is
+// shared by the rows of a result, so a pickled list of rows holds it once.
+//
+static PyObject *Row_reduce(RowObject *self, PyObject *Py_UNUSED(ignored)) {
+    PyObject *py_values = Row_as_tuple(self);
+    if (!py_values) return NULL;
+    PyObject *py_out = Py_BuildValue("(O(ON))", row_factory,
+                                     self->schema->py_names_list, py_values);
+    return py_out;
+}
+
+//
+// Build a row from column names and values.
+//
+static PyObject *make_row(PyObject *self, PyObject *args) {
+    PyObject *py_names = NULL;
+    PyObject *py_values = NULL;
+    PyObject **items = NULL;
+    SchemaObject *schema = NULL;
+    PyObject *py_out = NULL;
+    Py_ssize_t n_cols = 0;
+
+    if (!PyArg_ParseTuple(args, "OO", &py_names, &py_values)) return NULL;
+
+    py_values = PySequence_Tuple(py_values);
+    if (!py_values) return NULL;
+
+    schema = Schema_get_for_names(py_names);
+    if (!schema) goto exit;
+
+    n_cols = PyTuple_Size(py_values);
+    if ((unsigned long long)n_cols != schema->n_cols) {
+        PyErr_SetString(PyExc_ValueError, "number of values does not match the column names");
+        goto exit;
+    }
+
+    items = calloc(n_cols ? n_cols : 1, sizeof(PyObject*));
+    if (!items) { PyErr_NoMemory(); goto exit; }
+    for (Py_ssize_t i = 0; i < n_cols; i++) {
+        items[i] = PyTuple_GetItem(py_values, i);
+        Py_INCREF(items[i]);
+    }
+
+    py_out = Row_from_values(schema, items);
+    if (!py_out) {
+        for (Py_ssize_t i = 0; i < n_cols; i++) Py_CLEAR(items[i]);
+    }
+
+exit:
+    DESTROY(items);
+    Py_XDECREF(schema);
+    Py_DECREF(py_values);
+    return py_out;
+}
+
+static PyObject *Row_get_fields(RowObject *self, void *closure) {
+    return PyList_AsTuple(self->schema->py_names_list);
+}
+
+static PyMethodDef Row_methods[] = {
+    {"keys", (PyCFunction)Row_keys, METH_NOARGS,
+     "Return the list of column names"},
+    {"values", (PyCFunction)Row_values, METH_NOARGS,
+     "Return the list of values"},
+    {"items", (PyCFunction)Row_items, METH_NOARGS,
+     "Return the list of (column name, value) pairs"},
+    {"get", (PyCFunction)Row_get, METH_VARARGS,
+     "Return the value of a column name or index, or the default if there is none"},
+    {"_asdict", (PyCFunction)Row_asdict, METH_NOARGS,
+     "Return a dict of column names to values"},
+    {"count", (PyCFunction)Row_count, METH_O,
+     "Return the number of occurrences of a value"},
+    {"index", (PyCFunction)Row_index, METH_VARARGS,
+     "Return the first index of a value"},
+    {"__reduce__", (PyCFunction)Row_reduce, METH_NOARGS,
+     "Return the column names and values for pickling"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Row_getset[] = {
+    {"_fields", (getter)Row_get_fields, NULL,
+     "Tuple of column names", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyObject *Row_repr(RowObject *self) {
+    PyObject *py_out = NULL;
+    PyObject *py_fields = NULL;
+    PyObject *py_sep = NULL;
+    PyObject *py_joined = NULL;
+
+    py_fields = PyList_New(Py_SIZE(self));
+    if (!py_fields) goto error;
+
+    for (Py_ssize_t i = 0; i < Py_SIZE(self); i++) {
+        PyObject *py_value = Row_value(self, i);
+        if (!py_value) goto error;
+        PyObject *py_field = PyUnicode_FromFormat("%U=%R", self->schema->py_names[i], py_value);
+        Py_DECREF(py_value);
+        if (!py_field) goto error;
+        PyList_SetItem(py_fields, i, py_field);
+    }
+
+    py_sep = PyUnicode_FromString(", ");
+    if (!py_sep) goto error;
+
+    py_joined = PyUnicode_Join(py_sep, py_fields);
+    if (!py_joined) goto error;
+
+    py_out = PyUnicode_FromFormat("Row(%U)", py_joined);
+
+exit:
+    Py_XDECREF(py_joined);
+    Py_XDECREF(py_sep);
+    Py_XDECREF(py_fields);
+    return py_out;
+
+error:
+    Py_CLEAR(py_out);
+    goto exit;
+}
+
+static PyType_Slot RowType_slots[] = {
+    {Py_tp_new, (newfunc)Row_tp_new},
+    {Py_tp_dealloc, (destructor)Row_dealloc},
+    {Py_tp_traverse, (traverseproc)Row_traverse},
+    {Py_tp_clear, (inquiry)Row_clear},
+    {Py_tp_repr, (reprfunc)Row_repr},
+    {Py_tp_richcompare, (richcmpfunc)Row_richcompare},
+    {Py_tp_hash, (hashfunc)Row_hash},
+    {Py_tp_getattro, (getattrofunc)Row_getattro},
+    {Py_tp_methods, Row_methods},
+    {Py_tp_getset, Row_getset},
+    {Py_tp_iter, (getiterfunc)Row_iter},
+    {Py_sq_length, (lenfunc)Row_length},
+    {Py_sq_item, (ssizeargfunc)Row_item},
+    {Py_sq_concat, (binaryfunc)Row_concat},
+    {Py_nb_add, (binaryfunc)Row_add},
+    {Py_mp_length, (lenfunc)Row_length},
+    {Py_mp_subscript, (binaryfunc)Row_subscript},
+    {Py_tp_doc, "Row of data values accessible by index, column name, or attribute"},
+    {0, NULL},
+};
+
+static PyType_Spec RowType_spec = {
+    .name = "_singlestoredb_accel.Row",
+    .basicsize = offsetof(RowObject, values),
+    .itemsize = sizeof(PyObject*),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .slots = RowType_slots,
+};
+
+//
+// End Rows
+//
+
+//
+// Decode a row data packet into the row object of the results type. The
+// cells are decoded first, with the decoder of each column, and are then
+// moved into the row in one pass.
+//
+static PyObject *read_row_from_packet(
+    StateObject *py_state,
+    char *data,
+    unsigned long long data_l
+) {
+    char *out = NULL;
+    unsigned long long out_l = 0;
+    unsigned long long n_cols = py_state->n_cols;
+    unsigned long long n_items = 0;
+    int is_null = 0;
+    uint8_t *null_bitmap = NULL;
+    BinaryValue value;
+    CellDecoder *decoders = py_state->decoders;
+    PyObject **items = py_state->row_items;
+    PyObject *py_result = NULL;
+    unsigned long i = 0;
+
+    if (py_state->binary) {
+        null_bitmap = read_binary_row_header(py_state, &data, &data_l);
+        if (!null_bitmap) return NULL;
+
+        for (; n_items < n_cols; n_items++) {
+            read_binary_value(py_state, n_items, null_bitmap, &data, &data_l, &value);
+            if (value.kind == ACCEL_BIN_NULL) {
+                Py_INCREF(Py_None);
+                items[n_items] = Py_None;
+            } else {
+                items[n_items] = read_binary_cell(py_state, n_items, &value);
+                if (!items[n_items]) goto error;
+            }
+        }
+    }
+
+    // Text cells of lazy rows are decoded when they are accessed.
+    else if (py_state->options.results_type == ACCEL_OUT_LAZYROWS) {
+        return Row_from_text_packet(py_state, data, data_l);
+    }
+
+    else {
+        for (; n_items < n_cols; n_items++) {
+            read_length_coded_string(&data, &data_l, &out, &out_l, &is_null);
+            if (is_null) {
+                Py_INCREF(Py_None);
+                items[n_items] = Py_None;
+            } else {
+                items[n_items] = decoders[n_items](py_state, n_items, out, out_l);
+                if (!items[n_items]) goto error;
+            }
+        }
+    }
+
+    switch (py_state->options.results_type) {
+    case ACCEL_OUT_DICTS:
+        py_result = PyDict_New();
+        if (!py_result) goto error;
+        for (i = 0; i < n_cols; i++) {
+            if (PyDict_SetItem(py_result, py_state->py_names[i], items[i]) < 0) goto error;
+        }
+        break;
+
+    case ACCEL_OUT_STRUCTSEQUENCES:
+        if (!py_state->structsequence) goto error;
+        py_result = PyStructSequence_New(py_state->structsequence);
+        if (!py_result) goto error;
+        for (i = 0; i < n_cols; i++) {
+            PyStructSequence_SetItem(py_result, i, items[i]);
+            items[i] = NULL;
+        }
+        break;
+
+    case ACCEL_OUT_NAMEDTUPLES:
+        // The arguments tuple is reused for every row.
+        if (!py_state->py_namedtuple || !py_state->py_namedtuple_args) goto error;
+        for (i = 0; i < n_cols; i++) {
+            PyTuple_SetItem(py_state->py_namedtuple_args, i, items[i]);
+            items[i] = NULL;
+        }
+        py_result = PyObject_CallObject(py_state->py_namedtuple, py_state->py_namedtuple_args);
+        if (!py_result) goto error;
+        break;
+
+    case ACCEL_OUT_ROWS:
+    case ACCEL_OUT_LAZYROWS:
+        py_result = Row_from_values(py_state->schema, items);
+        if (!py_result) goto error;
+        break;
+
+    default:
+        py_result = PyTuple_New(n_cols);
+        if (!py_result) goto error;
+        for (i = 0; i < n_cols; i++) {
+            PyTuple_SetItem(py_result, i, items[i]);
+            items[i] = NULL;
+        }
+    }
+
+exit:
+    for (i = 0; i < n_items; i++) {
+        Py_CLEAR(items[i]);
+    }
+    return py_result;
+
+error:
+    Py_CLEAR(py_result);
+    goto exit;
+}
+
+//
+// RowBuffer
+//
+// Rows of a buffered result read with the decode_on_fetch option. The row
+// data packets are kept in a RowArena, and a row is decoded into the
+// object of the results type each time it is indexed. Slices return a list
+// of decoded rows. The buffer keeps the state of the result alive for the
+// column decoders.
+//
+
+static PyTypeObject *RowBufferType = NULL;
+
+typedef struct {
+    PyObject_HEAD
+    StateObject *state; // Decoders of the rows
+    RowArena *arena; // Row data packets
+} RowBufferObject;
+
+//
+// Create a row buffer from the rows received by a state. The buffer takes
+// over the state's arena.
+//
+static PyObject *RowBuffer_from_state(StateObject *py_state) {
+    RowBufferObject *self = (RowBufferObject*)PyType_GenericAlloc(RowBufferType, 0);
+    if (!self) return NULL;
+
+    self->arena = py_state->row_arena;
+    py_state->row_arena = NULL;
+    row_arena_shrink(self->arena);
+
+    self->state = py_state;
+    Py_INCREF(py_state);
+    State_release_io(py_state);
+
+    return (PyObject*)self;
+}
+
+static PyObject *RowBuffer_row(RowBufferObject *self, Py_ssize_t i) {
+    RowArena *arena = self->arena;
+    return read_row_from_packet(self->state, arena->data + arena->offsets[i],
+                                arena->offsets[i + 1] - arena->offsets[i]);
+}
+
+// Row buffers are only created by the result reader.
+static PyObject *RowBuffer_tp_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    PyErr_SetString(PyExc_TypeError, "cannot create 'RowBuffer' instances");
+    return NULL;
+}
+
+static int RowBuffer_clear(RowBufferObject *self) {
+    Py_CLEAR(self->state);
+    return 0;
+}
+
+static int RowBuffer_traverse(RowBufferObject *self, visitproc visit, void *arg) {
+    Py_VISIT(self->state);
+    return 0;
+}
+
+static void RowBuffer_dealloc(RowBufferObject *self) {
+    PyTypeObject *tp = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    RowBuffer_clear(self);
+    row_arena_free(self->arena);
+    self->arena = NULL;
+    PyObject_GC_Del(self);
+    Py_DECREF(tp);
+}
+
+static Py_ssize_t RowBuffer_length(RowBufferObject *self) {
+    return (Py_ssize_t)self->arena->n_rows;
+}
+
+static PyObject *RowBuffer_item(RowBufferObject *self, Py_ssize_t i) {
+    if (i < 0 || i >= (Py_ssize_t)self->arena->n_rows || !self->state) {
+        PyErr_SetString(PyExc_IndexError, "row index out of range");
+        return NULL;
+    }
+    return RowBuffer_row(self, i);
+}
+
+static PyObject *RowBuffer_subscript(RowBufferObject *self, PyObject *py_key) {
+    Py_ssize_t n_rows = (Py_ssize_t)self->arena->n_rows;
+    Py_ssize_t start = 0, stop = 0, step = 0, n = 0;
+    PyObject *py_out = NULL;
+
+    if (PySlice_Check(py_key)) {
+        if (PySlice_Unpack(py_key, &start, &stop, &step) < 0) return NULL;
+        n = PySlice_AdjustIndices(n_rows, &start, &stop, step);
+        py_out = PyList_New(n);
+        if (!py_out) return NULL;
+        for (Py_ssize_t i = 0; i < n; i++, start += step) {
+            PyObject *py_row = RowBuffer_item(self, start);
+            if (!py_row) { Py_DECREF(py_out); return NULL; }
+            PyList_SetItem(py_out, i, py_row);
+        }
+        return py_out;
+    }
+
+    Py_ssize_t i = PyNumber_AsSsize_t(py_key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) return NULL;
+    if (i < 0) i += n_rows;
+    return RowBuffer_item(self, i);
+}
+
+static PyObject *RowBuffer_iter(RowBufferObject *self) {
+    return PySeqIter_New((PyObject*)self);
+}
+
+static PyType_Slot RowBufferType_slots[] = {
+    {Py_tp_new, (newfunc)RowBuffer_tp_new},
+    {Py_tp_dealloc, (destructor)RowBuffer_dealloc},
+    {Py_tp_traverse, (traverseproc)RowBuffer_traverse},
+    {Py_tp_clear, (inquiry)RowBuffer_clear},
+    {Py_tp_iter, (getiterfunc)RowBuffer_iter},
+    {Py_sq_length, (lenfunc)RowBuffer_length},
+    {Py_sq_item, (ssizeargfunc)RowBuffer_item},
+    {Py_mp_length, (lenfunc)RowBuffer_length},
+    {Py_mp_subscript, (binaryfunc)RowBuffer_subscript},
+    {Py_tp_doc, "Rows of a buffered result, decoded when they are accessed"},
+    {0, NULL},
+};
+
+static PyType_Spec RowBufferType_spec = {
+    .name = "_singlestoredb_accel.RowBuffer",
+    .basicsize = sizeof(RowBufferObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .slots = RowBufferType_slots,
+};
+
+//
+// End RowBuffer
+//
+
+//
+// ArrowBatch
+//
+// A batch of columns in the Arrow memory layout. It implements the Arrow
+// PyCapsule interface (`__arrow_c_schema__`, `__arrow_c_array__` and
+// `__arrow_c_stream__`) so that pyarrow, polars and other Arrow consumers
+// can use the column buffers directly. Exported arrays hold a reference to
+// the batch, which keeps the buffers alive until the consumer releases them.
+//
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema*);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray*);
+    void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
 
-    self->py_rfile = PyObject_GetAttr(self->py_conn, PyStr._rfile);
-    if (!self->py_rfile) goto error;
-    self->py_read = PyObject_GetAttr(self->py_rfile, PyStr.read);
-    if (!self->py_read) goto error;
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
 
-    PyObject *py_next_seq_id = PyObject_GetAttr(self->py_conn, PyStr._next_seq_id);
-    if (!py_next_seq_id) goto error;
-    self->next_seq_id = PyLong_AsUnsignedLongLong(py_next_seq_id);
-    Py_XDECREF(py_next_seq_id);
+struct ArrowArrayStream {
+    int (*get_schema)(struct ArrowArrayStream*, struct ArrowSchema *out);
+    int (*get_next)(struct ArrowArrayStream*, struct ArrowArray *out);
+    const char *(*get_last_error)(struct ArrowArrayStream*);
+    void (*release)(struct ArrowArrayStream*);
+    void *private_data;
+};
 
-    if (py_options && PyDict_Check(py_options)) {
-        read_options(&self->options, py_options);
-    }
+#endif // ARROW_C_STREAM_INTERFACE
 
-    switch (self->options.results_type) {
-    case ACCEL_OUT_NAMEDTUPLES:
-    case ACCEL_OUT_STRUCTSEQUENCES:
-        if (self->options.results_type == ACCEL_OUT_NAMEDTUPLES)
-        {
-            py_args = PyTuple_New(2);
-            if (!py_args) goto error;
+static PyTypeObject *ArrowBatchType = NULL;
 
-            rc = PyTuple_SetItem(py_args, 0, PyStr.Row);
-            if (rc) goto error;
-            Py_INCREF(PyStr.Row);
+typedef struct {
+    PyObject *py_name; // Column name
+    char format[32]; // Arrow format string
+    int64_t null_count; // Number of NULL values
+    PyObject *py_validity; // bytearray of validity bits (NULL if there are no NULLs)
+    PyObject *py_offsets; // bytearray of int64 value offsets (NULL for fixed-width values)
+    PyObject *py_data; // bytearray of values
+} ArrowColumn;
 
-            rc = PyTuple_SetItem(py_args, 1, self->py_names_list);
-            if (rc) goto error;
-            Py_INCREF(self->py_names_list);
+typedef struct {
+    PyObject_HEAD
+    ArrowColumn *columns; // Column buffers
+    unsigned long long n_cols; // Number of columns
+    unsigned long long n_rows; // Number of rows
+} ArrowBatchObject;
 
-            self->py_namedtuple = PyObject_Call(
-                                      PyFunc.collections_namedtuple,
-                                      py_args, PyObj.namedtuple_kwargs);
-            if (!self->py_namedtuple) goto error;
+//
+// Private data of an exported array. Each array holds its own reference
+// to the batch since consumers may move children out of their parent.
+//
+typedef struct {
+    PyObject *py_batch; // Batch that owns the buffers
+    const void *buffers[3]; // Validity, offsets and data buffers
+    struct ArrowArray **children; // Child array pointers (struct array only)
+    struct ArrowArray *child_arrays; // Child arrays (struct array only)
+} ArrowArrayPrivate;
 
-            self->py_namedtuple_args = PyTuple_New(self->n_cols);
-            if (!self->py_namedtuple_args) goto error;
+typedef struct {
+    PyObject *py_batch; // Batch to export
+    int is_done; // Has the batch been returned yet?
+} ArrowStreamPrivate;
+
+static void ArrowBatch_dealloc(ArrowBatchObject *self) {
+    if (self->columns) {
+        for (unsigned long long i = 0; i < self->n_cols; i++) {
+            Py_CLEAR(self->columns[i].py_name);
+            Py_CLEAR(self->columns[i].py_validity);
+            Py_CLEAR(self->columns[i].py_offsets);
+            Py_CLEAR(self->columns[i].py_data);
         }
-        else
-        {
-            self->structsequence_desc.name = "singlestoredb.Row";
-            self->structsequence_desc.doc = "Row of data values";
-            self->structsequence_desc.n_in_sequence = (int)self->n_cols;
-            self->structsequence_desc.fields = calloc(self->n_cols + 1, sizeof(PyStructSequence_Field));
-            if (!self->structsequence_desc.fields) goto error;
-            for (unsigned long i = 0; i < self->n_cols; i++) {
-                self->structsequence_desc.fields[i].name = _PyUnicode_AsUTF8(self->py_names[i]);
-                self->structsequence_desc.fields[i].doc = NULL;
-            }
-            self->structsequence = PyStructSequence_NewType(&self->structsequence_desc);
-            if (!self->structsequence) goto error;
+        DESTROY(self->columns);
+    }
+    PyObject_Del(self);
+}
+
+static Py_ssize_t ArrowBatch_len(ArrowBatchObject *self) {
+    return (Py_ssize_t)self->n_rows;
+}
+
+static void ArrowBatch_release_schema(struct ArrowSchema *schema) {
+    if (!schema || !schema->release) return;
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        if (schema->children[i]->release) {
+            schema->children[i]->release(schema->children[i]);
         }
+    }
+    DESTROY(schema->name);
+    DESTROY(schema->children);
+    DESTROY(schema->private_data);
+    schema->release = NULL;
+}
 
-        // Fall through
+static void ArrowBatch_release_array(struct ArrowArray *array) {
+    if (!array || !array->release) return;
 
-    default:
-        // For fetchone, reuse the same list every time.
-        //if (requested_n_rows == 1) {
-        //    self->py_rows = PyList_New(1);
-        //    PyList_SetItem(self->py_rows, 0, Py_None);
-        //} else {
-            self->py_rows = PyList_New(0);
-        //}
-        if (!self->py_rows) goto error;
+    ArrowArrayPrivate *priv = (ArrowArrayPrivate*)array->private_data;
 
-        PyObject_SetAttr(py_res, PyStr.rows, self->py_rows);
+    for (int64_t i = 0; i < array->n_children; i++) {
+        if (array->children[i]->release) {
+            array->children[i]->release(array->children[i]);
+        }
     }
 
-exit:
-    Py_XDECREF(py_args);
-    Py_XDECREF(py_converters);
-    Py_XDECREF(py_options);
-    if (PyErr_Occurred()) {
-        PyErr_Print();
+    // Consumers may release arrays from any thread.
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    Py_CLEAR(priv->py_batch);
+    PyGILState_Release(gstate);
+
+    DESTROY(priv->children);
+    DESTROY(priv->child_arrays);
+    DESTROY(array->private_data);
+    array->release = NULL;
+}
+
+//
+// Export the batch schema as a struct type with one field per column.
+//
+static int ArrowBatch_export_schema(ArrowBatchObject *self, struct ArrowSchema *schema) {
+    struct ArrowSchema *children = NULL;
+
+    memset(schema, 0, sizeof(struct ArrowSchema));
+    schema->format = "+s";
+    schema->release = ArrowBatch_release_schema;
+
+    schema->name = calloc(1, 1);
+    if (!schema->name) goto error;
+
+    children = calloc(self->n_cols + 1, sizeof(struct ArrowSchema));
+    if (!children) goto error;
+    schema->private_data = children;
+
+    schema->children = calloc(self->n_cols + 1, sizeof(struct ArrowSchema*));
+    if (!schema->children) goto error;
+
+    for (unsigned long long i = 0; i < self->n_cols; i++) {
+        struct ArrowSchema *child = &children[i];
+        child->flags = ARROW_FLAG_NULLABLE;
+        child->release = ArrowBatch_release_schema;
+        schema->children[i] = child;
+        schema->n_children++;
+        child->private_data = calloc(sizeof(self->columns[i].format), 1);
+        if (!child->private_data) goto error;
+        memcpy(child->private_data, self->columns[i].format, sizeof(self->columns[i].format));
+        child->format = child->private_data;
+        child->name = _PyUnicode_AsUTF8(self->columns[i].py_name);
+        if (!child->name) goto error;
     }
-    return rc;
+
+    return 0;
 
 error:
-    State_clear_fields(self);
-    rc = -1;
-    goto exit;
+    ArrowBatch_release_schema(schema);
+    if (!PyErr_Occurred()) PyErr_NoMemory();
+    return -1;
 }
 
-static int State_reset_batch(
-    StateObject *self,
-    PyObject *py_res,
-    unsigned long long requested_n_rows
-) {
-    int rc = 0;
-    PyObject *py_tmp = NULL;
-
-    self->n_rows_in_batch = 0;
+//
+// Export the batch as a struct array with one child array per column.
+//
+static int ArrowBatch_export_array(ArrowBatchObject *self, struct ArrowArray *array) {
+    ArrowArrayPrivate *priv = NULL;
+
+    memset(array, 0, sizeof(struct ArrowArray));
+    array->length = (int64_t)self->n_rows;
+    array->n_buffers = 1;
+    array->release = ArrowBatch_release_array;
+
+    priv = calloc(1, sizeof(ArrowArrayPrivate));
+    if (!priv) goto error;
+    array->private_data = priv;
+    array->buffers = priv->buffers;
+    priv->py_batch = (PyObject*)self;
+    Py_INCREF(self);
+
+    priv->child_arrays = calloc(self->n_cols + 1, sizeof(struct ArrowArray));
+    if (!priv->child_arrays) goto error;
+    priv->children = calloc(self->n_cols + 1, sizeof(struct ArrowArray*));
+    if (!priv->children) goto error;
+    array->children = priv->children;
+
+    for (unsigned long long i = 0; i < self->n_cols; i++) {
+        ArrowColumn *col = &self->columns[i];
+        struct ArrowArray *child = &priv->child_arrays[i];
+        ArrowArrayPrivate *child_priv = calloc(1, sizeof(ArrowArrayPrivate));
+        if (!child_priv) goto error;
+
+        child->length = (int64_t)self->n_rows;
+        child->null_count = col->null_count;
+        child->n_buffers = (col->py_offsets) ? 3 : 2;
+        child->buffers = child_priv->buffers;
+        child->private_data = child_priv;
+        child->release = ArrowBatch_release_array;
+        child_priv->py_batch = (PyObject*)self;
+        Py_INCREF(self);
+
+        child_priv->buffers[0] = (col->py_validity) ?
+                                 PyByteArray_AsString(col->py_validity) : NULL;
+        if (col->py_offsets) {
+            child_priv->buffers[1] = PyByteArray_AsString(col->py_offsets);
+            child_priv->buffers[2] = PyByteArray_AsString(col->py_data);
+        } else {
+            child_priv->buffers[1] = PyByteArray_AsString(col->py_data);
+        }
 
-    //if (requested_n_rows != 1) {
-        py_tmp = self->py_rows;
-        self->py_rows = PyList_New(0);
-        Py_XDECREF(py_tmp);
-        if (!self->py_rows) { rc = -1; goto error; }
-        rc = PyObject_SetAttr(py_res, PyStr.rows, self->py_rows);
-    //}
+        priv->children[i] = child;
+        array->n_children++;
+    }
 
-exit:
-    return rc;
+    return 0;
 
 error:
-    goto exit;
+    ArrowBatch_release_array(array);
+    if (!PyErr_Occurred()) PyErr_NoMemory();
+    return -1;
 }
 
-static PyType_Slot StateType_slots[] = {
-    {Py_tp_init, (initproc)State_init},
-    {Py_tp_dealloc, (destructor)State_dealloc},
-    {Py_tp_doc, "PyMySQL accelerator"},
-    {0, NULL},
-};
-
-static PyType_Spec StateType_spec = {
-    .name = "_singlestoredb_accel.State",
-    .basicsize = sizeof(StateObject),
-    .itemsize = 0,
-    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .slots = StateType_slots,
-};
-
-//
-// End State
-//
+static void ArrowBatch_free_schema_capsule(PyObject *py_capsule) {
+    struct ArrowSchema *schema = PyCapsule_GetPointer(py_capsule, "arrow_schema");
+    if (!schema) return;
+    if (schema->release) schema->release(schema);
+    free(schema);
+}
 
-static void read_options(MySQLAccelOptions *options, PyObject *dict) {
-    if (!options || !dict) return;
+static void ArrowBatch_free_array_capsule(PyObject *py_capsule) {
+    struct ArrowArray *array = PyCapsule_GetPointer(py_capsule, "arrow_array");
+    if (!array) return;
+    if (array->release) array->release(array);
+    free(array);
+}
 
-    PyObject *key = NULL;
-    PyObject *value = NULL;
-    Py_ssize_t pos = 0;
+static PyObject *ArrowBatch_schema_capsule(ArrowBatchObject *self) {
+    PyObject *py_out = NULL;
+    struct ArrowSchema *schema = calloc(1, sizeof(struct ArrowSchema));
+    if (!schema) return PyErr_NoMemory();
 
-    while (PyDict_Next(dict, &pos, &key, &value)) {
-        if (PyUnicode_CompareWithASCIIString(key, "results_type") == 0) {
-            if (PyUnicode_CompareWithASCIIString(value, "dict") == 0 ||
-                PyUnicode_CompareWithASCIIString(value, "dicts") == 0 ) {
-                options->results_type = ACCEL_OUT_DICTS;
-            }
-            else if (PyUnicode_CompareWithASCIIString(value, "namedtuple") == 0 ||
-                     PyUnicode_CompareWithASCIIString(value, "namedtuples") == 0) {
-                options->results_type = ACCEL_OUT_NAMEDTUPLES;
-            }
-            else if (PyUnicode_CompareWithASCIIString(value, "structsequence") == 0 ||
-                     PyUnicode_CompareWithASCIIString(value, "structsequences") == 0) {
-                options->results_type = ACCEL_OUT_STRUCTSEQUENCES;
-            }
-            else {
-                options->results_type = ACCEL_OUT_TUPLES;
-            }
-        } else if (PyUnicode_CompareWithASCIIString(key, "parse_json") == 0) {
-            options->parse_json = PyObject_IsTrue(value);
-        } else if (PyUnicode_CompareWithASCIIString(key, "invalid_values") == 0) {
-            if (PyDict_Check(value)) {
-                options->invalid_values = value;
-            }
-        }
+    if (ArrowBatch_export_schema(self, schema) < 0) {
+        free(schema);
+        return NULL;
     }
-}
 
-static void raise_exception(
-    PyObject *self,
-    char *err_type,
-    unsigned long long err_code,
-    char *err_str
-) {
-    PyObject *py_exc = NULL;
-    PyObject *py_val = NULL;
+    py_out = PyCapsule_New(schema, "arrow_schema", ArrowBatch_free_schema_capsule);
+    if (!py_out) {
+        schema->release(schema);
+        free(schema);
+    }
 
-    py_exc = PyObject_GetAttrString(self, err_type);
-    if (!py_exc) goto error;
+    return py_out;
+}
 
-    py_val = Py_BuildValue("(Ks)", err_code, err_str);
-    if (!py_val) goto error;
+static PyObject *ArrowBatch_array_capsule(ArrowBatchObject *self) {
+    PyObject *py_out = NULL;
+    struct ArrowArray *array = calloc(1, sizeof(struct ArrowArray));
+    if (!array) return PyErr_NoMemory();
 
-    PyErr_SetObject(py_exc, py_val);
+    if (ArrowBatch_export_array(self, array) < 0) {
+        free(array);
+        return NULL;
+    }
 
-exit:
-    if (py_exc) { Py_DECREF(py_exc); }
-    if (py_val) { Py_DECREF(py_val); }
-    return;
+    py_out = PyCapsule_New(array, "arrow_array", ArrowBatch_free_array_capsule);
+    if (!py_out) {
+        array->release(array);
+        free(array);
+    }
 
-error:
-    goto exit;
+    return py_out;
 }
 
-static int is_error_packet(char *buff_bytes) {
-    return buff_bytes && *(uint8_t*)buff_bytes == 0xFF;
+static int ArrowStream_get_schema(struct ArrowArrayStream *stream, struct ArrowSchema *out) {
+    ArrowStreamPrivate *priv = (ArrowStreamPrivate*)stream->private_data;
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    int rc = ArrowBatch_export_schema((ArrowBatchObject*)priv->py_batch, out);
+    if (rc < 0) PyErr_Clear();
+    PyGILState_Release(gstate);
+    return (rc < 0) ? ENOMEM : 0;
 }
 
-static void force_close(PyObject *py_conn) {
-    PyObject *py_sock = NULL;
+static int ArrowStream_get_next(struct ArrowArrayStream *stream, struct ArrowArray *out) {
+    ArrowStreamPrivate *priv = (ArrowStreamPrivate*)stream->private_data;
+    int rc = 0;
 
-    py_sock = PyObject_GetAttr(py_conn, PyStr._sock);
-    if (!py_sock) goto error;
+    if (priv->is_done) {
+        memset(out, 0, sizeof(struct ArrowArray));
+        return 0;
+    }
 
-    Py_XDECREF(PyObject_CallMethod(py_sock, "close", NULL));
-    PyErr_Clear();
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    rc = ArrowBatch_export_array((ArrowBatchObject*)priv->py_batch, out);
+    if (rc < 0) PyErr_Clear();
+    PyGILState_Release(gstate);
 
-    PyObject_SetAttr(py_conn, PyStr._sock, Py_None);
-    PyObject_SetAttr(py_conn, PyStr._rfile, Py_None);
+    if (rc < 0) return ENOMEM;
 
-exit:
-    Py_XDECREF(py_sock);
-    return;
+    priv->is_done = 1;
 
-error:
-    goto exit;
+    return 0;
 }
 
-static PyObject *read_bytes(StateObject *py_state, unsigned long long num_bytes) {
-    PyObject *py_num_bytes = NULL;
-    PyObject *py_data = NULL;
-    PyObject *py_exc = NULL;
-
-    if (py_state->py_read_timeout && py_state->py_read_timeout != Py_None) {
-        Py_XDECREF(PyObject_CallFunctionObjArgs(py_state->py_settimeout,
-                                                py_state->py_read_timeout, NULL));
-        if (PyErr_Occurred()) goto error;
-    }
+static const char *ArrowStream_get_last_error(struct ArrowArrayStream *stream) {
+    return "out of memory";
+}
 
-    py_num_bytes = PyLong_FromUnsignedLongLong(num_bytes);
-    if (!py_num_bytes) goto error;
+static void ArrowStream_release(struct ArrowArrayStream *stream) {
+    if (!stream || !stream->release) return;
+    ArrowStreamPrivate *priv = (ArrowStreamPrivate*)stream->private_data;
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    Py_CLEAR(priv->py_batch);
+    PyGILState_Release(gstate);
+    DESTROY(stream->private_data);
+    stream->release = NULL;
+}
 
-    while (1) {
-        py_data = PyObject_CallFunctionObjArgs(py_state->py_read, py_num_bytes, NULL);
+static void ArrowBatch_free_stream_capsule(PyObject *py_capsule) {
+    struct ArrowArrayStream *stream = PyCapsule_GetPointer(py_capsule, "arrow_array_stream");
+    if (!stream) return;
+    if (stream->release) stream->release(stream);
+    free(stream);
+}
 
-        if ((py_exc = PyErr_Occurred())) {
-            if (PyErr_ExceptionMatches(PyExc_IOError) || PyErr_ExceptionMatches(PyExc_OSError)) {
-                PyObject *py_errno = PyObject_GetAttr(py_exc, PyStr.x_errno);
-                if (!py_errno) goto error;
+static PyObject *ArrowBatch_arrow_c_schema(ArrowBatchObject *self, PyObject *args) {
+    return ArrowBatch_schema_capsule(self);
+}
 
-                unsigned long long err = PyLong_AsUnsignedLongLong(py_errno);
-                Py_DECREF(py_errno);
+static PyObject *ArrowBatch_arrow_c_array(ArrowBatchObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *py_requested_schema = NULL;
+    PyObject *py_schema = NULL;
+    PyObject *py_array = NULL;
+    PyObject *py_out = NULL;
+    char *keywords[] = {"requested_schema", NULL};
 
-                if (err == 4 /* errno.EINTER */) {
-                    continue;
-                }
+    // The requested schema is only a hint, so it is ignored.
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", keywords, &py_requested_schema)) {
+        return NULL;
+    }
 
-                force_close(py_state->py_conn);
-                raise_exception(py_state->py_conn, "OperationalError", 0,
-                                "Lost connection to SingleStoreDB server during query");
-                goto error;
-            }
-            else if (PyErr_ExceptionMatches(PyExc_BaseException)) {
-                // Don't convert unknown exception to MySQLError.
-                force_close(py_state->py_conn);
-                goto error;
-            }
-        }
+    py_schema = ArrowBatch_schema_capsule(self);
+    if (!py_schema) goto error;
 
-        if (py_data) {
-            break;
-        }
-    }
+    py_array = ArrowBatch_array_capsule(self);
+    if (!py_array) goto error;
 
-    if (PyBytes_Size(py_data) < (long int)num_bytes) {
-        force_close(py_state->py_conn);
-        raise_exception(py_state->py_conn, "OperationalError", 0,
-                        "Lost connection to SingleStoreDB server during query");
-        goto error;
-    }
+    py_out = PyTuple_Pack(2, py_schema, py_array);
 
 exit:
-    Py_XDECREF(py_num_bytes);
-    return py_data;
+    Py_XDECREF(py_schema);
+    Py_XDECREF(py_array);
+    return py_out;
 
 error:
-    Py_CLEAR(py_data);
+    Py_CLEAR(py_out);
     goto exit;
 }
 
-static PyObject *read_packet(StateObject *py_state) {
-    PyObject *py_buff = NULL;
-    PyObject *py_new_buff = NULL;
-    PyObject *py_packet_header = NULL;
-    PyObject *py_bytes_to_read = NULL;
-    PyObject *py_recv_data = NULL;
-    unsigned long long bytes_to_read = 0;
-    char *buff = NULL;
-    uint64_t btrl = 0;
-    uint8_t btrh = 0;
-    uint8_t packet_number = 0;
+static PyObject *ArrowBatch_arrow_c_stream(ArrowBatchObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *py_requested_schema = NULL;
+    PyObject *py_out = NULL;
+    struct ArrowArrayStream *stream = NULL;
+    ArrowStreamPrivate *priv = NULL;
+    char *keywords[] = {"requested_schema", NULL};
+
+    // The requested schema is only a hint, so it is ignored.
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", keywords, &py_requested_schema)) {
+        return NULL;
+    }
+
+    stream = calloc(1, sizeof(struct ArrowArrayStream));
+    if (!stream) goto error;
+    priv = calloc(1, sizeof(ArrowStreamPrivate));
+    if (!priv) goto error;
 
-    py_buff = PyByteArray_FromStringAndSize(NULL, 0);
-    if (!py_buff) goto error;
+    priv->py_batch = (PyObject*)self;
+    Py_INCREF(self);
 
-    while (1) {
-        py_packet_header = read_bytes(py_state, 4);
-        if (!py_packet_header) goto error;
+    stream->get_schema = ArrowStream_get_schema;
+    stream->get_next = ArrowStream_get_next;
+    stream->get_last_error = ArrowStream_get_last_error;
+    stream->release = ArrowStream_release;
+    stream->private_data = priv;
 
-        buff = PyBytes_AsString(py_packet_header);
+    py_out = PyCapsule_New(stream, "arrow_array_stream", ArrowBatch_free_stream_capsule);
+    if (!py_out) goto error;
 
-        btrl = *(uint16_t*)buff;
-        btrh = *(uint8_t*)(buff+2);
-        packet_number = *(uint8_t*)(buff+3);
-        bytes_to_read = btrl + (btrh << 16);
+    return py_out;
 
-        Py_CLEAR(py_packet_header);
+error:
+    if (stream && stream->release) {
+        stream->release(stream);
+    }
+    else {
+        DESTROY(priv);
+    }
+    DESTROY(stream);
+    if (!PyErr_Occurred()) PyErr_NoMemory();
+    return NULL;
+}
 
-        if (packet_number != py_state->next_seq_id) {
-            force_close(py_state->py_conn);
-            if (packet_number == 0) {
-                raise_exception(py_state->py_conn, "OperationalError", 0,
-                                "Lost connection to SingleStoreDB server during query");
+static PyMethodDef ArrowBatch_methods[] = {
+    {"__arrow_c_schema__", (PyCFunction)ArrowBatch_arrow_c_schema, METH_NOARGS,
+     "Export the schema as an Arrow PyCapsule"},
+    {"__arrow_c_array__", (PyCFunction)ArrowBatch_arrow_c_array, METH_VARARGS | METH_KEYWORDS,
+     "Export the batch as Arrow PyCapsules of a struct schema and array"},
+    {"__arrow_c_stream__", (PyCFunction)ArrowBatch_arrow_c_stream, METH_VARARGS | METH_KEYWORDS,
+     "Export the batch as an Arrow PyCapsule of an array stream"},
+    {NULL, NULL, 0, NULL}
+};
 
-                goto error;
-            }
-            raise_exception(py_state->py_conn, "InternalError", 0,
-                            "Packet sequence number wrong");
-            goto error;
-        }
+static PyType_Slot ArrowBatchType_slots[] = {
+    {Py_tp_dealloc, (destructor)ArrowBatch_dealloc},
+    {Py_tp_methods, ArrowBatch_methods},
+    {Py_sq_length, (lenfunc)ArrowBatch_len},
+    {Py_tp_doc, "Batch of columns in the Arrow memory layout"},
+    {0, NULL},
+};
 
-        py_state->next_seq_id = (py_state->next_seq_id + 1) % 256;
+static PyType_Spec ArrowBatchType_spec = {
+    .name = "_singlestoredb_accel.ArrowBatch",
+    .basicsize = sizeof(ArrowBatchObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT,
+    .slots = ArrowBatchType_slots,
+};
 
-        py_recv_data = read_bytes(py_state, bytes_to_read);
-        if (!py_recv_data) goto error;
+//
+// End ArrowBatch
+//
 
-        py_new_buff = PyByteArray_Concat(py_buff, py_recv_data);
-        Py_CLEAR(py_recv_data);
-        Py_CLEAR(py_buff);
-        if (!py_new_buff) goto error;
+//
+// Columns
+//
+// Columnar results types decode each row straight into typed column
+// buffers rather than creating a Python object per value.
+//
+// The numpy results type stores numeric and date/time columns as int64,
+// uint64, float64, datetime64 and timedelta64 arrays with a separate NULL
+// mask. All other columns (and columns with custom converters) become
+// object arrays.
+//
+// The Arrow results type also stores date columns as date32, DECIMAL
+// columns as decimal128 or decimal256 and all other columns as UTF-8
+// strings or binary values in an ArrowBatch.
+//
+// The `decimal_type` option stores DECIMAL columns as float64 or as int64
+// values scaled by 10**scale in both results types.
+//
 
-        py_buff = py_new_buff;
-        py_new_buff = NULL;
+//
+// Precision of a DECIMAL column. The display length includes the sign and
+// the decimal point.
+//
+static int column_precision(StateObject *py_state, unsigned long i) {
+    long precision = (long)py_state->lengths[i];
+    long scale = (long)py_state->scales[i];
+    if (scale > 0) precision--;
+    if (!(py_state->flags[i] & MYSQL_FLAG_UNSIGNED)) precision--;
+    if (precision < scale) precision = scale;
+    if (precision < 1) precision = 1;
+    if (precision > 76) precision = 76;
+    return (int)precision;
+}
 
-        if (bytes_to_read == 0xFFFFFF) {
-            continue;
-        }
+static int column_kind(StateObject *py_state, unsigned long i) {
+    int is_arrow = py_state->options.results_type == ACCEL_OUT_ARROW;
+    int decimal_type = py_state->options.decimal_type;
+    int precision = 0;
 
-        if (bytes_to_read < MYSQL_MAX_PACKET_LEN) {
-            break;
-        }
+    // Arrow columns need a fixed type, so custom converters are not used.
+    if (!is_arrow && (py_state->py_converters[i] || py_state->py_invalid_values[i])) {
+        return ACCEL_COL_OBJECT;
     }
 
-    if (is_error_packet(PyByteArray_AsString(py_buff))) {
-        PyObject *py_result = PyObject_GetAttr(py_state->py_conn, PyStr._result);
-        if (py_result && py_result != Py_None) {
-            PyObject *py_unbuffered_active = PyObject_GetAttr(py_result, PyStr.unbuffered_active);
-            if (py_unbuffered_active == Py_True) {
-                PyObject_SetAttr(py_result, PyStr.unbuffered_active, Py_False);
-            }
-            Py_XDECREF(py_unbuffered_active);
+    switch (py_state->type_codes[i]) {
+    case MYSQL_TYPE_TINY:
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_INT24:
+    case MYSQL_TYPE_YEAR:
+        return ACCEL_COL_INT64;
+    case MYSQL_TYPE_LONGLONG:
+        return (py_state->flags[i] & MYSQL_FLAG_UNSIGNED) ?
+               ACCEL_COL_UINT64 : ACCEL_COL_INT64;
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_DOUBLE:
+        return ACCEL_COL_FLOAT64;
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+        return ACCEL_COL_DATETIME64;
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_NEWDATE:
+        return (is_arrow) ? ACCEL_COL_DATE32 : ACCEL_COL_DATE64;
+    case MYSQL_TYPE_TIME:
+        return ACCEL_COL_TIMEDELTA64;
+    case MYSQL_TYPE_DECIMAL:
+    case MYSQL_TYPE_NEWDECIMAL:
+        precision = column_precision(py_state, i);
+        if (decimal_type == ACCEL_OPTION_DECIMAL_TYPE_FLOAT) return ACCEL_COL_FLOAT64;
+        if (decimal_type == ACCEL_OPTION_DECIMAL_TYPE_SCALED_INT && precision <= 18) {
+            return ACCEL_COL_SCALED_INT64;
         }
-        Py_XDECREF(py_result);
-        Py_XDECREF(PyObject_CallMethod(py_state->py_conn, "_raise_mysql_exception",
-                                       "O", py_buff, NULL));
-        goto error;
+        if (!is_arrow) return ACCEL_COL_OBJECT;
+        if (precision <= 38) return ACCEL_COL_DECIMAL128;
+        // polars only reads decimal128 values; wider values are kept as text.
+        return (py_state->options.decimal256) ? ACCEL_COL_DECIMAL256 : ACCEL_COL_STRING;
+    default:
+        if (!is_arrow) return ACCEL_COL_OBJECT;
+        return (py_state->encodings[i]) ? ACCEL_COL_STRING : ACCEL_COL_BINARY;
     }
+}
 
-exit:
-    Py_XDECREF(py_new_buff);
-    Py_XDECREF(py_bytes_to_read);
-    Py_XDECREF(py_recv_data);
-    Py_XDECREF(py_packet_header);
-    return py_buff;
-
-error:
-    Py_CLEAR(py_buff);
-    goto exit;
+static int is_utf8_encoding(const char *encoding) {
+    return strcmp(encoding, "utf8") == 0 || strcmp(encoding, "utf-8") == 0 ||
+           strcmp(encoding, "ascii") == 0;
 }
 
-static int is_eof_packet(char *data, unsigned long long data_l) {
-    return data && (uint8_t)*(uint8_t*)data == 0xFE && data_l < 9;
+static void column_init(StateObject *py_state, unsigned long i) {
+    ColumnBuffer *col = &py_state->columns[i];
+
+    col->kind = column_kind(py_state, i);
+
+    switch (col->kind) {
+    case ACCEL_COL_OBJECT:
+    case ACCEL_COL_STRING:
+    case ACCEL_COL_BINARY:
+        col->itemsize = 0;
+        break;
+    case ACCEL_COL_DATE32:
+        col->itemsize = 4;
+        break;
+    case ACCEL_COL_DECIMAL128:
+        col->itemsize = 16;
+        break;
+    case ACCEL_COL_DECIMAL256:
+        col->itemsize = 32;
+        break;
+    default:
+        col->itemsize = 8;
+    }
+
+    if (py_state->type_codes[i] == MYSQL_TYPE_DECIMAL ||
+        py_state->type_codes[i] == MYSQL_TYPE_NEWDECIMAL) {
+        col->precision = column_precision(py_state, i);
+        col->scale = (int)py_state->scales[i];
+    }
+
+    col->transcode = col->kind == ACCEL_COL_STRING &&
+                     !is_utf8_encoding(py_state->encodings[i]);
 }
 
-static int check_packet_is_eof(
-    char **data,
-    unsigned long long *data_l,
-    unsigned long long *warning_count,
-    int *has_next
-) {
-    uint16_t server_status = 0;
-    if (!data || !data_l) {
-        if (has_next) *has_next = 0;
-        if (warning_count) *warning_count = 0;
-        return 0;
+static const char *column_dtype(int kind) {
+    switch (kind) {
+    case ACCEL_COL_INT64: return "int64";
+    case ACCEL_COL_SCALED_INT64: return "int64";
+    case ACCEL_COL_UINT64: return "uint64";
+    case ACCEL_COL_FLOAT64: return "float64";
+    case ACCEL_COL_DATETIME64: return "datetime64[us]";
+    case ACCEL_COL_DATE64: return "datetime64[D]";
+    case ACCEL_COL_TIMEDELTA64: return "timedelta64[us]";
+    default: return "object";
     }
-    if (!is_eof_packet(*data, *data_l)) {
-        return 0;
+}
+
+static void column_arrow_format(ColumnBuffer *col, char *format, size_t format_l) {
+    const char *out = "U";
+
+    switch (col->kind) {
+    case ACCEL_COL_INT64: out = "l"; break;
+    case ACCEL_COL_SCALED_INT64: out = "l"; break;
+    case ACCEL_COL_UINT64: out = "L"; break;
+    case ACCEL_COL_FLOAT64: out = "g"; break;
+    case ACCEL_COL_DATETIME64: out = "tsu:"; break;
+    case ACCEL_COL_DATE32: out = "tdD"; break;
+    case ACCEL_COL_TIMEDELTA64: out = "tDu"; break;
+    case ACCEL_COL_BINARY: out = "Z"; break;
+    case ACCEL_COL_DECIMAL128:
+        snprintf(format, format_l, "d:%d,%d", col->precision, col->scale);
+        return;
+    case ACCEL_COL_DECIMAL256:
+        snprintf(format, format_l, "d:%d,%d,256", col->precision, col->scale);
+        return;
     }
-    *data += 1; *data_l -= 1;
-    if (warning_count) *warning_count = **(uint16_t**)data;
-    *data += 2; *data_l -= 2;
-    server_status = **(uint16_t**)data;
-    *data += 2; *data_l -= 2;
-    if (has_next) *has_next = server_status & MYSQL_SERVER_MORE_RESULTS_EXISTS;
-    return 1;
+
+    snprintf(format, format_l, "%s", out);
 }
 
-static unsigned long long read_length_encoded_integer(
-    char **data,
-    unsigned long long *data_l,
-    int *is_null
+//
+// Number of days between 1970-01-01 and the given date in the proleptic
+// Gregorian calendar.
+//
+static int64_t days_from_civil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yoe = year - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+//
+// Decode a text protocol value into a fixed-width column slot. Returns -1
+// if the value can not be represented (zero or invalid dates), in which
+// case it is stored as NULL.
+//
+static int read_column_value(
+    ColumnBuffer *col,
+    char *out,
+    unsigned long long out_l,
+    char *value
 ) {
-    if (is_null) *is_null = 0;
+    int kind = col->kind;
+    int64_t i64 = 0;
+    uint64_t u64 = 0;
+    int32_t i32 = 0;
+    double dbl = 0;
+    int sign = 1;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    int microsecond = 0;
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    int64_t days = 0;
 
-    if (!data || !data_l || *data_l == 0) {
-        if (is_null) *is_null = 1;
+    switch (kind) {
+    case ACCEL_COL_INT64:
+        i64 = parse_int64(out, out_l);
+        memcpy(value, &i64, 8);
         return 0;
-    }
-
-    uint8_t c = **(uint8_t**)data;
-    *data += 1; *data_l -= 1;
 
-    if (c == MYSQL_COLUMN_NULL) {
-        if (is_null) *is_null = 1;
+    case ACCEL_COL_UINT64:
+        u64 = parse_uint64(out, out_l);
+        memcpy(value, &u64, 8);
         return 0;
-    }
 
-    if (c < MYSQL_COLUMN_UNSIGNED_CHAR) {
-        return c;
-    }
+    case ACCEL_COL_FLOAT64:
+        dbl = parse_double(out, out_l);
+        memcpy(value, &dbl, 8);
+        return 0;
 
-    if (c == MYSQL_COLUMN_UNSIGNED_SHORT) {
-        if (*data_l < 2) {
-            if (is_null) *is_null = 1;
+    case ACCEL_COL_SCALED_INT64:
+    case ACCEL_COL_DECIMAL128:
+    case ACCEL_COL_DECIMAL256:
+        // Limbs are little-endian, as are Arrow's decimal buffers.
+        return parse_scaled_decimal(out, out_l, col->scale, (uint64_t*)value,
+                                    col->itemsize / 8);
+
+    case ACCEL_COL_DATETIME64:
+    case ACCEL_COL_DATE64:
+    case ACCEL_COL_DATE32:
+        if (kind != ACCEL_COL_DATETIME64) {
+            if (!CHECK_DATE_STR(out, out_l)) return -1;
+        } else if (!CHECK_ANY_DATETIME_STR(out, out_l)) {
+            return -1;
+        }
+        if (CHECK_ZERO_DATE_STR(out, out_l)) return -1;
+        year = CHR2INT4(out);
+        month = CHR2INT2(out + 5);
+        day = CHR2INT2(out + 8);
+        if (month < 1 || month > 12 || day < 1 || day > 31) return -1;
+        days = days_from_civil(year, month, day);
+        if (kind == ACCEL_COL_DATE32) {
+            i32 = (int32_t)days;
+            memcpy(value, &i32, 4);
             return 0;
         }
-        uint16_t out = **(uint16_t**)data;
-        *data += 2; *data_l -= 2;
-        return out;
-    }
-
-    if (c == MYSQL_COLUMN_UNSIGNED_INT24) {
-        if (*data_l < 3) {
-            if (is_null) *is_null = 1;
+        if (kind == ACCEL_COL_DATE64) {
+            memcpy(value, &days, 8);
             return 0;
         }
-        uint16_t low = **(uint8_t**)data;
-        *data += 1; *data_l -= 1;
-        uint16_t high = **(uint16_t**)data;
-        *data += 2; *data_l -= 2;
-        return low + (high << 16);
-    }
+        out += 11;
+        hour = CHR2INT2(out); out += 3;
+        minute = CHR2INT2(out); out += 3;
+        second = CHR2INT2(out); out += 3;
+        microsecond = (IS_DATETIME_MICRO(out, out_l)) ? CHR2INT6(out) :
+                      (IS_DATETIME_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
+        i64 = ((days * 86400 + hour * 3600 + minute * 60 + second) * 1000000LL) + microsecond;
+        memcpy(value, &i64, 8);
+        return 0;
 
-    if (c == MYSQL_COLUMN_UNSIGNED_INT64) {
-        if (*data_l < 8) {
-            if (is_null) *is_null = 1;
-            return 0;
+    case ACCEL_COL_TIMEDELTA64:
+        sign = CHECK_ANY_TIMEDELTA_STR(out, out_l);
+        if (!sign) return -1;
+        if (sign < 0) {
+            out += 1; out_l -= 1;
         }
-        uint64_t out = **(uint64_t**)data;
-        *data += 8; *data_l -= 8;
-        return out;
+        if (IS_TIMEDELTA1(out, out_l)) {
+            hour = CHR2INT1(out); out += 2;
+        }
+        else if (IS_TIMEDELTA2(out, out_l)) {
+            hour = CHR2INT2(out); out += 3;
+        }
+        else if (IS_TIMEDELTA3(out, out_l)) {
+            hour = CHR2INT3(out); out += 4;
+        }
+        minute = CHR2INT2(out); out += 3;
+        second = CHR2INT2(out); out += 3;
+        microsecond = (IS_TIMEDELTA_MICRO(out, out_l)) ? CHR2INT6(out) :
+                      (IS_TIMEDELTA_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
+        i64 = sign * (((int64_t)hour * 3600 + minute * 60 + second) * 1000000LL + microsecond);
+        memcpy(value, &i64, 8);
+        return 0;
     }
 
-    if (is_null) *is_null = 1;
-    return 0;
+    return -1;
 }
 
-static void read_length_coded_string(
-    char **data,
-    unsigned long long *data_l,
-    char **out,
-    unsigned long long *out_l,
-    int *is_null
+//
+// Store a fixed-width binary protocol value in a column slot. Returns -1
+// if the value can not be represented, in which case it is stored as NULL.
+//
+static int read_binary_column_value(
+    ColumnBuffer *col,
+    BinaryValue *v,
+    char *value
 ) {
-    if (is_null) *is_null = 0;
-
-    if (!data || !data_l || !out || !out_l) {
-        if (is_null) *is_null = 1;
-        return;
-    }
-
-    unsigned long long length = read_length_encoded_integer(data, data_l, is_null);
+    int64_t i64 = 0;
+    int32_t i32 = 0;
+    int64_t days = 0;
 
-    if (is_null && *is_null) {
-        return;
-    }
+    switch (col->kind) {
+    case ACCEL_COL_INT64:
+    case ACCEL_COL_UINT64:
+        if (v->kind != ACCEL_BIN_INT) return -1;
+        memcpy(value, &v->i64, 8);
+        return 0;
 
-    length = (length > *data_l) ? *data_l : length;
+    case ACCEL_COL_FLOAT64:
+        if (v->kind == ACCEL_BIN_INT) {
+            v->dbl = (v->is_unsigned) ? (double)(uint64_t)v->i64 : (double)v->i64;
+        } else if (v->kind != ACCEL_BIN_FLOAT) {
+            return -1;
+        }
+        memcpy(value, &v->dbl, 8);
+        return 0;
 
-    *out = *data;
-    *out_l = length;
+    case ACCEL_COL_DATETIME64:
+    case ACCEL_COL_DATE64:
+    case ACCEL_COL_DATE32:
+        if (v->kind != ACCEL_BIN_DATE && v->kind != ACCEL_BIN_DATETIME) return -1;
+        if (v->month < 1 || v->month > 12 || v->day < 1 || v->day > 31) return -1;
+        days = days_from_civil(v->year, v->month, v->day);
+        if (col->kind == ACCEL_COL_DATE32) {
+            i32 = (int32_t)days;
+            memcpy(value, &i32, 4);
+            return 0;
+        }
+        if (col->kind == ACCEL_COL_DATE64) {
+            memcpy(value, &days, 8);
+            return 0;
+        }
+        i64 = ((days * 86400 + v->hour * 3600 + v->minute * 60 + v->second) * 1000000LL) +
+              v->microsecond;
+        memcpy(value, &i64, 8);
+        return 0;
 
-    *data += length;
-    *data_l -= length;
+    case ACCEL_COL_TIMEDELTA64:
+        if (v->kind != ACCEL_BIN_TIME) return -1;
+        i64 = (((int64_t)v->days * 24 + v->hour) * 3600 + v->minute * 60 + v->second) *
+              1000000LL + v->microsecond;
+        if (v->negative) i64 = -i64;
+        memcpy(value, &i64, 8);
+        return 0;
+    }
 
-    return;
+    return -1;
 }
 
-#ifdef Py_LIMITED_API
+//
+// Make sure the column buffers can hold at least `n_rows` rows.
+//
+static int columns_reserve(StateObject *py_state, unsigned long long n_rows) {
+    unsigned long long capacity = py_state->columns_capacity;
 
-static PyObject *PyDate_FromDate(
-    StateObject *py_state,
-    int year,
-    int month,
-    int day
-) {
-    PyObject *out = NULL;
-    PyObject *py_year = NULL;
-    int free_year = 0;
+    if (n_rows <= capacity) return 0;
 
-    if (year >= 0 && year <= 60) {
-       py_year = PyInts[year];
-    } else {
-       free_year = 1;
-       py_year = PyLong_FromLong(year);
-    }
+    if (capacity < ACCEL_COL_MIN_CAPACITY) capacity = ACCEL_COL_MIN_CAPACITY;
+    while (capacity < n_rows) capacity *= 2;
 
-    out = PyObject_CallFunctionObjArgs(
-        PyFunc.datetime_date, py_year, PyInts[month], PyInts[day], NULL
-    );
+    for (unsigned long i = 0; i < py_state->n_cols; i++) {
+        ColumnBuffer *col = &py_state->columns[i];
 
-    if (free_year) Py_XDECREF(py_year);
+        if (col->kind == ACCEL_COL_OBJECT) {
+            if (!col->py_objs) {
+                col->py_objs = PyList_New(0);
+                if (!col->py_objs) return -1;
+            }
+            continue;
+        }
 
-    return out;
-}
+        if (!col->py_mask) {
+            col->py_mask = PyByteArray_FromStringAndSize(NULL, capacity);
+            if (!col->py_mask) return -1;
+        } else if (PyByteArray_Resize(col->py_mask, capacity) < 0) {
+            return -1;
+        }
+        col->mask = (uint8_t*)PyByteArray_AsString(col->py_mask);
+
+        if (col->itemsize) {
+            if (!col->py_data) {
+                col->py_data = PyByteArray_FromStringAndSize(NULL, capacity * col->itemsize);
+                if (!col->py_data) return -1;
+            } else if (PyByteArray_Resize(col->py_data, capacity * col->itemsize) < 0) {
+                return -1;
+            }
+            col->data = PyByteArray_AsString(col->py_data);
+            continue;
+        }
 
-static PyObject *PyDelta_FromDSU(
-    StateObject *py_state,
-    int days,
-    int seconds,
-    int microseconds
-) {
-    PyObject *out = NULL;
-    PyObject *py_days = NULL;
-    PyObject *py_seconds = NULL;
-    PyObject *py_microseconds = NULL;
-    int free_days = 0;
-    int free_seconds = 0;
-    int free_microseconds = 0;
-
-    if (days >= 0 && days <= 60) {
-        py_days = PyInts[days];
-    } else {
-        free_days = 1;
-        py_days = PyLong_FromLong(days);
+        // Variable-length values grow their data buffer as they are appended.
+        if (!col->py_offsets) {
+            col->py_offsets = PyByteArray_FromStringAndSize(NULL, (capacity + 1) * 8);
+            if (!col->py_offsets) return -1;
+            col->offsets = (int64_t*)PyByteArray_AsString(col->py_offsets);
+            col->offsets[0] = 0;
+            col->py_data = PyByteArray_FromStringAndSize(NULL, ACCEL_COL_MIN_DATA_SIZE);
+            if (!col->py_data) return -1;
+            col->data = PyByteArray_AsString(col->py_data);
+            col->data_size = ACCEL_COL_MIN_DATA_SIZE;
+            col->data_l = 0;
+        } else {
+            if (PyByteArray_Resize(col->py_offsets, (capacity + 1) * 8) < 0) return -1;
+            col->offsets = (int64_t*)PyByteArray_AsString(col->py_offsets);
+        }
     }
 
-    if (seconds >= 0 && seconds <= 60) {
-        py_seconds = PyInts[seconds];
-    } else {
-        free_seconds = 1;
-        py_seconds = PyLong_FromLong(seconds);
-    }
+    py_state->columns_capacity = capacity;
 
-    if (microseconds >= 0 && microseconds <= 60) {
-        py_microseconds = PyInts[microseconds];
-    } else {
-        free_microseconds = 1;
-        py_microseconds = PyLong_FromLong(microseconds);
-    }
+    return 0;
+}
 
-    out = PyObject_CallFunctionObjArgs(
-        PyFunc.datetime_timedelta, py_days, py_seconds, py_microseconds, NULL
-    );
+//
+// Append a variable-length value to the column data buffer.
+//
+static int column_append(
+    ColumnBuffer *col,
+    unsigned long long row,
+    const char *value,
+    unsigned long long value_l
+) {
+    if (col->data_l + value_l > col->data_size) {
+        unsigned long long size = col->data_size;
+        while (size < col->data_l + value_l) size *= 2;
+        if (PyByteArray_Resize(col->py_data, size) < 0) return -1;
+        col->data = PyByteArray_AsString(col->py_data);
+        col->data_size = size;
+    }
 
-    if (free_days) Py_XDECREF(py_days);
-    if (free_seconds) Py_XDECREF(py_seconds);
-    if (free_microseconds) Py_XDECREF(py_microseconds);
+    memcpy(col->data + col->data_l, value, value_l);
+    col->data_l += value_l;
+    col->offsets[row + 1] = (int64_t)col->data_l;
 
-    return out;
+    return 0;
 }
 
-static PyObject *PyDateTime_FromDateAndTime(
+//
+// Append a string value to the column data buffer as UTF-8.
+//
+static int column_append_string(
     StateObject *py_state,
-    int year,
-    int month,
-    int day,
-    int hour,
-    int minute,
-    int second,
-    int microsecond
+    unsigned long i,
+    unsigned long long row,
+    char *out,
+    unsigned long long out_l
 ) {
-    PyObject *out = NULL;
-    PyObject *py_year = NULL;
-    PyObject *py_microsecond = NULL;
-    int free_year = 0;
-    int free_microsecond = 0;
-
-    if (year >= 0 && year <= 60) {
-       py_year = PyInts[year];
-    } else {
-       free_year = 1;
-       py_year = PyLong_FromLong(year);
-    }
+    ColumnBuffer *col = &py_state->columns[i];
+    PyObject *py_str = NULL;
+    PyObject *py_bytes = NULL;
+    char *str = NULL;
+    Py_ssize_t str_l = 0;
+    int rc = 0;
 
-    if (microsecond >= 0 && microsecond <= 60) {
-       py_microsecond = PyInts[microsecond];
-    } else {
-       free_microsecond = 1;
-       py_microsecond = PyLong_FromLong(microsecond);
-    }
+    if (!col->transcode) return column_append(col, row, out, out_l);
 
-    out = PyObject_CallFunctionObjArgs(
-        PyFunc.datetime_datetime, py_year, PyInts[month], PyInts[day],
-        PyInts[hour], PyInts[minute], PyInts[second], py_microsecond, NULL
-    );
+    py_str = PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
+    if (!py_str) goto error;
+    py_bytes = PyUnicode_AsUTF8String(py_str);
+    if (!py_bytes) goto error;
+    CHECKRC(PyBytes_AsStringAndSize(py_bytes, &str, &str_l));
+    CHECKRC(column_append(col, row, str, str_l));
 
-    if (free_microsecond) Py_XDECREF(py_microsecond);
-    if (free_year) Py_XDECREF(py_year);
+exit:
+    Py_XDECREF(py_str);
+    Py_XDECREF(py_bytes);
+    return rc;
 
-    return out;
+error:
+    rc = -1;
+    goto exit;
 }
 
-#endif
-
-static PyObject *read_row_from_packet(
+//
+// Decode a row data packet into the column buffers. The row is stored at
+// index `n_rows_in_batch - 1`.
+//
+static int read_columns_from_packet(
     StateObject *py_state,
     char *data,
     unsigned long long data_l
 ) {
+    unsigned long long row = py_state->n_rows_in_batch - 1;
     char *out = NULL;
-    char *orig_out = NULL;
     unsigned long long out_l = 0;
-    unsigned long long orig_out_l = 0;
     int is_null = 0;
-    PyObject *py_result = NULL;
+    int rc = 0;
+    uint8_t *null_bitmap = NULL;
+    BinaryValue bin;
     PyObject *py_item = NULL;
-    PyObject *py_str = NULL;
-    char end = '\0';
 
-    int sign = 1;
-    int year = 0;
-    int month = 0;
-    int day = 0;
-    int hour = 0;
-    int minute = 0;
-    int second = 0;
-    int microsecond = 0;
+    if (columns_reserve(py_state, row + 1) < 0) return -1;
 
-    switch (py_state->options.results_type) {
-    case ACCEL_OUT_DICTS:
-        py_result = PyDict_New();
-        break;
-   case ACCEL_OUT_STRUCTSEQUENCES: {
-        if (!py_state->structsequence) goto error;
-        py_result = PyStructSequence_New(py_state->structsequence);
-        break;
-        }
-    case ACCEL_OUT_NAMEDTUPLES:
-        if (!py_state->py_namedtuple) goto error;
-        if (!py_state->py_namedtuple_args) goto error;
-        py_result = py_state->py_namedtuple_args;
-        break;
-    default:
-        py_result = PyTuple_New(py_state->n_cols);
+    if (py_state->binary) {
+        null_bitmap = read_binary_row_header(py_state, &data, &data_l);
+        if (!null_bitmap) return -1;
     }
 
     for (unsigned long i = 0; i < py_state->n_cols; i++) {
+        ColumnBuffer *col = &py_state->columns[i];
 
-        read_length_coded_string(&data, &data_l, &out, &out_l, &is_null);
-        end = out[out_l];
-
-        orig_out = out;
-        orig_out_l = out_l;
-
-        py_item = Py_None;
-
-        // Don't convert if it's a NULL.
-        if (!is_null) {
+        if (null_bitmap) {
+            read_binary_value(py_state, i, null_bitmap, &data, &data_l, &bin);
+            is_null = bin.kind == ACCEL_BIN_NULL;
+            out = bin.out;
+            out_l = bin.out_l;
+        } else {
+            read_length_coded_string(&data, &data_l, &out, &out_l, &is_null);
+        }
 
-            // If a converter was passed in, use it.
-            if (py_state->py_converters[i]) {
-                py_str = NULL;
-                if (py_state->encodings[i] == NULL) {
-                    py_str = PyBytes_FromStringAndSize(out, out_l);
-                    if (!py_str) goto error;
-                } else {
-                    py_str = PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
-                    if (!py_str) goto error;
-                }
-                py_item = PyObject_CallFunctionObjArgs(py_state->py_converters[i], py_str, NULL);
-                Py_CLEAR(py_str);
-                if (!py_item) goto error;
+        if (col->kind == ACCEL_COL_OBJECT) {
+            if (is_null) {
+                py_item = Py_None;
+                Py_INCREF(Py_None);
+            } else if (null_bitmap) {
+                py_item = read_binary_cell(py_state, i, &bin);
+                if (!py_item) return -1;
+            } else {
+                py_item = read_cell(py_state, i, out, out_l);
+                if (!py_item) return -1;
             }
+            rc = PyList_Append(col->py_objs, py_item);
+            Py_DECREF(py_item);
+            if (rc < 0) return -1;
+            continue;
+        }
 
-            // If no converter was passed in, do the default processing.
-            else {
-                switch (py_state->type_codes[i]) {
-                case MYSQL_TYPE_NEWDECIMAL:
-                case MYSQL_TYPE_DECIMAL:
-                    py_str = PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
-                    if (!py_str) goto error;
-
-                    py_item = PyObject_CallFunctionObjArgs(PyFunc.decimal_Decimal, py_str, NULL);
-                    Py_CLEAR(py_str);
-                    if (!py_item) goto error;
-                    break;
-
-                case MYSQL_TYPE_TINY:
-                case MYSQL_TYPE_SHORT:
-                case MYSQL_TYPE_LONG:
-                case MYSQL_TYPE_LONGLONG:
-                case MYSQL_TYPE_INT24:
-                    if (data_l) out[out_l] = '\0';
-                    if (py_state->flags[i] & MYSQL_FLAG_UNSIGNED) {
-                        py_item = PyLong_FromUnsignedLongLong(strtoull(out, NULL, 10));
-                    } else {
-                        py_item = PyLong_FromLongLong(strtoll(out, NULL, 10));
-                    }
-                    if (data_l) out[out_l] = end;
-                    if (!py_item) goto error;
-                    break;
+        col->mask[row] = 0;
 
-                case MYSQL_TYPE_FLOAT:
-                case MYSQL_TYPE_DOUBLE:
-                    if (data_l) out[out_l] = '\0';
-                    py_item = PyFloat_FromDouble(strtod(out, NULL));
-                    if (data_l) out[out_l] = end;
-                    if (!py_item) goto error;
-                    break;
+        if (!col->itemsize) {
+            if (is_null) {
+                col->offsets[row + 1] = (int64_t)col->data_l;
+                col->mask[row] = 1;
+                col->n_nulls++;
+            }
+            else if (column_append_string(py_state, i, row, out, out_l) < 0) {
+                return -1;
+            }
+            continue;
+        }
 
-                case MYSQL_TYPE_NULL:
-                    py_item = Py_None;
-                    break;
+        char *value = col->data + row * col->itemsize;
 
-                case MYSQL_TYPE_DATETIME:
-                case MYSQL_TYPE_TIMESTAMP:
-                    if (CHECK_ANY_ZERO_DATETIME_STR(out, out_l)) {
-                        py_item = Py_None;
-                        Py_INCREF(Py_None);
-                        break;
-                    }
-                    else if (!CHECK_ANY_DATETIME_STR(out, out_l)) {
-                        if (py_state->py_invalid_values[i]) {
-                            py_item = py_state->py_invalid_values[i];
-                            Py_INCREF(py_item);
-                        } else {
-                            py_item = PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
-                            if (!py_item) goto error;
-                        }
-                        break;
-                    }
-                    year = CHR2INT4(out); out += 5;
-                    month = CHR2INT2(out); out += 3;
-                    day = CHR2INT2(out); out += 3;
-                    hour = CHR2INT2(out); out += 3;
-                    minute = CHR2INT2(out); out += 3;
-                    second = CHR2INT2(out); out += 3;
-                    microsecond = (IS_DATETIME_MICRO(out, out_l)) ? CHR2INT6(out) :
-                                  (IS_DATETIME_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
-                    py_item = PyDateTime_FromDateAndTime(
-#ifdef Py_LIMITED_API
-                                    py_state,
-#endif
-                                    year, month, day, hour, minute, second, microsecond);
-                    if (!py_item) {
-                        PyErr_Clear();
-                        py_item = PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
-                    }
-                    if (!py_item) goto error;
-                    break;
+        if (is_null) {
+            rc = -1;
+        } else if (null_bitmap && bin.kind != ACCEL_BIN_STRING) {
+            rc = read_binary_column_value(col, &bin, value);
+        } else {
+            rc = read_column_value(col, out, out_l, value);
+        }
 
-                case MYSQL_TYPE_NEWDATE:
-                case MYSQL_TYPE_DATE:
-                    if (CHECK_ZERO_DATE_STR(out, out_l)) {
-                        py_item = Py_None;
-                        Py_INCREF(Py_None);
-                        break;
-                    }
-                    else if (!CHECK_DATE_STR(out, out_l)) {
-                        if (py_state->py_invalid_values[i]) {
-                            py_item = py_state->py_invalid_values[i];
-                            Py_INCREF(py_item);
-                        } else {
-                            py_item = PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
-                            if (!py_item) goto error;
-                        }
-                        break;
-                    }
-                    year = CHR2INT4(out); out += 5;
-                    month = CHR2INT2(out); out += 3;
-                    day = CHR2INT2(out); out += 3;
-                    py_item = PyDate_FromDate(
-#ifdef Py_LIMITED_API
-                                    py_state,
-#endif
-                                    year, month, day);
-                    if (!py_item) {
-                        PyErr_Clear();
-                        py_item = PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
-                    }
-                    if (!py_item) goto error;
-                    break;
-
-                case MYSQL_TYPE_TIME:
-                    sign = CHECK_ANY_TIMEDELTA_STR(out, out_l);
-                    if (!sign) {
-                        if (py_state->py_invalid_values[i]) {
-                            py_item = py_state->py_invalid_values[i];
-                            Py_INCREF(py_item);
-                        } else {
-                            py_item = PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
-                            if (!py_item) goto error;
-                        }
-                        break;
-                    } else if (sign < 0) {
-                        out += 1; out_l -= 1;
-                    }
-                    if (IS_TIMEDELTA1(out, out_l)) {
-                        hour = CHR2INT1(out); out += 2;
-                        minute = CHR2INT2(out); out += 3;
-                        second = CHR2INT2(out); out += 3;
-                        microsecond = (IS_TIMEDELTA_MICRO(out, out_l)) ? CHR2INT6(out) :
-                                      (IS_TIMEDELTA_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
-                    }
-                    else if (IS_TIMEDELTA2(out, out_l)) {
-                        hour = CHR2INT2(out); out += 3;
-                        minute = CHR2INT2(out); out += 3;
-                        second = CHR2INT2(out); out += 3;
-                        microsecond = (IS_TIMEDELTA_MICRO(out, out_l)) ? CHR2INT6(out) :
-                                      (IS_TIMEDELTA_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
-                    }
-                    else if (IS_TIMEDELTA3(out, out_l)) {
-                        hour = CHR2INT3(out); out += 4;
-                        minute = CHR2INT2(out); out += 3;
-                        second = CHR2INT2(out); out += 3;
-                        microsecond = (IS_TIMEDELTA_MICRO(out, out_l)) ? CHR2INT6(out) :
-                                      (IS_TIMEDELTA_MILLI(out, out_l)) ? CHR2INT3(out) * 1e3 : 0;
-                    }
-                    py_item = PyDelta_FromDSU(
-#ifdef Py_LIMITED_API
-                                    py_state,
-#endif
-                                    0, sign * hour * 60 * 60 +
-                                       sign * minute * 60 +
-                                       sign * second,
-                                       sign * microsecond);
-                    if (!py_item) {
-                        PyErr_Clear();
-                        py_item = PyUnicode_Decode(orig_out, orig_out_l, "ascii", py_state->encoding_errors);
-                    }
-                    if (!py_item) goto error;
-                    break;
+        if (rc < 0) {
+            int64_t null_value = (col->kind == ACCEL_COL_DATETIME64 ||
+                                  col->kind == ACCEL_COL_DATE64 ||
+                                  col->kind == ACCEL_COL_TIMEDELTA64) ? INT64_MIN : 0;
+            memset(value, 0, col->itemsize);
+            memcpy(value, &null_value, IMIN(col->itemsize, 8));
+            col->mask[row] = 1;
+            col->n_nulls++;
+        }
+    }
 
-                case MYSQL_TYPE_YEAR:
-                    if (out_l == 0) {
-                        goto error;
-                        break;
-                    }
-                    if (data_l) out[out_l] = '\0';
-                    year = strtoul(out, NULL, 10);
-                    py_item = PyLong_FromLong(year);
-                    if (data_l) out[out_l] = end;
-                    if (!py_item) goto error;
-                    break;
-
-                case MYSQL_TYPE_BIT:
-                case MYSQL_TYPE_JSON:
-                case MYSQL_TYPE_TINY_BLOB:
-                case MYSQL_TYPE_MEDIUM_BLOB:
-                case MYSQL_TYPE_LONG_BLOB:
-                case MYSQL_TYPE_BLOB:
-                case MYSQL_TYPE_GEOMETRY:
-                case MYSQL_TYPE_ENUM:
-                case MYSQL_TYPE_SET:
-                case MYSQL_TYPE_VARCHAR:
-                case MYSQL_TYPE_VAR_STRING:
-                case MYSQL_TYPE_STRING:
-                    if (!py_state->encodings[i]) {
-                        py_item = PyBytes_FromStringAndSize(out, out_l);
-                        if (!py_item) goto error;
-                        break;
-                    }
+    return 0;
+}
 
-                    py_item = PyUnicode_Decode(out, out_l, py_state->encodings[i], py_state->encoding_errors);
-                    if (!py_item) goto error;
+//
+// Convert the current batch of column buffers to a dict of numpy arrays
+// and start a new batch. Columns containing NULLs are returned as masked
+// arrays.
+//
+static PyObject *columns_to_numpy(StateObject *py_state) {
+    PyObject *py_out = NULL;
+    PyObject *py_arr = NULL;
+    PyObject *py_mask = NULL;
+    PyObject *py_args = NULL;
+    PyObject *py_kwargs = NULL;
+    unsigned long long n_rows = py_state->n_rows_in_batch;
 
-                    // Parse JSON string.
-                    if (py_state->type_codes[i] == MYSQL_TYPE_JSON && py_state->options.parse_json) {
-                        py_str = py_item;
-                        py_item = PyObject_CallFunctionObjArgs(PyFunc.json_loads, py_str, NULL);
-                        Py_CLEAR(py_str);
-                        if (!py_item) goto error;
-                    }
+    py_out = PyDict_New();
+    if (!py_out) goto error;
 
-                    break;
+    if (columns_reserve(py_state, 1) < 0) goto error;
 
-                default:
-                    PyErr_Format(PyExc_TypeError, "unknown type code: %ld",
-                                 py_state->type_codes[i], NULL);
+    for (unsigned long i = 0; i < py_state->n_cols; i++) {
+        ColumnBuffer *col = &py_state->columns[i];
+
+        if (col->kind == ACCEL_COL_OBJECT) {
+            // Items are set one at a time so that sequences are not unpacked.
+            py_arr = PyObject_CallFunction(PyFunc.numpy_empty, "ns",
+                                           (Py_ssize_t)n_rows, "object");
+            if (!py_arr) goto error;
+            for (unsigned long long j = 0; j < n_rows; j++) {
+                if (PySequence_SetItem(py_arr, j, PyList_GetItem(col->py_objs, j)) < 0) {
                     goto error;
                 }
             }
+            Py_CLEAR(col->py_objs);
         }
+        else {
+            if (PyByteArray_Resize(col->py_data, n_rows * 8) < 0) goto error;
+            py_arr = PyObject_CallFunction(PyFunc.numpy_frombuffer, "Os",
+                                           col->py_data, column_dtype(col->kind));
+            if (!py_arr) goto error;
+
+            if (col->n_nulls) {
+                if (PyByteArray_Resize(col->py_mask, n_rows) < 0) goto error;
+                py_mask = PyObject_CallFunction(PyFunc.numpy_frombuffer, "Os",
+                                                col->py_mask, "bool");
+                if (!py_mask) goto error;
+
+                py_args = PyTuple_Pack(1, py_arr);
+                if (!py_args) goto error;
+                py_kwargs = PyDict_New();
+                if (!py_kwargs) goto error;
+                CHECKRC(PyDict_SetItem(py_kwargs, PyStr.mask, py_mask));
+
+                Py_CLEAR(py_arr);
+                py_arr = PyObject_Call(PyFunc.numpy_masked_array, py_args, py_kwargs);
+                if (!py_arr) goto error;
+
+                Py_CLEAR(py_mask);
+                Py_CLEAR(py_args);
+                Py_CLEAR(py_kwargs);
+
+                // The mask array now owns the mask buffer.
+                Py_CLEAR(col->py_mask);
+                col->mask = NULL;
+            }
 
-        if (py_item == Py_None) {
-            Py_INCREF(Py_None);
+            // The array now owns the data buffer.
+            Py_CLEAR(col->py_data);
+            col->data = NULL;
+            col->n_nulls = 0;
         }
 
-        switch (py_state->options.results_type) {
-        case ACCEL_OUT_STRUCTSEQUENCES:
-            PyStructSequence_SetItem(py_result, i, py_item);
-            break;
-        case ACCEL_OUT_DICTS:
-            PyDict_SetItem(py_result, py_state->py_names[i], py_item);
-            Py_INCREF(py_state->py_names[i]);
-            Py_DECREF(py_item);
-            break;
-        default:
-            PyTuple_SetItem(py_result, i, py_item);
-        }
+        CHECKRC(PyDict_SetItem(py_out, py_state->py_names[i], py_arr));
+        Py_CLEAR(py_arr);
     }
 
-    if (py_state->options.results_type == ACCEL_OUT_NAMEDTUPLES) {
-        // We just use py_result above as storage for the parameters to
-        // the namedtuple constructor. It gets deleted at the end of the
-        // fetch operation.
-        py_result = PyObject_CallObject(py_state->py_namedtuple, py_result);
-        if (!py_result) goto error;
+    py_state->columns_capacity = 0;
+    py_state->n_rows_in_batch = 0;
+
+exit:
+    Py_XDECREF(py_arr);
+    Py_XDECREF(py_mask);
+    Py_XDECREF(py_args);
+    Py_XDECREF(py_kwargs);
+    return py_out;
+
+error:
+    Py_CLEAR(py_out);
+    goto exit;
+}
+
+//
+// Convert the current batch of column buffers to an ArrowBatch and start
+// a new batch.
+//
+static PyObject *columns_to_arrow(StateObject *py_state) {
+    ArrowBatchObject *py_out = NULL;
+    unsigned long long n_rows = py_state->n_rows_in_batch;
+
+    if (columns_reserve(py_state, 1) < 0) goto error;
+
+    py_out = (ArrowBatchObject*)PyObject_CallObject((PyObject*)ArrowBatchType, NULL);
+    if (!py_out) goto error;
+
+    py_out->columns = calloc(py_state->n_cols + 1, sizeof(ArrowColumn));
+    if (!py_out->columns) goto error;
+    py_out->n_cols = py_state->n_cols;
+    py_out->n_rows = n_rows;
+
+    for (unsigned long i = 0; i < py_state->n_cols; i++) {
+        ColumnBuffer *col = &py_state->columns[i];
+        ArrowColumn *arrow_col = &py_out->columns[i];
+
+        arrow_col->py_name = py_state->py_names[i];
+        Py_INCREF(arrow_col->py_name);
+        column_arrow_format(col, arrow_col->format, sizeof(arrow_col->format));
+        arrow_col->null_count = (int64_t)col->n_nulls;
+
+        if (col->n_nulls) {
+            arrow_col->py_validity = PyByteArray_FromStringAndSize(NULL, (n_rows + 7) / 8);
+            if (!arrow_col->py_validity) goto error;
+            uint8_t *bits = (uint8_t*)PyByteArray_AsString(arrow_col->py_validity);
+            memset(bits, 0, (n_rows + 7) / 8);
+            for (unsigned long long j = 0; j < n_rows; j++) {
+                bits[j >> 3] |= (uint8_t)(!col->mask[j]) << (j & 7);
+            }
+        }
+
+        // The batch takes over the buffers.
+        if (col->itemsize) {
+            if (PyByteArray_Resize(col->py_data, n_rows * col->itemsize) < 0) goto error;
+        } else {
+            if (PyByteArray_Resize(col->py_data, col->data_l) < 0) goto error;
+            if (PyByteArray_Resize(col->py_offsets, (n_rows + 1) * 8) < 0) goto error;
+            arrow_col->py_offsets = col->py_offsets;
+            col->py_offsets = NULL;
+            col->offsets = NULL;
+        }
+        arrow_col->py_data = col->py_data;
+        col->py_data = NULL;
+        col->data = NULL;
+        col->data_l = 0;
+        col->data_size = 0;
+        col->n_nulls = 0;
     }
 
+    py_state->columns_capacity = 0;
+    py_state->n_rows_in_batch = 0;
+
 exit:
-    return py_result;
+    return (PyObject*)py_out;
 
 error:
-    Py_CLEAR(py_result);
+    Py_CLEAR(py_out);
     goto exit;
 }
 
+//
+// Convert the current batch of column buffers to the output type of the
+// results type and start a new batch.
+//
+static PyObject *columns_to_results(StateObject *py_state) {
+    if (py_state->options.results_type == ACCEL_OUT_ARROW) {
+        return columns_to_arrow(py_state);
+    }
+    return columns_to_numpy(py_state);
+}
+
+//
+// End Columns
+//
+
 static PyObject *read_rowdata_packet(PyObject *self, PyObject *args, PyObject *kwargs) {
     int rc = 0;
     StateObject *py_state = NULL;
@@ -1676,18 +9164,15 @@ static PyObject *read_rowdata_packet(PyObject *self, PyObject *args, PyObject *k
     }
 
     while (row_idx < requested_n_rows) {
-        PyObject *py_buff = read_packet(py_state);
-        if (!py_buff) goto error;
-
         PyObject *py_row = NULL;
-        char *data = PyByteArray_AsString(py_buff);
-        unsigned long long data_l = PyByteArray_Size(py_buff);
+        char *data = NULL;
+        unsigned long long data_l = 0;
         unsigned long long warning_count = 0;
         int has_next = 0;
 
-        if (check_packet_is_eof(&data, &data_l, &warning_count, &has_next)) {
-            Py_CLEAR(py_buff);
+        if (read_packet(py_state, &data, &data_l) < 0) goto error;
 
+        if (check_packet_is_eof(&data, &data_l, &warning_count, &has_next)) {
             py_state->is_eof = 1;
 
             PyObject *py_long = NULL;
@@ -1709,8 +9194,23 @@ static PyObject *read_rowdata_packet(PyObject *self, PyObject *args, PyObject *k
         py_state->n_rows++;
         py_state->n_rows_in_batch++;
 
+        if (py_state->columns) {
+            if (read_columns_from_packet(py_state, data, data_l) < 0) goto error;
+            row_idx++;
+            continue;
+        }
+
+        if (py_state->row_arena) {
+            if (row_arena_append(py_state->row_arena, data, data_l) < 0) {
+                PyErr_NoMemory();
+                goto error;
+            }
+            row_idx++;
+            continue;
+        }
+
         py_row = read_row_from_packet(py_state, data, data_l);
-        if (!py_row) { Py_CLEAR(py_buff); goto error; }
+        if (!py_row) goto error;
 
         //if (requested_n_rows == 1) {
         //    rc = PyList_SetItem(py_state->py_rows, 0, py_row);
@@ -1718,17 +9218,15 @@ static PyObject *read_rowdata_packet(PyObject *self, PyObject *args, PyObject *k
             rc = PyList_Append(py_state->py_rows, py_row);
             Py_DECREF(py_row);
         //}
-        if (rc != 0) { Py_CLEAR(py_buff); goto error; }
+        if (rc != 0) goto error;
 
         row_idx++;
-
-        Py_CLEAR(py_buff);
     }
 
 exit:
     if (!py_state) return NULL;
 
-    py_next_seq_id = PyLong_FromUnsignedLongLong(py_state->next_seq_id);
+    py_next_seq_id = PyLong_FromUnsignedLongLong(py_state->framer.next_seq_id);
     if (!py_next_seq_id) goto error;
     PyObject_SetAttr(py_state->py_conn, PyStr._next_seq_id, py_next_seq_id);
     Py_DECREF(py_next_seq_id);
@@ -1746,6 +9244,9 @@ exit:
             PyObject_DelAttr(py_res, PyStr._state);
             Py_CLEAR(py_state);
         }
+        else if (py_state->columns) {
+            py_out = (py_err_type) ? NULL : columns_to_results(py_state);
+        }
         else {
             py_out = (requested_n_rows == 1) ?
                      PyList_GetItem(py_state->py_rows, 0) : py_state->py_rows;
@@ -1753,8 +9254,22 @@ exit:
         }
     }
     else {
-        py_out = py_state->py_rows;
-        Py_INCREF(py_out);
+        if (py_state->columns) {
+            if (py_state->is_eof && !py_err_type) {
+                py_out = columns_to_results(py_state);
+                if (py_out) PyObject_SetAttr(py_res, PyStr.rows, py_out);
+            }
+        }
+        else if (py_state->row_arena) {
+            if (py_state->is_eof && !py_err_type) {
+                py_out = RowBuffer_from_state(py_state);
+                if (py_out) PyObject_SetAttr(py_res, PyStr.rows, py_out);
+            }
+        }
+        else {
+            py_out = py_state->py_rows;
+            Py_INCREF(py_out);
+        }
         PyObject *py_n_rows = PyLong_FromSsize_t(py_state->n_rows);
         PyObject_SetAttr(py_res, PyStr.affected_rows, (py_n_rows) ? py_n_rows : Py_None);
         Py_XDECREF(py_n_rows);
@@ -1764,6 +9279,7 @@ exit:
         }
     }
 
+    Py_XDECREF(py_state);
     Py_XDECREF(py_zero);
 
     if (PyErr_Occurred()) {
@@ -1848,6 +9364,8 @@ error:
 
 
 int ensure_numpy() {
+    PyObject *numpy_ma = NULL;
+
     if (PyFunc.numpy_array && PyFunc.numpy_vectorize) goto exit;
 
     // Import numpy if it exists
@@ -1860,6 +9378,19 @@ int ensure_numpy() {
     PyFunc.numpy_vectorize = PyObject_GetAttr(numpy_mod, PyStr.vectorize);
     if (!PyFunc.numpy_vectorize) goto error;
 
+    PyFunc.numpy_frombuffer = PyObject_GetAttr(numpy_mod, PyStr.frombuffer);
+    if (!PyFunc.numpy_frombuffer) goto error;
+
+    PyFunc.numpy_empty = PyObject_GetAttr(numpy_mod, PyStr.empty);
+    if (!PyFunc.numpy_empty) goto error;
+
+    numpy_ma = PyObject_GetAttr(numpy_mod, PyStr.ma);
+    if (!numpy_ma) goto error;
+
+    PyFunc.numpy_masked_array = PyObject_GetAttr(numpy_ma, PyStr.MaskedArray);
+    Py_DECREF(numpy_ma);
+    if (!PyFunc.numpy_masked_array) goto error;
+
 exit:
     return 0;
 
@@ -4307,6 +11838,7 @@ error:
 
 static PyMethodDef PyMySQLAccelMethods[] = {
     {"read_rowdata_packet", (PyCFunction)read_rowdata_packet, METH_VARARGS | METH_KEYWORDS, "PyMySQL row data packet reader"},
+    {"_make_row", (PyCFunction)make_row, METH_VARARGS, "Build a Row from column names and values"},
     {"dump_rowdat_1", (PyCFunction)dump_rowdat_1, METH_VARARGS | METH_KEYWORDS, "ROWDAT_1 formatter for external functions"},
     {"load_rowdat_1", (PyCFunction)load_rowdat_1, METH_VARARGS | METH_KEYWORDS, "ROWDAT_1 parser for external functions"},
     {"dump_rowdat_1_numpy", (PyCFunction)dump_rowdat_1_numpy, METH_VARARGS | METH_KEYWORDS, "ROWDAT_1 formatter for external functions which takes numpy.arrays"},
@@ -4327,15 +11859,53 @@ PyMODINIT_FUNC PyInit__singlestoredb_accel(void) {
     PyDateTime_IMPORT;
 #endif
 
+    PyObject *mod = NULL;
+
+    SchemaType = (PyTypeObject*)PyType_FromSpec(&SchemaType_spec);
+    if (SchemaType == NULL || PyType_Ready(SchemaType) < 0) {
+        return NULL;
+    }
+
+    schema_cache = PyDict_New();
+    if (!schema_cache) return NULL;
+
     StateType = (PyTypeObject*)PyType_FromSpec(&StateType_spec);
     if (StateType == NULL || PyType_Ready(StateType) < 0) {
         return NULL;
     }
 
-    // Populate ints
-    for (int i = 0; i < 62; i++) {
-        PyInts[i] = PyLong_FromLong(i);
+    SocketReaderType = (PyTypeObject*)PyType_FromSpec(&SocketReaderType_spec);
+    if (SocketReaderType == NULL || PyType_Ready(SocketReaderType) < 0) {
+        return NULL;
+    }
+
+    ArrowBatchType = (PyTypeObject*)PyType_FromSpec(&ArrowBatchType_spec);
+    if (ArrowBatchType == NULL || PyType_Ready(ArrowBatchType) < 0) {
+        return NULL;
+    }
+
+    RowType = (PyTypeObject*)PyType_FromSpec(&RowType_spec);
+    if (RowType == NULL || PyType_Ready(RowType) < 0) {
+        return NULL;
+    }
+
+    RowBufferType = (PyTypeObject*)PyType_FromSpec(&RowBufferType_spec);
+    if (RowBufferType == NULL || PyType_Ready(RowBufferType) < 0) {
+        return NULL;
+    }
+
+    PyObject *py_row_attrs = PyObject_Dir((PyObject*)RowType);
+    if (!py_row_attrs) return NULL;
+    row_type_attrs = PyFrozenSet_New(py_row_attrs);
+    Py_DECREF(py_row_attrs);
+    if (!row_type_attrs) return NULL;
+
+#ifdef ACCEL_HAVE_READ_ENGINE
+    ReadEngineType = (PyTypeObject*)PyType_FromSpec(&ReadEngineType_spec);
+    if (ReadEngineType == NULL || PyType_Ready(ReadEngineType) < 0) {
+        return NULL;
     }
+#endif
 
     PyStr.unbuffered_active = PyUnicode_FromString("unbuffered_active");
     PyStr._state = PyUnicode_FromString("_state");
@@ -4351,27 +11921,28 @@ PyMODINIT_FUNC PyInit__singlestoredb_accel(void) {
     PyStr.datetime = PyUnicode_FromString("datetime");
     PyStr.loads = PyUnicode_FromString("loads");
     PyStr.field_count = PyUnicode_FromString("field_count");
-    PyStr.converters = PyUnicode_FromString("converters");
-    PyStr.fields = PyUnicode_FromString("fields");
-    PyStr.flags = PyUnicode_FromString("flags");
-    PyStr.scale = PyUnicode_FromString("scale");
-    PyStr.type_code = PyUnicode_FromString("type_code");
-    PyStr.name = PyUnicode_FromString("name");
-    PyStr.table_name = PyUnicode_FromString("table_name");
     PyStr._sock = PyUnicode_FromString("_sock");
     PyStr.settimeout = PyUnicode_FromString("settimeout");
     PyStr._read_timeout = PyUnicode_FromString("_read_timeout");
     PyStr._rfile = PyUnicode_FromString("_rfile");
     PyStr.read = PyUnicode_FromString("read");
+    PyStr.fileno = PyUnicode_FromString("fileno");
     PyStr.x_errno = PyUnicode_FromString("errno");
     PyStr._result = PyUnicode_FromString("_result");
     PyStr._next_seq_id = PyUnicode_FromString("_next_seq_id");
+    PyStr._compression = PyUnicode_FromString("_compression");
+    PyStr._column_definitions = PyUnicode_FromString("_column_definitions");
     PyStr.rows = PyUnicode_FromString("rows");
     PyStr.namedtuple = PyUnicode_FromString("namedtuple");
     PyStr.Row = PyUnicode_FromString("Row");
     PyStr.Series = PyUnicode_FromString("Series");
     PyStr.array = PyUnicode_FromString("array");
     PyStr.vectorize = PyUnicode_FromString("vectorize");
+    PyStr.frombuffer = PyUnicode_FromString("frombuffer");
+    PyStr.empty = PyUnicode_FromString("empty");
+    PyStr.ma = PyUnicode_FromString("ma");
+    PyStr.MaskedArray = PyUnicode_FromString("MaskedArray");
+    PyStr.mask = PyUnicode_FromString("mask");
 
     PyObject *decimal_mod = PyImport_ImportModule("decimal");
     if (!decimal_mod) goto error;
@@ -4412,7 +11983,94 @@ PyMODINIT_FUNC PyInit__singlestoredb_accel(void) {
         goto error;
     }
 
-    return PyModule_Create(&_singlestoredb_accelmodule);
+    mod = PyModule_Create(&_singlestoredb_accelmodule);
+    if (!mod) goto error;
+
+    Py_INCREF(StateType);
+    if (PyModule_AddObject(mod, "State", (PyObject*)StateType) < 0) {
+        Py_DECREF(StateType);
+        Py_DECREF(mod);
+        goto error;
+    }
+
+    Py_INCREF(SocketReaderType);
+    if (PyModule_AddObject(mod, "SocketReader", (PyObject*)SocketReaderType) < 0) {
+        Py_DECREF(SocketReaderType);
+        Py_DECREF(mod);
+        goto error;
+    }
+
+    Py_INCREF(ArrowBatchType);
+    if (PyModule_AddObject(mod, "ArrowBatch", (PyObject*)ArrowBatchType) < 0) {
+        Py_DECREF(ArrowBatchType);
+        Py_DECREF(mod);
+        goto error;
+    }
+
+    Py_INCREF(RowType);
+    if (PyModule_AddObject(mod, "Row", (PyObject*)RowType) < 0) {
+        Py_DECREF(RowType);
+        Py_DECREF(mod);
+        goto error;
+    }
+
+    row_factory = PyObject_GetAttrString(mod, "_make_row");
+    if (!row_factory) {
+        Py_DECREF(mod);
+        goto error;
+    }
+
+    Py_INCREF(RowBufferType);
+    if (PyModule_AddObject(mod, "RowBuffer", (PyObject*)RowBufferType) < 0) {
+        Py_DECREF(RowBufferType);
+        Py_DECREF(mod);
+        goto error;
+    }
+
+#ifdef ACCEL_HAVE_READ_ENGINE
+    Py_INCREF(ReadEngineType);
+    if (PyModule_AddObject(mod, "ReadEngine", (PyObject*)ReadEngineType) < 0) {
+        Py_DECREF(ReadEngineType);
+        Py_DECREF(mod);
+        goto error;
+    }
+#endif
+
+    // Algorithms that SocketReader.set_compression accepts
+    PyObject *py_algorithms = Py_BuildValue("("
+#ifdef ACCEL_HAVE_ZLIB
+        "s"
+#endif
+#ifdef ACCEL_HAVE_ZSTD
+        "s"
+#endif
+        ")"
+#ifdef ACCEL_HAVE_ZLIB
+        , "zlib"
+#endif
+#ifdef ACCEL_HAVE_ZSTD
+        , "zstd"
+#endif
+    );
+    if (!py_algorithms || PyModule_AddObject(mod, "compression_algorithms", py_algorithms) < 0) {
+        Py_XDECREF(py_algorithms);
+        Py_DECREF(mod);
+        goto error;
+    }
+
+#ifdef ACCEL_HAVE_OPENSSL
+    PyObject *py_native_tls = Py_True;
+#else
+    PyObject *py_native_tls = Py_False;
+#endif
+    Py_INCREF(py_native_tls);
+    if (PyModule_AddObject(mod, "native_tls", py_native_tls) < 0) {
+        Py_DECREF(py_native_tls);
+        Py_DECREF(mod);
+        goto error;
+    }
+
+    return mod;
 
 error:
     return NULL;
@@ -9,11 +9,32 @@ from setuptools import setup
 from wheel.bdist_wheel import bdist_wheel
 
 
-py_limited_api = '0x03080000'
-# py_limited_api = False
-
 build_extension = bool(int(os.environ.get('SINGLESTOREDB_BUILD_EXTENSION', '1')))
 
+# Building against the full C API (SINGLESTOREDB_BUILD_LIMITED_API=0) creates
+# date/time values with the datetime C API, but the resulting extension only
+# works with the Python version it was built for.
+py_limited_api = '0x03080000' \
+    if bool(int(os.environ.get('SINGLESTOREDB_BUILD_LIMITED_API', '1'))) else False
+
+# The native socket reader inflates frames of the compressed protocol with
+# zlib (SINGLESTOREDB_BUILD_ZLIB, on by default except on Windows) and zstd
+# (SINGLESTOREDB_BUILD_ZSTD, off by default). Without them, compressed
+# connections are read by the Python fallback.
+native_libraries = []
+if bool(int(os.environ.get(
+    'SINGLESTOREDB_BUILD_ZLIB', '0' if platform.system() == 'Windows' else '1',
+))):
+    native_libraries.append((['z'], 'ACCEL_HAVE_ZLIB'))
+if bool(int(os.environ.get('SINGLESTOREDB_BUILD_ZSTD', '0'))):
+    native_libraries.append((['zstd'], 'ACCEL_HAVE_ZSTD'))
+
+# With OpenSSL (SINGLESTOREDB_BUILD_OPENSSL, off by default), the socket
+# reader also runs TLS itself and decrypts straight into its buffer instead
+# of reading through the Python ssl module.
+if bool(int(os.environ.get('SINGLESTOREDB_BUILD_OPENSSL', '0'))):
+    native_libraries.append((['ssl', 'crypto'], 'ACCEL_HAVE_OPENSSL'))
+
 universal2_flags = ['-arch', 'x86_64', '-arch', 'arm64'] \
     if (
         platform.platform().startswith('mac') and
@@ -42,9 +63,12 @@ if build_extension:
             Extension(
                 '_singlestoredb_accel',
                 sources=['accel.c'],
-                define_macros=[
+                define_macros=([
                     ('Py_LIMITED_API', py_limited_api),
-                ] if py_limited_api else [],
+                ] if py_limited_api else []) + [
+                    (macro, '1') for _, macro in native_libraries
+                ],
+                libraries=[name for names, _ in native_libraries for name in names],
                 py_limited_api=bool(py_limited_api),
                 extra_compile_args=universal2_flags,
                 extra_link_args=universal2_flags,
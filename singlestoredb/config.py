@@ -90,6 +90,58 @@ register_option(
     environ='SINGLESTOREDB_ENCODING_ERRORS',
 )
 
+register_option(
+    'decimal_type', 'string',
+    functools.partial(
+        check_str,
+        valid_values=['decimal', 'float', 'scaled_int'],
+    ),
+    'decimal',
+    'What type should DECIMAL values be returned as? Scaled integers are '
+    'the decimal values multiplied by 10 to the power of the column scale.',
+    environ='SINGLESTOREDB_DECIMAL_TYPE',
+)
+
+register_option(
+    'intern_strings', 'bool', check_bool, False,
+    'Should string values be shared between all cells of a column that have '
+    'the same value? This is always done for ENUM and SET columns.',
+    environ='SINGLESTOREDB_INTERN_STRINGS',
+)
+
+register_option(
+    'read_ahead', 'bool', check_bool, False,
+    'Should unbuffered results be received on a background thread while '
+    'rows are being fetched?',
+    environ='SINGLESTOREDB_READ_AHEAD',
+)
+
+register_option(
+    'decode_on_fetch', 'bool', check_bool, False,
+    'Should the rows of buffered results be kept undecoded until '
+    'they are fetched?',
+    environ='SINGLESTOREDB_DECODE_ON_FETCH',
+)
+
+register_option(
+    'server_side_prepare', 'bool', check_bool, False,
+    'Should queries with parameters be executed as server-side '
+    'prepared statements?',
+    environ='SINGLESTOREDB_SERVER_SIDE_PREPARE',
+)
+
+register_option(
+    'compress', 'string',
+    functools.partial(
+        check_str,
+        valid_values=['auto', 'zlib', 'zstd'],
+    ),
+    None,
+    'Compression algorithm of the MySQL protocol: zlib, zstd, or auto '
+    'for the best one that the client and server both support.',
+    environ='SINGLESTOREDB_COMPRESS',
+)
+
 register_option(
     'local_infile', 'bool', check_bool, False,
     'Should it be possible to load local files?',
@@ -230,6 +282,8 @@ register_option(
         valid_values=[
             'tuple', 'tuples', 'namedtuple', 'namedtuples',
             'dict', 'dicts', 'structsequence', 'structsequences',
+            'row', 'rows', 'lazyrow', 'lazyrows',
+            'numpy', 'pandas', 'arrow', 'polars',
         ],
     ),
     'tuples',
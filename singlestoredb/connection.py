@@ -1284,6 +1284,12 @@ def connect(
     nan_as_null: Optional[bool] = None,
     inf_as_null: Optional[bool] = None,
     encoding_errors: Optional[str] = None,
+    decimal_type: Optional[str] = None,
+    intern_strings: Optional[bool] = None,
+    read_ahead: Optional[bool] = None,
+    decode_on_fetch: Optional[bool] = None,
+    server_side_prepare: Optional[bool] = None,
+    compress: Optional[str] = None,
     track_env: Optional[bool] = None,
 ) -> Connection:
     """
@@ -1338,7 +1344,12 @@ def connect(
     autocommit : bool, optional
         Enable autocommits
     results_type : str, optional
-        The form of the query results: tuples, namedtuples, dicts
+        The form of the query results: tuples, namedtuples, dicts, numpy,
+        pandas, arrow, polars, rows, or lazyrows. rows are rows of the C
+        extension that allow access by index, column name, and attribute,
+        and compare like tuples; lazyrows are rows that decode each value
+        when it is first accessed. The pure Python driver returns tuples
+        for both
     results_format : str, optional
         Deprecated. This option has been renamed to results_type.
     program_name : str, optional
@@ -1359,6 +1370,23 @@ def connect(
         substitutions including uploaded data?
     encoding_errors : str, optional
         The error handler name for value decoding errors
+    decimal_type : str, optional
+        The type to return DECIMAL values as: decimal, float, scaled_int.
+        Scaled integers are the values multiplied by 10**scale of the column.
+    intern_strings : bool, optional
+        Share one str object between the cells of a string column that have
+        the same value? This is always done for ENUM and SET columns.
+    read_ahead : bool, optional
+        Receive the rows of unbuffered results on a background thread while
+        rows are being fetched?
+    decode_on_fetch : bool, optional
+        Keep the rows of buffered results undecoded until they are fetched?
+    server_side_prepare : bool, optional
+        Execute queries that have parameters as server-side prepared
+        statements, which use the binary protocol?
+    compress : str, optional
+        Compress the MySQL protocol with 'zlib', 'zstd', or 'auto' for
+        the best algorithm that both the client and the server support.
     track_env : bool, optional
         Should the connection track the SINGLESTOREDB_URL environment variable?
 
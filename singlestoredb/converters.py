@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 """Data value conversion utilities."""
 import datetime
+import functools
 import re
 from base64 import b64decode
 from decimal import Decimal
@@ -350,6 +351,59 @@ def decimal_or_none(x: Any) -> Optional[Decimal]:
     return Decimal(x)
 
 
+def scaled_int_or_none(x: Any, scale: int = 0) -> Optional[int]:
+    """
+    Convert decimal value to an integer scaled by ``10 ** scale``.
+
+    Parameters
+    ----------
+    x : Any
+        Arbitrary value
+    scale : int, optional
+        Number of digits after the decimal point
+
+    Returns
+    -------
+    int
+        If value can be cast to a scaled integer
+    None
+        If input value is None
+
+    """
+    if x is None:
+        return None
+    if isinstance(x, (bytes, bytearray)):
+        x = x.decode('ascii')
+    whole, _, fraction = str(x).partition('.')
+    return int(whole + fraction[:scale].ljust(scale, '0'))
+
+
+def get_decimal_converter(
+    decimal_type: str,
+    scale: int = 0,
+) -> Callable[[Any], Any]:
+    """
+    Return the converter for DECIMAL values.
+
+    Parameters
+    ----------
+    decimal_type : str
+        The type to return DECIMAL values as: 'decimal', 'float', or 'scaled_int'
+    scale : int, optional
+        Number of digits after the decimal point
+
+    Returns
+    -------
+    Callable
+
+    """
+    if decimal_type == 'float':
+        return float_or_none
+    if decimal_type == 'scaled_int':
+        return functools.partial(scaled_int_or_none, scale=scale)
+    return decimal_or_none
+
+
 def date_or_none(x: Optional[str]) -> Optional[Union[datetime.date, str]]:
     """
     Convert value to a date.
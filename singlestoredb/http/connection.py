@@ -47,6 +47,8 @@ from .. import fusion
 from .. import types
 from ..config import get_option
 from ..converters import converters
+from ..converters import decimal_or_none
+from ..converters import get_decimal_converter
 from ..exceptions import DatabaseError  # noqa: F401
 from ..exceptions import DataError
 from ..exceptions import Error  # noqa: F401
@@ -598,6 +600,13 @@ class Cursor(connection.Cursor):
                             charset = 63  # BINARY
                         if type_code == 0:  # DECIMAL
                             type_code = types.ColumnType.get_code('NEWDECIMAL')
+                        if type_code == 246 and converter is decimal_or_none:
+                            converter = get_decimal_converter(
+                                self._connection.connection_params.get(
+                                    'decimal_type', 'decimal',
+                                ),
+                                scale or 0,
+                            )
                         elif type_code == 15:  # VARCHAR / VARBINARY
                             type_code = types.ColumnType.get_code('VARSTRING')
                         if type_code == 246 and prec is not None:  # NEWDECIMAL
@@ -1187,6 +1196,12 @@ def connect(
     nan_as_null: Optional[bool] = None,
     inf_as_null: Optional[bool] = None,
     encoding_errors: Optional[str] = None,
+    decimal_type: Optional[str] = None,
+    intern_strings: Optional[bool] = None,
+    read_ahead: Optional[bool] = None,
+    decode_on_fetch: Optional[bool] = None,
+    server_side_prepare: Optional[bool] = None,
+    compress: Optional[str] = None,
     track_env: Optional[bool] = None,
 ) -> Connection:
     return Connection(**dict(locals()))
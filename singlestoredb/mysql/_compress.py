@@ -0,0 +1,180 @@
+# type: ignore
+"""
+Compressed protocol
+
+With CLIENT_COMPRESS (zlib) or CLIENT_ZSTD_COMPRESSION_ALGORITHM (zstd),
+the packet stream is carried in compressed frames once authentication has
+completed. Each frame has a 7 byte header: the 3 byte length of the frame
+payload, a 1 byte sequence number, and the 3 byte length of the payload
+after decompression, which is zero if the payload was sent uncompressed.
+
+https://dev.mysql.com/doc/dev/mysql-server/latest/page_protocol_basic_compression.html
+"""
+import struct
+import zlib
+
+try:
+    import _singlestoredb_accel
+except (ImportError, ModuleNotFoundError):
+    _singlestoredb_accel = None
+
+try:
+    from compression import zstd as _zstd  # Python 3.14+
+
+    def _zstd_compress(data, level):
+        return _zstd.compress(data, level)
+
+    def _zstd_decompress(data, size):
+        return _zstd.decompress(data)
+
+except ImportError:
+    try:
+        import zstandard as _zstd
+
+        def _zstd_compress(data, level):
+            return _zstd.ZstdCompressor(level=level).compress(data)
+
+        def _zstd_decompress(data, size):
+            return _zstd.ZstdDecompressor().decompress(data, max_output_size=size)
+
+    except ImportError:
+        _zstd = None
+
+
+ZLIB = 'zlib'
+ZSTD = 'zstd'
+
+#: Default zstd compression level sent in the handshake response
+ZSTD_LEVEL = 3
+
+# Payloads shorter than this are sent uncompressed
+MIN_COMPRESS_LENGTH = 50
+
+FRAME_HEADER_LEN = 7
+MAX_FRAME_LEN = 2 ** 24 - 1
+
+
+def native_algorithms():
+    """Return the algorithms supported by the C extension's socket reader."""
+    return tuple(getattr(_singlestoredb_accel, 'compression_algorithms', ()))
+
+
+def python_algorithms():
+    """Return the algorithms supported by the Python frame reader."""
+    return (ZLIB, ZSTD) if _zstd is not None else (ZLIB,)
+
+
+def compress_frames(data, seq_id, algorithm, level=ZSTD_LEVEL):
+    """
+    Wrap packet data in compressed frames.
+
+    Parameters
+    ----------
+    data : bytes
+        One or more complete MySQL packets
+    seq_id : int
+        Sequence number of the first frame
+    algorithm : str
+        Compression algorithm: 'zlib' or 'zstd'
+    level : int, optional
+        Compression level of zstd frames
+
+    Returns
+    -------
+    (bytes, int)
+        The frames and the sequence number following the last frame
+
+    """
+    out = []
+    view = memoryview(data)
+    while True:
+        chunk = view[:MAX_FRAME_LEN]
+        view = view[MAX_FRAME_LEN:]
+        payload = b''
+        if len(chunk) >= MIN_COMPRESS_LENGTH:
+            if algorithm == ZLIB:
+                payload = zlib.compress(chunk)
+            elif _zstd is not None:
+                payload = _zstd_compress(bytes(chunk), level)
+        # Frames that do not get smaller are sent as is.
+        if payload and len(payload) < len(chunk):
+            header = struct.pack('<I', len(payload))[:3] + bytes([seq_id]) + \
+                struct.pack('<I', len(chunk))[:3]
+        else:
+            payload = chunk
+            header = struct.pack('<I', len(payload))[:3] + bytes([seq_id]) + \
+                b'\x00\x00\x00'
+        out.append(header)
+        out.append(payload)
+        seq_id = (seq_id + 1) % 256
+        if not view:
+            break
+    return b''.join(out), seq_id
+
+
+class CompressedReader(object):
+    """
+    Reads the packet stream out of compressed frames.
+
+    This is used for SSL sockets and the pure Python implementation.
+    The C extension's socket reader inflates frames into its own buffer.
+
+    Parameters
+    ----------
+    rfile : file-like
+        Buffered reader of the socket
+    algorithm : str
+        Compression algorithm: 'zlib' or 'zstd'
+
+    """
+
+    def __init__(self, rfile, algorithm):
+        if algorithm == ZSTD and _zstd is None:
+            raise ValueError('zstd compression requires the zstandard package')
+        self._rfile = rfile
+        self._algorithm = algorithm
+        self._buff = bytearray()
+        self._pos = 0
+
+        #: Sequence number following the last frame that was received
+        self.compressed_seq_id = 0
+
+    def read(self, num_bytes):
+        while len(self._buff) - self._pos < num_bytes:
+            if not self._read_frame():
+                break
+        out = bytes(self._buff[self._pos:self._pos + num_bytes])
+        self._pos += len(out)
+        return out
+
+    def _read_frame(self):
+        header = self._rfile.read(FRAME_HEADER_LEN)
+        if len(header) < FRAME_HEADER_LEN:
+            return False
+
+        length = header[0] | (header[1] << 8) | (header[2] << 16)
+        uncompressed_length = header[4] | (header[5] << 8) | (header[6] << 16)
+
+        payload = self._rfile.read(length)
+        if len(payload) < length:
+            return False
+
+        self.compressed_seq_id = (header[3] + 1) % 256
+
+        if uncompressed_length:
+            try:
+                if self._algorithm == ZLIB:
+                    payload = zlib.decompress(payload)
+                else:
+                    payload = _zstd_decompress(payload, uncompressed_length)
+            except Exception as exc:
+                raise OSError(f'malformed compressed packet ({exc})')
+            if len(payload) != uncompressed_length:
+                raise OSError('malformed compressed packet')
+
+        if self._pos:
+            del self._buff[:self._pos]
+            self._pos = 0
+        self._buff += payload
+
+        return True
@@ -0,0 +1,769 @@
+# type: ignore
+"""
+Asyncio connections
+
+An :class:`AsyncConnection` speaks the same protocol as :class:`Connection`
+over an asyncio transport, so that many connections can share one event
+loop without a thread per query.
+
+Received data is appended to a reader that does not own a socket (the
+C extension's ``SocketReader`` or :class:`FeedReader`). Its response
+scanner reports when the complete response to a command has arrived, and
+only then is the response parsed by the regular result classes, which
+therefore never wait for the network.
+
+The connection handshake reuses the blocking authentication code on a
+worker thread, once per connection. Its reads wait for the data that the
+event loop receives, and TLS is started on the event loop's transport.
+
+"""
+import asyncio
+import concurrent.futures
+import functools
+import socket
+import threading
+
+try:
+    import _singlestoredb_accel
+except (ImportError, ModuleNotFoundError):
+    _singlestoredb_accel = None
+
+from . import _compress
+from . import err
+from .connection import _buffered_cursors
+from .connection import Connection
+from .connection import MySQLResultSV
+from .connection import RE_LOAD_LOCAL
+from .constants import COMMAND
+from .constants import CR
+from .constants import SERVER_STATUS
+from .. import fusion
+from ..utils.debug import log_query
+
+
+MAX_PACKET_LEN = 2 ** 24 - 1
+
+# States of the response scanner
+_SCAN_FIRST = 0  # First packet of a result
+_SCAN_COLUMNS = 1  # Column definitions and the EOF packet after them
+_SCAN_ROWS = 2  # Rows and the EOF or error packet after them
+
+
+def _read_length_encoded_integer(data, pos):
+    """Return a length-encoded integer of a packet and the position after it."""
+    c = data[pos]
+    if c < 0xFB:
+        return c, pos + 1
+    if c == 0xFC:
+        return data[pos + 1] + (data[pos + 2] << 8), pos + 3
+    if c == 0xFD:
+        return int.from_bytes(data[pos + 1:pos + 4], 'little'), pos + 4
+    if c == 0xFE:
+        return int.from_bytes(data[pos + 1:pos + 9], 'little'), pos + 9
+    return 0, pos + 1
+
+
+class FeedReader(object):
+    """
+    Reader for data that is received by the caller.
+
+    This is the pure Python counterpart of a ``SocketReader`` created
+    without a socket.
+
+    """
+
+    def __init__(self):
+        self._buff = bytearray()
+        self._start = 0
+        self._scan_state = _SCAN_FIRST
+        self._scan_continued = False
+        self._scan_pos = 0
+        self._scan_columns = 0
+
+    @property
+    def buffered(self):
+        """Number of received bytes that have not been read."""
+        return len(self._buff) - self._start
+
+    def feed(self, data):
+        """Append received data."""
+        if self._start:
+            del self._buff[:self._start]
+            self._start = 0
+        self._buff += data
+
+    def read(self, num_bytes):
+        """Read up to `num_bytes` of the received data."""
+        data = bytes(self._buff[self._start:self._start + num_bytes])
+        self._start += len(data)
+        return data
+
+    def scan(self):
+        """
+        Scan the received packets for the end of the response to a command.
+
+        Scanning continues where the previous call left off. The response
+        ends with the OK, EOF or error packet of its last result set. Once
+        the end has been found, the next call starts over at the first
+        unread byte.
+
+        Returns
+        -------
+        bool : True if the complete response has been received
+
+        """
+        buff = self._buff
+        end = len(buff)
+
+        while True:
+            pos = self._start + self._scan_pos
+            if end - pos < 4:
+                return False
+
+            packet_len = buff[pos] + (buff[pos + 1] << 8) + (buff[pos + 2] << 16)
+            if end - pos < 4 + packet_len:
+                return False
+
+            pos += 4
+            self._scan_pos += 4 + packet_len
+
+            # Only the first packet of a multi-packet payload is inspected.
+            continued = self._scan_continued
+            self._scan_continued = packet_len == MAX_PACKET_LEN
+            if continued:
+                continue
+
+            first = buff[pos] if packet_len else None
+            done = False
+
+            if self._scan_state == _SCAN_FIRST:
+                if first == 0x00:
+                    _, i = _read_length_encoded_integer(buff, pos + 1)
+                    _, i = _read_length_encoded_integer(buff, i)
+                    status = buff[i] + (buff[i + 1] << 8) if i + 2 <= end else 0
+                    done = not status & SERVER_STATUS.SERVER_MORE_RESULTS_EXISTS
+                elif first in (0xFF, 0xFB):
+                    # Error packet or LOAD DATA LOCAL request
+                    done = True
+                else:
+                    self._scan_columns, _ = _read_length_encoded_integer(buff, pos)
+                    self._scan_state = _SCAN_COLUMNS
+
+            elif self._scan_state == _SCAN_COLUMNS:
+                if self._scan_columns:
+                    self._scan_columns -= 1
+                else:
+                    self._scan_state = _SCAN_ROWS
+
+            elif first == 0xFE and packet_len < 9:
+                status = buff[pos + 3] + (buff[pos + 4] << 8) if packet_len >= 5 else 0
+                done = not status & SERVER_STATUS.SERVER_MORE_RESULTS_EXISTS
+                self._scan_state = _SCAN_FIRST
+
+            elif first == 0xFF:
+                done = True
+
+            if done:
+                self._scan_state = _SCAN_FIRST
+                self._scan_continued = False
+                self._scan_pos = 0
+                self._scan_columns = 0
+                return True
+
+
+class TransportSocket(object):
+    """
+    Socket-like object that writes to an asyncio transport.
+
+    Data received by the transport is fed to `rfile`. While the handshake
+    runs on a worker thread, its reads wait for that data to arrive. On the
+    event loop itself, nothing ever waits.
+
+    """
+
+    def __init__(self, loop, rfile):
+        self.rfile = rfile
+        self.transport = None
+        self.protocol = None
+        self.closed = False
+        self._loop = loop
+        self._loop_thread = threading.get_ident()
+        self.cond = threading.Condition()
+        self._waiter = None
+        self._drain_waiter = None
+        self._paused = False
+
+    def on_loop(self):
+        """Is this called on the event loop's thread?"""
+        return threading.get_ident() == self._loop_thread
+
+    def settimeout(self, timeout):
+        """Does nothing; timeouts are applied while waiting for responses."""
+
+    def sendall(self, data):
+        if self.closed:
+            raise OSError('socket is closed')
+        if self.on_loop():
+            self.transport.write(data)
+        else:
+            self._loop.call_soon_threadsafe(self._write, bytes(data))
+
+    def _write(self, data):
+        if not self.closed:
+            self.transport.write(data)
+
+    def close(self):
+        if self.closed:
+            return
+        self.closed = True
+        try:
+            if self.on_loop():
+                self._close()
+            else:
+                self._loop.call_soon_threadsafe(self._close)
+        except RuntimeError:
+            # The event loop has been closed already.
+            pass
+        with self.cond:
+            self.cond.notify_all()
+
+    def _close(self):
+        if self.transport is not None:
+            self.transport.close()
+        self._wake()
+
+    def _wake(self):
+        for waiter in (self._waiter, self._drain_waiter):
+            if waiter is not None and not waiter.done():
+                waiter.set_result(None)
+
+    def start_tls(self, ctx, server_hostname):
+        """Switch the transport to TLS from the worker thread."""
+        asyncio.run_coroutine_threadsafe(
+            self._start_tls(ctx, server_hostname), self._loop,
+        ).result()
+
+    async def _start_tls(self, ctx, server_hostname):
+        self.transport = await self._loop.start_tls(
+            self.transport, self.protocol, ctx, server_hostname=server_hostname,
+        )
+
+    def wait(self, ready, timeout=None):
+        """
+        Wait on the worker thread until `ready()` returns True.
+
+        This must be called with the condition held.
+
+        """
+        while not ready() and not self.closed:
+            if not self.cond.wait(timeout):
+                break
+
+    def data_received(self, data):
+        with self.cond:
+            self.rfile.feed(data)
+            self.cond.notify_all()
+        if self._waiter is not None and not self._waiter.done() and self.rfile.scan():
+            self._waiter.set_result(None)
+
+    def connection_lost(self, exc):
+        self.closed = True
+        with self.cond:
+            self.cond.notify_all()
+        self._wake()
+
+    def pause_writing(self):
+        self._paused = True
+
+    def resume_writing(self):
+        self._paused = False
+        if self._drain_waiter is not None and not self._drain_waiter.done():
+            self._drain_waiter.set_result(None)
+
+    async def drain(self):
+        """Wait until the transport's write buffer has been flushed."""
+        if not self._paused or self.closed:
+            return
+        self._drain_waiter = self._loop.create_future()
+        try:
+            await self._drain_waiter
+        finally:
+            self._drain_waiter = None
+
+    async def wait_response(self, timeout=None):
+        """Wait until the complete response to a command has been received."""
+        if self.rfile.scan() or self.closed:
+            return
+        self._waiter = self._loop.create_future()
+        try:
+            await asyncio.wait_for(self._waiter, timeout)
+        finally:
+            self._waiter = None
+
+
+class _Protocol(asyncio.Protocol):
+    """Protocol that hands the transport's events to a `TransportSocket`."""
+
+    def __init__(self, sock):
+        self._sock = sock
+        sock.protocol = self
+
+    def connection_made(self, transport):
+        self._sock.transport = transport
+
+    def data_received(self, data):
+        self._sock.data_received(data)
+
+    def connection_lost(self, exc):
+        self._sock.connection_lost(exc)
+
+    def pause_writing(self):
+        self._sock.pause_writing()
+
+    def resume_writing(self):
+        self._sock.resume_writing()
+
+
+class TransportConnection(Connection):
+    """
+    Connection whose socket is a `TransportSocket`.
+
+    Internal use only. The blocking methods of this class are only called
+    once the response they read has been received completely, except during
+    the handshake, which runs on a worker thread.
+
+    """
+
+    def _make_rfile(self, sock):
+        return sock.rfile
+
+    def _start_tls(self):
+        self._sock.start_tls(self.ctx, self.host)
+        self._secure = True
+
+    def _compression_algorithms(self):
+        # Frames have to be inflated as they are fed for the scanner to see them.
+        if isinstance(self._rfile, FeedReader):
+            return []
+        return list(_compress.native_algorithms())
+
+    def _read_bytes(self, num_bytes):
+        sock = self._sock
+        if sock is None or sock.on_loop():
+            return super()._read_bytes(num_bytes)
+        with sock.cond:
+            sock.wait(lambda: sock.rfile.buffered >= num_bytes, self._read_timeout)
+            return super()._read_bytes(num_bytes)
+
+    def _read_query_result(self, unbuffered=False, binary=False):
+        sock = self._sock
+        if sock is None or sock.on_loop():
+            return super()._read_query_result(unbuffered=unbuffered, binary=binary)
+        with sock.cond:
+            sock.wait(sock.rfile.scan, self._read_timeout)
+            return super()._read_query_result(unbuffered=unbuffered, binary=binary)
+
+
+class AsyncConnection(object):
+    """
+    Asyncio connection to a SingleStoreDB database.
+
+    The proper way to get an instance of this class is to await
+    :func:`connect`. The parameters are the same as for :class:`Connection`,
+    except that ``local_infile`` is not supported.
+
+    Commands on one connection are run one at a time. Concurrent queries
+    should use separate connections, which can all share one event loop.
+
+    """
+
+    def __init__(self, **kwargs):
+        if kwargs.get('local_infile'):
+            raise err.NotSupportedError(
+                0, 'LOAD DATA LOCAL is not supported on asyncio connections',
+            )
+        kwargs['defer_connect'] = True
+        self._conn = TransportConnection(**kwargs)
+        self._lock = None
+
+    @property
+    def connection(self):
+        """The underlying blocking connection object."""
+        return self._conn
+
+    @property
+    def open(self):
+        """Return True if the connection is open."""
+        return self._conn.open
+
+    @property
+    def server_version(self):
+        return self._conn.server_version
+
+    def get_autocommit(self):
+        """Retrieve autocommit status."""
+        return self._conn.get_autocommit()
+
+    def insert_id(self):
+        return self._conn.insert_id()
+
+    def escape(self, obj, mapping=None):
+        """Escape whatever value is passed."""
+        return self._conn.escape(obj, mapping)
+
+    def literal(self, obj):
+        """Alias for escape()."""
+        return self._conn.literal(obj)
+
+    async def connect(self):
+        """
+        Connect to the server.
+
+        Internal use only.
+
+        """
+        conn = self._conn
+        loop = asyncio.get_running_loop()
+        self._lock = asyncio.Lock()
+
+        if conn.resultclass is MySQLResultSV:
+            rfile = _singlestoredb_accel.SocketReader(None)
+        else:
+            rfile = FeedReader()
+        sock = TransportSocket(loop, rfile)
+        factory = functools.partial(_Protocol, sock)
+
+        try:
+            if conn.unix_socket:
+                coro = loop.create_unix_connection(factory, conn.unix_socket)
+                conn.host_info = 'Localhost via UNIX socket'
+                conn._secure = True
+            else:
+                local_addr = None
+                if conn.bind_address is not None:
+                    local_addr = (conn.bind_address, 0)
+                coro = loop.create_connection(
+                    factory, conn.host, conn.port, local_addr=local_addr,
+                )
+                conn.host_info = 'socket %s:%d' % (conn.host, conn.port)
+            transport, _ = await asyncio.wait_for(coro, conn.connect_timeout)
+        except (OSError, asyncio.TimeoutError) as e:
+            exc = err.OperationalError(
+                CR.CR_CONN_HOST_ERROR,
+                f'Can\'t connect to MySQL server on {conn.host!r} ({e!r})',
+            )
+            exc.original_exception = e
+            raise exc
+
+        if not conn.unix_socket:
+            raw_sock = transport.get_extra_info('socket')
+            if raw_sock is not None:
+                raw_sock.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
+
+        # The handshake gets a thread of its own, so that a slow server
+        # does not hold up the handshakes of other connections. Like on
+        # blocking connections, its reads are only limited by the read timeout.
+        future = concurrent.futures.Future()
+
+        def handshake():
+            try:
+                future.set_result(conn.connect(sock))
+            except BaseException as exc:
+                future.set_exception(exc)
+
+        threading.Thread(target=handshake, daemon=True).start()
+        try:
+            await asyncio.wrap_future(future)
+        except BaseException:
+            sock.close()
+            raise
+
+        return self
+
+    async def _command(self, command, sql, read):
+        """
+        Send a command, wait for its response, and read it with `read`.
+
+        Internal use only.
+
+        """
+        async with self._lock:
+            conn = self._conn
+            conn._execute_command(command, sql)
+            sock = conn._sock
+            try:
+                await sock.drain()
+                await sock.wait_response(conn._read_timeout)
+            except asyncio.TimeoutError:
+                conn._force_close()
+                raise err.OperationalError(
+                    CR.CR_SERVER_LOST,
+                    'Lost connection to MySQL server during query (timed out)',
+                )
+            except BaseException:
+                # The response can not be matched to its command any more.
+                conn._force_close()
+                raise
+            return read()
+
+    async def query(self, sql):
+        """
+        Run a query on the server.
+
+        Internal use only.
+
+        """
+        conn = self._conn
+        if fusion.get_handler(sql) is not None:
+            raise err.NotSupportedError(
+                0, 'Management commands are not supported on asyncio connections',
+            )
+        if RE_LOAD_LOCAL.match(sql):
+            raise err.NotSupportedError(
+                0, 'LOAD DATA LOCAL is not supported on asyncio connections',
+            )
+        if isinstance(sql, str):
+            sql = sql.encode(conn.encoding, 'surrogateescape')
+        conn._affected_rows = await self._command(
+            COMMAND.COM_QUERY, sql, conn._read_query_result,
+        )
+        return conn._affected_rows
+
+    async def autocommit(self, value):
+        """Enable autocommit in the server."""
+        conn = self._conn
+        conn.autocommit_mode = bool(value)
+        if value != conn.get_autocommit():
+            sql = 'SET AUTOCOMMIT = %s' % conn.escape(conn.autocommit_mode)
+            log_query(sql)
+            await self._command(COMMAND.COM_QUERY, sql, conn._read_ok_packet)
+
+    async def begin(self):
+        """Begin transaction."""
+        log_query('BEGIN')
+        await self._command(COMMAND.COM_QUERY, 'BEGIN', self._conn._read_ok_packet)
+
+    async def commit(self):
+        """Commit changes to stable storage."""
+        log_query('COMMIT')
+        await self._command(COMMAND.COM_QUERY, 'COMMIT', self._conn._read_ok_packet)
+
+    async def rollback(self):
+        """Roll back the current transaction."""
+        log_query('ROLLBACK')
+        await self._command(COMMAND.COM_QUERY, 'ROLLBACK', self._conn._read_ok_packet)
+
+    async def select_db(self, db):
+        """
+        Set current db.
+
+        db : str
+            The name of the db.
+
+        """
+        await self._command(COMMAND.COM_INIT_DB, db, self._conn._read_ok_packet)
+
+    async def ping(self):
+        """
+        Check if the server is alive.
+
+        Raises
+        ------
+        Error : If the connection is closed.
+
+        """
+        if self._conn._sock is None:
+            raise err.Error('Already closed')
+        await self._command(COMMAND.COM_PING, '', self._conn._read_ok_packet)
+
+    async def close(self):
+        """Send the quit message and close the connection."""
+        self._conn.close()
+
+    def cursor(self, cursor=None):
+        """
+        Create a new cursor to execute queries with.
+
+        Parameters
+        ----------
+        cursor : Cursor, optional
+            The type of cursor to create. Unbuffered cursor classes are
+            replaced by their buffered counterparts.
+
+        Returns
+        -------
+        AsyncCursor
+
+        """
+        cursorclass = cursor or self._conn.cursorclass
+        cursorclass = _buffered_cursors.get(cursorclass, cursorclass)
+        return AsyncCursor(self, cursorclass(self._conn))
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, *exc_info):
+        del exc_info
+        if self._conn._sock is not None:
+            await self.close()
+
+
+class AsyncCursor(object):
+    """
+    Asyncio cursor of an :class:`AsyncConnection`.
+
+    Results are buffered, so only :meth:`execute` and :meth:`executemany`
+    wait on the server. Parameters are always interpolated on the client.
+
+    Parameters
+    ----------
+    connection : AsyncConnection
+        The connection the cursor belongs to
+    cursor : Cursor
+        The buffered cursor that holds the results
+
+    """
+
+    def __init__(self, connection, cursor):
+        self.connection = connection
+        self._cursor = cursor
+
+    @property
+    def description(self):
+        return self._cursor.description
+
+    @property
+    def rowcount(self):
+        return self._cursor.rowcount
+
+    @property
+    def rownumber(self):
+        return self._cursor.rownumber
+
+    @property
+    def lastrowid(self):
+        return self._cursor.lastrowid
+
+    @property
+    def warning_count(self):
+        return self._cursor.warning_count
+
+    @property
+    def arraysize(self):
+        return self._cursor.arraysize
+
+    @arraysize.setter
+    def arraysize(self, value):
+        self._cursor.arraysize = value
+
+    def mogrify(self, query, args=None):
+        """Return the exact string that :meth:`execute` sends to the database."""
+        return self._cursor.mogrify(query, args)
+
+    async def execute(self, query, args=None):
+        """
+        Execute a query.
+
+        Parameters
+        ----------
+        query : str
+            Query to execute.
+        args : Sequence[Any] or Dict[str, Any] or Any, optional
+            Parameters used with query. (optional)
+
+        Returns
+        -------
+        int : Number of affected rows.
+
+        """
+        cur = self._cursor
+        while cur.nextset():
+            pass
+
+        log_query(query, args)
+        query = cur.mogrify(query, args)
+
+        cur._clear_result()
+        await self.connection.query(query)
+        cur._do_get_result()
+        cur._executed = query
+        return cur.rowcount
+
+    async def executemany(self, query, args):
+        """
+        Run a query against every sequence or mapping in `args`.
+
+        Returns
+        -------
+        int : Number of affected rows.
+
+        """
+        rowcount = 0
+        for arg in args:
+            rowcount += await self.execute(query, arg)
+        self._cursor.rowcount = rowcount
+        return rowcount
+
+    async def fetchone(self):
+        """Fetch the next row."""
+        return self._cursor.fetchone()
+
+    async def fetchmany(self, size=None):
+        """Fetch several rows."""
+        return self._cursor.fetchmany(size)
+
+    async def fetchall(self):
+        """Fetch all the rows."""
+        return self._cursor.fetchall()
+
+    def scroll(self, value, mode='relative'):
+        """Scroll the cursor to a new position in the result set."""
+        self._cursor.scroll(value, mode)
+
+    async def nextset(self):
+        """Move to the next result set, which has been received already."""
+        return self._cursor.nextset()
+
+    async def close(self):
+        """Close the cursor."""
+        self._cursor.close()
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        row = self._cursor.fetchone()
+        if row is None:
+            raise StopAsyncIteration
+        return row
+
+    async def __aenter__(self):
+        return self
+
+    async def __aexit__(self, *exc_info):
+        del exc_info
+        await self.close()
+
+
+async def connect(**kwargs):
+    """
+    Connect to a SingleStoreDB database from asyncio code.
+
+    Parameters
+    ----------
+    **kwargs : Any
+        The parameters of :class:`Connection`
+
+    Returns
+    -------
+    AsyncConnection
+
+    Examples
+    --------
+    >>> async with await connect(host='...', user='...') as conn:
+    ...     cur = conn.cursor()
+    ...     await cur.execute('SELECT 1')
+    ...     rows = await cur.fetchall()
+
+    """
+    return await AsyncConnection(**kwargs).connect()
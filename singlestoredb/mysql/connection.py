@@ -3,9 +3,15 @@
 # http://dev.mysql.com/doc/internals/en/client-server-protocol.html
 # Error codes:
 # https://dev.mysql.com/doc/refman/5.5/en/error-handling.html
+import collections
+import concurrent.futures
+import datetime
+import decimal
 import errno
 import functools
+import numbers
 import os
+import re
 import socket
 import struct
 import sys
@@ -18,6 +24,7 @@ except (ImportError, ModuleNotFoundError):
     _singlestoredb_accel = None
 
 from . import _auth
+from . import _compress
 
 from .charset import charset_by_name, charset_by_id
 from .constants import CLIENT, COMMAND, CR, ER, FIELD_TYPE, SERVER_STATUS
@@ -29,12 +36,30 @@ from .cursors import (
     DictCursorSV,
     NamedtupleCursor,
     NamedtupleCursorSV,
+    ArrowCursor,
+    ArrowCursorSV,
+    ColumnarCursorSV,
+    NumpyCursor,
+    NumpyCursorSV,
+    PandasCursor,
+    PandasCursorSV,
+    PolarsCursor,
+    PolarsCursorSV,
     SSCursor,
     SSCursorSV,
     SSDictCursor,
     SSDictCursorSV,
     SSNamedtupleCursor,
     SSNamedtupleCursorSV,
+    SSArrowCursor,
+    SSArrowCursorSV,
+    SSColumnarCursorSV,
+    SSNumpyCursor,
+    SSNumpyCursorSV,
+    SSPandasCursor,
+    SSPandasCursorSV,
+    SSPolarsCursor,
+    SSPolarsCursorSV,
 )
 from .optionfile import Parser
 from .protocol import (
@@ -47,6 +72,7 @@ from .protocol import (
 )
 from . import err
 from ..config import get_option
+from ..converters import get_decimal_converter
 from .. import fusion
 from .. import connection
 from ..connection import Connection as BaseConnection
@@ -83,12 +109,102 @@ TEXT_TYPES = {
     FIELD_TYPE.GEOMETRY,
 }
 
+DECIMAL_TYPES = {
+    FIELD_TYPE.DECIMAL,
+    FIELD_TYPE.NEWDECIMAL,
+}
+
 UNSET = 'unset'
 
 DEFAULT_CHARSET = 'utf8mb4'
 
 MAX_PACKET_LEN = 2**24 - 1
 
+# Bytes of queries a pipeline sends before reading their results. Keeping
+# this below the socket buffer sizes means that sending never blocks on a
+# server that is itself blocked sending results.
+PIPELINE_WINDOW = 64 * 1024
+
+#: Receives the data of many connections on one native thread (io_uring on
+#: Linux). Pass an instance as ``read_engine`` to share it. None without the
+#: C extension.
+ReadEngine = getattr(_singlestoredb_accel, 'ReadEngine', None)
+
+# The server would read the queries that follow as the file data.
+RE_LOAD_LOCAL = re.compile(r'\s*LOAD\s+DATA\s+(?:\w+\s+)?LOCAL\b', re.IGNORECASE)
+
+# Literals, quoted identifiers and comments, which are skipped when looking
+# for the clauses that can not be split by parallel_fetch.
+RE_QUOTED = re.compile(
+    r"'(?:[^'\\]|\\.|'')*'|\"(?:[^\"\\]|\\.|\"\")*\"|`(?:[^`]|``)*`"
+    r'|/\*.*?\*/|(?:--|#)[^\n]*',
+    re.DOTALL,
+)
+
+# Clauses whose results change when a query is run in parts.
+RE_NOT_SPLITTABLE = re.compile(
+    r'\b(?:(?:GROUP\s+BY|ORDER\s+BY|LIMIT|DISTINCT|HAVING)\b'
+    r'|(?:OVER|COUNT|SUM|AVG|MIN|MAX|GROUP_CONCAT|STD|STDDEV|STDDEV_POP|STDDEV_SAMP'
+    r'|VARIANCE|VAR_POP|VAR_SAMP|BIT_AND|BIT_OR|BIT_XOR|ANY_VALUE|MEDIAN'
+    r'|APPROX_COUNT_DISTINCT|APPROX_PERCENTILE|PERCENTILE_CONT|PERCENTILE_DISC'
+    r'|JSON_AGG)\s*\()',
+    re.IGNORECASE,
+)
+
+# Column types that can be split into key ranges.
+_INTEGER_TYPES = {
+    FIELD_TYPE.TINY, FIELD_TYPE.SHORT, FIELD_TYPE.INT24,
+    FIELD_TYPE.LONG, FIELD_TYPE.LONGLONG, FIELD_TYPE.YEAR,
+}
+
+# C extension cursors of the columnar results types
+_columnar_cursors_sv = {
+    NumpyCursor: NumpyCursorSV,
+    SSNumpyCursor: SSNumpyCursorSV,
+    PandasCursor: PandasCursorSV,
+    SSPandasCursor: SSPandasCursorSV,
+    ArrowCursor: ArrowCursorSV,
+    SSArrowCursor: SSArrowCursorSV,
+    PolarsCursor: PolarsCursorSV,
+    SSPolarsCursor: SSPolarsCursorSV,
+}
+
+# Buffered cursors used for the results of the unbuffered cursors in a pipeline
+_buffered_cursors = {
+    SSCursor: Cursor,
+    SSCursorSV: CursorSV,
+    SSDictCursor: DictCursor,
+    SSDictCursorSV: DictCursorSV,
+    SSNamedtupleCursor: NamedtupleCursor,
+    SSNamedtupleCursorSV: NamedtupleCursorSV,
+    SSNumpyCursor: NumpyCursor,
+    SSNumpyCursorSV: NumpyCursorSV,
+    SSPandasCursor: PandasCursor,
+    SSPandasCursorSV: PandasCursorSV,
+    SSArrowCursor: ArrowCursor,
+    SSArrowCursorSV: ArrowCursorSV,
+    SSPolarsCursor: PolarsCursor,
+    SSPolarsCursorSV: PolarsCursorSV,
+}
+
+
+def _pack_command(command, sql):
+    """Return the packets of a command and the sequence number that follows."""
+    if len(sql) + 1 < MAX_PACKET_LEN:
+        return struct.pack('<iB', len(sql) + 1, command) + sql, 1
+
+    data = bytes([command]) + sql
+    packets = []
+    seq_id = 0
+    while True:
+        chunk = data[:MAX_PACKET_LEN]
+        data = data[MAX_PACKET_LEN:]
+        packets.append(_pack_int24(len(chunk)) + bytes([seq_id]) + chunk)
+        seq_id = (seq_id + 1) % 256
+        if len(chunk) < MAX_PACKET_LEN:
+            break
+    return b''.join(packets), seq_id
+
 
 def _pack_int24(n):
     return struct.pack('<I', n)[:3]
@@ -215,8 +331,13 @@ class Connection(BaseConnection):
         SHA256 authentication plugin public key value. (default: None)
     binary_prefix : bool, optional
         Add _binary prefix on bytes and bytearray. (default: False)
-    compress :
-        Not supported.
+    compress : bool or str, optional
+        Use the compressed protocol: 'zlib', 'zstd', or True / 'auto' for
+        zstd when both sides support it and zlib otherwise. The connection
+        is not compressed if the server does not support the algorithm.
+        The C extension inflates incoming frames in its socket reader.
+        zstd requires the C extension to be built with zstd
+        (``SINGLESTOREDB_BUILD_ZSTD=1``) or the ``zstandard`` package.
     named_pipe :
         Not supported.
     db : str, optional
@@ -241,6 +362,40 @@ class Connection(BaseConnection):
     inf_as_null : bool, optional
         Should Inf values be treated as NULLs in parameter substitution including
         uploading data?
+    decimal_type : str, optional
+        The type to return DECIMAL values as: 'decimal' (the default), 'float',
+        or 'scaled_int'. Scaled integers are the values multiplied by
+        10**scale of the column. In the arrow and polars results types,
+        'decimal' columns are returned as Arrow decimal128 / decimal256 values.
+    intern_strings : bool, optional
+        Share one str object between all cells of a string column that have the
+        same value. This is always done for ENUM and SET columns. It reduces
+        the memory used by low-cardinality columns in large result sets.
+        Only used by the C extension.
+    read_ahead : bool, optional
+        Receive the rows of unbuffered results on a background thread, so that
+        network transfer overlaps with the processing of fetched rows. Up to
+        16MB of rows are buffered ahead of the cursor. Only used by the
+        C extension on connections without SSL.
+    decode_on_fetch : bool, optional
+        Keep the rows of buffered results as the packets received from the
+        server, and decode each row when it is fetched. This uses a fraction
+        of the memory of decoded rows for large results that are processed
+        with ``fetchone``, ``fetchmany``, or by iterating over the cursor.
+        Only used by the C extension for results that are not columnar.
+    read_engine : ReadEngine, optional
+        Receive data through a ``ReadEngine`` that is shared by many
+        connections. The engine completes the reads of all of them on one
+        native thread, using io_uring on Linux, which cuts down on system
+        calls and context switches when many queries are in flight at once.
+        Only used by the C extension on connections without SSL.
+    server_side_prepare : bool, optional
+        Execute queries that have parameters as server-side prepared
+        statements. Parameters are sent and rows are received in the binary
+        protocol, so numbers and dates are not formatted and parsed as text.
+        Statements are kept open per connection for reuse, keyed by the
+        query text. Queries with parameter types that can not be sent in
+        the binary protocol (such as sequences) use the text protocol.
     track_env : bool, optional
         Should the connection track the SINGLESTOREDB_URL environment variable?
 
@@ -252,10 +407,17 @@ class Connection(BaseConnection):
     driver = 'mysql'
     paramstyle = 'pyformat'
 
+    #: Number of server-side prepared statements kept open per connection
+    #: when ``server_side_prepare`` is enabled.
+    max_prepared_statements = 128
+
     _sock = None
+    _compression = None
     _auth_plugin_name = ''
     _closed = False
     _secure = False
+    _tls_options = None
+    _writer = None
 
     def __init__(  # noqa: C901
         self,
@@ -301,7 +463,7 @@ class Connection(BaseConnection):
         pure_python=None,
         buffered=True,
         results_type='tuples',
-        compress=None,  # not supported
+        compress=None,
         named_pipe=None,  # not supported
         passwd=None,  # deprecated
         db=None,  # deprecated
@@ -311,6 +473,12 @@ class Connection(BaseConnection):
         nan_as_null=None,
         inf_as_null=None,
         encoding_errors='strict',
+        decimal_type='decimal',
+        intern_strings=False,
+        read_ahead=False,
+        decode_on_fetch=False,
+        read_engine=None,
+        server_side_prepare=False,
         track_env=False,
     ):
         BaseConnection.__init__(**dict(locals()))
@@ -328,10 +496,24 @@ class Connection(BaseConnection):
             # )
             password = passwd
 
-        if compress or named_pipe:
-            raise NotImplementedError(
-                'compress and named_pipe arguments are not supported',
+        if named_pipe:
+            raise NotImplementedError('named_pipe argument is not supported')
+
+        if isinstance(compress, str):
+            compress = compress.lower()
+        if compress is True or compress in ('true', 'on', '1'):
+            compress = 'auto'
+        elif not compress or compress in ('false', 'off', '0', 'none'):
+            compress = None
+        elif compress not in ('auto', _compress.ZLIB, _compress.ZSTD):
+            raise ValueError(f'unrecognized compression algorithm: {compress}')
+        elif compress == _compress.ZSTD and \
+                _compress.ZSTD not in _compress.python_algorithms() and \
+                _compress.ZSTD not in _compress.native_algorithms():
+            raise err.NotSupportedError(
+                'zstd compression requires the zstandard package',
             )
+        self.compress = compress
 
         self._local_infile = bool(local_infile)
         if self._local_infile:
@@ -399,6 +581,7 @@ class Connection(BaseConnection):
                 self.ssl = True
                 client_flag |= CLIENT.SSL
                 self.ctx = self._create_ssl_ctx(ssl)
+                self._tls_options = self._native_tls_options(ssl)
 
         self.host = host or 'localhost'
         self.port = port or 3306
@@ -425,6 +608,13 @@ class Connection(BaseConnection):
         self.collation = collation
         self.use_unicode = use_unicode
         self.encoding_errors = encoding_errors
+        self.decimal_type = decimal_type or 'decimal'
+        self.intern_strings = bool(intern_strings)
+        self.read_ahead = bool(read_ahead)
+        self.decode_on_fetch = bool(decode_on_fetch)
+        self.read_engine = read_engine
+        self.server_side_prepare = bool(server_side_prepare)
+        self._prepared_statements = collections.OrderedDict()
 
         self.encoding = charset_by_name(self.charset).encoding
 
@@ -443,6 +633,14 @@ class Connection(BaseConnection):
                 self.cursorclass = DictCursor
             elif 'namedtuple' in self.results_type:
                 self.cursorclass = NamedtupleCursor
+            elif 'numpy' in self.results_type:
+                self.cursorclass = NumpyCursor
+            elif 'pandas' in self.results_type:
+                self.cursorclass = PandasCursor
+            elif 'arrow' in self.results_type:
+                self.cursorclass = ArrowCursor
+            elif 'polars' in self.results_type:
+                self.cursorclass = PolarsCursor
             else:
                 self.cursorclass = Cursor
         else:
@@ -450,6 +648,14 @@ class Connection(BaseConnection):
                 self.cursorclass = SSDictCursor
             elif 'namedtuple' in self.results_type:
                 self.cursorclass = SSNamedtupleCursor
+            elif 'numpy' in self.results_type:
+                self.cursorclass = SSNumpyCursor
+            elif 'pandas' in self.results_type:
+                self.cursorclass = SSPandasCursor
+            elif 'arrow' in self.results_type:
+                self.cursorclass = SSArrowCursor
+            elif 'polars' in self.results_type:
+                self.cursorclass = SSPolarsCursor
             else:
                 self.cursorclass = SSCursor
 
@@ -487,6 +693,16 @@ class Connection(BaseConnection):
             elif self.cursorclass is SSNamedtupleCursor:
                 self.cursorclass = SSNamedtupleCursorSV
                 self.results_type = 'namedtuples'
+            elif self.cursorclass in _columnar_cursors_sv:
+                cursorclass_sv = _columnar_cursors_sv[self.cursorclass]
+                if cursorclass_sv._columns.is_available():
+                    self.cursorclass = cursorclass_sv
+
+            # Only the columnar cursors know how to handle columnar results.
+            if issubclass(self.cursorclass, (ColumnarCursorSV, SSColumnarCursorSV)):
+                self.results_type = self.cursorclass._columns.name
+            elif self.results_type in ('numpy', 'pandas', 'arrow', 'polars'):
+                self.results_type = 'tuples'
 
         self._result = None
         self._affected_rows = 0
@@ -593,6 +809,33 @@ class Connection(BaseConnection):
         ctx.options |= ssl.OP_NO_SSLv3
         return ctx
 
+    def _native_tls_options(self, sslp):
+        """
+        Return the arguments for running TLS in the native socket reader.
+
+        Only connections configured with a dict of options can use it;
+        a user-supplied ``ssl.SSLContext`` may carry settings that cannot
+        be carried over, so it always goes through the Python ``ssl`` layer.
+
+        Returns
+        -------
+        dict or None
+
+        """
+        if _singlestoredb_accel is None or \
+                not getattr(_singlestoredb_accel, 'native_tls', False) or \
+                not isinstance(sslp, dict):
+            return None
+        return dict(
+            cafile=sslp.get('ca'),
+            capath=sslp.get('capath'),
+            certfile=sslp.get('cert'),
+            keyfile=sslp.get('key'),
+            ciphers=sslp.get('cipher'),
+            verify=self.ctx.verify_mode != ssl.CERT_NONE,
+            check_hostname=self.ctx.check_hostname,
+        )
+
     def close(self):
         """
         Send the quit message and close the socket.
@@ -615,6 +858,8 @@ class Connection(BaseConnection):
             return
         send_data = struct.pack('<iB', 1, COMMAND.COM_QUIT)
         try:
+            if self._compression:
+                self._rfile.compressed_seq_id = 0
             self._write_bytes(send_data)
         except Exception:
             pass
@@ -769,6 +1014,164 @@ class Connection(BaseConnection):
         """Create a new cursor to execute queries with."""
         return self.cursorclass(self)
 
+    def pipeline(self):
+        """
+        Create a pipeline that sends many queries before reading results.
+
+        Queries are queued with :meth:`Pipeline.execute`, which returns the
+        cursor that will hold the results. When the ``with`` block exits,
+        the queued queries are sent back to back and their results are read
+        in order, so a batch of small queries costs about one round trip.
+
+        Examples
+        --------
+        >>> with conn.pipeline() as p:
+        ...     cursors = [p.execute('SELECT %s', (i,)) for i in range(1000)]
+        >>> cursors[10].fetchall()
+
+        Returns
+        -------
+        Pipeline
+
+        """
+        return Pipeline(self)
+
+    def parallel_fetch(self, query, args=None, n_workers=None, key=None):
+        """
+        Fetch the results of a query over several connections at once.
+
+        The query is split into parts that are run on ``n_workers`` extra
+        connections, whose results are merged into one results object of
+        the connection's results type. With the C extension, the parts are
+        received on read-ahead connections, so the network reads of all
+        parts run on native threads without the GIL.
+
+        By default, the query is split by the partitions of the current
+        database, which only works for queries of a single sharded table
+        that can be filtered on ``PARTITION_ID()``. Giving an integer
+        ``key`` column splits the query into ranges of that column instead.
+        The parts are merged in range order; rows within a part, and all
+        rows of partition splits, have no order.
+
+        Only plain scans that produce rows can be split. Queries with
+        aggregates, window functions, ``GROUP BY``, ``HAVING``,
+        ``DISTINCT``, ``ORDER BY`` or ``LIMIT`` raise a
+        :class:`NotSupportedError`, since running them in parts would
+        change their results.
+
+        Parameters
+        ----------
+        query : str
+            Query to execute
+        args : Sequence[Any] or Dict[str, Any] or Any, optional
+            Parameters used with query
+        n_workers : int, optional
+            Number of connections to use. Defaults to the number of CPUs,
+            but no more than the number of partitions.
+        key : str, optional
+            Integer column to split the query by
+
+        Returns
+        -------
+        list of rows or the results object of a columnar results type
+
+        """
+        with self.cursor() as cur:
+            query = cur.mogrify(query, args)
+        if isinstance(query, (bytes, bytearray)):
+            query = query.decode(self.encoding)
+
+        if RE_NOT_SPLITTABLE.search(RE_QUOTED.sub(' ', query)):
+            raise err.NotSupportedError(
+                0, 'Only queries without aggregates, window functions, GROUP BY, '
+                'HAVING, DISTINCT, ORDER BY or LIMIT can be fetched in parallel',
+            )
+
+        params = dict(self.connection_params)
+        params.update(
+            database=self.db, buffered=True, read_ahead=True,
+            defer_connect=False, track_env=False,
+        )
+        if params.get('cursorclass') is not None:
+            params['cursorclass'] = _buffered_cursors.get(
+                params['cursorclass'], params['cursorclass'],
+            )
+
+        n_workers = n_workers or os.cpu_count() or 1
+        control = type(self)(**dict(params, results_type='tuples', cursorclass=None))
+        try:
+            with control.cursor() as cur:
+                if key is None:
+                    filters = self._partition_filters(cur, n_workers)
+                else:
+                    filters = self._key_range_filters(cur, query, key, n_workers)
+        finally:
+            control.close()
+
+        def fetch(where):
+            conn = type(self)(**params)
+            try:
+                with conn.cursor() as cur:
+                    cur.execute(
+                        f'SELECT * FROM ({query}) AS __s2_parallel_fetch WHERE {where}',
+                    )
+                    return cur.fetchall()
+            finally:
+                conn.close()
+
+        with concurrent.futures.ThreadPoolExecutor(len(filters)) as pool:
+            results = list(pool.map(fetch, filters))
+
+        columns = getattr(self.cursorclass, '_columns', None)
+        if columns is not None:
+            return columns.concat(results)
+        return [row for res in results for row in res]
+
+    def _partition_filters(self, cur, n_workers):
+        """Return the conditions that split a query by partition."""
+        if not self.db:
+            raise err.ProgrammingError(
+                0, 'Splitting a query by partition requires a database',
+            )
+        cur.execute('SHOW PARTITIONS')
+        names = [x[0].lower() for x in cur.description]
+        ordinals = sorted(
+            int(row[names.index('ordinal')]) for row in cur.fetchall()
+            if str(row[names.index('role')]).lower() == 'master'
+        )
+        if not ordinals:
+            raise err.ProgrammingError(0, 'The database has no partitions')
+        n_workers = min(n_workers, len(ordinals))
+        return [
+            'PARTITION_ID() IN ({})'.format(
+                ', '.join(str(x) for x in ordinals[i::n_workers]),
+            )
+            for i in range(n_workers)
+        ]
+
+    def _key_range_filters(self, cur, query, key, n_workers):
+        """Return the conditions that split a query into key ranges."""
+        key = connection.quote_identifier(key)
+        cur.execute(
+            f'SELECT MIN({key}), MAX({key}) FROM ({query}) AS __s2_parallel_fetch',
+        )
+        if cur.description[0][1] not in _INTEGER_TYPES:
+            raise err.NotSupportedError(
+                0, f'The key column {key} must have an integer type',
+            )
+        low, high = cur.fetchone()
+        if low is None:
+            return [f'{key} IS NULL']
+        n_workers = max(1, min(n_workers, high - low + 1))
+        bounds = [low + (high - low + 1) * i // n_workers for i in range(n_workers + 1)]
+        filters = [
+            f'{key} >= {bounds[i]} AND {key} < {bounds[i + 1]}'
+            for i in range(n_workers)
+        ]
+        # NULLs sort first.
+        filters[0] = f'{key} IS NULL OR ({filters[0]})'
+        return filters
+
     # The following methods are INTERNAL USE ONLY (called from Cursor)
     def query(self, sql, unbuffered=False):
         """
@@ -797,7 +1200,74 @@ class Connection(BaseConnection):
         Internal use only.
 
         """
-        self._affected_rows = self._read_query_result(unbuffered=unbuffered)
+        binary = getattr(self._result, 'binary', False)
+        self._affected_rows = self._read_query_result(
+            unbuffered=unbuffered, binary=binary,
+        )
+        return self._affected_rows
+
+    def prepare(self, sql):
+        """
+        Return a server-side prepared statement for a query.
+
+        Statements use ``?`` placeholders for parameters. They are cached
+        by query text, and the least recently used statement is closed
+        once more than ``max_prepared_statements`` are open.
+
+        Internal use only.
+
+        """
+        stmt = self._prepared_statements.get(sql)
+        if stmt is not None:
+            self._prepared_statements.move_to_end(sql)
+            return stmt
+
+        while len(self._prepared_statements) >= self.max_prepared_statements:
+            _, old_stmt = self._prepared_statements.popitem(last=False)
+            self._close_statement(old_stmt)
+
+        data = sql.encode(self.encoding, 'surrogateescape') \
+            if isinstance(sql, str) else sql
+        self._execute_command(COMMAND.COM_STMT_PREPARE, data)
+        stmt = PreparedStatement.read(self)
+        self._prepared_statements[sql] = stmt
+        return stmt
+
+    def _close_statement(self, stmt):
+        """Deallocate a prepared statement (the server does not reply)."""
+        self._execute_command(
+            COMMAND.COM_STMT_CLOSE, struct.pack('<I', stmt.statement_id),
+        )
+
+    def query_prepared(self, sql, params, unbuffered=False):
+        """
+        Run a query as a server-side prepared statement.
+
+        Returns None without running the query if a parameter can not be
+        sent in the binary protocol, if the number of parameters does not
+        match the statement, or if the statement can not be prepared.
+
+        Internal use only.
+
+        """
+        params = _encode_binary_params(params, self.encoding)
+        if params is None:
+            return None
+
+        try:
+            stmt = self.prepare(sql)
+        except err.DatabaseError as exc:
+            if exc.args[0] == ER.UNSUPPORTED_PS:
+                return None
+            raise
+
+        if stmt.num_params != len(params):
+            return None
+
+        self._execute_command(COMMAND.COM_STMT_EXECUTE, stmt.execute_packet(params))
+        self._affected_rows = self._read_query_result(
+            unbuffered=unbuffered, binary=True,
+        )
         return self._affected_rows
 
     def affected_rows(self):
@@ -975,12 +1445,23 @@ class Connection(BaseConnection):
                 sock.settimeout(None)
 
             self._sock = sock
-            self._rfile = sock.makefile('rb')
+            self._rfile = self._make_rfile(sock)
+            # The native reader also sends data on plain sockets.
+            self._writer = self._rfile \
+                if isinstance(sock, socket.socket) and \
+                _singlestoredb_accel is not None and \
+                isinstance(self._rfile, _singlestoredb_accel.SocketReader) else None
             self._next_seq_id = 0
+            self._compression = None
+            self._prepared_statements = collections.OrderedDict()
 
             self._get_server_information()
             self._request_authentication()
 
+            if self.read_engine is not None and self._writer is not None and \
+                    not (self.ssl and self.server_capabilities & CLIENT.SSL):
+                self.read_engine.register(self._writer)
+
             # Send "SET NAMES" query on init for:
             # - Ensure charaset (and collation) is set to the server.
             #   - collation_id in handshake packet may be ignored.
@@ -1034,6 +1515,80 @@ class Connection(BaseConnection):
             # So just reraise it.
             raise
 
+    def _make_rfile(self, sock):
+        """
+        Create the buffered reader for incoming data on `sock`.
+
+        When the C extension is in use, plain sockets are read by its native
+        reader, which allows result rows to be parsed straight out of its
+        buffer. SSL sockets have to go through the Python ``ssl`` layer.
+
+        """
+        if self.resultclass is MySQLResultSV and \
+                not (SSL_ENABLED and isinstance(sock, ssl.SSLSocket)):
+            return _singlestoredb_accel.SocketReader(sock, self._read_timeout)
+        return sock.makefile('rb')
+
+    def _start_tls(self):
+        """Switch the connection to TLS after the SSL request was sent."""
+        if self._uses_native_tls():
+            # Outgoing data is now encrypted by the reader as well.
+            self._rfile.start_tls(self.host, **self._tls_options)
+        else:
+            self._sock = self.ctx.wrap_socket(self._sock, server_hostname=self.host)
+            self._rfile = self._make_rfile(self._sock)
+            self._writer = None
+        self._secure = True
+
+    def _uses_native_tls(self):
+        """Return True if TLS is run by the native socket reader."""
+        return self._tls_options is not None and \
+            isinstance(self._rfile, _singlestoredb_accel.SocketReader)
+
+    def _compression_algorithms(self):
+        """Return the compression algorithms that incoming data can be read with."""
+        algorithms = list(_compress.python_algorithms())
+        if self.resultclass is MySQLResultSV and \
+                (self._uses_native_tls() or
+                 not (self.ssl and self.server_capabilities & CLIENT.SSL)):
+            algorithms += _compress.native_algorithms()
+        return algorithms
+
+    def _negotiate_compression(self):
+        """
+        Choose the compression algorithm to request in the handshake.
+
+        Returns
+        -------
+        str or None
+
+        """
+        if not self.compress:
+            return None
+
+        algorithms = self._compression_algorithms()
+
+        if self.server_capabilities & CLIENT.ZSTD_COMPRESSION_ALGORITHM and \
+                self.compress in ('auto', _compress.ZSTD) and \
+                _compress.ZSTD in algorithms:
+            return _compress.ZSTD
+
+        if self.server_capabilities & CLIENT.COMPRESS and \
+                self.compress in ('auto', _compress.ZLIB) and \
+                _compress.ZLIB in algorithms:
+            return _compress.ZLIB
+
+        return None
+
+    def _enable_compression(self, algorithm):
+        """Switch both directions of the connection to compressed frames."""
+        if algorithm in _compress.native_algorithms() and \
+                isinstance(self._rfile, _singlestoredb_accel.SocketReader):
+            self._rfile.set_compression(algorithm)
+        else:
+            self._rfile = _compress.CompressedReader(self._rfile, algorithm)
+        self._compression = algorithm
+
     def write_packet(self, payload):
         """
         Writes an entire "mysql packet" in its entirety to the network.
@@ -1070,7 +1625,8 @@ class Connection(BaseConnection):
 
             btrl, btrh, packet_number = struct.unpack('<HBB', packet_header)
             bytes_to_read = btrl + (btrh << 16)
-            if packet_number != self._next_seq_id:
+            # Packets in compressed frames are not numbered contiguously.
+            if packet_number != self._next_seq_id and not self._compression:
                 self._force_close()
                 if packet_number == 0:
                     # MariaDB sends error packet with seqno==0 when shutdown
@@ -1082,7 +1638,7 @@ class Connection(BaseConnection):
                     'Packet sequence number wrong - got %d expected %d'
                     % (packet_number, self._next_seq_id),
                 )
-            self._next_seq_id = (self._next_seq_id + 1) % 256
+            self._next_seq_id = (packet_number + 1) % 256
 
             recv_data = self._read_bytes(bytes_to_read)
             if DEBUG:
@@ -1128,22 +1684,35 @@ class Connection(BaseConnection):
         return data
 
     def _write_bytes(self, data):
-        if self._write_timeout is not None:
-            self._sock.settimeout(self._write_timeout)
+        if self._compression:
+            data, self._rfile.compressed_seq_id = _compress.compress_frames(
+                data, self._rfile.compressed_seq_id, self._compression,
+            )
+        self._sendall(data)
+
+    def _sendall(self, data):
         try:
-            self._sock.sendall(data)
+            if self._writer is not None:
+                self._writer.sendall(data, self._write_timeout)
+            else:
+                if self._write_timeout is not None:
+                    self._sock.settimeout(self._write_timeout)
+                self._sock.sendall(data)
         except OSError as e:
-            self._force_close()
-            raise err.OperationalError(
-                CR.CR_SERVER_GONE_ERROR, f'MySQL server has gone away ({e!r})',
-            )
+            self._server_gone(e)
 
-    def _read_query_result(self, unbuffered=False):
+    def _server_gone(self, e):
+        self._force_close()
+        raise err.OperationalError(
+            CR.CR_SERVER_GONE_ERROR, f'MySQL server has gone away ({e!r})',
+        )
+
+    def _read_query_result(self, unbuffered=False, binary=False):
         self._result = None
         if unbuffered:
-            result = self.resultclass(self, unbuffered=unbuffered)
+            result = self.resultclass(self, unbuffered=unbuffered, binary=binary)
         else:
-            result = self.resultclass(self)
+            result = self.resultclass(self, binary=binary)
             result.read()
         self._result = result
         if result.server_status is not None:
@@ -1166,6 +1735,64 @@ class Connection(BaseConnection):
         ValueError : If no username was specified.
 
         """
+        self._start_command()
+
+        if isinstance(sql, str):
+            sql = sql.encode(self.encoding)
+
+        # The native writer frames the packets itself and sends them
+        # straight from `sql`, which may be any bytes-like object.
+        if self._writer is not None and not self._compression and not DEBUG:
+            try:
+                self._next_seq_id = self._writer.send_command(
+                    command, sql, self._write_timeout,
+                )
+            except OSError as e:
+                self._server_gone(e)
+            return
+
+        packet, next_seq_id = _pack_command(command, sql)
+        if self._compression:
+            self._rfile.compressed_seq_id = 0
+        self._write_bytes(packet)
+        if DEBUG:
+            dump_packet(packet)
+        self._next_seq_id = next_seq_id
+
+    def _execute_pipeline(self, queries):
+        """
+        Send queries back to back without reading their results.
+
+        Returns
+        -------
+        List[int]
+            The sequence number that the result of each query starts with
+
+        Raises
+        ------
+        InterfaceError : If the connection is closed.
+
+        """
+        self._start_command()
+
+        data = []
+        seq_ids = []
+        for sql in queries:
+            if isinstance(sql, str):
+                sql = sql.encode(self.encoding, 'surrogateescape')
+            packet, next_seq_id = _pack_command(COMMAND.COM_QUERY, sql)
+            # Queries of 16MB or more take several packets.
+            seq_ids.append(next_seq_id)
+            # Every command starts a new sequence of compressed frames.
+            if self._compression:
+                packet, _ = _compress.compress_frames(packet, 0, self._compression)
+            data.append(packet)
+
+        self._sendall(b''.join(data))
+        return seq_ids
+
+    def _start_command(self):
+        """Make sure the connection is ready for a new command."""
         self._sync_connection()
 
         if self._sock is None:
@@ -1181,31 +1808,6 @@ class Connection(BaseConnection):
                 self.next_result()
             self._result = None
 
-        if isinstance(sql, str):
-            sql = sql.encode(self.encoding)
-
-        packet_size = min(MAX_PACKET_LEN, len(sql) + 1)  # +1 is for command
-
-        # tiny optimization: build first packet manually instead of
-        # calling self..write_packet()
-        prelude = struct.pack('<iB', packet_size, command)
-        packet = prelude + sql[: packet_size - 1]
-        self._write_bytes(packet)
-        if DEBUG:
-            dump_packet(packet)
-        self._next_seq_id = 1
-
-        if packet_size < MAX_PACKET_LEN:
-            return
-
-        sql = sql[packet_size - 1:]
-        while True:
-            packet_size = min(MAX_PACKET_LEN, len(sql))
-            self.write_packet(sql[:packet_size])
-            sql = sql[packet_size:]
-            if not sql and packet_size < MAX_PACKET_LEN:
-                break
-
     def _request_authentication(self):  # noqa: C901
         # https://dev.mysql.com/doc/internals/en/connection-phase-packets.html#packet-Protocol::HandshakeResponse
         if int(self.server_version.split('.', 1)[0]) >= 5:
@@ -1218,16 +1820,20 @@ class Connection(BaseConnection):
         if isinstance(self.user, str):
             self.user = self.user.encode(self.encoding)
 
+        compress = self._negotiate_compression()
+        self.client_flag &= ~(CLIENT.COMPRESS | CLIENT.ZSTD_COMPRESSION_ALGORITHM)
+        if compress == _compress.ZLIB:
+            self.client_flag |= CLIENT.COMPRESS
+        elif compress == _compress.ZSTD:
+            self.client_flag |= CLIENT.ZSTD_COMPRESSION_ALGORITHM
+
         data_init = struct.pack(
             '<iIB23s', self.client_flag, MAX_PACKET_LEN, charset_id, b'',
         )
 
         if self.ssl and self.server_capabilities & CLIENT.SSL:
             self.write_packet(data_init)
-
-            self._sock = self.ctx.wrap_socket(self._sock, server_hostname=self.host)
-            self._rfile = self._sock.makefile('rb')
-            self._secure = True
+            self._start_tls()
 
         data = data_init + self.user + b'\0'
 
@@ -1283,6 +1889,9 @@ class Connection(BaseConnection):
                 connect_attrs += _lenenc_int(len(v)) + v
             data += _lenenc_int(len(connect_attrs)) + connect_attrs
 
+        if compress == _compress.ZSTD:
+            data += struct.pack('B', _compress.ZSTD_LEVEL)
+
         self.write_packet(data)
         auth_packet = self._read_packet()
 
@@ -1317,6 +1926,9 @@ class Connection(BaseConnection):
         if DEBUG:
             print('Succeed to auth')
 
+        if compress:
+            self._enable_compression(compress)
+
     def _process_auth(self, plugin_name, auth_packet):
         handler = self._get_auth_plugin_handler(plugin_name)
         if handler:
@@ -1520,10 +2132,12 @@ class MySQLResult:
         The connection the result came from.
     unbuffered : bool, optional
         Should the reads be unbuffered?
+    binary : bool, optional
+        Are the rows in the binary protocol of prepared statements?
 
     """
 
-    def __init__(self, connection, unbuffered=False):
+    def __init__(self, connection, unbuffered=False, binary=False):
         self.connection = connection
         self.affected_rows = None
         self.insert_id = None
@@ -1537,6 +2151,7 @@ class MySQLResult:
         self.unbuffered_active = False
         self.converters = []
         self.fields = []
+        self.binary = binary
         self.encoding_errors = self.connection.encoding_errors
         if unbuffered:
             try:
@@ -1698,6 +2313,8 @@ class MySQLResult:
         self.rows = tuple(rows)
 
     def _read_row_from_packet(self, packet):
+        if self.binary:
+            return self._read_binary_row_from_packet(packet)
         row = []
         for encoding, converter in self.converters:
             try:
@@ -1716,17 +2333,49 @@ class MySQLResult:
             row.append(data)
         return tuple(row)
 
+    def _read_binary_row_from_packet(self, packet):
+        # Binary rows start with a 0x00 header and a NULL bitmap whose
+        # first two bits are unused.
+        packet.advance(1)
+        null_bitmap = packet.read((self.field_count + 9) // 8)
+        row = []
+        for i, (encoding, converter) in enumerate(self.converters):
+            bit = i + 2
+            if null_bitmap[bit >> 3] & (1 << (bit & 7)):
+                row.append(None)
+                continue
+            field = self.fields[i]
+            data = packet.read_binary_value(field.type_code, field.flags)
+            if encoding is not None:
+                data = data.decode(encoding, errors=self.encoding_errors)
+            if converter is not None:
+                data = converter(data)
+            row.append(data)
+        return tuple(row)
+
     def _get_descriptions(self):
         """Read a column descriptor packet for each column in the result."""
-        self.fields = []
+        fields = []
+        for i in range(self.field_count):
+            fields.append(self.connection._read_packet(FieldDescriptorPacket))
+
+        eof_packet = self.connection._read_packet()
+        assert eof_packet.is_eof_packet(), 'Protocol error, expecting EOF'
+
+        self._set_descriptions(
+            fields,
+            self.connection.use_unicode,
+            self.connection.encoding,
+            self.connection.decoders,
+        )
+
+    def _set_descriptions(self, fields, use_unicode, conn_encoding, decoders):
+        """Set the description and converters of the given column fields."""
+        self.fields = fields
         self.converters = []
-        use_unicode = self.connection.use_unicode
-        conn_encoding = self.connection.encoding
         description = []
 
-        for i in range(self.field_count):
-            field = self.connection._read_packet(FieldDescriptorPacket)
-            self.fields.append(field)
+        for field in fields:
             description.append(field.description())
             field_type = field.type_code
             if use_unicode:
@@ -1748,31 +2397,72 @@ class MySQLResult:
                     encoding = 'ascii'
             else:
                 encoding = None
-            converter = self.connection.decoders.get(field_type)
+            converter = decoders.get(field_type)
             if converter is converters.through:
                 converter = None
+            elif field_type in DECIMAL_TYPES:
+                converter = self._get_decimal_converter(field, converter)
             if DEBUG:
                 print(f'DEBUG: field={field}, converter={converter}')
             self.converters.append((encoding, converter))
 
-        eof_packet = self.connection._read_packet()
-        assert eof_packet.is_eof_packet(), 'Protocol error, expecting EOF'
         self.description = tuple(description)
 
+    def _get_decimal_converter(self, field, converter):
+        """Return the converter for a DECIMAL field based on ``decimal_type``."""
+        if converter is not converters.decoders.get(field.type_code):
+            return converter
+        return get_decimal_converter(self.connection.decimal_type, field.scale)
+
+
+def _column_attribute(name):
+    """
+    Attribute of :class:`MySQLResultSV` that is derived from the column
+    definitions, which are only turned into Python objects when needed.
+
+    """
+    key = '_' + name
+
+    def fget(self):
+        self._load_descriptions()
+        return getattr(self, key)
+
+    def fset(self, value):
+        setattr(self, key, value)
+
+    return property(fget, fset)
+
 
 class MySQLResultSV(MySQLResult):
 
-    def __init__(self, connection, unbuffered=False):
-        MySQLResult.__init__(self, connection, unbuffered=unbuffered)
+    fields = _column_attribute('fields')
+    converters = _column_attribute('converters')
+    description = _column_attribute('description')
+
+    _pending_descriptions = None
+
+    def __init__(self, connection, unbuffered=False, binary=False):
         self.options = {
             k: v for k, v in dict(
                 default_converters=converters.decoders,
+                converters={
+                    k: v for k, v in connection.decoders.items()
+                    if v is not converters.through
+                },
+                encoding=connection.encoding,
+                use_unicode=connection.use_unicode,
                 results_type=connection.results_type,
                 parse_json=connection.parse_json,
                 invalid_values=connection.invalid_values,
+                decimal_type=connection.decimal_type,
+                intern_strings=connection.intern_strings,
+                read_ahead=connection.read_ahead,
+                decode_on_fetch=connection.decode_on_fetch,
                 unbuffered=unbuffered,
+                binary=binary,
             ).items() if v is not UNSET
         }
+        MySQLResult.__init__(self, connection, unbuffered=unbuffered, binary=binary)
         self._read_rowdata_packet = functools.partial(
             _singlestoredb_accel.read_rowdata_packet, self, False,
         )
@@ -1780,6 +2470,334 @@ class MySQLResultSV(MySQLResult):
             _singlestoredb_accel.read_rowdata_packet, self, True,
         )
 
+    def _get_descriptions(self):
+        # The C extension parses the column definitions straight into its
+        # state and leaves the packets in ``_column_definitions``; fields,
+        # converters, and description are built from them on demand.
+        conn = self.connection
+        self._state = _singlestoredb_accel.State(self, 0)
+        self._pending_descriptions = (conn.use_unicode, conn.encoding, conn.decoders)
+
+    def _load_descriptions(self):
+        if self._pending_descriptions is None:
+            return
+        use_unicode, encoding, decoders = self._pending_descriptions
+        self._pending_descriptions = None
+
+        # Each packet is preceded by its 4 byte length.
+        data = self._column_definitions
+        self._column_definitions = None
+        fields = []
+        pos = 0
+        while pos < len(data):
+            length, = struct.unpack_from('<I', data, pos)
+            pos += 4
+            fields.append(FieldDescriptorPacket(data[pos:pos + length], encoding))
+            pos += length
+
+        self._set_descriptions(fields, use_unicode, encoding, decoders)
+
+    def _get_decimal_converter(self, field, converter):
+        # DECIMAL values are decoded natively by the C extension.
+        return converter
+
+    def _finish_unbuffered_query(self):
+        # Once rows are being read ahead, the rest of the packets have to
+        # come from the C extension rather than from the socket.
+        if getattr(self, '_state', None) is None:
+            return MySQLResult._finish_unbuffered_query(self)
+
+        while self.unbuffered_active and self.connection._sock is not None:
+            try:
+                self._read_rowdata_packet_unbuffered(1000)
+            except err.OperationalError as e:
+                if e.args[0] in (
+                    ER.QUERY_TIMEOUT,
+                    ER.STATEMENT_TIMEOUT,
+                ):
+                    # if the query timed out we can simply ignore this error
+                    self.unbuffered_active = False
+                    self.connection = None
+                    return
+
+                raise
+
+
+class PreparedStatement:
+    """
+    Server-side prepared statement.
+
+    Parameters
+    ----------
+    statement_id : int
+        The statement ID assigned by the server
+    num_params : int
+        The number of ``?`` placeholders in the statement
+    num_columns : int
+        The number of columns in the result of the statement
+
+    """
+
+    def __init__(self, statement_id, num_params, num_columns):
+        self.statement_id = statement_id
+        self.num_params = num_params
+        self.num_columns = num_columns
+
+    @classmethod
+    def read(cls, connection):
+        """Read the response to a COM_STMT_PREPARE command."""
+        packet = connection._read_packet()
+        packet.advance(1)
+        statement_id, num_columns, num_params = packet.read_struct('<IHH')
+
+        # Parameter and column definitions are each followed by an EOF packet.
+        for count in (num_params, num_columns):
+            if not count:
+                continue
+            for _ in range(count):
+                connection._read_packet(FieldDescriptorPacket)
+            eof_packet = connection._read_packet()
+            assert eof_packet.is_eof_packet(), 'Protocol error, expecting EOF'
+
+        return cls(statement_id, num_params, num_columns)
+
+    def execute_packet(self, params):
+        """
+        Return the payload of a COM_STMT_EXECUTE command.
+
+        Parameters
+        ----------
+        params : List[Tuple[bytes, Optional[bytes]]]
+            The parameter types and values from ``_encode_binary_params``
+
+        """
+        # No cursor, one iteration
+        out = [struct.pack('<IBI', self.statement_id, 0, 1)]
+        if params:
+            null_bitmap = bytearray((len(params) + 7) // 8)
+            for i, (_, value) in enumerate(params):
+                if value is None:
+                    null_bitmap[i >> 3] |= 1 << (i & 7)
+            out.append(bytes(null_bitmap))
+            # Parameter types are always sent
+            out.append(b'\x01')
+            out.extend(param_type for param_type, _ in params)
+            out.extend(value for _, value in params if value is not None)
+        return b''.join(out)
+
+
+def _binary_param_type(type_code, unsigned=False):
+    return struct.pack('<BB', type_code, 0x80 if unsigned else 0)
+
+
+def _encode_binary_params(params, encoding):
+    """
+    Encode query parameters in the binary protocol.
+
+    Returns a list of ``(type, value)`` tuples, where ``value`` is None for
+    NULL, or None if a parameter can not be encoded. Those parameters are
+    left to the text protocol, which applies the connection's encoders.
+
+    """
+    out = []
+    for value in params:
+        if value is None:
+            out.append((_binary_param_type(FIELD_TYPE.NULL), None))
+        elif isinstance(value, bool):
+            out.append((_binary_param_type(FIELD_TYPE.TINY), struct.pack('<b', value)))
+        elif isinstance(value, numbers.Integral):
+            value = int(value)
+            if -(1 << 63) <= value < (1 << 63):
+                out.append((
+                    _binary_param_type(FIELD_TYPE.LONGLONG),
+                    struct.pack('<q', value),
+                ))
+            elif 0 <= value < (1 << 64):
+                out.append((
+                    _binary_param_type(FIELD_TYPE.LONGLONG, unsigned=True),
+                    struct.pack('<Q', value),
+                ))
+            else:
+                data = str(value).encode('ascii')
+                out.append((
+                    _binary_param_type(FIELD_TYPE.NEWDECIMAL),
+                    _lenenc_int(len(data)) + data,
+                ))
+        elif isinstance(value, numbers.Real):
+            value = float(value)
+            # NaN and infinity are handled by the text protocol encoders.
+            if value != value or value in (float('inf'), float('-inf')):
+                return None
+            out.append((_binary_param_type(FIELD_TYPE.DOUBLE), struct.pack('<d', value)))
+        elif isinstance(value, str):
+            data = value.encode(encoding, 'surrogateescape')
+            out.append((
+                _binary_param_type(FIELD_TYPE.VAR_STRING),
+                _lenenc_int(len(data)) + data,
+            ))
+        elif isinstance(value, (bytes, bytearray, memoryview)):
+            data = bytes(value)
+            out.append((
+                _binary_param_type(FIELD_TYPE.BLOB),
+                _lenenc_int(len(data)) + data,
+            ))
+        elif isinstance(value, decimal.Decimal):
+            data = format(value, 'f').encode('ascii')
+            out.append((
+                _binary_param_type(FIELD_TYPE.NEWDECIMAL),
+                _lenenc_int(len(data)) + data,
+            ))
+        elif isinstance(value, datetime.datetime):
+            out.append((
+                _binary_param_type(FIELD_TYPE.DATETIME),
+                struct.pack(
+                    '<BHBBBBBI', 11, value.year, value.month, value.day,
+                    value.hour, value.minute, value.second, value.microsecond,
+                ),
+            ))
+        elif isinstance(value, datetime.date):
+            out.append((
+                _binary_param_type(FIELD_TYPE.DATE),
+                struct.pack('<BHBB', 4, value.year, value.month, value.day),
+            ))
+        elif isinstance(value, datetime.timedelta):
+            negative = value < datetime.timedelta(0)
+            if negative:
+                value = -value
+            out.append((
+                _binary_param_type(FIELD_TYPE.TIME),
+                struct.pack(
+                    '<BBIBBBI', 12, negative, value.days, value.seconds // 3600,
+                    value.seconds // 60 % 60, value.seconds % 60,
+                    value.microseconds,
+                ),
+            ))
+        elif isinstance(value, datetime.time):
+            out.append((
+                _binary_param_type(FIELD_TYPE.TIME),
+                struct.pack(
+                    '<BBIBBBI', 12, 0, 0, value.hour, value.minute,
+                    value.second, value.microsecond,
+                ),
+            ))
+        else:
+            return None
+    return out
+
+
+class Pipeline:
+    """
+    Queries that are sent to the server together.
+
+    Queries are queued by :meth:`execute` and sent when the pipeline is
+    flushed, either explicitly or at the end of a ``with`` block. The
+    results are read in order into the cursors returned by :meth:`execute`.
+    Unbuffered cursor classes are replaced by their buffered counterparts,
+    and only the first result set of each query is kept.
+
+    If a query fails, the results of the other queries are still read and
+    the first error is raised once all of them have been read.
+
+    Parameters
+    ----------
+    connection : Connection
+        The connection to send the queries on
+
+    """
+
+    def __init__(self, connection):
+        self.connection = connection
+        self._queue = []
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        # Nothing has been sent yet, so a failed block sends nothing.
+        if exc_type is not None:
+            self._queue = []
+            return
+        self.flush()
+
+    def __len__(self):
+        return len(self._queue)
+
+    def execute(self, query, args=None):
+        """
+        Queue a query.
+
+        Parameters
+        ----------
+        query : str
+            Query to execute
+        args : Sequence[Any] or Dict[str, Any] or Any, optional
+            Parameters used with query
+
+        Returns
+        -------
+        Cursor
+            The cursor that holds the results once the pipeline is flushed
+
+        """
+        conn = self.connection
+        cursorclass = _buffered_cursors.get(conn.cursorclass, conn.cursorclass)
+        cur = cursorclass(conn)
+        query = cur.mogrify(query, args)
+        if fusion.get_handler(query) is not None:
+            raise err.NotSupportedError(
+                0, 'Management commands can not be run in a pipeline',
+            )
+        if RE_LOAD_LOCAL.match(query):
+            raise err.NotSupportedError(
+                0, 'LOAD DATA LOCAL can not be run in a pipeline',
+            )
+        log_query(query, args)
+        self._queue.append((cur, query))
+        return cur
+
+    def flush(self):
+        """Send the queued queries and read their results."""
+        conn = self.connection
+        queue, self._queue = self._queue, []
+        error = None
+
+        sqls = [query.encode(conn.encoding, 'surrogateescape') for _, query in queue]
+
+        pos = 0
+        while pos < len(queue):
+            # A query that does not fit in the window on its own is sent
+            # alone, and its results are read before anything else is sent.
+            start = pos
+            size = len(sqls[pos])
+            pos += 1
+            while pos < len(queue) and size + len(sqls[pos]) <= PIPELINE_WINDOW:
+                size += len(sqls[pos])
+                pos += 1
+
+            seq_ids = conn._execute_pipeline(sqls[start:pos])
+
+            for (cur, query), seq_id in zip(queue[start:pos], seq_ids):
+                conn._next_seq_id = seq_id
+                try:
+                    conn._read_query_result()
+                except err.Error as exc:
+                    # Errors from the server leave the connection usable.
+                    if conn._sock is None:
+                        raise
+                    if error is None:
+                        error = exc
+                    continue
+
+                cur._clear_result()
+                cur._do_get_result()
+                cur._executed = query
+
+                while conn._result.has_next:
+                    conn.next_result()
+
+        if error is not None:
+            raise error
+
 
 class LoadLocalFile:
 
@@ -5,6 +5,11 @@ from collections import namedtuple
 from . import err
 from ..connection import Cursor as BaseCursor
 from ..utils.debug import log_query
+from ..utils.results import ArrowResults
+from ..utils.results import ColumnarResults
+from ..utils.results import NumpyResults
+from ..utils.results import PandasResults
+from ..utils.results import PolarsResults
 
 
 #: Regular expression for :meth:`Cursor.executemany`.
@@ -17,6 +22,46 @@ RE_INSERT_VALUES = re.compile(
     re.IGNORECASE | re.DOTALL,
 )
 
+#: Regular expression for the placeholders of pyformat queries.
+RE_PYFORMAT = re.compile(r'%(?:\(([^)]*)\))?([s%])')
+
+
+def _pyformat_to_qmark(query, args):
+    """
+    Convert a pyformat query to one with ``?`` placeholders.
+
+    Returns the query and the parameters in placeholder order, or None if
+    the placeholders do not match the arguments.
+
+    """
+    named = isinstance(args, dict)
+    if not named and not isinstance(args, (tuple, list)):
+        return None
+
+    params = []
+    positional = iter(args)
+
+    def replace(m):
+        name, conv = m.groups()
+        if conv == '%':
+            if name is not None:
+                raise ValueError(name)
+            return '%'
+        if named != (name is not None):
+            raise ValueError(name)
+        params.append(args[name] if named else next(positional))
+        return '?'
+
+    try:
+        query = RE_PYFORMAT.sub(replace, query)
+    except (KeyError, StopIteration, ValueError):
+        return None
+
+    if not named and len(params) != len(args):
+        return None
+
+    return query, params
+
 
 class Cursor(BaseCursor):
     """
@@ -60,6 +105,9 @@ class Cursor(BaseCursor):
 
     @property
     def description(self):
+        # Results of the C extension build their description on first access.
+        if self._description is None and self._result is not None:
+            self._description = self._result.description
         return self._description
 
     @property
@@ -196,6 +244,14 @@ class Cursor(BaseCursor):
 
         log_query(query, args)
 
+        if args and self._get_db().server_side_prepare:
+            prepared = _pyformat_to_qmark(query, args)
+            if prepared is not None:
+                result = self._query_prepared(*prepared)
+                if result is not None:
+                    self._executed = query
+                    return result
+
         query = self.mogrify(query, args)
 
         result = self._query(query)
@@ -268,12 +324,14 @@ class Cursor(BaseCursor):
             if type(v) is str or isinstance(v, str):
                 v = v.encode(encoding, 'surrogateescape')
             if len(sql) + len(v) + len(postfix) + 1 > max_stmt_length:
-                rows += self.execute(sql + postfix)
+                sql += postfix
+                rows += self.execute(sql)
                 sql = bytearray(prefix)
             else:
                 sql += b','
             sql += v
-        rows += self.execute(sql + postfix)
+        sql += postfix
+        rows += self.execute(sql)
         self.rowcount = rows
         return rows
 
@@ -360,7 +418,8 @@ class Cursor(BaseCursor):
         self._check_executed()
         if self._rows is None:
             return ()
-        if self._rownumber:
+        # Rows kept undecoded by the C extension are decoded by slicing.
+        if self._rownumber or not isinstance(self._rows, (list, tuple)):
             result = self._rows[self._rownumber:]
         else:
             result = self._rows
@@ -387,6 +446,14 @@ class Cursor(BaseCursor):
         self._do_get_result()
         return self.rowcount
 
+    def _query_prepared(self, q, params):
+        conn = self._get_db()
+        self._clear_result()
+        if conn.query_prepared(q, params) is None:
+            return None
+        self._do_get_result()
+        return self.rowcount
+
     def _clear_result(self):
         self._rownumber = 0
         self._result = None
@@ -408,7 +475,7 @@ class Cursor(BaseCursor):
         # the DB-API requires this value to be -1. This happens in unbuffered mode.
         if self.rowcount == 18446744073709551615:
             self.rowcount = -1
-        self._description = result.description
+        self._description = None
         self.lastrowid = result.insert_id
         self._rows = result.rows
 
@@ -447,7 +514,7 @@ class DictCursorMixin:
     def _do_get_result(self):
         super(DictCursorMixin, self)._do_get_result()
         fields = []
-        if self._description:
+        if self.description:
             for f in self._result.fields:
                 name = f.name
                 if name in fields:
@@ -477,7 +544,7 @@ class NamedtupleCursorMixin:
     def _do_get_result(self):
         super(NamedtupleCursorMixin, self)._do_get_result()
         fields = []
-        if self._description:
+        if self.description:
             for f in self._result.fields:
                 name = f.name
                 if name in fields:
@@ -503,6 +570,175 @@ class NamedtupleCursorSV(Cursor):
     """A cursor which returns results as a named tuple for C extension."""
 
 
+class ColumnarCursorMixin:
+    """
+    Mixin which returns each fetch as a columnar results object.
+
+    The type of the results object is defined by the `_columns` attribute.
+    Iterating over the cursor still produces a tuple for each row.
+
+    """
+
+    _columns = ColumnarResults
+
+    def _do_get_result(self):
+        super(ColumnarCursorMixin, self)._do_get_result()
+        self._columnar_description = None
+        if self.description:
+            fields = []
+            for f in self._result.fields:
+                name = f.name
+                if name in fields:
+                    name = f.table_name + '.' + name
+                fields.append(name)
+            self._columnar_description = [
+                d._replace(name=name) for d, name in zip(self.description, fields)
+            ]
+
+    def fetchone(self):
+        """Fetch the next row."""
+        return self._columns.from_rows(
+            self._columnar_description,
+            super(ColumnarCursorMixin, self).fetchone(), single=True,
+        )
+
+    def fetchmany(self, size=None):
+        """Fetch several rows."""
+        return self._columns.from_rows(
+            self._columnar_description,
+            super(ColumnarCursorMixin, self).fetchmany(size),
+        )
+
+    def fetchall(self):
+        """Fetch all the rows."""
+        return self._columns.from_rows(
+            self._columnar_description,
+            super(ColumnarCursorMixin, self).fetchall(),
+        )
+
+
+class ColumnarCursorSV(CursorSV):
+    """
+    A cursor which returns columnar results for C extension.
+
+    The C extension decodes the entire result directly into column
+    buffers, which are wrapped in the results object defined by the
+    `_columns` attribute and sliced for each fetch.
+
+    """
+
+    _columns = ColumnarResults
+
+    def _do_get_result(self):
+        super(ColumnarCursorSV, self)._do_get_result()
+        if self._rows is not None:
+            self._rows = self._columns.from_accel(self._rows)
+
+    def _num_rows(self):
+        return self._columns.num_rows(self._rows)
+
+    def _unchecked_fetchone(self):
+        """Fetch the next row as a tuple."""
+        if self._rows is None or self._rownumber >= self._num_rows():
+            return None
+        result = self._columns.row(self._rows, self._rownumber)
+        self._rownumber += 1
+        return result
+
+    def fetchone(self):
+        """Fetch the next row."""
+        self._check_executed()
+        if self._rows is None or self._rownumber >= self._num_rows():
+            return None
+        result = self._columns.slice(self._rows, self._rownumber, self._rownumber + 1)
+        self._rownumber += 1
+        return result
+
+    def fetchmany(self, size=None):
+        """Fetch several rows."""
+        self._check_executed()
+        if self._rows is None:
+            self.warning_count = self._result.warning_count
+            return ()
+        end = self._rownumber + (size or self.arraysize)
+        result = self._columns.slice(self._rows, self._rownumber, end)
+        self._rownumber = min(end, self._num_rows())
+        return result
+
+    def fetchall(self):
+        """Fetch all the rows."""
+        self._check_executed()
+        if self._rows is None:
+            return ()
+        if self._rownumber:
+            result = self._columns.slice(self._rows, self._rownumber)
+        else:
+            result = self._rows
+        self._rownumber = self._num_rows()
+        return result
+
+    def scroll(self, value, mode='relative'):
+        self._check_executed()
+        if mode == 'relative':
+            r = self._rownumber + value
+        elif mode == 'absolute':
+            r = value
+        else:
+            raise err.ProgrammingError('unknown scroll mode %s' % mode)
+
+        if not (0 <= r < self._num_rows()):
+            raise IndexError('out of range')
+        self._rownumber = r
+
+
+class NumpyCursor(ColumnarCursorMixin, Cursor):
+    """A cursor which returns results as numpy arrays."""
+
+    _columns = NumpyResults
+
+
+class NumpyCursorSV(ColumnarCursorSV):
+    """A cursor which returns results as numpy arrays for C extension."""
+
+    _columns = NumpyResults
+
+
+class PandasCursor(ColumnarCursorMixin, Cursor):
+    """A cursor which returns results as a pandas DataFrame."""
+
+    _columns = PandasResults
+
+
+class PandasCursorSV(ColumnarCursorSV):
+    """A cursor which returns results as a pandas DataFrame for C extension."""
+
+    _columns = PandasResults
+
+
+class ArrowCursor(ColumnarCursorMixin, Cursor):
+    """A cursor which returns results as a pyarrow Table."""
+
+    _columns = ArrowResults
+
+
+class ArrowCursorSV(ColumnarCursorSV):
+    """A cursor which returns results as a pyarrow Table for C extension."""
+
+    _columns = ArrowResults
+
+
+class PolarsCursor(ColumnarCursorMixin, Cursor):
+    """A cursor which returns results as a polars DataFrame."""
+
+    _columns = PolarsResults
+
+
+class PolarsCursorSV(ColumnarCursorSV):
+    """A cursor which returns results as a polars DataFrame for C extension."""
+
+    _columns = PolarsResults
+
+
 class SSCursor(Cursor):
     """
     Unbuffered Cursor, mainly useful for queries that return a lot of data,
@@ -546,6 +782,14 @@ class SSCursor(Cursor):
         self._do_get_result()
         return self.rowcount
 
+    def _query_prepared(self, q, params):
+        conn = self._get_db()
+        self._clear_result()
+        if conn.query_prepared(q, params, unbuffered=True) is None:
+            return None
+        self._do_get_result()
+        return self.rowcount
+
     def nextset(self):
         return self._nextset(unbuffered=True)
 
@@ -711,3 +955,103 @@ class SSNamedtupleCursor(NamedtupleCursorMixin, SSCursor):
 
 class SSNamedtupleCursorSV(SSCursorSV):
     """An unbuffered cursor for the C extension, which returns results as a named tuple"""
+
+
+class SSColumnarCursorSV(SSCursorSV):
+    """
+    An unbuffered cursor for the C extension, which returns columnar results
+
+    Each fetch is decoded directly into column buffers, which are wrapped
+    in the results object defined by the `_columns` attribute.
+
+    """
+
+    _columns = ColumnarResults
+
+    def _empty_result(self):
+        return self._columns.from_rows(self._result.description, [])
+
+    def _unchecked_fetchone(self):
+        """Fetch the next row as a tuple."""
+        out = self._result._read_rowdata_packet_unbuffered(1)
+        if out is None:
+            return None
+        self._rownumber += 1
+        return self._columns.row(self._columns.from_accel(out), 0)
+
+    def fetchone(self):
+        """Fetch next row."""
+        self._check_executed()
+        out = self._result._read_rowdata_packet_unbuffered(1)
+        if out is None:
+            return None
+        self._rownumber += 1
+        return self._columns.from_accel(out)
+
+    def fetchmany(self, size=None):
+        """Fetch many."""
+        self._check_executed()
+        out = self._result._read_rowdata_packet_unbuffered(size or self.arraysize)
+        if out is None:
+            return self._empty_result()
+        out = self._columns.from_accel(out)
+        self._rownumber += self._columns.num_rows(out)
+        return out
+
+    def fetchall(self):
+        """Fetch all remaining rows."""
+        self._check_executed()
+        out = self._result._read_rowdata_packet_unbuffered(0)
+        if out is None:
+            return self._empty_result()
+        out = self._columns.from_accel(out)
+        self._rownumber += self._columns.num_rows(out)
+        return out
+
+
+class SSNumpyCursor(ColumnarCursorMixin, SSCursor):
+    """An unbuffered cursor, which returns results as numpy arrays"""
+
+    _columns = NumpyResults
+
+
+class SSNumpyCursorSV(SSColumnarCursorSV):
+    """An unbuffered cursor for the C extension, which returns results as numpy arrays"""
+
+    _columns = NumpyResults
+
+
+class SSPandasCursor(ColumnarCursorMixin, SSCursor):
+    """An unbuffered cursor, which returns results as a pandas DataFrame"""
+
+    _columns = PandasResults
+
+
+class SSPandasCursorSV(SSColumnarCursorSV):
+    """An unbuffered cursor for the C extension, which returns a pandas DataFrame"""
+
+    _columns = PandasResults
+
+
+class SSArrowCursor(ColumnarCursorMixin, SSCursor):
+    """An unbuffered cursor, which returns results as a pyarrow Table"""
+
+    _columns = ArrowResults
+
+
+class SSArrowCursorSV(SSColumnarCursorSV):
+    """An unbuffered cursor for the C extension, which returns a pyarrow Table"""
+
+    _columns = ArrowResults
+
+
+class SSPolarsCursor(ColumnarCursorMixin, SSCursor):
+    """An unbuffered cursor, which returns results as a polars DataFrame"""
+
+    _columns = PolarsResults
+
+
+class SSPolarsCursorSV(SSColumnarCursorSV):
+    """An unbuffered cursor for the C extension, which returns a polars DataFrame"""
+
+    _columns = PolarsResults
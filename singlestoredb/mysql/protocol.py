@@ -9,6 +9,7 @@ from ..config import get_option
 from ..utils.results import Description
 from .charset import MBLENGTH
 from .constants import FIELD_TYPE
+from .constants import FLAG
 from .constants import SERVER_STATUS
 
 
@@ -20,6 +21,26 @@ UNSIGNED_SHORT_COLUMN = 252
 UNSIGNED_INT24_COLUMN = 253
 UNSIGNED_INT64_COLUMN = 254
 
+# Struct formats of the fixed-width values of the binary protocol
+BINARY_INT_FORMATS = {
+    FIELD_TYPE.TINY: ('<b', '<B'),
+    FIELD_TYPE.SHORT: ('<h', '<H'),
+    FIELD_TYPE.YEAR: ('<h', '<H'),
+    FIELD_TYPE.INT24: ('<i', '<I'),
+    FIELD_TYPE.LONG: ('<i', '<I'),
+    FIELD_TYPE.LONGLONG: ('<q', '<Q'),
+}
+
+
+def _float_to_text(value):
+    """Return the shortest text that round-trips a single precision float."""
+    packed = struct.pack('<f', value)
+    for precision in range(6, 10):
+        text = '%.*g' % (precision, value)
+        if struct.pack('<f', float(text)) == packed:
+            return text
+    return repr(value)
+
 
 def dump_packet(data):  # pragma: no cover
 
@@ -188,6 +209,67 @@ class MysqlPacket:
             return None
         return self.read(length)
 
+    def read_binary_value(self, type_code, flags=0):
+        """
+        Read a value of a binary protocol (prepared statement) result row.
+
+        Integers, floats, dates and times are stored as fixed-width values.
+        They are returned as the bytes the text protocol would have used
+        for them, so that the same converters apply to both protocols.
+        Zero dates are returned as an all-zero date. All other types are
+        length coded strings.
+
+        """
+        if type_code in BINARY_INT_FORMATS:
+            fmt = BINARY_INT_FORMATS[type_code][bool(flags & FLAG.UNSIGNED)]
+            value = self.read_struct(fmt)[0]
+            if type_code == FIELD_TYPE.YEAR:
+                return b'%04d' % value
+            return b'%d' % value
+
+        if type_code == FIELD_TYPE.DOUBLE:
+            return repr(self.read_struct('<d')[0]).encode('ascii')
+
+        if type_code == FIELD_TYPE.FLOAT:
+            return _float_to_text(self.read_struct('<f')[0]).encode('ascii')
+
+        if type_code in (
+            FIELD_TYPE.DATE, FIELD_TYPE.NEWDATE,
+            FIELD_TYPE.DATETIME, FIELD_TYPE.TIMESTAMP,
+        ):
+            length = self.read_uint8()
+            year = month = day = hour = minute = second = microsecond = 0
+            if length >= 4:
+                year, month, day = self.read_struct('<HBB')
+            if length >= 7:
+                hour, minute, second = self.read_struct('<BBB')
+            if length >= 11:
+                microsecond = self.read_uint32()
+            if type_code in (FIELD_TYPE.DATE, FIELD_TYPE.NEWDATE):
+                return b'%04d-%02d-%02d' % (year, month, day)
+            out = b'%04d-%02d-%02d %02d:%02d:%02d' % (
+                year, month, day, hour, minute, second,
+            )
+            if microsecond:
+                out += b'.%06d' % microsecond
+            return out
+
+        if type_code == FIELD_TYPE.TIME:
+            length = self.read_uint8()
+            negative = days = hour = minute = second = microsecond = 0
+            if length >= 8:
+                negative, days, hour, minute, second = self.read_struct('<BIBBB')
+            if length >= 12:
+                microsecond = self.read_uint32()
+            out = b'%s%d:%02d:%02d' % (
+                b'-' if negative else b'', days * 24 + hour, minute, second,
+            )
+            if microsecond:
+                out += b'.%06d' % microsecond
+            return out
+
+        return self.read_length_coded_string()
+
     def read_struct(self, fmt):
         s = struct.Struct(fmt)
         result = s.unpack_from(self._data, self._position)
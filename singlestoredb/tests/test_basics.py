@@ -1147,6 +1147,21 @@ class TestBasics(unittest.TestCase):
         self.cur.execute(f"SELECT 1.2 :> DOUBLE, '{string}'")
         self.assertEqual((1.2, string), self.cur.fetchone())
 
+    def test_numeric_strings(self):
+        self.cur.execute(
+            'SELECT 9223372036854775807, -9223372036854775808, '
+            '18446744073709551615, 1.7976931348623157e308 :> DOUBLE, '
+            '0.1 :> DOUBLE, -1.5e-10 :> DOUBLE, 123456789.123456789 :> DOUBLE',
+        )
+        self.assertEqual(
+            (
+                9223372036854775807, -9223372036854775808,
+                18446744073709551615, 1.7976931348623157e308,
+                0.1, -1.5e-10, 123456789.123456789,
+            ),
+            self.cur.fetchone(),
+        )
+
     def test_year_string(self):
         string = 'a' * 49
         self.cur.execute(f"SELECT 1999 :> YEAR, '{string}'")
@@ -1,14 +1,28 @@
 #!/usr/bin/env python
 # type: ignore
 """Basic SingleStoreDB connection testing."""
+import asyncio
+import concurrent.futures
+import copy
 import datetime
 import decimal
+import json
 import os
+import pickle
+import signal
+import socket
+import ssl
+import threading
+import time
 import unittest
 import uuid
+from unittest import mock
 
 import singlestoredb as s2
 from singlestoredb import connection as sc
+from singlestoredb.mysql import connection as mysql_connection
+from singlestoredb.mysql.connection import MySQLResultSV
+from singlestoredb.mysql.constants import CLIENT
 from singlestoredb.tests import utils
 # import pandas as pd
 # import traceback
@@ -1349,6 +1363,643 @@ class TestConnection(unittest.TestCase):
                 assert type(out[0]) is dict, type(out)
                 assert list(out[0].keys()) == columns, out[0].keys()
 
+    def test_results_type_lazyrows(self):
+        try:
+            import _singlestoredb_accel  # noqa: F401
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        with self.conn.cursor() as cur:
+            cur.execute('select * from alltypes order by id')
+            rows = cur.fetchall()
+            names = [x[0] for x in cur.description]
+
+        with s2.connect(database=type(self).dbname, results_type='lazyrows') as conn:
+            # The pure Python driver returns tuples.
+            if conn.resultclass is not MySQLResultSV:
+                self.skipTest('Test requires the C extension')
+            with conn.cursor() as cur:
+                cur.execute('select * from alltypes order by id')
+                out = cur.fetchall()
+
+        assert len(out) == len(rows), len(out)
+        for row, expected in zip(out, rows):
+            assert len(row) == len(expected), len(row)
+            # Access a few cells by name before decoding the rest.
+            assert row['json'] == expected[names.index('json')], row['json']
+            assert row[-1] == expected[-1], row[-1]
+            assert tuple(row) == tuple(expected), row
+            assert [row[x] for x in names] == list(expected), row
+
+    def test_results_type_rows(self):
+        try:
+            import _singlestoredb_accel  # noqa: F401
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        with s2.connect(database=type(self).dbname, results_type='rows') as conn:
+            # The pure Python driver returns tuples.
+            if conn.resultclass is not MySQLResultSV:
+                self.skipTest('Test requires the C extension')
+            with conn.cursor() as cur:
+                cur.execute('select id, name, value from data order by id')
+                out = cur.fetchall()
+
+        row = out[0]
+        assert type(row) is _singlestoredb_accel.Row, type(row)
+        assert row == ('a', 'antelopes', 2), row
+        assert row.id == row['id'] == row[0] == 'a', row
+        assert row.value == row['value'] == row[-1] == 2, row
+        assert row.keys() == ['id', 'name', 'value'], row.keys()
+        assert row._fields == ('id', 'name', 'value'), row._fields
+        assert dict(row) == dict(id='a', name='antelopes', value=2), dict(row)
+        assert row.get('missing') is None, row.get('missing')
+        assert hash(row) == hash(('a', 'antelopes', 2)), row
+
+        # Rows behave like tuples
+        assert row + (1,) == ('a', 'antelopes', 2, 1), row + (1,)
+        assert (0,) + row == (0, 'a', 'antelopes', 2), (0,) + row
+        assert row.count(2) == 1 and row.index('antelopes') == 1, row
+
+        for copied in [
+            pickle.loads(pickle.dumps(row)), copy.copy(row), copy.deepcopy(row),
+        ]:
+            assert type(copied) is _singlestoredb_accel.Row, type(copied)
+            assert copied == row and copied.name == 'antelopes', copied
+            assert copied._fields == row._fields, copied._fields
+        assert pickle.loads(pickle.dumps(out)) == out
+
+    def test_results_type_numpy(self):
+        try:
+            import numpy as np
+        except ImportError:
+            self.skipTest('Test requires numpy')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        with s2.connect(database=type(self).dbname) as conn:
+            with conn.cursor() as cur:
+                cur.execute('select * from alltypes order by id')
+                names = [x[0] for x in cur.description]
+                rows = cur.fetchall()
+
+        for buffered in [True, False]:
+            with s2.connect(
+                database=type(self).dbname,
+                results_type='numpy',
+                buffered=buffered,
+            ) as conn:
+                with conn.cursor() as cur:
+                    cur.execute('select * from alltypes order by id')
+                    first = cur.fetchone()
+                    rest = cur.fetchall()
+
+            assert list(first.keys()) == names, first.keys()
+            assert list(rest.keys()) == names, rest.keys()
+            assert len(first['id']) == 1, len(first['id'])
+            assert len(rest['id']) == len(rows) - 1, len(rest['id'])
+
+            assert first['id'].dtype == np.int64, first['id'].dtype
+            assert first['unsigned_bigint'].dtype == np.uint64, \
+                first['unsigned_bigint'].dtype
+            assert first['double'].dtype == np.float64, first['double'].dtype
+            assert first['date'].dtype == np.dtype('datetime64[D]'), \
+                first['date'].dtype
+            assert first['datetime_6'].dtype == np.dtype('datetime64[us]'), \
+                first['datetime_6'].dtype
+            assert first['time_6'].dtype == np.dtype('timedelta64[us]'), \
+                first['time_6'].dtype
+            assert first['text'].dtype == object, first['text'].dtype
+
+            assert first['id'][0] == rows[0][0], first['id'][0]
+            assert first['text'][0] == rows[0][names.index('text')], \
+                first['text'][0]
+            assert first['datetime_6'][0].astype(object) == \
+                rows[0][names.index('datetime_6')], first['datetime_6'][0]
+
+            # NULL values are masked in typed columns
+            nulls = [i for i, x in enumerate(rows[1:]) if x[names.index('int')] is None]
+            if nulls:
+                assert isinstance(rest['int'], np.ma.MaskedArray), type(rest['int'])
+                assert rest['int'].mask[nulls[0]], rest['int'].mask
+
+    def test_results_type_arrow(self):
+        try:
+            import pyarrow as pa
+        except ImportError:
+            self.skipTest('Test requires pyarrow')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        with s2.connect(database=type(self).dbname) as conn:
+            with conn.cursor() as cur:
+                cur.execute('select * from alltypes order by id')
+                names = [x[0] for x in cur.description]
+                rows = cur.fetchall()
+
+        for buffered in [True, False]:
+            with s2.connect(
+                database=type(self).dbname,
+                results_type='arrow',
+                buffered=buffered,
+            ) as conn:
+                with conn.cursor() as cur:
+                    cur.execute('select * from alltypes order by id')
+                    first = cur.fetchone()
+                    rest = cur.fetchall()
+
+            assert isinstance(rest, pa.Table), type(rest)
+            assert first.column_names == names, first.column_names
+            assert first.num_rows == 1, first.num_rows
+            assert rest.num_rows == len(rows) - 1, rest.num_rows
+
+            schema = first.schema
+            assert schema.field('id').type == pa.int64(), schema.field('id').type
+            assert schema.field('unsigned_bigint').type == pa.uint64(), \
+                schema.field('unsigned_bigint').type
+            assert schema.field('double').type == pa.float64(), \
+                schema.field('double').type
+            assert schema.field('date').type == pa.date32(), schema.field('date').type
+            assert schema.field('datetime_6').type == pa.timestamp('us'), \
+                schema.field('datetime_6').type
+            assert schema.field('time_6').type == pa.duration('us'), \
+                schema.field('time_6').type
+            assert schema.field('text').type == pa.large_string(), \
+                schema.field('text').type
+            assert schema.field('blob').type == pa.large_binary(), \
+                schema.field('blob').type
+
+            assert first.column('id')[0].as_py() == rows[0][0]
+            assert first.column('text')[0].as_py() == rows[0][names.index('text')]
+            assert first.column('datetime_6')[0].as_py() == \
+                rows[0][names.index('datetime_6')]
+
+            ints = [x[names.index('int')] for x in rows[1:]]
+            assert rest.column('int').to_pylist() == ints, rest.column('int')
+
+    def test_results_type_dataframes(self):
+        try:
+            import pandas as pd
+            import polars as pl
+        except ImportError:
+            self.skipTest('Test requires pandas and polars')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        with s2.connect(database=type(self).dbname) as conn:
+            with conn.cursor() as cur:
+                cur.execute('select * from alltypes order by id')
+                names = [x[0] for x in cur.description]
+                rows = cur.fetchall()
+
+        for results_type, frame_type in [('pandas', pd.DataFrame),
+                                         ('polars', pl.DataFrame)]:
+            for buffered in [True, False]:
+                with s2.connect(
+                    database=type(self).dbname,
+                    results_type=results_type,
+                    buffered=buffered,
+                ) as conn:
+                    with conn.cursor() as cur:
+                        cur.execute('select * from alltypes order by id')
+                        first = cur.fetchmany(1)
+                        rest = cur.fetchall()
+
+                assert isinstance(first, frame_type), type(first)
+                assert isinstance(rest, frame_type), type(rest)
+                assert list(first.columns) == names, first.columns
+                assert len(first) == 1, len(first)
+                assert len(rest) == len(rows) - 1, len(rest)
+                assert list(rest['id']) == [x[0] for x in rows[1:]], rest['id']
+
+    def test_decimal_type(self):
+        with s2.connect(database=type(self).dbname) as conn:
+            with conn.cursor() as cur:
+                cur.execute('select id, `decimal` from alltypes order by id')
+                rows = cur.fetchall()
+
+        assert any(x[1] is not None for x in rows)
+
+        with s2.connect(database=type(self).dbname, decimal_type='float') as conn:
+            with conn.cursor() as cur:
+                cur.execute('select id, `decimal` from alltypes order by id')
+                out = cur.fetchall()
+
+        assert [x[1] for x in out] == \
+            [None if x[1] is None else float(x[1]) for x in rows], out
+
+        with s2.connect(database=type(self).dbname, decimal_type='scaled_int') as conn:
+            with conn.cursor() as cur:
+                cur.execute('select id, `decimal` from alltypes order by id')
+                out = cur.fetchall()
+
+        assert [x[1] for x in out] == \
+            [None if x[1] is None else int(x[1].scaleb(6)) for x in rows], out
+
+        try:
+            import pyarrow as pa
+        except ImportError:
+            self.skipTest('Test requires pyarrow')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        with s2.connect(database=type(self).dbname, results_type='arrow') as conn:
+            with conn.cursor() as cur:
+                cur.execute('select id, `decimal` from alltypes order by id')
+                out = cur.fetchall()
+
+        assert out.schema.field('decimal').type == pa.decimal128(20, 6), \
+            out.schema.field('decimal').type
+        assert out.column('decimal').to_pylist() == [x[1] for x in rows]
+
+    def test_intern_strings(self):
+        query = 'select `enum`, `set`, `char_100` from alltypes, ' \
+                '(select 1 union all select 2) as x order by id'
+
+        with s2.connect(database=type(self).dbname) as conn:
+            with conn.cursor() as cur:
+                cur.execute(query)
+                rows = cur.fetchall()
+
+        with s2.connect(database=type(self).dbname, intern_strings=True) as conn:
+            with conn.cursor() as cur:
+                cur.execute(query)
+                out = cur.fetchall()
+
+        assert list(out) == list(rows), out
+
+        try:
+            import _singlestoredb_accel  # noqa: F401
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        # Repeated ENUM values share a single object
+        enums = [x[0] for x in out if x[0] is not None]
+        assert len(set(id(x) for x in enums)) <= len(set(enums)), enums
+
+    def test_repeated_temporal_values(self):
+        columns = '`date`, `time`, `time_6`, `datetime`, `datetime_6`, ' \
+                  '`timestamp`, `timestamp_6`'
+
+        with self.conn.cursor() as cur:
+            cur.execute(f'select {columns} from alltypes order by id')
+            rows = list(cur.fetchall())
+
+            cur.execute(
+                f'select {columns} from alltypes, '
+                '(select 1 as n union all select 2 union all select 3) as x '
+                'order by id, x.n',
+            )
+            out = list(cur.fetchall())
+
+        assert out == [x for x in rows for _ in range(3)], out
+
+    def test_json_values(self):
+        docs = [
+            '{"a": [1, -2.5, 1e300, true, false, null], "b": {"c": "d"}}',
+            '"esc \\" \\\\ \\/ \\b \\f \\n \\r \\t \\u00e9 \\ud83d\\ude00"',
+            '"é中😀"', '12345678901234567890123', '-0.125', '[]', '{}',
+        ]
+
+        with self.conn.cursor() as cur:
+            for doc in docs:
+                cur.execute('select cast(%s as json)', [doc])
+                out = cur.fetchone()[0]
+                assert out == json.loads(doc), (doc, out)
+
+            # Object keys repeat in every row
+            cur.execute(
+                'select cast(\'{"key": 1}\' as json) from alltypes, '
+                '(select 1 union all select 2) as x',
+            )
+            keys = [k for x in cur.fetchall() for k in x[0]]
+            assert keys == ['key'] * len(keys), keys
+
+    def test_threaded_fetch(self):
+        query = 'select * from alltypes, ' \
+                '(select 1 union all select 2 union all select 3) as x order by id'
+
+        with self.conn.cursor() as cur:
+            cur.execute(query)
+            expected = list(cur.fetchall())
+
+        def fetch():
+            with s2.connect(database=type(self).dbname) as conn:
+                with conn.cursor() as cur:
+                    cur.execute(query)
+                    return list(cur.fetchall())
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=4) as pool:
+            results = list(pool.map(lambda _: fetch(), range(8)))
+
+        for out in results:
+            assert out == expected, out
+
+    def test_read_ahead(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        query = 'select * from alltypes, ' \
+                '(select 1 union all select 2 union all select 3) as x order by id'
+
+        with self.conn.cursor() as cur:
+            cur.execute(query)
+            expected = list(cur.fetchall())
+
+        with s2.connect(
+            database=type(self).dbname, buffered=False, read_ahead=True,
+        ) as conn:
+            with conn.cursor() as cur:
+                cur.execute(query)
+                out = [cur.fetchone()]
+                out.extend(cur.fetchmany(2))
+                out.extend(cur.fetchall())
+                assert out == expected, out
+
+                # An abandoned result is drained before the next query
+                cur.execute(query)
+                cur.fetchmany(2)
+                with self.assertWarns(UserWarning):
+                    cur.execute('select 1')
+                assert list(cur.fetchall()) == [(1,)]
+
+    def test_decode_on_fetch(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        query = 'select * from alltypes order by id'
+
+        with self.conn.cursor() as cur:
+            cur.execute(query)
+            expected = list(cur.fetchall())
+
+        with s2.connect(database=type(self).dbname, decode_on_fetch=True) as conn:
+            with conn.cursor() as cur:
+                cur.execute(query)
+                assert cur.rowcount == len(expected), cur.rowcount
+                out = [cur.fetchone()]
+                out.extend(cur.fetchmany(2))
+                out.extend(cur.fetchall())
+                assert out == expected, out
+
+                cur.scroll(1, mode='absolute')
+                assert cur.fetchone() == expected[1]
+                cur.scroll(-2)
+                assert list(cur) == expected
+
+    def test_server_side_prepare(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        query = 'select * from alltypes where id >= %s and id < %s order by id'
+
+        with self.conn.cursor() as cur:
+            cur.execute(query, (0, 1000))
+            expected = list(cur.fetchall())
+
+        for buffered in [True, False]:
+            with s2.connect(
+                database=type(self).dbname, buffered=buffered,
+                server_side_prepare=True,
+            ) as conn:
+                with conn.cursor() as cur:
+                    cur.execute(query, (0, 1000))
+                    assert list(cur.fetchall()) == expected
+
+                    # Statements are reused
+                    cur.execute(query, (0, 1000))
+                    assert list(cur.fetchall()) == expected
+
+                    # Parameters of the binary protocol
+                    cur.execute(
+                        'select %s, %s, %s, %s, %s, %s',
+                        (None, 1.5, 'abc', b'\x00\x01',
+                         datetime.date(2020, 1, 2),
+                         decimal.Decimal('1.25')),
+                    )
+                    assert list(cur.fetchall()) == [
+                        (None, 1.5, 'abc', b'\x00\x01',
+                         datetime.date(2020, 1, 2),
+                         decimal.Decimal('1.25')),
+                    ]
+
+    def test_compress(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        query = 'select * from alltypes order by id'
+
+        with self.conn.cursor() as cur:
+            cur.execute(query)
+            expected = list(cur.fetchall())
+
+        for compress in ['zlib', 'auto']:
+            for buffered in [True, False]:
+                with s2.connect(
+                    database=type(self).dbname, buffered=buffered,
+                    compress=compress,
+                ) as conn:
+                    with conn.cursor() as cur:
+                        cur.execute(query)
+                        assert list(cur.fetchall()) == expected
+
+    def test_duplicate_column_names(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        query = 'select a.id, b.id, a.name from data as a, data as b ' \
+                'where a.id = b.id order by a.id'
+
+        with s2.connect(database=type(self).dbname, results_type='dicts') as conn:
+            with conn.cursor() as cur:
+                cur.execute(query)
+                out = cur.fetchall()
+                names = [x[0] for x in cur.description]
+
+        assert names == ['id', 'id', 'name'], names
+        assert list(out[0].keys()) == ['id', 'b.id', 'name'], list(out[0].keys())
+        assert out[0]['id'] == out[0]['b.id'], out[0]
+
+    def test_pipeline(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        ids = ['a', 'b', 'c', 'd', 'e']
+
+        with self.conn.pipeline() as p:
+            curs = [p.execute('select name from data where id = %s', [x]) for x in ids]
+
+        out = [cur.fetchall()[0][0] for cur in curs]
+        assert out == ['antelopes', 'bears', 'cats', 'dogs', 'elephants'], out
+
+        # Queries of 16MB or more are sent in several packets
+        big = 'x' * (16 * 1024 * 1024)
+        with self.conn.pipeline() as p:
+            cur1 = p.execute('select 1')
+            cur2 = p.execute('select length(%s)', [big])
+            cur3 = p.execute('select 3')
+
+        assert list(cur1.fetchall()) == [(1,)]
+        assert list(cur2.fetchall()) == [(len(big),)]
+        assert list(cur3.fetchall()) == [(3,)]
+
+        # Queries are sent at most a window at a time, and a query larger
+        # than the window is sent on its own
+        window = mysql_connection.PIPELINE_WINDOW
+        large = 'y' * (window + 1)
+        execute_pipeline = mock.patch.object(
+            self.conn, '_execute_pipeline', wraps=self.conn._execute_pipeline,
+        )
+        with execute_pipeline as m:
+            with self.conn.pipeline() as p:
+                curs = [p.execute('select %s', [x]) for x in ['a', large, 'b']]
+                curs += [p.execute('select length(%s)', [large]) for _ in range(2)]
+                curs.append(p.execute('select %s', ['c' * (window // 4)]))
+                curs.append(p.execute('select %s', ['d' * (window // 4)]))
+
+        assert [list(cur.fetchall()) for cur in curs] == [
+            [('a',)], [(large,)], [('b',)],
+            [(len(large),)], [(len(large),)],
+            [('c' * (window // 4),)], [('d' * (window // 4),)],
+        ]
+        for call in m.call_args_list:
+            sqls = call.args[0]
+            assert len(sqls) == 1 or sum(len(x) for x in sqls) <= window, \
+                [len(x) for x in sqls]
+        assert len(m.call_args_list) == 6, m.call_args_list
+
+        # Errors are raised once every result has been read
+        with self.assertRaises(s2.ProgrammingError):
+            with self.conn.pipeline() as p:
+                p.execute('select * from nonexistent_table')
+                cur = p.execute('select count(*) from data')
+
+        assert list(cur.fetchall()) == [(5,)]
+
+        self.cur.execute('select 1')
+        assert list(self.cur.fetchall()) == [(1,)]
+
+    def test_parallel_fetch(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        self.cur.execute('select * from data order by id')
+        expected = list(self.cur.fetchall())
+
+        out = self.conn.parallel_fetch('select * from data', n_workers=3)
+        assert sorted(out) == expected, out
+
+        self.cur.execute('select id from alltypes order by id')
+        expected = list(self.cur.fetchall())
+
+        out = self.conn.parallel_fetch('select id from alltypes', n_workers=2, key='id')
+        assert sorted(out) == expected, out
+
+        # Only integer key columns can be split into ranges
+        for key in ['decimal', 'double', 'datetime']:
+            with self.assertRaises(s2.NotSupportedError):
+                self.conn.parallel_fetch('select * from alltypes', n_workers=2, key=key)
+
+        # Queries whose results change when run in parts are refused
+        for query in [
+            'select * from data limit 2',
+            'select * from data order by id',
+            'select count(*) from data',
+            'select value, sum(id) from data group by value',
+            'select distinct value from data',
+        ]:
+            with self.assertRaises(s2.NotSupportedError):
+                self.conn.parallel_fetch(query, n_workers=2)
+
+        # Clause names inside literals are not mistaken for clauses
+        out = self.conn.parallel_fetch(
+            'select * from data where name != %s', ['order by'], n_workers=2,
+        )
+        self.cur.execute('select * from data order by id')
+        assert sorted(out) == list(self.cur.fetchall()), out
+
+    def test_read_engine(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        from singlestoredb.mysql import connection as mc
+
+        if mc.ReadEngine is None:
+            self.skipTest('Test requires the C extension')
+
+        params = sc.build_params(database=type(self).dbname)
+
+        self.cur.execute('select * from data order by id')
+        expected = list(self.cur.fetchall())
+
+        for backend in ['io_uring', 'poll']:
+            try:
+                engine = mc.ReadEngine(backend=backend)
+            except (OSError, ValueError):
+                continue
+            assert engine.backend == backend
+
+            def fetch(i):
+                with mc.Connection(read_engine=engine, **params) as conn:
+                    with conn.cursor() as cur:
+                        for _ in range(5):
+                            cur.execute('select * from data order by id')
+                            assert list(cur.fetchall()) == expected
+                    return i
+
+            with concurrent.futures.ThreadPoolExecutor(8) as pool:
+                assert sorted(pool.map(fetch, range(16))) == list(range(16))
+
+            # Connections read from their sockets directly once it is closed
+            conn = mc.Connection(read_engine=engine, **params)
+            engine.close()
+            with conn.cursor() as cur:
+                cur.execute('select * from data order by id')
+                assert list(cur.fetchall()) == expected
+            conn.close()
+
+    def test_asyncio_connection(self):
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        from singlestoredb.mysql import aio
+
+        params = sc.build_params(database=type(self).dbname)
+
+        async def get_name(id):
+            async with await aio.connect(**params) as conn:
+                cur = conn.cursor()
+                await cur.execute('select name from data where id = %s', [id])
+                return (await cur.fetchall())[0][0]
+
+        async def run():
+            out = await asyncio.gather(*[get_name(x) for x in 'abcde'])
+
+            async with await aio.connect(**params) as conn:
+                cur = conn.cursor()
+                with self.assertRaises(s2.ProgrammingError):
+                    await cur.execute('select * from nonexistent_table')
+                await cur.execute('select count(*) from data')
+                assert list(await cur.fetchall()) == [(5,)]
+
+            return out
+
+        out = asyncio.run(run())
+        assert out == ['antelopes', 'bears', 'cats', 'dogs', 'elephants'], out
+
     def test_results_format(self):
         with self.assertWarns(DeprecationWarning):
             with s2.connect(database=type(self).dbname, results_format='dicts') as conn:
@@ -1376,6 +2027,128 @@ class TestConnection(unittest.TestCase):
                 cur.execute('SELECT 1')
                 self.assertEqual([(1,)], list(cur))
 
+    def test_socket_reader(self):
+        try:
+            import _singlestoredb_accel
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        # The native reader is only used with the C extension, and not on
+        # sockets that are wrapped by the Python ssl module.
+        if self.conn.driver not in ['http', 'https']:
+            native = self.conn.resultclass is MySQLResultSV and \
+                not isinstance(self.conn._sock, ssl.SSLSocket)
+            assert (type(self.conn._rfile) is _singlestoredb_accel.SocketReader) \
+                == native, type(self.conn._rfile)
+
+        server, client = socket.socketpair()
+        try:
+            rfile = _singlestoredb_accel.SocketReader(client, 0.5)
+
+            writer = threading.Thread(
+                target=server.sendall, args=(b'0123456789' * 100000,),
+            )
+            writer.start()
+            self.assertEqual(rfile.read(4), b'0123')
+            self.assertEqual(len(rfile.read(999990)), 999990)
+            self.assertEqual(rfile.read(6), b'456789')
+            writer.join()
+
+            with self.assertRaises(OSError):
+                rfile.read(1)
+
+            server.sendall(b'abc')
+            server.close()
+            self.assertEqual(rfile.read(10), b'abc')
+            self.assertEqual(rfile.read(10), b'')
+        finally:
+            client.close()
+
+    def test_send_command(self):
+        try:
+            import _singlestoredb_accel
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        max_packet_len = 0xFFFFFF
+        sql = bytearray(b'0123456789' * (2 * max_packet_len // 10 + 7))
+
+        server, client = socket.socketpair()
+        try:
+            rfile = _singlestoredb_accel.SocketReader(client, 5)
+            received = bytearray()
+
+            def read():
+                while True:
+                    data = server.recv(1 << 20)
+                    if not data:
+                        return
+                    received.extend(data)
+
+            reader = threading.Thread(target=read)
+            reader.start()
+            self.assertEqual(rfile.send_command(3, sql), 3)
+            client.shutdown(socket.SHUT_WR)
+            reader.join()
+        finally:
+            server.close()
+            client.close()
+
+        payload = b'\x03' + sql
+        expected = b''
+        for i in range(3):
+            chunk = payload[i * max_packet_len:(i + 1) * max_packet_len]
+            expected += len(chunk).to_bytes(3, 'little') + bytes([i]) + chunk
+        assert received == expected, len(received)
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        # Statements spanning several packets
+        query = b'select 1 /* ' + b'x' * (max_packet_len + 100) + b' */'
+        self.cur.execute(bytearray(query))
+        assert list(self.cur.fetchall()) == [(1,)]
+
+    def test_native_tls(self):
+        try:
+            import _singlestoredb_accel
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        server, client = socket.socketpair()
+        try:
+            rfile = _singlestoredb_accel.SocketReader(client, 0.5)
+            reader = threading.Thread(target=server.recv, args=(1,))
+            reader.start()
+            rfile.sendall(b'x')
+            reader.join()
+        finally:
+            server.close()
+            client.close()
+
+        if not _singlestoredb_accel.native_tls:
+            self.skipTest('Test requires the C extension built with OpenSSL')
+
+        if self.conn.driver in ['http', 'https']:
+            self.skipTest('Test requires the MySQL protocol')
+
+        query = 'select * from alltypes order by id'
+
+        with self.conn.cursor() as cur:
+            cur.execute(query)
+            expected = list(cur.fetchall())
+
+        for compress in [None, 'zlib']:
+            with s2.connect(
+                database=type(self).dbname, compress=compress,
+                ssl_cipher='HIGH:!aNULL', ssl_verify_cert=False,
+            ) as conn:
+                if conn.server_capabilities & CLIENT.SSL:
+                    assert conn._writer is not None
+                with conn.cursor() as cur:
+                    cur.execute(query)
+                    assert list(cur.fetchall()) == expected
+
     def test_show_accessors(self):
         out = self.conn.show.columns('data')
         assert out.columns == [
@@ -1469,6 +2242,102 @@ class TestConnection(unittest.TestCase):
         # out = self.conn.show.create_view('vname')
 
 
+class TestConnectionWithoutServer(unittest.TestCase):
+    """Connection tests that run against a local listener."""
+
+    def _listen(self):
+        # Accept one connection and close it before the handshake.
+        server = socket.socket()
+        server.bind(('127.0.0.1', 0))
+        server.listen(1)
+
+        def accept():
+            try:
+                conn, _ = server.accept()
+                conn.close()
+            finally:
+                server.close()
+
+        thread = threading.Thread(target=accept)
+        thread.start()
+        return server.getsockname()[1], thread
+
+    def test_connect_without_c_extension(self):
+        port, thread = self._listen()
+        try:
+            with mock.patch.object(mysql_connection, '_singlestoredb_accel', None):
+                with self.assertRaises(s2.OperationalError):
+                    mysql_connection.Connection(
+                        host='127.0.0.1', port=port, user='user', password='pw',
+                    )
+        finally:
+            thread.join()
+
+    def test_send_command_interrupted(self):
+        try:
+            import _singlestoredb_accel
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        if not hasattr(signal, 'setitimer'):
+            self.skipTest('Test requires signal.setitimer')
+
+        sql = bytes(range(256)) * (8 * 1024)
+
+        # Small socket buffers and a slow reader force short writes, and the
+        # timer interrupts the sends that are waiting for the socket.
+        for timeout in [None, 5.0]:
+            server, client = socket.socketpair()
+            client.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, 4096)
+            server.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4096)
+            received = bytearray()
+
+            def read():
+                while True:
+                    data = server.recv(8192)
+                    if not data:
+                        return
+                    received.extend(data)
+                    time.sleep(0.0002)
+
+            handler = signal.signal(signal.SIGALRM, lambda signum, frame: None)
+            reader = threading.Thread(target=read)
+            reader.start()
+            try:
+                rfile = _singlestoredb_accel.SocketReader(client, timeout)
+                signal.setitimer(signal.ITIMER_REAL, 0.002, 0.002)
+                self.assertEqual(rfile.send_command(3, sql, timeout), 1)
+            finally:
+                signal.setitimer(signal.ITIMER_REAL, 0)
+                signal.signal(signal.SIGALRM, handler)
+                client.shutdown(socket.SHUT_WR)
+                reader.join()
+                server.close()
+                client.close()
+
+            expected = (len(sql) + 1).to_bytes(3, 'little') + b'\x00\x03' + sql
+            assert received == expected, (len(received), len(expected))
+
+    def test_socket_reader_short_timeout(self):
+        try:
+            import _singlestoredb_accel
+        except ImportError:
+            self.skipTest('Test requires the C extension')
+
+        # Timeouts under a millisecond still wait instead of polling once
+        server, client = socket.socketpair()
+        try:
+            rfile = _singlestoredb_accel.SocketReader(client, 0.0009)
+            for _ in range(3):
+                start = time.monotonic()
+                with self.assertRaises(OSError):
+                    rfile.read(1)
+                assert time.monotonic() - start >= 0.0009
+        finally:
+            server.close()
+            client.close()
+
+
 if __name__ == '__main__':
     import nose2
     nose2.main()
@@ -1,6 +1,9 @@
 #!/usr/bin/env python
 """SingleStoreDB package utilities."""
 import collections
+import datetime
+import decimal
+import json
 import warnings
 from typing import Any
 from typing import Callable
@@ -11,6 +14,12 @@ from typing import Optional
 from typing import Tuple
 from typing import Union
 
+try:
+    has_numpy = True
+    import numpy as np
+except ImportError:
+    has_numpy = False
+
 try:
     has_pandas = True
     from pandas import DataFrame
@@ -18,6 +27,18 @@ except ImportError:
     has_pandas = False
     DataFrame = Any
 
+try:
+    has_pyarrow = True
+    import pyarrow as pa
+except ImportError:
+    has_pyarrow = False
+
+try:
+    has_polars = True
+    import polars as pl
+except ImportError:
+    has_polars = False
+
 DBAPIResult = Union[List[Tuple[Any, ...]], Tuple[Any, ...]]
 OneResult = Union[Tuple[Any, ...], Dict[str, Any], DataFrame]
 ManyResult = Union[List[Tuple[Any, ...]], List[Dict[str, Any]], DataFrame]
@@ -183,6 +204,507 @@ def results_to_tuple(
     return [tuple(x) for x in res]
 
 
+# Field type codes of the columns that have a native numpy type
+_numpy_dtypes = {
+    1: 'int64',  # TINY
+    2: 'int64',  # SHORT
+    3: 'int64',  # LONG
+    9: 'int64',  # INT24
+    13: 'int64',  # YEAR
+    8: 'int64',  # LONGLONG
+    4: 'float64',  # FLOAT
+    5: 'float64',  # DOUBLE
+    12: 'datetime64[us]',  # DATETIME
+    7: 'datetime64[us]',  # TIMESTAMP
+    10: 'datetime64[D]',  # DATE
+    14: 'datetime64[D]',  # NEWDATE
+    11: 'timedelta64[us]',  # TIME
+}
+
+_UNSIGNED_FLAG = 32
+
+_DECIMAL_TYPES = (0, 246)
+
+
+def _decimal_precision(desc: Description) -> int:
+    """Return the precision of a DECIMAL column."""
+    precision = desc[4] or 0
+    scale = desc[5] or 0
+    if scale > 0:
+        precision -= 1
+    if not (desc[7] or 0) & _UNSIGNED_FLAG:
+        precision -= 1
+    return min(max(precision, scale, 1), 76)
+
+
+def _decimal_dtype(desc: Description, values: List[Any]) -> Optional[str]:
+    """Return the numpy dtype of DECIMAL values converted by ``decimal_type``."""
+    for x in values:
+        if isinstance(x, float):
+            return 'float64'
+        if isinstance(x, int) and _decimal_precision(desc) <= 18:
+            return 'int64'
+        if x is not None:
+            return None
+    return None
+
+
+def _numpy_column(desc: Description, values: List[Any]) -> Any:
+    """Convert the values of one column to a numpy array."""
+    dtype = _numpy_dtypes.get(desc[1])
+    if dtype == 'int64' and desc[1] == 8 and (desc[7] or 0) & _UNSIGNED_FLAG:
+        dtype = 'uint64'
+    elif desc[1] in _DECIMAL_TYPES:
+        dtype = _decimal_dtype(desc, values)
+
+    if dtype is not None:
+        is_temporal = dtype.startswith(('datetime64', 'timedelta64'))
+        if is_temporal:
+            mask = [
+                not isinstance(x, (datetime.date, datetime.timedelta))
+                for x in values
+            ]
+        else:
+            mask = [x is None for x in values]
+        try:
+            if any(mask):
+                fill = None if is_temporal else 0
+                return np.ma.MaskedArray(
+                    np.array(
+                        [fill if m else x for x, m in zip(values, mask)],
+                        dtype=dtype,
+                    ),
+                    mask=mask,
+                )
+            return np.array(values, dtype=dtype)
+        except (TypeError, ValueError, OverflowError):
+            pass
+
+    # Items are set one at a time so that sequences are not unpacked.
+    out = np.empty(len(values), dtype=object)
+    for i, x in enumerate(values):
+        out[i] = x
+    return out
+
+
+def results_to_numpy(
+    desc: List[Description],
+    res: Optional[DBAPIResult],
+    single: Optional[bool] = False,
+) -> Optional[Result]:
+    """
+    Convert results to numpy arrays.
+
+    Parameters
+    ----------
+    desc : list of Descriptions
+        The column metadata
+    res : tuple or list of tuples
+        The query results
+    single : bool, optional
+        Is this a single result (i.e., from `fetchone`)?
+
+    Returns
+    -------
+    dict of numpy arrays
+        If `numpy` is available. Integer, float, and date / time columns
+        that contain NULLs are returned as masked arrays.
+    tuple or list of tuples
+        If `numpy` is not available
+
+    """
+    if res is None or not desc:
+        return res
+    if not has_numpy:
+        warnings.warn(
+            'numpy is not available; unable to convert to arrays',
+            RuntimeWarning,
+        )
+        return res
+    if single:
+        res = [res]
+    return {
+        d[0]: _numpy_column(d, [x[i] for x in res])
+        for i, d in enumerate(desc)
+    }
+
+
+def results_to_pandas(
+    desc: List[Description],
+    res: Optional[DBAPIResult],
+    single: Optional[bool] = False,
+) -> Optional[Result]:
+    """
+    Convert results to a DataFrame with numpy-backed columns.
+
+    Unlike :func:`results_to_dataframe`, the columns have the same types as
+    the arrays created by :func:`results_to_numpy`.
+
+    Parameters
+    ----------
+    desc : list of Descriptions
+        The column metadata
+    res : tuple or list of tuples
+        The query results
+    single : bool, optional
+        Is this a single result (i.e., from `fetchone`)?
+
+    Returns
+    -------
+    DataFrame
+        If `pandas` and `numpy` are available
+    tuple or list of tuples
+        If `pandas` or `numpy` is not available
+
+    """
+    if res is None or not desc:
+        return res
+    if not has_pandas or not has_numpy:
+        warnings.warn(
+            'pandas is not available; unable to convert to DataFrame',
+            RuntimeWarning,
+        )
+        return res
+    return DataFrame(results_to_numpy(desc, res, single))
+
+
+def _arrow_type(desc: Description) -> Any:
+    """Return the Arrow type of a column (None if it should be inferred)."""
+    dtype = _numpy_dtypes.get(desc[1])
+    if dtype == 'int64':
+        if desc[1] == 8 and (desc[7] or 0) & _UNSIGNED_FLAG:
+            return pa.uint64()
+        return pa.int64()
+    if dtype == 'float64':
+        return pa.float64()
+    if dtype == 'datetime64[us]':
+        return pa.timestamp('us')
+    if dtype == 'datetime64[D]':
+        return pa.date32()
+    if dtype == 'timedelta64[us]':
+        return pa.duration('us')
+    return None
+
+
+def _arrow_decimal_type(desc: Description, values: List[Any]) -> Any:
+    """Return the Arrow type of a DECIMAL column."""
+    dtype = _decimal_dtype(desc, values)
+    if dtype == 'float64':
+        return pa.float64()
+    if dtype == 'int64':
+        return pa.int64()
+    precision = _decimal_precision(desc)
+    if precision <= 38:
+        return pa.decimal128(precision, desc[5] or 0)
+    return pa.decimal256(precision, desc[5] or 0)
+
+
+def _arrow_column(desc: Description, values: List[Any]) -> Any:
+    """Convert the values of one column to an Arrow array."""
+    dtype = _arrow_type(desc)
+    if desc[1] in _DECIMAL_TYPES:
+        dtype = _arrow_decimal_type(desc, values)
+        if pa.types.is_decimal(dtype):
+            # Scaled integers that do not fit in int64
+            values = [
+                decimal.Decimal(x).scaleb(-(desc[5] or 0))
+                if isinstance(x, int) else x for x in values
+            ]
+    if dtype is not None:
+        if desc[1] in (7, 10, 11, 12, 14):
+            # Zero and invalid dates are returned as strings.
+            values = [
+                x if isinstance(x, (datetime.date, datetime.timedelta)) else None
+                for x in values
+            ]
+        try:
+            return pa.array(values, type=dtype)
+        except (TypeError, ValueError, OverflowError, pa.ArrowException):
+            pass
+
+    # All other columns are strings or binary values, as in the C extension.
+    if any(isinstance(x, (bytes, bytearray)) for x in values):
+        return pa.array(values, type=pa.large_binary())
+    return pa.array(
+        [
+            x if x is None or isinstance(x, str)
+            else json.dumps(x) if isinstance(x, (dict, list))
+            else str(x) for x in values
+        ],
+        type=pa.large_string(),
+    )
+
+
+def results_to_arrow(
+    desc: List[Description],
+    res: Optional[DBAPIResult],
+    single: Optional[bool] = False,
+) -> Optional[Result]:
+    """
+    Convert results to an Arrow table.
+
+    Parameters
+    ----------
+    desc : list of Descriptions
+        The column metadata
+    res : tuple or list of tuples
+        The query results
+    single : bool, optional
+        Is this a single result (i.e., from `fetchone`)?
+
+    Returns
+    -------
+    pyarrow.Table
+        If `pyarrow` is available
+    tuple or list of tuples
+        If `pyarrow` is not available
+
+    """
+    if res is None or not desc:
+        return res
+    if not has_pyarrow:
+        warnings.warn(
+            'pyarrow is not available; unable to convert to Table',
+            RuntimeWarning,
+        )
+        return res
+    if single:
+        res = [res]
+    return pa.table(
+        [_arrow_column(d, [x[i] for x in res]) for i, d in enumerate(desc)],
+        names=[d[0] for d in desc],
+    )
+
+
+def results_to_polars(
+    desc: List[Description],
+    res: Optional[DBAPIResult],
+    single: Optional[bool] = False,
+) -> Optional[Result]:
+    """
+    Convert results to a polars DataFrame.
+
+    Parameters
+    ----------
+    desc : list of Descriptions
+        The column metadata
+    res : tuple or list of tuples
+        The query results
+    single : bool, optional
+        Is this a single result (i.e., from `fetchone`)?
+
+    Returns
+    -------
+    polars.DataFrame
+        If `polars` is available
+    tuple or list of tuples
+        If `polars` is not available
+
+    """
+    if res is None or not desc:
+        return res
+    if not has_polars:
+        warnings.warn(
+            'polars is not available; unable to convert to DataFrame',
+            RuntimeWarning,
+        )
+        return res
+    if has_pyarrow:
+        out = results_to_arrow(desc, res, single)
+        # polars only reads decimal128 values; wider values are kept as text.
+        for i, field in enumerate(out.schema):
+            if pa.types.is_decimal256(field.type):
+                out = out.set_column(
+                    i, field.name, pa.array(
+                        [
+                            None if x is None else format(x, 'f')
+                            for x in out.column(i).to_pylist()
+                        ],
+                        type=pa.large_string(),
+                    ),
+                )
+        return pl.DataFrame(out)
+    if single:
+        res = [res]
+    return pl.DataFrame(
+        {d[0]: [x[i] for x in res] for i, d in enumerate(desc)},
+        strict=False,
+    )
+
+
+class ColumnarResults:
+    """
+    Operations on the results of a columnar results type.
+
+    The C extension decodes columnar results types directly into column
+    buffers. :meth:`from_accel` wraps its output in the results object,
+    while :meth:`from_rows` builds the same object from row tuples.
+
+    """
+
+    #: Name of the results type
+    name = ''
+
+    @staticmethod
+    def is_available() -> bool:
+        """Can the results type be created?"""
+        return False
+
+    @staticmethod
+    def from_rows(
+        desc: List[Description],
+        res: Optional[DBAPIResult],
+        single: Optional[bool] = False,
+    ) -> Optional[Result]:
+        """Convert row tuples to the results object."""
+        raise NotImplementedError
+
+    @staticmethod
+    def from_accel(columns: Any) -> Any:
+        """Convert the output of the C extension to the results object."""
+        return columns
+
+    @staticmethod
+    def num_rows(results: Any) -> int:
+        """Return the number of rows in the results object."""
+        return len(results)
+
+    @staticmethod
+    def slice(results: Any, start: int, end: Optional[int] = None) -> Any:
+        """Return a range of rows of the results object."""
+        return results[start:end]
+
+    @staticmethod
+    def row(results: Any, i: int) -> Tuple[Any, ...]:
+        """Return one row of the results object as a tuple."""
+        raise NotImplementedError
+
+    @staticmethod
+    def concat(results: List[Any]) -> Any:
+        """Join results objects of the same columns into one."""
+        raise NotImplementedError
+
+
+class NumpyResults(ColumnarResults):
+    """Dict of numpy arrays, one per column."""
+
+    name = 'numpy'
+
+    @staticmethod
+    def is_available() -> bool:
+        return has_numpy
+
+    from_rows = staticmethod(results_to_numpy)
+
+    @staticmethod
+    def num_rows(results: Any) -> int:
+        for value in results.values():
+            return len(value)
+        return 0
+
+    @staticmethod
+    def slice(results: Any, start: int, end: Optional[int] = None) -> Any:
+        return {k: v[start:end] for k, v in results.items()}
+
+    @staticmethod
+    def row(results: Any, i: int) -> Tuple[Any, ...]:
+        return tuple(v[i] for v in results.values())
+
+    @staticmethod
+    def concat(results: List[Any]) -> Any:
+        out = {}
+        for k in results[0]:
+            arrs = [x[k] for x in results]
+            if any(isinstance(x, np.ma.MaskedArray) for x in arrs):
+                out[k] = np.ma.concatenate(arrs)
+            else:
+                out[k] = np.concatenate(arrs)
+        return out
+
+
+class PandasResults(ColumnarResults):
+    """pandas DataFrame with numpy-backed columns."""
+
+    name = 'pandas'
+
+    @staticmethod
+    def is_available() -> bool:
+        return has_pandas and has_numpy
+
+    from_rows = staticmethod(results_to_pandas)
+
+    @staticmethod
+    def from_accel(columns: Any) -> Any:
+        return DataFrame(columns, copy=False)
+
+    @staticmethod
+    def slice(results: Any, start: int, end: Optional[int] = None) -> Any:
+        return results.iloc[start:end]
+
+    @staticmethod
+    def row(results: Any, i: int) -> Tuple[Any, ...]:
+        return tuple(results.iloc[i])
+
+    @staticmethod
+    def concat(results: List[Any]) -> Any:
+        import pandas as pd
+        return pd.concat(results, ignore_index=True)
+
+
+class ArrowResults(ColumnarResults):
+    """pyarrow Table."""
+
+    name = 'arrow'
+
+    @staticmethod
+    def is_available() -> bool:
+        return has_pyarrow
+
+    from_rows = staticmethod(results_to_arrow)
+
+    @staticmethod
+    def from_accel(columns: Any) -> Any:
+        return pa.table(columns)
+
+    @staticmethod
+    def slice(results: Any, start: int, end: Optional[int] = None) -> Any:
+        if end is None:
+            return results.slice(start)
+        return results.slice(start, max(end - start, 0))
+
+    @staticmethod
+    def row(results: Any, i: int) -> Tuple[Any, ...]:
+        return tuple(col[i].as_py() for col in results.columns)
+
+    @staticmethod
+    def concat(results: List[Any]) -> Any:
+        return pa.concat_tables(results)
+
+
+class PolarsResults(ColumnarResults):
+    """polars DataFrame."""
+
+    name = 'polars'
+
+    @staticmethod
+    def is_available() -> bool:
+        return has_polars
+
+    from_rows = staticmethod(results_to_polars)
+
+    @staticmethod
+    def from_accel(columns: Any) -> Any:
+        return pl.DataFrame(columns)
+
+    @staticmethod
+    def row(results: Any, i: int) -> Tuple[Any, ...]:
+        return results.row(i)
+
+    @staticmethod
+    def concat(results: List[Any]) -> Any:
+        return pl.concat(results)
+
+
 _converters: Dict[
     str, Callable[
         [List[Description], Optional[DBAPIResult], Optional[bool]],
@@ -195,7 +717,16 @@ _converters: Dict[
     'namedtuples': results_to_namedtuple,
     'dict': results_to_dict,
     'dicts': results_to_dict,
+    # Row objects are only produced by the C extension.
+    'row': results_to_tuple,
+    'rows': results_to_tuple,
+    'lazyrow': results_to_tuple,
+    'lazyrows': results_to_tuple,
     'dataframe': results_to_dataframe,
+    'numpy': results_to_numpy,
+    'pandas': results_to_pandas,
+    'arrow': results_to_arrow,
+    'polars': results_to_polars,
 }
 
 